@@ -797,23 +797,29 @@ int NativeArchive::exportRecording(QDomElement   &itemNode,
             "Created recordedmarkup element for " + title);
     }
 
-    // add the recordedseek table
+    // add the position maps, these are no longer kept in the recordedseek
+    // table but the element keeps its name
     QDomElement recordedseek = doc.createElement("recordedseek");
-    query.prepare("SELECT chanid, starttime, mark, offset, type "
-            "FROM recordedseek "
-            "WHERE chanid = :CHANID and starttime = :STARTTIME;");
-    query.bindValue(":CHANID", chanID);
-    query.bindValue(":STARTTIME", startTime);
-    if (query.exec() && query.size())
+    ProgramInfo pginfo(chanID.toUInt(), MythDate::fromString(startTime));
+    const MarkTypes seekTypes[] = {
+        MARK_GOP_START, MARK_KEYFRAME, MARK_GOP_BYFRAME, MARK_DURATION_MS };
+    for (uint i = 0; i < sizeof(seekTypes) / sizeof(MarkTypes); i++)
     {
-        while (query.next())
+        frm_pos_map_t posMap;
+        pginfo.QueryPositionMap(posMap, seekTypes[i]);
+
+        frm_pos_map_t::const_iterator it = posMap.begin();
+        for (; it != posMap.end(); ++it)
         {
             QDomElement mark = doc.createElement("mark");
-            mark.setAttribute("mark", query.value(2).toString());
-            mark.setAttribute("offset", query.value(3).toString());
-            mark.setAttribute("type", query.value(4).toString());
+            mark.setAttribute("mark", QString::number(it.key()));
+            mark.setAttribute("offset", QString::number(*it));
+            mark.setAttribute("type", (int)seekTypes[i]);
             recordedseek.appendChild(mark);
         }
+    }
+    if (recordedseek.hasChildNodes())
+    {
         root.appendChild(recordedseek);
         LOG(VB_JOBQUEUE, LOG_INFO, "Created recordedseek element for " + title);
     }
@@ -1364,26 +1370,29 @@ int NativeArchive::importRecording(const QDomElement &itemNode,
         }
         else
         {
+            QMap<int, frm_pos_map_t> posMaps;
             for (int x = 0; x < nodeList.count(); x++)
             {
                 n = nodeList.item(x);
                 QDomElement e = n.toElement();
-                query.prepare("INSERT INTO recordedseek (chanid, starttime, "
-                        "mark, offset, type)"
-                        "VALUES(:CHANID,:STARTTIME,:MARK,:OFFSET,:TYPE);");
-                query.bindValue(":CHANID", chanID);
-                query.bindValue(":STARTTIME", startTime);
-                query.bindValue(":MARK", e.attribute("mark"));
-                query.bindValue(":OFFSET", e.attribute("offset"));
-                query.bindValue(":TYPE", e.attribute("type"));
+                posMaps[e.attribute("type").toInt()]
+                    [e.attribute("mark").toULongLong()] =
+                    e.attribute("offset").toULongLong();
+            }
 
-                if (!query.exec())
-                {
-                    MythDB::DBError("recordedseek insert", query);
-                    return 1;
-                }
+            ProgramInfo pginfo(chanID, MythDate::fromString(startTime));
+            if (!pginfo.GetChanID())
+            {
+                LOG(VB_JOBQUEUE, LOG_ERR,
+                    "Couldn't load the imported recording to add its "
+                    "position maps");
+                return 1;
             }
 
+            QMap<int, frm_pos_map_t>::iterator it = posMaps.begin();
+            for (; it != posMaps.end(); ++it)
+                pginfo.SavePositionMap(*it, (MarkTypes)it.key());
+
             LOG(VB_JOBQUEUE, LOG_INFO,
                 "Inserted recordedseek details into database");
         }
@@ -191,6 +191,8 @@ bool IconView::Create(void)
             this, SLOT( UpdateText(MythUIButtonListItem*)));
     connect(m_imageList, SIGNAL(itemSelected( MythUIButtonListItem*)),
             this, SLOT( UpdateImage(MythUIButtonListItem*)));
+    connect(m_imageList, SIGNAL(itemSelected( MythUIButtonListItem*)),
+            this, SLOT( UpdateThumbPriority(MythUIButtonListItem*)));
 
     if (m_noImagesText)
     {
@@ -429,6 +431,24 @@ void IconView::UpdateImage(MythUIButtonListItem *item)
     m_selectedImage->Load();
 }
 
+/// Has the thumbnails of the items on screen made before the others.
+void IconView::UpdateThumbPriority(MythUIButtonListItem *item)
+{
+    (void) item;
+
+    if (!m_thumbGen || !m_thumbGen->isRunning())
+        return;
+
+    int first = m_imageList->GetTopItemPos();
+    int last  = min(first + (int)m_imageList->GetVisibleCount(),
+                    m_itemList.size());
+
+    QStringList visible;
+    for (int i = max(first, 0); i < last; i++)
+        visible.append(m_itemList.at(i)->GetName());
+
+    m_thumbGen->prioritise(visible);
+}
 
 bool IconView::keyPressEvent(QKeyEvent *event)
 {
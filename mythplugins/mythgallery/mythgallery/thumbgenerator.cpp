@@ -19,6 +19,9 @@
  *
  * ============================================================ */
 
+// c
+#include <cstdio>
+
 // qt
 #include <QApplication>
 #include <QImage>
@@ -27,6 +30,10 @@
 #include <QEvent>
 #include <QImageReader>
 #include <QSet>
+#include <QThread>
+#include <QCryptographicHash>
+#include <QAtomicInt>
+#include <QRunnable>
 
 // myth
 #include <mythuihelper.h>
@@ -56,10 +63,43 @@
 QEvent::Type ThumbGenEvent::kEventType =
     (QEvent::Type) QEvent::registerEventType();
 
+/// Makes the thumbnail of one file on the generator's thread pool.
+class ThumbGenTask : public QRunnable
+{
+  public:
+    ThumbGenTask(ThumbGenerator *generator, const QString &dir,
+                 const QString &file, bool isGallery, uint generation) :
+        m_generator(generator), m_dir(dir), m_file(file),
+        m_isGallery(isGallery), m_generation(generation) {}
+
+    void run(void)
+    {
+        m_generator->generateThumb(m_dir, m_file, m_isGallery, m_generation);
+        m_generator->taskDone();
+    }
+
+  private:
+    ThumbGenerator *m_generator;
+    QString         m_dir;
+    QString         m_file;
+    bool            m_isGallery;
+    uint            m_generation;
+};
+
 ThumbGenerator::ThumbGenerator(QObject *parent, int w, int h) :
     MThread("ThumbGenerator"), m_parent(parent),
-    m_isGallery(false), m_width(w), m_height(h), m_cancel(false)
+    m_isGallery(false), m_width(w), m_height(h), m_cancel(false),
+    m_generation(0), m_inFlight(0), m_maxInFlight(1),
+    m_pool("ThumbGenerator")
 {
+    int threads = QThread::idealThreadCount();
+    if (threads < 1)
+        threads = 1;
+    m_pool.setMaxThreadCount(threads);
+
+    // Only hand the pool as many files as it can work on, so that
+    // prioritise() still has the rest to reorder
+    m_maxInFlight = threads;
 }
 
 ThumbGenerator::~ThumbGenerator()
@@ -88,6 +128,20 @@ void ThumbGenerator::addFile(const QString& filePath)
     // Must remember to call start after adding all the files!
     m_mutex.lock();
     m_fileList.append(filePath);
+    m_cancel = false;
+    m_wait.wakeAll();
+    m_mutex.unlock();
+}
+
+/// Moves the given files to the front of the list, e.g. the ones on screen.
+void ThumbGenerator::prioritise(const QStringList& fileNames)
+{
+    m_mutex.lock();
+    for (int i = fileNames.size() - 1; i >= 0; i--)
+    {
+        if (m_fileList.removeOne(fileNames[i]))
+            m_fileList.prepend(fileNames[i]);
+    }
     m_mutex.unlock();
 }
 
@@ -96,6 +150,8 @@ void ThumbGenerator::cancel()
     m_mutex.lock();
     m_fileList.clear();
     m_cancel = true;
+    m_generation++;
+    m_wait.wakeAll();
     m_mutex.unlock();
 }
 
@@ -103,99 +159,154 @@ void ThumbGenerator::run()
 {
     RunProlog();
 
+    m_mutex.lock();
     m_cancel = false;
-    while (moreWork() && !m_cancel)
+    while (true)
     {
-        QString file, dir;
-        bool    isGallery;
-
-        m_mutex.lock();
-        dir       = m_directory;
-        isGallery = m_isGallery;
-        file = m_fileList.first();
-        if (!m_fileList.isEmpty())
-            m_fileList.pop_front();
-        m_mutex.unlock();
-        if (file.isEmpty())
+        if (m_cancel || m_fileList.isEmpty() || m_inFlight >= m_maxInFlight)
+        {
+            // stop once the running thumbnails are done, unless more
+            // files are added while waiting for them
+            if (m_inFlight == 0 && (m_cancel || m_fileList.isEmpty()))
+                break;
+            m_wait.wait(&m_mutex);
             continue;
+        }
 
-        QString   filePath = dir + QString("/") + file;
-        QFileInfo fileInfo(filePath);
-        if (!fileInfo.exists())
+        QString file      = m_fileList.takeFirst();
+        QString dir       = m_directory;
+        bool    isGallery = m_isGallery;
+        if (file.isEmpty())
             continue;
 
-        if (isGallery)
-        {
-            if (fileInfo.isDir())
-                isGallery = checkGalleryDir(fileInfo);
-            else
-                isGallery = checkGalleryFile(fileInfo);
-        }
+        m_inFlight++;
+        m_pool.start(new ThumbGenTask(this, dir, file, isGallery,
+                                      m_generation), "ThumbGen");
+    }
+    m_mutex.unlock();
 
-        if (!isGallery)
-        {
-            QString cachePath = QString("%1%2.jpg").arg(getThumbcacheDir(dir))
-                                                   .arg(file);
-            QFileInfo cacheInfo(cachePath);
+    RunEpilog();
+}
 
-            if (cacheInfo.exists() &&
-                cacheInfo.lastModified() >= fileInfo.lastModified())
-            {
-                continue;
-            }
-            else
-            {
-                // cached thumbnail not there or out of date
-                QImage image;
+void ThumbGenerator::taskDone(void)
+{
+    m_mutex.lock();
+    m_inFlight--;
+    m_wait.wakeAll();
+    m_mutex.unlock();
+}
 
-                // Remove the old one if it exists
-                if (cacheInfo.exists())
-                    QFile::remove(cachePath);
+void ThumbGenerator::generateThumb(const QString& dir, const QString& file,
+                                   bool isGallery, uint generation)
+{
+    QString   filePath = dir + QString("/") + file;
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.exists())
+        return;
 
-                if (fileInfo.isDir())
-                    loadDir(image, fileInfo);
-                else
-                    loadFile(image, fileInfo);
+    if (isGallery)
+    {
+        if (fileInfo.isDir())
+            isGallery = checkGalleryDir(fileInfo);
+        else
+            isGallery = checkGalleryFile(fileInfo);
+    }
 
-                if (image.isNull())
-                    continue; // give up;
+    if (isGallery)
+        return;
 
-                // if the file is a movie save the image to use as a screenshot
-                if (GalleryUtil::IsMovie(fileInfo.filePath()))
-                {
-                    QString screenshotPath = QString("%1%2-screenshot.jpg")
-                            .arg(getThumbcacheDir(dir))
-                            .arg(file);
-                    image.save(screenshotPath, "JPEG", 95);
-                }
+    QString cachePath = QString("%1%2.jpg").arg(getThumbcacheDir(dir))
+                                           .arg(file);
+    QFileInfo cacheInfo(cachePath);
+
+    if (cacheInfo.exists() &&
+        cacheInfo.lastModified() >= fileInfo.lastModified())
+    {
+        return;
+    }
+
+    // cached thumbnail not there or out of date
+    QImage image;
+
+    // Remove the old one if it exists
+    if (cacheInfo.exists())
+        QFile::remove(cachePath);
 
-                image = image.scaled(m_width,m_height,
-                                Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                image.save(cachePath, "JPEG", 95);
+    // Still images are also kept by content, so a frontend using another
+    // thumbnail directory or a copy of the image with the same modification
+    // time elsewhere can reuse them
+    bool isMovie = GalleryUtil::IsMovie(fileInfo.filePath());
+    QString sharedPath;
+    if (!fileInfo.isDir() && !isMovie)
+    {
+        QString key = getContentKey(fileInfo);
+        if (!key.isEmpty())
+            sharedPath = QString("%1%2-%3x%4.jpg").arg(getSharedCacheDir())
+                             .arg(key).arg(m_width).arg(m_height);
+    }
 
-                // deep copies all over
-                ThumbData *td = new ThumbData;
-                td->directory = dir;
-                td->fileName  = file;
-                td->thumb     = image.copy();
+    if (!sharedPath.isEmpty() && QFile::exists(sharedPath) &&
+        QFile::copy(sharedPath, cachePath))
+    {
+        image.load(cachePath);
+    }
+    else
+    {
+        if (fileInfo.isDir())
+            loadDir(image, fileInfo);
+        else
+            loadFile(image, fileInfo);
 
-                // inform parent we have thumbnail ready for it
-                QApplication::postEvent(m_parent, new ThumbGenEvent(td));
+        if (image.isNull())
+            return; // give up;
 
+        // if the file is a movie save the image to use as a screenshot
+        if (isMovie)
+        {
+            QString screenshotPath = QString("%1%2-screenshot.jpg")
+                    .arg(getThumbcacheDir(dir))
+                    .arg(file);
+            image.save(screenshotPath, "JPEG", 95);
+        }
+
+        image = image.scaled(m_width,m_height,
+                        Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        image.save(cachePath, "JPEG", 95);
+
+        // write to a temporary name first, other frontends may be reading
+        if (!sharedPath.isEmpty())
+        {
+            QString tmpPath = sharedPath + QString(".%1.tmp")
+                                  .arg((quintptr)QThread::currentThreadId());
+            QFile::remove(tmpPath);
+            if (QFile::copy(cachePath, tmpPath) &&
+                rename(tmpPath.toLocal8Bit().constData(),
+                       sharedPath.toLocal8Bit().constData()) != 0)
+            {
+                QFile::remove(tmpPath);
             }
         }
     }
 
-    RunEpilog();
-}
+    if (image.isNull())
+        return;
 
-bool ThumbGenerator::moreWork()
-{
-    bool result;
     m_mutex.lock();
-    result = !m_fileList.isEmpty();
+    bool current = (generation == m_generation);
     m_mutex.unlock();
-    return result;
+
+    // the directory has been changed since this one was started
+    if (!current)
+        return;
+
+    // deep copies all over
+    ThumbData *td = new ThumbData;
+    td->directory = dir;
+    td->fileName  = file;
+    td->thumb     = image.copy();
+
+    // inform parent we have thumbnail ready for it
+    QApplication::postEvent(m_parent, new ThumbGenEvent(td));
 }
 
 bool ThumbGenerator::checkGalleryDir(const QFileInfo& fi)
@@ -281,7 +392,8 @@ void ThumbGenerator::loadDir(QImage& image, const QFileInfo& fi)
 
 void ThumbGenerator::loadFile(QImage& image, const QFileInfo& fi)
 {
-    static int sequence = 0;
+    // thumbnails are made on several threads at once
+    static QAtomicInt sequence(0);
 
     if (GalleryUtil::IsMovie(fi.filePath()))
     {
@@ -300,7 +412,7 @@ void ThumbGenerator::loadFile(QImage& image, const QFileInfo& fi)
         if (tmpDir.exists())
         {
             QString thumbFile = QString("%1.png")
-                .arg(++sequence,8,10,QChar('0'));
+                .arg(sequence.fetchAndAddOrdered(1) + 1,8,10,QChar('0'));
 
             QString cmd = "mythpreviewgen";
             QStringList args;
@@ -371,10 +483,39 @@ void ThumbGenerator::loadFile(QImage& image, const QFileInfo& fi)
         }
 #endif
 
-        image.load(fi.absoluteFilePath());
+        // Have the decoder scale the image down as it reads it, for JPEGs
+        // libjpeg then only decodes a fraction of the DCT coefficients
+        QImageReader reader(fi.absoluteFilePath());
+        QSize size = reader.size();
+        if (size.isValid() && m_width > 0 && m_height > 0 &&
+            size.width() > m_width && size.height() > m_height)
+        {
+            size.scale(m_width, m_height, Qt::KeepAspectRatio);
+            reader.setScaledSize(size);
+        }
+        image = reader.read();
     }
 }
 
+/// Returns a name for the content of an image file, or an empty string
+/// if it can't be read. Only the start of the file is read, that holds
+/// the EXIF data and enough of the picture to tell images apart. The
+/// modification time is part of the name, so editing the file in place
+/// without changing its size or header still gives a new name.
+QString ThumbGenerator::getContentKey(const QFileInfo& fi) const
+{
+    QFile file(fi.absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return QString();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(fi.size()));
+    hash.addData(QByteArray::number(fi.lastModified().toTime_t()));
+    hash.addData(file.read(64 * 1024));
+
+    return QString(hash.result().toHex());
+}
+
 // static function
 QString ThumbGenerator::getThumbcacheDir(const QString& inDir)
 {
@@ -410,6 +551,26 @@ QString ThumbGenerator::getThumbcacheDir(const QString& inDir)
     return aPath;
 }
 
+// static function
+QString ThumbGenerator::getSharedCacheDir(void)
+{
+    // With thumbnails stored in the gallery, the cache lives there too so
+    // every frontend using the gallery shares it
+    QString galleryDir = gCoreContext->GetSetting("GalleryDir");
+    QString aPath = galleryDir + QString("/.thumbcache/.shared/");
+    QDir dir(aPath);
+
+    if (!gCoreContext->GetNumSetting("GalleryThumbnailLocation") ||
+        (!dir.exists() && !dir.mkpath(aPath)))
+    {
+        aPath = QString("%1/MythGallery/.shared/").arg(GetConfDir());
+        dir.setPath(aPath);
+        dir.mkpath(aPath);
+    }
+
+    return aPath;
+}
+
 /*
  * vim:ts=4:sw=4:ai:et:si:sts=4
  */
@@ -24,8 +24,10 @@
 
 #include <QStringList>
 #include <QImage>
+#include <QWaitCondition>
 
 #include <mthread.h>
+#include <mthreadpool.h>
 
 class QObject;
 class QImage;
@@ -49,6 +51,8 @@ class ThumbGenEvent : public QEvent
 
 class ThumbGenerator : public MThread
 {
+    friend class ThumbGenTask;
+
 public:
 
     ThumbGenerator(QObject *parent, int w, int h);
@@ -57,9 +61,11 @@ public:
     void setSize(int w, int h);
     void setDirectory(const QString& directory, bool isGallery=false);
     void addFile(const QString& fileName);
+    void prioritise(const QStringList& fileNames);
     void cancel();
 
     static QString getThumbcacheDir(const QString& inDir);
+    static QString getSharedCacheDir(void);
 
 protected:
 
@@ -67,20 +73,28 @@ protected:
     
 private:
 
-    bool moreWork();
+    void generateThumb(const QString& dir, const QString& file,
+                       bool isGallery, uint generation);
+    void taskDone(void);
     bool checkGalleryDir(const QFileInfo& fi);
     bool checkGalleryFile(const QFileInfo& fi);
     void loadDir(QImage& image, const QFileInfo& fi);
     void loadFile(QImage& image, const QFileInfo& fi);
-
-    QObject     *m_parent;
-    QString      m_directory;
-    bool         m_isGallery;
-    QStringList  m_fileList;
-    QMutex       m_mutex;
-    int          m_width;
-    int          m_height;
-    bool         m_cancel;
+    QString getContentKey(const QFileInfo& fi) const;
+
+    QObject       *m_parent;
+    QString        m_directory;
+    bool           m_isGallery;
+    QStringList    m_fileList;
+    QMutex         m_mutex;
+    QWaitCondition m_wait;
+    int            m_width;
+    int            m_height;
+    bool           m_cancel;
+    uint           m_generation; // bumped by cancel()
+    int            m_inFlight;
+    int            m_maxInFlight;
+    MThreadPool    m_pool;
 };
 
 #endif /* THUMBGENERATOR_H */
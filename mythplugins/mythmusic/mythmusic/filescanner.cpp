@@ -4,6 +4,10 @@
 // Qt headers
 #include <QApplication>
 #include <QDir>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QRunnable>
+#include <QThread>
 
 // MythTV headers
 #include <mythdate.h>
@@ -12,6 +16,8 @@
 #include <mythdialogs.h>
 #include <mythscreenstack.h>
 #include <mythprogressdialog.h>
+#include <mthreadpool.h>
+#include <mythtimer.h>
 
 // MythMusic headers
 #include "decoder.h"
@@ -19,6 +25,96 @@
 #include "metadata.h"
 #include "metaio.h"
 
+/// Number of songs written or removed per query
+static const int kWriteBatch = 100;
+/// Number of files between throughput reports in the log
+static const int kReportInterval = 1000;
+
+/// Tags read from one file by a MetadataReadTask.
+typedef struct
+{
+    QString       filename;
+    bool          update;
+    Metadata     *metadata;
+    AlbumArtList  artList;
+} MetadataReadResult;
+
+/// Hands the results of the tag reading threads to the scanner.
+class MetadataReadQueue
+{
+  public:
+    void Add(const MetadataReadResult &result)
+    {
+        QMutexLocker locker(&m_lock);
+        m_results.push_back(result);
+        m_wait.wakeAll();
+    }
+
+    bool Take(MetadataReadResult &result, unsigned long timeout_ms)
+    {
+        QMutexLocker locker(&m_lock);
+        if (m_results.isEmpty())
+            m_wait.wait(&m_lock, timeout_ms);
+        if (m_results.isEmpty())
+            return false;
+        result = m_results.takeFirst();
+        return true;
+    }
+
+  private:
+    QMutex                    m_lock;
+    QWaitCondition            m_wait;
+    QList<MetadataReadResult> m_results;
+};
+
+/*!
+ * \brief Reads the tags, and for new files any embedded images, from one
+ *        file on a thread pool thread.
+ *
+ *        Each task makes its own Decoder and MetaIO, the taggers shared
+ *        through Metadata::getTagger() keep the open file in them.
+ */
+class MetadataReadTask : public QRunnable
+{
+  public:
+    MetadataReadTask(const QString &filename, bool update,
+                     MetadataReadQueue *queue) :
+        m_filename(filename), m_update(update), m_queue(queue) {}
+
+    void run(void)
+    {
+        MetadataReadResult result;
+        result.filename = m_filename;
+        result.update   = m_update;
+        result.metadata = NULL;
+
+        Decoder *decoder = Decoder::create(m_filename, NULL, NULL, true);
+        if (decoder)
+        {
+            LOG(VB_FILE, LOG_INFO,
+                QString("Reading metadata from %1").arg(m_filename));
+            result.metadata = decoder->readMetadata();
+
+            if (result.metadata && !m_update)
+            {
+                MetaIO *tagger = decoder->doCreateTagger();
+                if (tagger && tagger->supportsEmbeddedImages())
+                    result.artList = tagger->getAlbumArtList(m_filename);
+                delete tagger;
+            }
+
+            delete decoder;
+        }
+
+        m_queue->Add(result);
+    }
+
+  private:
+    QString            m_filename;
+    bool               m_update;
+    MetadataReadQueue *m_queue;
+};
+
 FileScanner::FileScanner() : m_decoder(NULL)
 {
     MSqlQuery query(MSqlQuery::InitCon());
@@ -143,6 +239,7 @@ void FileScanner::BuildFileList(QString &directory, MusicLoadedMap &music_files,
             }
 
             music_files[filename] = FileScanner::kFileSystem;
+            m_filestats[filename] = qMakePair(fi->size(), fi->lastModified());
         }
     }
 }
@@ -198,16 +295,34 @@ int FileScanner::GetDirectoryId(const QString &directory, const int &parentid)
  *
  * \param filename File to examine
  * \param date_modified Date to use in comparison
+ * \param size Size of the file when it was last read, or 0 if not known
  *
  * \returns True if file has been modified, otherwise false
  */
 bool FileScanner::HasFileChanged(
-    const QString &filename, const QString &date_modified)
+    const QString &filename, const QString &date_modified, qint64 size)
 {
-    QFileInfo fi(filename);
-    QDateTime dt = fi.lastModified();
+    // BuildFileList() has already been to the file system for these
+    QDateTime dt;
+    qint64 cur_size;
+    FileStatMap::const_iterator it = m_filestats.find(filename);
+    if (it != m_filestats.end())
+    {
+        cur_size = (*it).first;
+        dt = (*it).second;
+    }
+    else
+    {
+        QFileInfo fi(filename);
+        cur_size = fi.size();
+        dt = fi.lastModified();
+    }
+
     if (dt.isValid())
     {
+        if (size > 0 && size != cur_size)
+            return true;
+
         QDateTime old_dt = MythDate::fromString(date_modified);
         return !old_dt.isValid() || (dt > old_dt);
     }
@@ -220,107 +335,122 @@ bool FileScanner::HasFileChanged(
 }
 
 /*!
- * \brief Insert file details into database.
- *        If it is an audio file, read the metadata and insert
- *        that information at the same time.
- *
- *        If it is an image file, just insert the filename and
- *        type.
+ * \brief Check if a file is album art, according to the AlbumArtFilter
+ *        setting.
+ */
+bool FileScanner::IsArtwork(const QString &filename) const
+{
+    QString extension = filename.section( '.', -1 ) ;
+    return m_artFilter.indexOf(extension.toLower()) > -1;
+}
+
+/*!
+ * \brief Insert the filename and type of an album art image into
+ *        the database.
  *
  * \param filename Full path to file.
  *
  * \returns Nothing.
  */
-void FileScanner::AddFileToDB(const QString &filename)
+void FileScanner::AddArtworkToDB(const QString &filename)
 {
-    QString extension = filename.section( '.', -1 ) ;
     QString directory = filename;
     directory.remove(0, m_startdir.length());
     directory = directory.section( '/', 0, -2);
 
-    QString nameFilter = gCoreContext->GetSetting("AlbumArtFilter", "*.png;*.jpg;*.jpeg;*.gif;*.bmp");
+    QString name = filename.section( '/', -1);
 
-    // If this file is an image, insert the details into the music_albumart table
-    if (nameFilter.indexOf(extension.toLower()) > -1)
+    MSqlQuery query(MSqlQuery::InitCon());
+    query.prepare("INSERT INTO music_albumart SET filename = :FILE, "
+                  "directory_id = :DIRID, imagetype = :TYPE;");
+    query.bindValue(":FILE", name);
+    query.bindValue(":DIRID", m_directoryid[directory]);
+    query.bindValue(":TYPE", AlbumArtImages::guessImageType(name));
+
+    if (!query.exec() || query.numRowsAffected() <= 0)
     {
-        QString name = filename.section( '/', -1);
+        MythDB::DBError("music insert artwork", query);
+    }
+}
 
-        MSqlQuery query(MSqlQuery::InitCon());
-        query.prepare("INSERT INTO music_albumart SET filename = :FILE, "
-                      "directory_id = :DIRID, imagetype = :TYPE;");
-        query.bindValue(":FILE", name);
-        query.bindValue(":DIRID", m_directoryid[directory]);
-        query.bindValue(":TYPE", AlbumArtImages::guessImageType(name));
+/*!
+ * \brief Queue the details of an audio file for insertion into the
+ *        database, see FlushFilesToDB().
+ *
+ * \param filename Full path to file.
+ * \param data The metadata read from the file, the scanner takes it over.
+ * \param artList The images embedded in the file.
+ *
+ * \returns Nothing.
+ */
+void FileScanner::AddFileToDB(const QString &filename, Metadata *data,
+                              AlbumArtList &artList)
+{
+    QString directory = filename;
+    directory.remove(0, m_startdir.length());
+    directory = directory.section( '/', 0, -2);
 
-        if (!query.exec() || query.numRowsAffected() <= 0)
-        {
-            MythDB::DBError("music insert artwork", query);
-        }
-        return;
-    }
+    data->setFileSize((quint64)m_filestats.value(filename).first);
 
-    Decoder *decoder = Decoder::create(filename, NULL, NULL, true);
+    QString album_cache_string;
 
-    if (decoder)
-    {
-        LOG(VB_FILE, LOG_INFO,
-            QString("Reading metadata from %1").arg(filename));
-        Metadata *data = decoder->readMetadata();
-        data->setFileSize((quint64)QFileInfo(filename).size());
-        if (data)
-        {
-            QString album_cache_string;
+    // Set values from cache
+    int did = m_directoryid[directory];
+    if (did > 0)
+        data->setDirectoryId(did);
 
-            // Set values from cache
-            int did = m_directoryid[directory];
-            if (did > 0)
-                data->setDirectoryId(did);
+    int aid = m_artistid[data->Artist().toLower()];
+    if (aid > 0)
+    {
+        data->setArtistId(aid);
 
-            int aid = m_artistid[data->Artist().toLower()];
-            if (aid > 0)
-            {
-                data->setArtistId(aid);
+        // The album cache depends on the artist id
+        album_cache_string = data->getArtistId() + "#"
+            + data->Album().toLower();
 
-                // The album cache depends on the artist id
-                album_cache_string = data->getArtistId() + "#"
-                    + data->Album().toLower();
+        if (m_albumid[album_cache_string] > 0)
+            data->setAlbumId(m_albumid[album_cache_string]);
+    }
 
-                if (m_albumid[album_cache_string] > 0)
-                    data->setAlbumId(m_albumid[album_cache_string]);
-            }
+    int gid = m_genreid[data->Genre().toLower()];
+    if (gid > 0)
+        data->setGenreId(gid);
 
-            int gid = m_genreid[data->Genre().toLower()];
-            if (gid > 0)
-                data->setGenreId(gid);
+    // Look up the ids now, so the cache serves the following files
+    data->dumpIdsToDatabase();
 
-            // Commit track info to database
-            data->dumpToDatabase();
+    // Update the cache
+    m_artistid[data->Artist().toLower()] =
+        data->getArtistId();
 
-            // Update the cache
-            m_artistid[data->Artist().toLower()] =
-                data->getArtistId();
+    m_genreid[data->Genre().toLower()] =
+        data->getGenreId();
 
-            m_genreid[data->Genre().toLower()] =
-                data->getGenreId();
+    album_cache_string = data->getArtistId() + "#"
+        + data->Album().toLower();
+    m_albumid[album_cache_string] = data->getAlbumId();
 
-            album_cache_string = data->getArtistId() + "#"
-                + data->Album().toLower();
-            m_albumid[album_cache_string] = data->getAlbumId();
+    // keep any images embedded in the tag, they are saved with the track
+    if (!artList.isEmpty())
+        data->setEmbeddedAlbumArt(artList);
 
-            // read any embedded images from the tag
-            MetaIO *tagger = data->getTagger();
-            if (tagger && tagger->supportsEmbeddedImages())
-            {
-                AlbumArtList artList = tagger->getAlbumArtList(data->Filename());
-                data->setEmbeddedAlbumArt(artList);
-                data->getAlbumArtImages()->dumpToDatabase();
-            }
+    m_pendingTracks.push_back(data);
+    if (m_pendingTracks.size() >= kWriteBatch)
+        FlushFilesToDB();
+}
 
-            delete data;
-        }
+/*!
+ * \brief Write the tracks queued by AddFileToDB() and UpdateFileInDB()
+ *        to the database.
+ *
+ * \returns Nothing.
+ */
+void FileScanner::FlushFilesToDB(void)
+{
+    Metadata::dumpListToDatabase(m_pendingTracks);
 
-        delete decoder;
-    }
+    while (!m_pendingTracks.isEmpty())
+        delete m_pendingTracks.takeFirst();
 }
 
 /*!
@@ -428,27 +558,31 @@ void FileScanner::cleanDB()
 }
 
 /*!
- * \brief Removes a file from the database.
+ * \brief Removes files from the database.
  *
- * \param filename Full path to file.
+ * \param filenames Full paths to the files.
  *
  * \returns Nothing.
  */
-void FileScanner::RemoveFileFromDB (const QString &filename)
+void FileScanner::RemoveFilesFromDB(const QStringList &filenames)
 {
-    QString sqlfilename(filename);
-    sqlfilename.remove(0, m_startdir.length());
-    // We know that the filename will not contain :// as the SQL limits this
-    QString directory = sqlfilename.section( '/', 0, -2 ) ;
-    sqlfilename = sqlfilename.section( '/', -1 ) ;
+    QStringList songs;
 
-    QString extension = sqlfilename.section( '.', -1 ) ;
+    QStringList::const_iterator it = filenames.begin();
+    for (; it != filenames.end(); ++it)
+    {
+        QString sqlfilename(*it);
+        sqlfilename.remove(0, m_startdir.length());
+        // We know that the filename will not contain :// as the SQL limits this
+        QString directory = sqlfilename.section( '/', 0, -2 ) ;
+        sqlfilename = sqlfilename.section( '/', -1 ) ;
 
-    QString nameFilter = gCoreContext->GetSetting("AlbumArtFilter",
-                                              "*.png;*.jpg;*.jpeg;*.gif;*.bmp");
+        if (!IsArtwork(sqlfilename))
+        {
+            songs.append(sqlfilename);
+            continue;
+        }
 
-    if (nameFilter.indexOf(extension) > -1)
-    {
         MSqlQuery query(MSqlQuery::InitCon());
         query.prepare("DELETE FROM music_albumart WHERE filename= :FILE AND "
                       "directory_id= :DIRID;");
@@ -459,101 +593,185 @@ void FileScanner::RemoveFileFromDB (const QString &filename)
         {
             MythDB::DBError("music delete artwork", query);
         }
-        return;
     }
 
+    // Delete the songs with one query per batch rather than one per file
     MSqlQuery query(MSqlQuery::InitCon());
-    query.prepare("DELETE FROM music_songs WHERE filename = :NAME ;");
-    query.bindValue(":NAME", sqlfilename);
-    if (!query.exec())
-        MythDB::DBError("FileScanner::RemoveFileFromDB - deleting music_songs",
-                        query);
+    for (int first = 0; first < songs.size(); first += kWriteBatch)
+    {
+        QStringList names = songs.mid(first, kWriteBatch);
+        QStringList holders;
+        for (int i = 0; i < names.size(); i++)
+            holders.append(QString(":NAME%1").arg(i));
+
+        query.prepare(QString("DELETE FROM music_songs WHERE filename IN (%1);")
+                      .arg(holders.join(",")), false);
+        for (int i = 0; i < names.size(); i++)
+            query.bindValue(holders[i], names[i]);
+
+        if (!query.exec())
+            MythDB::DBError("FileScanner::RemoveFilesFromDB - "
+                            "deleting music_songs", query);
+    }
 }
 
 /*!
- * \brief Updates a file in the database.
+ * \brief Queue an update of a file in the database, see FlushFilesToDB().
  *
  * \param filename Full path to file.
+ * \param disk_meta The metadata read from the file, the scanner takes it
+ *                  over.
  *
  * \returns Nothing.
  */
-void FileScanner::UpdateFileInDB(const QString &filename)
+void FileScanner::UpdateFileInDB(const QString &filename, Metadata *disk_meta)
 {
     QString directory = filename;
     directory.remove(0, m_startdir.length());
     directory = directory.section( '/', 0, -2);
 
-    Decoder *decoder = Decoder::create(filename, NULL, NULL, true);
+    Metadata db_meta(filename);
+    if (!db_meta.isInDatabase() || db_meta.ID() <= 0)
+    {
+        LOG(VB_GENERAL, LOG_ERR, QString("Asked to update track with "
+                                         "invalid ID - %1")
+                                        .arg(db_meta.ID()));
+        delete disk_meta;
+        return;
+    }
+
+    disk_meta->setID(db_meta.ID());
+    disk_meta->setRating(db_meta.Rating());
+    if (db_meta.PlayCount() > disk_meta->PlayCount())
+        disk_meta->setPlaycount(db_meta.Playcount());
+
+    QString album_cache_string;
 
-    if (decoder)
+    // Set values from cache
+    int did = m_directoryid[directory];
+    if (did > 0)
+        disk_meta->setDirectoryId(did);
+
+    int aid = m_artistid[disk_meta->Artist().toLower()];
+    if (aid > 0)
     {
-        Metadata *db_meta   = decoder->getMetadata();
-        Metadata *disk_meta = decoder->readMetadata();
+        disk_meta->setArtistId(aid);
 
-        if (db_meta && disk_meta)
-        {
-            if (db_meta->ID() <= 0)
-            {
-                LOG(VB_GENERAL, LOG_ERR, QString("Asked to update track with "
-                                                 "invalid ID - %1")
-                                                .arg(db_meta->ID()));
-                delete disk_meta;
-                delete db_meta;
-                return;
-            }
-            
-            disk_meta->setID(db_meta->ID());
-            disk_meta->setRating(db_meta->Rating());
-            if (db_meta->PlayCount() > disk_meta->PlayCount())
-                disk_meta->setPlaycount(db_meta->Playcount());
+        // The album cache depends on the artist id
+        album_cache_string = disk_meta->getArtistId() + "#" +
+            disk_meta->Album().toLower();
 
-            QString album_cache_string;
+        if (m_albumid[album_cache_string] > 0)
+            disk_meta->setAlbumId(m_albumid[album_cache_string]);
+    }
 
-            // Set values from cache
-            int did = m_directoryid[directory];
-            if (did > 0)
-                disk_meta->setDirectoryId(did);
+    int gid = m_genreid[disk_meta->Genre().toLower()];
+    if (gid > 0)
+        disk_meta->setGenreId(gid);
 
-            int aid = m_artistid[disk_meta->Artist().toLower()];
-            if (aid > 0)
-            {
-                disk_meta->setArtistId(aid);
+    disk_meta->setFileSize((quint64)m_filestats.value(filename).first);
 
-                // The album cache depends on the artist id
-                album_cache_string = disk_meta->getArtistId() + "#" +
-                    disk_meta->Album().toLower();
+    // Look up the ids now, so the cache serves the following files
+    disk_meta->dumpIdsToDatabase();
 
-                if (m_albumid[album_cache_string] > 0)
-                    disk_meta->setAlbumId(m_albumid[album_cache_string]);
-            }
+    // Update the cache
+    m_artistid[disk_meta->Artist().toLower()]
+        = disk_meta->getArtistId();
+    m_genreid[disk_meta->Genre().toLower()]
+        = disk_meta->getGenreId();
+    album_cache_string = disk_meta->getArtistId() + "#" +
+        disk_meta->Album().toLower();
+    m_albumid[album_cache_string] = disk_meta->getAlbumId();
+
+    m_pendingTracks.push_back(disk_meta);
+    if (m_pendingTracks.size() >= kWriteBatch)
+        FlushFilesToDB();
+}
+
+/*!
+ * \brief Reads the tags of new and changed files on a pool of threads,
+ *        and writes them to the database as they come in.
+ *
+ * \param add_files Full paths of the files to add.
+ * \param update_files Full paths of the files to update.
+ * \param progress Progress dialog to update, or NULL.
+ * \param counter Number of files done so far, for the progress dialog.
+ *
+ * \returns Nothing.
+ */
+void FileScanner::ReadFiles(const QStringList &add_files,
+                            const QStringList &update_files,
+                            MythUIProgressDialog *progress, uint &counter)
+{
+    int total = add_files.size() + update_files.size();
+    if (total == 0)
+        return;
+
+    // Reading tags mostly waits on the disk, so use more threads than cores
+    int threads = qMax(QThread::idealThreadCount(), 1) * 2;
+    MThreadPool pool("MusicFileScanner");
+    pool.setMaxThreadCount(threads);
 
-            int gid = m_genreid[disk_meta->Genre().toLower()];
-            if (gid > 0)
-                disk_meta->setGenreId(gid);
-
-            disk_meta->setFileSize((quint64)QFileInfo(filename).size());
-            
-            // Commit track info to database
-            disk_meta->dumpToDatabase();
-
-            // Update the cache
-            m_artistid[disk_meta->Artist().toLower()]
-                = disk_meta->getArtistId();
-            m_genreid[disk_meta->Genre().toLower()]
-                = disk_meta->getGenreId();
-            album_cache_string = disk_meta->getArtistId() + "#" +
-                disk_meta->Album().toLower();
-            m_albumid[album_cache_string] = disk_meta->getAlbumId();
+    // Make sure the decoder factories are registered before the threads
+    // go looking for them
+    Decoder::all();
+
+    // Only keep a few files per thread in flight, the results hold images
+    int max_in_flight = threads * 4;
+
+    MetadataReadQueue queue;
+    MythTimer timer;
+    timer.start();
+
+    int submitted = 0, done = 0;
+    while (done < total)
+    {
+        while (submitted < total && submitted - done < max_in_flight)
+        {
+            bool update = submitted >= add_files.size();
+            QString filename = update ?
+                update_files[submitted - add_files.size()] :
+                add_files[submitted];
+            pool.start(new MetadataReadTask(filename, update, &queue),
+                       "MusicFileRead");
+            submitted++;
+        }
+
+        MetadataReadResult result;
+        if (!queue.Take(result, 100))
+        {
+            qApp->processEvents();
+            continue;
         }
+        done++;
 
-        if (disk_meta)
-            delete disk_meta;
+        if (result.metadata)
+        {
+            if (result.update)
+                UpdateFileInDB(result.filename, result.metadata);
+            else
+                AddFileToDB(result.filename, result.metadata, result.artList);
+        }
 
-        if (db_meta)
-            delete db_meta;
+        if (done % kReportInterval == 0 || done == total)
+        {
+            int elapsed = qMax(timer.elapsed(), 1);
+            LOG(VB_GENERAL, LOG_INFO,
+                QString("Music scan: read %1 of %2 files in %3 s, "
+                        "%4 files/s, using %5 threads")
+                    .arg(done).arg(total).arg(elapsed / 1000)
+                    .arg(done * 1000.0 / elapsed, 0, 'f', 1).arg(threads));
+        }
 
-        delete decoder;
+        if (progress)
+        {
+            progress->SetProgress(++counter);
+            qApp->processEvents();
+        }
     }
+
+    pool.waitForDone();
+    FlushFilesToDB();
 }
 
 /*!
@@ -569,6 +787,9 @@ void FileScanner::SearchDir(QString &directory)
 {
 
     m_startdir = directory;
+    m_artFilter = gCoreContext->GetSetting("AlbumArtFilter",
+                                           "*.png;*.jpg;*.jpeg;*.gif;*.bmp");
+    m_filestats.clear();
 
     MusicLoadedMap music_files;
     MusicLoadedMap::Iterator iter;
@@ -609,35 +830,46 @@ void FileScanner::SearchDir(QString &directory)
         file_checking = NULL;
     }
 
-     /*
-       This can be optimised quite a bit by consolidating all commands
-       via a lot of refactoring.
-
-       1) group all files of the same decoder type, and don't
-       create/delete a Decoder pr. AddFileToDB. Or make Decoders be
-       singletons, it should be a fairly simple change.
-
-       2) RemoveFileFromDB should group the remove into one big SQL.
-
-       3) UpdateFileInDB, same as 1.
-     */
+    QStringList add_files, update_files, remove_files;
 
     uint counter = 0;
     for (iter = music_files.begin(); iter != music_files.end(); iter++)
     {
         if (*iter == FileScanner::kFileSystem)
-            AddFileToDB(iter.key());
+        {
+            // Images are only named in the database, they aren't read
+            if (IsArtwork(iter.key()))
+            {
+                AddArtworkToDB(iter.key());
+                if (file_checking)
+                    file_checking->SetProgress(++counter);
+                continue;
+            }
+            add_files.append(iter.key());
+        }
         else if (*iter == FileScanner::kDatabase)
-            RemoveFileFromDB(iter.key ());
+            remove_files.append(iter.key());
         else if (*iter == FileScanner::kNeedUpdate)
-            UpdateFileInDB(iter.key());
-
-        if (file_checking)
-        {
+            update_files.append(iter.key());
+        else if (file_checking)
             file_checking->SetProgress(++counter);
-            qApp->processEvents();
-        }
     }
+
+    LOG(VB_GENERAL, LOG_INFO,
+        QString("Music scan: %1 files to add, %2 to update, %3 to remove")
+            .arg(add_files.size()).arg(update_files.size())
+            .arg(remove_files.size()));
+
+    RemoveFilesFromDB(remove_files);
+    counter += remove_files.size();
+    if (file_checking)
+    {
+        file_checking->SetProgress(counter);
+        qApp->processEvents();
+    }
+
+    ReadFiles(add_files, update_files, file_checking, counter);
+
     if (file_checking)
         file_checking->Close();
 
@@ -657,7 +889,8 @@ void FileScanner::ScanMusic(MusicLoadedMap &music_files)
     MusicLoadedMap::Iterator iter;
 
     MSqlQuery query(MSqlQuery::InitCon());
-    if (!query.exec("SELECT CONCAT_WS('/', path, filename), date_modified "
+    if (!query.exec("SELECT CONCAT_WS('/', path, filename), date_modified, "
+                    "size "
                     "FROM music_songs LEFT JOIN music_directories ON "
                     "music_songs.directory_id=music_directories.directory_id "
                     "WHERE filename NOT LIKE ('%://%')"))
@@ -704,7 +937,8 @@ void FileScanner::ScanMusic(MusicLoadedMap &music_files)
                         }
                         continue;
                     }
-                    else if (HasFileChanged(name, query.value(1).toString()))
+                    else if (HasFileChanged(name, query.value(1).toString(),
+                                            query.value(2).toLongLong()))
                         music_files[name] = FileScanner::kNeedUpdate;
                     else
                         music_files.erase(iter);
@@ -1,8 +1,13 @@
 #ifndef _FILESCANNER_H_
 #define _FILESCANNER_H_
 
-class Metadata;
+#include <QStringList>
+#include <QPair>
+
+#include "metadata.h"
+
 class Decoder;
+class MythUIProgressDialog;
 
 typedef QMap<QString, int> IdCache;
 
@@ -17,6 +22,9 @@ class FileScanner
     };
 
     typedef QMap <QString, MusicFileLocation> MusicLoadedMap;
+    // size and modification time of the files found by BuildFileList()
+    typedef QMap <QString, QPair<qint64, QDateTime> > FileStatMap;
+
     public:
         FileScanner ();
         ~FileScanner ();
@@ -26,19 +34,31 @@ class FileScanner
     private:
         void BuildFileList(QString &directory, MusicLoadedMap &music_files, int parentid);
         int  GetDirectoryId(const QString &directory, const int &parentid);
-        bool HasFileChanged(const QString &filename, const QString &date_modified);
-        void AddFileToDB(const QString &filename);
-        void RemoveFileFromDB (const QString &filename);
-        void UpdateFileInDB(const QString &filename);
+        bool HasFileChanged(const QString &filename, const QString &date_modified,
+                            qint64 size);
+        bool IsArtwork(const QString &filename) const;
+        void AddArtworkToDB(const QString &filename);
+        void AddFileToDB(const QString &filename, Metadata *data,
+                         AlbumArtList &artList);
+        void RemoveFilesFromDB(const QStringList &filenames);
+        void UpdateFileInDB(const QString &filename, Metadata *disk_meta);
+        void FlushFilesToDB(void);
+        void ReadFiles(const QStringList &add_files,
+                       const QStringList &update_files,
+                       MythUIProgressDialog *progress, uint &counter);
         void ScanMusic(MusicLoadedMap &music_files);
         void ScanArtwork(MusicLoadedMap &music_files);
         void cleanDB();
 
         QString  m_startdir;
+        QString  m_artFilter;
         IdCache  m_directoryid;
         IdCache  m_artistid;
         IdCache  m_genreid;
         IdCache  m_albumid;
+        FileStatMap m_filestats;
+        // tracks read but not yet written, see FlushFilesToDB()
+        MetadataPtrList m_pendingTracks;
 
         Decoder *m_decoder;
 };
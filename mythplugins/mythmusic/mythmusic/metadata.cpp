@@ -268,10 +268,11 @@ bool Metadata::isInDatabase()
     return retval;
 }
 
-void Metadata::dumpToDatabase()
+/// Finds the directory, artist, album and genre of the track in the
+/// database, adding the ones that are missing, and sets their ids.
+bool Metadata::dumpIdsToDatabase(void)
 {
     QString sqldir = m_filename.section('/', 0, -2);
-    QString sqlfilename = m_filename.section('/', -1);
 
     checkEmptyFields();
 
@@ -291,7 +292,7 @@ void Metadata::dumpToDatabase()
         if (!query.exec() || !query.isActive())
         {
             MythDB::DBError("music select directory id", query);
-            return;
+            return false;
         }
         if (query.next())
         {
@@ -305,7 +306,7 @@ void Metadata::dumpToDatabase()
             if (!query.exec() || !query.isActive() || query.numRowsAffected() <= 0)
             {
                 MythDB::DBError("music insert directory", query);
-                return;
+                return false;
             }
             m_directoryid = query.lastInsertId().toInt();
         }
@@ -321,7 +322,7 @@ void Metadata::dumpToDatabase()
         if (!query.exec() || !query.isActive())
         {
             MythDB::DBError("music select artist id", query);
-            return;
+            return false;
         }
         if (query.next())
         {
@@ -335,7 +336,7 @@ void Metadata::dumpToDatabase()
             if (!query.exec() || !query.isActive() || query.numRowsAffected() <= 0)
             {
                 MythDB::DBError("music insert artist", query);
-                return;
+                return false;
             }
             m_artistid = query.lastInsertId().toInt();
         }
@@ -354,7 +355,7 @@ void Metadata::dumpToDatabase()
         if (!query.exec() || !query.isActive())
         {
             MythDB::DBError("music select compilation artist id", query);
-            return;
+            return false;
         }
         if (query.next())
         {
@@ -368,7 +369,7 @@ void Metadata::dumpToDatabase()
             if (!query.exec() || !query.isActive() || query.numRowsAffected() <= 0)
             {
                 MythDB::DBError("music insert compilation artist", query);
-                return;
+                return false;
             }
             m_compartistid = query.lastInsertId().toInt();
         }
@@ -385,7 +386,7 @@ void Metadata::dumpToDatabase()
         if (!query.exec() || !query.isActive())
         {
             MythDB::DBError("music select album id", query);
-            return;
+            return false;
         }
         if (query.next())
         {
@@ -402,7 +403,7 @@ void Metadata::dumpToDatabase()
             if (!query.exec() || !query.isActive() || query.numRowsAffected() <= 0)
             {
                 MythDB::DBError("music insert album", query);
-                return;
+                return false;
             }
             m_albumid = query.lastInsertId().toInt();
         }
@@ -417,7 +418,7 @@ void Metadata::dumpToDatabase()
         if (!query.exec() || !query.isActive())
         {
             MythDB::DBError("music select genre id", query);
-            return;
+            return false;
         }
         if (query.next())
         {
@@ -431,12 +432,24 @@ void Metadata::dumpToDatabase()
             if (!query.exec() || !query.isActive() || query.numRowsAffected() <= 0)
             {
                 MythDB::DBError("music insert genre", query);
-                return;
+                return false;
             }
             m_genreid = query.lastInsertId().toInt();
         }
     }
 
+    return true;
+}
+
+void Metadata::dumpToDatabase()
+{
+    if (!dumpIdsToDatabase())
+        return;
+
+    QString sqlfilename = m_filename.section('/', -1);
+
+    MSqlQuery query(MSqlQuery::InitCon());
+
     // We have all the id's now. We can insert it.
     QString strQuery;
     if (m_id < 1)
@@ -523,6 +536,141 @@ void Metadata::dumpToDatabase()
     }
 }
 
+/** \brief Writes the tracks like dumpToDatabase(), but with one multi-row
+ *         statement per kRowsPerStatement tracks for music_songs.
+ *
+ *  New tracks are inserted and known ones updated by the same statement,
+ *  the ids of new tracks are only looked up when they have album art.
+ */
+void Metadata::dumpListToDatabase(const QList<Metadata*> &tracks)
+{
+    static const int kRowsPerStatement = 100;
+
+    QList<Metadata*> ready;
+    for (int i = 0; i < tracks.size(); i++)
+    {
+        Metadata *track = tracks[i];
+        if ((track->m_directoryid >= 0 && track->m_artistid >= 0 &&
+             track->m_compartistid >= 0 && track->m_albumid >= 0 &&
+             track->m_genreid >= 0) || track->dumpIdsToDatabase())
+        {
+            ready.push_back(track);
+        }
+    }
+
+    MSqlQuery query(MSqlQuery::InitCon());
+    QDateTime now = MythDate::current();
+
+    for (int first = 0; first < ready.size(); first += kRowsPerStatement)
+    {
+        int last = min(ready.size(), first + kRowsPerStatement);
+
+        QString sql =
+            "INSERT INTO music_songs ( song_id,  directory_id,"
+            " artist_id, album_id,    name,         genre_id,"
+            " year,      track,       length,       filename,"
+            " rating,    format,      date_entered, date_modified,"
+            " numplays,  track_count, size) VALUES ";
+        MSqlBindings bindings;
+        for (int i = first; i < last; ++i)
+        {
+            const Metadata *track = ready[i];
+            QVariantList values;
+            values << ((track->m_id < 1) ? QVariant(QVariant::UInt) :
+                       QVariant(track->m_id))
+                   << track->m_directoryid
+                   << track->m_artistid << track->m_albumid
+                   << track->m_title << track->m_genreid
+                   << track->m_year << track->m_tracknum
+                   << track->m_length
+                   << track->m_filename.section('/', -1)
+                   << track->m_rating << track->m_format
+                   << now << now
+                   << track->m_playcount << track->m_trackCount
+                   << (quint64)track->m_fileSize;
+
+            QStringList holders;
+            for (int j = 0; j < values.size(); ++j)
+            {
+                QString holder = QString(":R%1C%2").arg(i - first).arg(j);
+                holders.push_back(holder);
+                bindings[holder] = values[j];
+            }
+            sql += QString((i == first) ? "(" : ", (") +
+                holders.join(",") + ")";
+        }
+
+        // date_entered is kept, like the UPDATE in dumpToDatabase()
+        sql += " ON DUPLICATE KEY UPDATE"
+               " directory_id = VALUES(directory_id)"
+               ", artist_id = VALUES(artist_id)"
+               ", album_id = VALUES(album_id)"
+               ", name = VALUES(name)"
+               ", genre_id = VALUES(genre_id)"
+               ", year = VALUES(year)"
+               ", track = VALUES(track)"
+               ", length = VALUES(length)"
+               ", filename = VALUES(filename)"
+               ", rating = VALUES(rating)"
+               ", format = VALUES(format)"
+               ", date_modified = VALUES(date_modified)"
+               ", numplays = VALUES(numplays)"
+               ", track_count = VALUES(track_count)"
+               ", size = VALUES(size)";
+
+        query.prepare(sql, false);
+        query.bindValues(bindings);
+
+        if (!query.exec())
+            MythDB::DBError("Metadata::dumpListToDatabase - "
+                            "updating music_songs", query);
+    }
+
+    // make sure the compilation flags are updated, once per album
+    QMap<int, const Metadata*> albums;
+    for (int i = 0; i < ready.size(); i++)
+        albums[ready[i]->m_albumid] = ready[i];
+
+    QMap<int, const Metadata*>::const_iterator it = albums.begin();
+    for (; it != albums.end(); ++it)
+    {
+        query.prepare("UPDATE music_albums SET compilation = :COMPILATION, year = :YEAR "
+                      "WHERE music_albums.album_id = :ALBUMID");
+        query.bindValue(":ALBUMID", it.key());
+        query.bindValue(":COMPILATION", (*it)->m_compilation);
+        query.bindValue(":YEAR", (*it)->m_year);
+
+        if (!query.exec() || !query.isActive())
+            MythDB::DBError("music compilation update", query);
+    }
+
+    // save the albumart to the db, it needs the song id
+    for (int i = 0; i < ready.size(); i++)
+    {
+        Metadata *track = ready[i];
+        if (!track->m_albumArt)
+            continue;
+
+        if (track->m_id < 1)
+        {
+            query.prepare("SELECT song_id FROM music_songs "
+                          "WHERE directory_id = :DIRECTORY "
+                          " AND filename = :FILENAME");
+            query.bindValue(":DIRECTORY", track->m_directoryid);
+            query.bindValue(":FILENAME", track->m_filename.section('/', -1));
+
+            if (!query.exec() || !query.next())
+            {
+                MythDB::DBError("music select song id", query);
+                continue;
+            }
+            track->m_id = query.value(0).toUInt();
+        }
+
+        track->m_albumArt->dumpToDatabase();
+    }
+}
+
 // Default values for formats
 // NB These will eventually be customizable....
 QString Metadata::m_formatnormalfileartist      = "ARTIST";
@@ -245,6 +245,7 @@ class Metadata
     void setEmbeddedAlbumArt(AlbumArtList &albumart);
 
     bool isInDatabase(void);
+    bool dumpIdsToDatabase(void);
     void dumpToDatabase(void);
     void setField(const QString &field, const QString &data);
     void getField(const QString& field, QString *data);
@@ -258,6 +259,7 @@ class Metadata
     // static functions
     static void setArtistAndTrackFormats();
     static QStringList fillFieldList(QString field);
+    static void dumpListToDatabase(const QList<Metadata*> &tracks);
 
     // this looks for any image available - preferring a front cover if available
     QString getAlbumArtFile(void);
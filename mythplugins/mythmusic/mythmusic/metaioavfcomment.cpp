@@ -11,6 +11,14 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 }
 
+/// avformat_find_stream_info() opens the codecs, which must be serialized
+/// with the other threads reading tags or decoding.
+static int find_stream_info(AVFormatContext *p_context)
+{
+    QMutexLocker locker(avcodeclock);
+    return avformat_find_stream_info(p_context, NULL);
+}
+
 MetaIOAVFComment::MetaIOAVFComment(void)
     : MetaIO()
 {
@@ -50,8 +58,11 @@ Metadata* MetaIOAVFComment::read(const QString &filename)
         return NULL;
     }
 
-    if (avformat_find_stream_info(p_context, NULL) < 0)
+    if (find_stream_info(p_context) < 0)
+    {
+        avformat_close_input(&p_context);
         return NULL;
+    }
 
     AVDictionaryEntry *tag = av_dict_get(p_context->metadata, "title", NULL, 0);
     if (!tag)
@@ -115,8 +126,11 @@ int MetaIOAVFComment::getTrackLength(const QString &filename)
         return 0;
     }
 
-    if (avformat_find_stream_info(p_context, NULL) < 0)
+    if (find_stream_info(p_context) < 0)
+    {
+        avformat_close_input(&p_context);
         return 0;
+    }
 
     int rv = getTrackLength(p_context);
 
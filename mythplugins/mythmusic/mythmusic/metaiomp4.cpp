@@ -13,6 +13,14 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 }
 
+/// avformat_find_stream_info() opens the codecs, which must be serialized
+/// with the other threads reading tags or decoding.
+static int find_stream_info(AVFormatContext *p_context)
+{
+    QMutexLocker locker(avcodeclock);
+    return avformat_find_stream_info(p_context, NULL);
+}
+
 MetaIOMP4::MetaIOMP4(void)
     : MetaIO()
 {
@@ -95,8 +103,11 @@ Metadata* MetaIOMP4::read(const QString &filename)
         return NULL;
     }
 
-    if (avformat_find_stream_info(p_context, NULL) < 0)
+    if (find_stream_info(p_context) < 0)
+    {
+        avformat_close_input(&p_context);
         return NULL;
+    }
 
 #if 0
     //### Debugging, enable to dump a list of all field names/values found
@@ -191,8 +202,11 @@ int MetaIOMP4::getTrackLength(const QString &filename)
         return 0;
     }
 
-    if (avformat_find_stream_info(p_context, NULL) < 0)
+    if (find_stream_info(p_context) < 0)
+    {
+        avformat_close_input(&p_context);
         return 0;
+    }
 
     int rv = getTrackLength(p_context);
 
@@ -20,6 +20,8 @@
 #include <cstring>
 #include <cstdio>
 #include <map>
+#include <vector>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/time.h>
@@ -28,6 +30,12 @@
 #include <fcntl.h>
 #include <signal.h>
 
+#ifdef linux
+#  include <sys/epoll.h>
+#else
+#  include <sys/select.h>
+#endif
+
 #include "zmserver.h"
 
 // default port to listen on
@@ -47,22 +55,191 @@
 
 using namespace std;
 
+/*
+ * Waits for the listening socket and the clients to become readable, and
+ * for clients with replies queued to become writable. Uses epoll on Linux
+ * so the cost of a wakeup doesn't grow with the number of clients, and
+ * select() elsewhere.
+ */
+class SocketPoller
+{
+  public:
+    typedef struct
+    {
+        int  fd;
+        bool readable;
+        bool writable;
+    } Event;
+
+    SocketPoller()
+    {
+#ifdef linux
+        m_epfd = epoll_create(64);
+#else
+        FD_ZERO(&m_readSet);
+        FD_ZERO(&m_writeSet);
+        m_fdmax = -1;
+#endif
+    }
+
+    ~SocketPoller()
+    {
+#ifdef linux
+        if (m_epfd >= 0)
+            close(m_epfd);
+#endif
+    }
+
+    bool isValid(void) const
+    {
+#ifdef linux
+        return m_epfd >= 0;
+#else
+        return true;
+#endif
+    }
+
+    void add(int fd)
+    {
+#ifdef linux
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &ev);
+#else
+        FD_SET(fd, &m_readSet);
+        if (fd > m_fdmax)
+            m_fdmax = fd;
+#endif
+    }
+
+    void remove(int fd)
+    {
+#ifdef linux
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        epoll_ctl(m_epfd, EPOLL_CTL_DEL, fd, &ev);
+#else
+        FD_CLR(fd, &m_readSet);
+        FD_CLR(fd, &m_writeSet);
+#endif
+        m_writing.erase(fd);
+    }
+
+    // also wait for fd to become writable?
+    void setWriting(int fd, bool writing)
+    {
+        if (writing == (m_writing.find(fd) != m_writing.end()))
+            return;
+
+        if (writing)
+            m_writing[fd] = true;
+        else
+            m_writing.erase(fd);
+
+#ifdef linux
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = writing ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(m_epfd, EPOLL_CTL_MOD, fd, &ev);
+#else
+        if (writing)
+            FD_SET(fd, &m_writeSet);
+        else
+            FD_CLR(fd, &m_writeSet);
+#endif
+    }
+
+    // returns the number of events, 0 on timeout or -1 on error
+    int wait(int timeoutSecs, vector<Event> &events)
+    {
+        events.clear();
+
+#ifdef linux
+        struct epoll_event evs[64];
+        int res = epoll_wait(m_epfd, evs, 64, timeoutSecs * 1000);
+        if (res <= 0)
+            return (res == -1 && errno == EINTR) ? 0 : res;
+
+        for (int i = 0; i < res; i++)
+        {
+            Event ev;
+            ev.fd = evs[i].data.fd;
+            // errors and hang ups are reported by the read
+            ev.readable = evs[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP);
+            ev.writable = evs[i].events & EPOLLOUT;
+            events.push_back(ev);
+        }
+#else
+        struct timeval timeout;
+        timeout.tv_sec = timeoutSecs;
+        timeout.tv_usec = 0;
+
+        fd_set read_fds = m_readSet;
+        fd_set write_fds = m_writeSet;
+        int res = select(m_fdmax + 1, &read_fds, &write_fds, NULL, &timeout);
+        if (res <= 0)
+            return (res == -1 && errno == EINTR) ? 0 : res;
+
+        for (int fd = 0; fd <= m_fdmax; fd++)
+        {
+            Event ev;
+            ev.fd = fd;
+            ev.readable = FD_ISSET(fd, &read_fds);
+            ev.writable = FD_ISSET(fd, &write_fds);
+            if (ev.readable || ev.writable)
+                events.push_back(ev);
+        }
+#endif
+
+        return events.size();
+    }
+
+  private:
+#ifdef linux
+    int m_epfd;
+#else
+    fd_set m_readSet;
+    fd_set m_writeSet;
+    int m_fdmax;
+#endif
+    map<int, bool> m_writing;
+};
+
+static bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+static void closeClient(int fd, SocketPoller &poller,
+                        map<int, ZMServer*> &serverList)
+{
+    poller.remove(fd);
+    close(fd);
+
+    // remove from server list
+    map<int, ZMServer*>::iterator it = serverList.find(fd);
+    if (it != serverList.end())
+    {
+        delete it->second;
+        serverList.erase(it);
+    }
+}
+
 int main(int argc, char **argv)
 {
-    fd_set master;                  // master file descriptor list
-    fd_set read_fds;                // temp file descriptor list for select()
     struct sockaddr_in myaddr;      // server address
     struct sockaddr_in remoteaddr;  // client address
-    struct timeval timeout;         // maximum time to wait for data
-    int res;                        // result from select()
-    int fdmax;                      // maximum file descriptor number
+    int res;                        // result from wait()
     int listener;                   // listening socket descriptor
     int newfd;                      // newly accept()ed socket descriptor
     char buf[4096];                 // buffer for client data
     int nbytes;
     int yes=1;                      // for setsockopt() SO_REUSEADDR, below
     socklen_t addrlen;
-    int i;
     bool quit = false;              // quit flag
 
     bool debug = false;             // debug mode enabled
@@ -212,9 +389,12 @@ int main(int argc, char **argv)
     // connect to the DB
     connectToDatabase();
 
-    // clear the master and temp sets
-    FD_ZERO(&master);
-    FD_ZERO(&read_fds);
+    SocketPoller poller;
+    if (!poller.isValid())
+    {
+        perror("epoll_create");
+        return EXIT_SOCKET_ERROR;
+    }
 
     // get the listener
     if ((listener = socket(AF_INET, SOCK_STREAM, 0)) == -1)
@@ -249,104 +429,119 @@ int main(int argc, char **argv)
         return EXIT_SOCKET_ERROR;
     }
 
+    // accept() must not block if a client goes away before we get to it
+    if (!setNonBlocking(listener))
+    {
+        perror("fcntl");
+        return EXIT_SOCKET_ERROR;
+    }
+
     cout << "Listening on port: " << port << endl;
 
-    // add the listener to the master set
-    FD_SET(listener, &master);
+    poller.add(listener);
 
-    // keep track of the biggest file descriptor
-    fdmax = listener; // so far, it's this one
+    vector<SocketPoller::Event> events;
 
     // main loop
     while (!quit)
     {
-        // the maximum time select() should wait
-        timeout.tv_sec = DB_CHECK_TIME;
-        timeout.tv_usec = 0;
-
-        read_fds = master; // copy it
-        res = select(fdmax+1, &read_fds, NULL, NULL, &timeout);
+        res = poller.wait(DB_CHECK_TIME, events);
 
         if (res == -1)
         {
-            perror("select");
+            perror("wait");
             return EXIT_SOCKET_ERROR;
         }
         else if (res == 0)
         {
-            // select timed out
+            // wait timed out
             // just kick the DB connection to keep it alive
             kickDatabase(debug);
             continue;
         }
 
-        // run through the existing connections looking for data to read
-        for (i = 0; i <= fdmax; i++)
+        // run through the sockets which are ready
+        for (uint n = 0; n < events.size(); n++)
         {
-            if (FD_ISSET(i, &read_fds))
+            int fd = events[n].fd;
+
+            if (fd == listener)
             {
-                // we got one!!
-                if (i == listener) 
+                // handle new connections
+                while (true)
                 {
-                    // handle new connections
                     addrlen = sizeof(remoteaddr);
                     if ((newfd = accept(listener,
                                         (struct sockaddr *) &remoteaddr,
-                                                               &addrlen)) == -1)
+                                                           &addrlen)) == -1)
                     {
-                        perror("accept");
+                        if (errno != EAGAIN && errno != EWOULDBLOCK)
+                            perror("accept");
+                        break;
                     }
-                    else
+
+                    if (!setNonBlocking(newfd))
                     {
-                        // add to master set
-                        FD_SET(newfd, &master);
-                        if (newfd > fdmax)
-                        {    // keep track of the maximum
-                            fdmax = newfd;
-                        }
-
-                        // create new ZMServer and add to map
-                        ZMServer *server = new ZMServer(newfd, debug);
-                        serverList[newfd] = server;
-
-                        printf("new connection from %s on socket %d\n",
-                               inet_ntoa(remoteaddr.sin_addr), newfd);
+                        perror("fcntl");
+                        close(newfd);
+                        continue;
                     }
+
+                    // create new ZMServer and add to map
+                    ZMServer *server = new ZMServer(newfd, debug);
+                    serverList[newfd] = server;
+                    poller.add(newfd);
+
+                    printf("new connection from %s on socket %d\n",
+                           inet_ntoa(remoteaddr.sin_addr), newfd);
                 }
-                else
+                continue;
+            }
+
+            map<int, ZMServer*>::iterator it = serverList.find(fd);
+            if (it == serverList.end())
+                continue;
+            ZMServer *server = it->second;
+
+            if (events[n].readable)
+            {
+                // handle data from a client
+                if ((nbytes = recv(fd, buf, sizeof(buf) - 1, 0)) <= 0)
                 {
-                    // handle data from a client
-                    if ((nbytes = recv(i, buf, sizeof(buf), 0)) <= 0)
+                    if (nbytes == -1 &&
+                        (errno == EAGAIN || errno == EWOULDBLOCK ||
+                         errno == EINTR))
                     {
-                        // got error or connection closed by client
-                        if (nbytes == 0)
-                        {
-                            // connection closed
-                            printf("socket %d hung up\n", i);
-                        }
-                        else
-                        {
-                            perror("recv");
-                        }
-
-                        close(i);
-
-                        // remove from master set
-                        FD_CLR(i, &master);
-
-                        // remove from server list
-                        ZMServer *server = serverList[i];
-                        if (server)
-                            delete server;
-                        serverList.erase(i);
+                        continue;
+                    }
+
+                    // got error or connection closed by client
+                    if (nbytes == 0)
+                    {
+                        // connection closed
+                        printf("socket %d hung up\n", fd);
                     }
                     else
                     {
-                        ZMServer *server = serverList[i];
-                        server->processRequest(buf, nbytes);
+                        perror("recv");
                     }
+
+                    closeClient(fd, poller, serverList);
+                    continue;
                 }
+
+                server->processRequest(buf, nbytes);
             }
+
+            // send any replies the socket wouldn't take before
+            if (events[n].writable && !server->flushOutput())
+            {
+                perror("send");
+                closeClient(fd, poller, serverList);
+                continue;
+            }
+
+            poller.setWriting(fd, server->hasPendingOutput());
         }
     }
 
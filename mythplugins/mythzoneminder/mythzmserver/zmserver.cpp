@@ -20,6 +20,7 @@
 #include <cstdio>
 #include <errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <sys/stat.h>
@@ -205,6 +206,7 @@ ZMServer::ZMServer(int sock, bool debug)
 
     m_sock = sock;
     m_debug = debug;
+    m_outPos = 0;
 
     // get the shared memory key
     char buf[100];
@@ -336,43 +338,94 @@ void ZMServer::processRequest(char* buf, int nbytes)
         send("UNKNOWN_COMMAND");
 }
 
-bool ZMServer::send(const string s) const
+bool ZMServer::send(const string s)
 {
-    // send length
-    uint32_t len = s.size();
+    return send(s, NULL, 0);
+}
+
+/*
+ * The client socket is non-blocking, so a slow client never holds up the
+ * others. Whatever the socket will take is written straight from the
+ * callers buffer, which for live frames is the image slot in ZM's shared
+ * memory. Only the part which is left over is copied, to be sent by
+ * flushOutput() when the socket is writable again, since ZM will reuse the
+ * slot.
+ */
+bool ZMServer::send(const string s, const unsigned char *buffer, int dataLen)
+{
+    // the length of the message, followed by the message
     char buf[9];
-    sprintf(buf, "%8d", len);
-    int status = ::send(m_sock, buf, 8, MSG_NOSIGNAL);
+    sprintf(buf, "%8d", (int)s.size());
+    string header(buf, 8);
+    header += s;
+
+    if (hasPendingOutput())
+    {
+        m_outBuffer += header;
+        if (dataLen > 0)
+            m_outBuffer.append((const char *)buffer, dataLen);
+        return true;
+    }
+
+    struct iovec iov[2];
+    iov[0].iov_base = (void *)header.data();
+    iov[0].iov_len  = header.size();
+    iov[1].iov_base = (void *)buffer;
+    iov[1].iov_len  = dataLen;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = (dataLen > 0) ? 2 : 1;
+
+    ssize_t status = sendmsg(m_sock, &msg, MSG_NOSIGNAL);
     if (status == -1)
-        return false;
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            return false;
+        status = 0;
+    }
 
-    // send message
-    status = ::send(m_sock, s.c_str(), s.size(), MSG_NOSIGNAL);
-    if ( status == -1 )
-        return false;
+    // queue whatever wasn't sent
+    size_t sent = status;
+    if (sent < header.size())
+    {
+        m_outBuffer.assign(header, sent, string::npos);
+        sent = 0;
+    }
     else
-        return true;
+    {
+        m_outBuffer.clear();
+        sent -= header.size();
+    }
+    if (sent < (size_t)dataLen)
+        m_outBuffer.append((const char *)buffer + sent, dataLen - sent);
+    m_outPos = 0;
+
+    if (m_debug && hasPendingOutput())
+        cout << "Queued " << m_outBuffer.size() << " bytes for socket "
+             << m_sock << endl;
+
+    return true;
 }
 
-bool ZMServer::send(const string s, const unsigned char *buffer, int dataLen) const
+bool ZMServer::flushOutput(void)
 {
-    // send length
-    uint32_t len = s.size();
-    char buf[9];
-    sprintf(buf, "%8d", len);
-    int status = ::send(m_sock, buf, 8, MSG_NOSIGNAL);
-    if (status == -1)
-        return false;
-
-    // send message
-    status = ::send(m_sock, s.c_str(), s.size(), MSG_NOSIGNAL);
-    if ( status == -1 )
-        return false;
+    while (hasPendingOutput())
+    {
+        ssize_t status = ::send(m_sock, m_outBuffer.data() + m_outPos,
+                                m_outBuffer.size() - m_outPos, MSG_NOSIGNAL);
+        if (status == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+        m_outPos += status;
+    }
 
-    // send data
-    status = ::send(m_sock, buffer, dataLen, MSG_NOSIGNAL);
-    if ( status == -1 )
-        return false;
+    m_outBuffer.clear();
+    m_outPos = 0;
 
     return true;
 }
@@ -948,7 +1001,7 @@ void ZMServer::handleGetAnalyseFrame(vector<string> tokens)
 
 void ZMServer::handleGetLiveFrame(vector<string> tokens)
 {
-    static unsigned char buffer[MAX_IMAGE_SIZE];
+    const unsigned char *data = NULL;
     char str[100];
 
     // we need to periodically kick the DB connection here to make sure it
@@ -994,7 +1047,7 @@ void ZMServer::handleGetLiveFrame(vector<string> tokens)
     }
 
     // read a frame from the shared memory
-    int dataSize = getFrame(buffer, sizeof(buffer), monitor);
+    int dataSize = getFrame(data, monitor);
 
     if (m_debug)
         cout << "Frame size: " <<  dataSize << endl;
@@ -1016,7 +1069,7 @@ void ZMServer::handleGetLiveFrame(vector<string> tokens)
     ADD_STR(outStr, str)
 
     // send the data
-    send(outStr, buffer, dataSize);
+    send(outStr, data, dataSize);
 }
 
 void ZMServer::handleGetFrameList(vector<string> tokens)
@@ -1442,10 +1495,8 @@ void ZMServer::initMonitor(MONITOR *monitor)
             ((monitor->image_buffer_count) * sizeof(struct timeval));
 }
 
-int ZMServer::getFrame(unsigned char *buffer, int bufferSize, MONITOR *monitor)
+int ZMServer::getFrame(const unsigned char *&data, MONITOR *monitor)
 {
-    (void) bufferSize;
-
     // is there a new frame available?
     if (monitor->shared_data->last_write_index == monitor->last_read)
         return 0;
@@ -1479,13 +1530,10 @@ int ZMServer::getFrame(unsigned char *buffer, int bufferSize, MONITOR *monitor)
             break;
     }
 
-    unsigned char *data = monitor->shared_images +
-            monitor->frame_size * monitor->last_read;
-
     // FIXME: should do some sort of compression JPEG??
-    // just copy the data to our buffer for now
-    memcpy(buffer, data, monitor->frame_size);
-
+    // the frame is sent from the shared memory as it is
+    data = monitor->shared_images +
+            monitor->frame_size * monitor->last_read;
 
     return monitor->frame_size;
 }
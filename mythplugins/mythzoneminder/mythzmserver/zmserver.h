@@ -154,14 +154,18 @@ class ZMServer
 
     void processRequest(char* buf, int nbytes);
 
+    // replies which the socket would not take yet
+    bool hasPendingOutput(void) const { return m_outPos < m_outBuffer.size(); }
+    bool flushOutput(void);
+
   private:
     string getZMSetting(const string &setting);
-    bool send(const string s) const;
-    bool send(const string s, const unsigned char *buffer, int dataLen) const;
+    bool send(const string s);
+    bool send(const string s, const unsigned char *buffer, int dataLen);
     void sendError(string error);
     void getMonitorList(void);
     void initMonitor(MONITOR *monitor);
-    int  getFrame(unsigned char *buffer, int bufferSize, MONITOR *monitor);
+    int  getFrame(const unsigned char *&data, MONITOR *monitor);
     long long getDiskSpace(const string &filename, long long &total, long long &used);
     void tokenize(const string &command, vector<string> &tokens);
     void handleHello(void);
@@ -194,6 +198,8 @@ class ZMServer
     string               m_analyseFileFormat;
     key_t                m_shmKey;
     string               m_mmapPath;
+    string               m_outBuffer;
+    string::size_type    m_outPos;
 };
 
 
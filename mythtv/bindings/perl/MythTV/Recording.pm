@@ -65,13 +65,40 @@ package MythTV::Recording;
         #                          + $self->{'fs_low'};
         #}
     # Pull the last known frame from the database, to help guestimate the
-    # total frame count.
-        $sh = $self->{'_mythtv'}{'dbh'}->prepare('SELECT MAX(mark)
-                                                    FROM recordedseek
+    # total frame count.  Position maps are kept packed in recordedseekmap,
+    # as pairs of varints, or a row per keyframe in recordedseek for older
+    # recordings.
+        $sh = $self->{'_mythtv'}{'dbh'}->prepare('SELECT data
+                                                    FROM recordedseekmap
                                                    WHERE chanid=? AND starttime=FROM_UNIXTIME(?)');
         $sh->execute($self->{'chanid'}, $self->{'recstartts'});
-        ($self->{'last_frame'}) = $sh->fetchrow_array();
+        my $have_map = 0;
+        while (my ($data) = $sh->fetchrow_array) {
+            $have_map = 1;
+            my ($frame, $val, $shift, $odd) = (0, 0, 0, 0);
+            foreach my $byte (unpack('C*', $data)) {
+                $val |= ($byte & 0x7f) << $shift;
+                $shift += 7;
+                next if ($byte & 0x80);
+            # Every other varint is an offset, which is not needed here
+                unless ($odd) {
+                    $frame = ($val & 1) ? ($val >> 1) : $frame + ($val >> 1);
+                    $self->{'last_frame'} = $frame
+                        if ($frame > $self->{'last_frame'});
+                }
+                $odd = !$odd;
+                ($val, $shift) = (0, 0);
+            }
+        }
         $sh->finish();
+        unless ($have_map) {
+            $sh = $self->{'_mythtv'}{'dbh'}->prepare('SELECT MAX(mark)
+                                                        FROM recordedseek
+                                                       WHERE chanid=? AND starttime=FROM_UNIXTIME(?)');
+            $sh->execute($self->{'chanid'}, $self->{'recstartts'});
+            ($self->{'last_frame'}) = $sh->fetchrow_array();
+            $sh->finish();
+        }
 
     # Split the filename up into its respective parts
         if ($self->{'filename'} =~ m#myth://(.+?)(?::(\d+))?/(.*?)$#) {
@@ -359,10 +386,10 @@ package MythTV::Recording;
             $info{'mpeg_stream_type'} = 'ts';
         }
     # French localisation
-        elsif ($data =~ m/Fichier de type MPEG-(PE?S) dtect./m) {
+        elsif ($data =~ m/Fichier de type MPEG-(PE?S) d�tect�./m) {
             $info{'mpeg_stream_type'} = lc($1);
         }
-        elsif ($data =~ m/Fichier de type TS dtect./m) {
+        elsif ($data =~ m/Fichier de type TS d�tect�./m) {
             $info{'mpeg_stream_type'} = 'ts';
         }
     # No matches on stream type?
@@ -224,9 +224,113 @@ class Recorded( CMPRecord, DBDataWrite ):
         _cref = ['person']
 
     class _Seek( DBDataRef, MARKUP ):
+        """
+        Position map entries, as rows of recordedseek. Recordings keep
+        their maps packed in recordedseekmap, one row per type, holding
+        pairs of varints. Types without a packed row are read from
+        recordedseek, as older recordings use it.
+        """
         _table = 'recordedseek'
         _ref = ['chanid','starttime']
 
+        @staticmethod
+        def _decode(data):
+            vals = []
+            val = shift = 0
+            for c in data:
+                c = ord(c)
+                val |= (c & 0x7f) << shift
+                shift += 7
+                if not (c & 0x80):
+                    vals.append(val)
+                    val = shift = 0
+            entries = {}
+            frame = offset = None
+            for i in range(0, len(vals)-1, 2):
+                if vals[i] & 1:
+                    frame = vals[i] >> 1
+                    offset = vals[i+1]
+                elif frame is None:
+                    break
+                else:
+                    frame += vals[i] >> 1
+                    offset += vals[i+1]
+                entries[frame] = offset
+            return sorted(entries.items())
+
+        @staticmethod
+        def _encode(entries):
+            def varint(val):
+                s = ''
+                while val >= 0x80:
+                    s += chr((val & 0x7f) | 0x80)
+                    val >>= 7
+                return s + chr(val)
+            data = []
+            prev = None
+            for frame, offset in sorted(entries):
+                if prev and (frame > prev[0]) and (offset >= prev[1]):
+                    data.append(varint((frame-prev[0]) << 1))
+                    data.append(varint(offset-prev[1]))
+                else:
+                    data.append(varint((frame << 1) | 1))
+                    data.append(varint(offset))
+                prev = (frame, offset)
+            return ''.join(data)
+
+        def _populate(self, force=False, data=None):
+            if (data is not None) or (self._populated and (not force)):
+                return DBDataRef._populate(self, force, data)
+            rows = []
+            with self._db as cursor:
+                cursor.execute("""SELECT type,data FROM recordedseekmap
+                                  WHERE chanid=? AND starttime=?""",
+                               self._refdat)
+                for type, packed in cursor.fetchall():
+                    for mark, offset in self._decode(packed):
+                        dat = {'mark':mark, 'type':type, 'offset':offset}
+                        rows.append([dat[f] for f in self._datfields])
+                types = set([r[self._datfields.index('type')] for r in rows])
+                cursor.execute("""SELECT %s FROM recordedseek
+                                  WHERE chanid=? AND starttime=?""" % \
+                                    ','.join(self._datfields),
+                               self._refdat)
+                for row in cursor:
+                    if row[self._datfields.index('type')] not in types:
+                        rows.append(row)
+            DBDataRef._populate(self, True, rows)
+
+        def commit(self):
+            """Push all local changes to database, as packed maps."""
+            if not self._populated:
+                return
+            diff = self^self._origdata
+            if len(diff) == 0:
+                return
+            maps = {}
+            for dat in self:
+                maps.setdefault(dat.type, []).append((dat.mark, dat.offset))
+            with self._db as cursor:
+                for type in set([dat.type for dat in diff]):
+                    entries = maps.get(type, [])
+                    if len(entries) == 0:
+                        cursor.execute("""DELETE FROM recordedseekmap
+                                          WHERE chanid=? AND starttime=?
+                                            AND type=?""",
+                                       list(self._refdat)+[type])
+                    else:
+                        cursor.execute("""REPLACE INTO recordedseekmap
+                                          (chanid,starttime,type,entries,data)
+                                          VALUES (?,?,?,?,?)""",
+                                       list(self._refdat)+[type,
+                                            len(entries),
+                                            self._encode(entries)])
+                    cursor.execute("""DELETE FROM recordedseek
+                                      WHERE chanid=? AND starttime=?
+                                        AND type=?""",
+                                   list(self._refdat)+[type])
+            self._origdata = self.deepcopy()
+
     class _Markup( DBDataRef, MARKUP, MARKUPLIST ):
         _table = 'recordedmarkup'
         _ref = ['chanid','starttime']
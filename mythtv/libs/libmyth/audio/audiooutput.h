@@ -127,6 +127,9 @@ class MPUBLIC AudioOutput : public VolumeBase, public OutputListeners
     virtual void GetBufferStatus(uint &fill, uint &total)
         { fill = total = 0; }
 
+    /// report how many times the output ran out of audio while playing
+    virtual uint GetUnderruns(void) const { return 0; }
+
     //  Only really used by the AudioOutputNULL object
     virtual void bufferOutputData(bool y) = 0;
     virtual int readOutputData(unsigned char *read_buffer,
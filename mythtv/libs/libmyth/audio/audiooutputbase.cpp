@@ -23,7 +23,6 @@
 #define LOC QString("AO: ")
 
 #define WPOS audiobuffer + org_waud
-#define RPOS audiobuffer + raud
 #define ABUF audiobuffer
 #define STST soundtouch::SAMPLETYPE
 #define AOALIGN(x) (((long)&x + 15) & ~0xf);
@@ -102,14 +101,15 @@ AudioOutputBase::AudioOutputBase(const AudioSettings &settings) :
     memory_corruption_test1(0xdeadbeef),
     src_out(NULL),              kAudioSRCOutputSize(0),
     memory_corruption_test2(0xdeadbeef),
-    memory_corruption_test3(0xdeadbeef),
+    audiobuffer(NULL),          audiobuffer_size(0),
+    m_underruns(0),             m_flowing(false),
+    m_draining(0),
     m_configure_succeeded(false),m_length_last_data(0),
     m_spdifenc(NULL),           m_forcedprocessing(false)
 {
     src_in = (float *)AOALIGN(src_in_buf);
     memset(&src_data,          0, sizeof(SRC_DATA));
     memset(src_in_buf,         0, sizeof(src_in_buf));
-    memset(audiobuffer,        0, sizeof(audiobuffer));
 
     // Handle override of SRC quality settings
     if (gCoreContext->GetNumSetting("SRCQualityOverride", false))
@@ -146,10 +146,11 @@ AudioOutputBase::~AudioOutputBase()
     if (kAudioSRCOutputSize > 0)
         delete[] src_out;
 
+    delete[] audiobuffer;
+
     assert(memory_corruption_test0 == 0xdeadbeef);
     assert(memory_corruption_test1 == 0xdeadbeef);
     assert(memory_corruption_test2 == 0xdeadbeef);
-    assert(memory_corruption_test3 == 0xdeadbeef);
 }
 
 void AudioOutputBase::InitSettings(const AudioSettings &settings)
@@ -779,6 +780,11 @@ void AudioOutputBase::Reconfigure(const AudioSettings &orig_settings)
         sizeof(float) : output_settings->SampleSize(format);
     bytes_per_frame *= channels;
 
+    // Size the ring for float samples, so it needn't grow if time
+    // stretch turns processing on later
+    SetRingSize(channels * sizeof(float) * samplerate *
+                kAudioRingBufferSeconds);
+
     if (enc)
         channels = 2; // But only post-encoder
 
@@ -947,13 +953,17 @@ void AudioOutputBase::Reset()
     if (encoder)
     {
         waud = raud = 0;    // empty ring buffer
-        memset(audiobuffer, 0, kAudioRingBufferSize);
+        memset(audiobuffer, 0, audiobuffer_size);
     }
     else
     {
-        waud = raud;        // empty ring buffer
+        // empty ring buffer; moving raud rather than waud also makes
+        // any update the output thread has in flight fail
+        raud.fetchAndStoreRelease(waud);
     }
     reset_active.Ref();
+    m_flowing = false;
+    m_draining.fetchAndStoreRelaxed(0);
     current_seconds = -1;
     was_paused = !pauseaudio;
     // clear any state that could remember previous audio in any active filters
@@ -992,15 +1002,48 @@ void AudioOutputBase::SetEffDsp(int dsprate)
     effdsp = dsprate;
 }
 
+/**
+ * Resize the audiobuffer for the current format
+ *
+ * The size is clamped to the ring limits and rounded down so every frame
+ * size divides it. Only call this with the output thread stopped and
+ * while holding the audio_buflock.
+ */
+void AudioOutputBase::SetRingSize(uint size)
+{
+    if (size < kAudioRingBufferMinSize)
+        size = kAudioRingBufferMinSize;
+    else if (size > kAudioRingBufferMaxSize)
+        size = kAudioRingBufferMaxSize;
+    size -= size % kAudioRingBufferAlign;
+
+    if (size == audiobuffer_size)
+        return;
+
+    VBAUDIO(QString("Audio ring buffer size: %1 bytes").arg(size));
+
+    delete[] audiobuffer;
+    audiobuffer      = new uchar[size];
+    audiobuffer_size = size;
+    memset(audiobuffer, 0, size);
+    waud = raud = 0;
+}
+
 /**
  * Get the number of bytes in the audiobuffer
+ *
+ * Safe from either end of the buffer, the acquire loads order the reads
+ * of the data after the position that covers it.
  */
 inline int AudioOutputBase::audiolen()
 {
-    if (waud >= raud)
-        return waud - raud;
+    uint r = raud.fetchAndAddAcquire(0);
+    uint w = waud.fetchAndAddAcquire(0);
+
+    if (w >= r)
+        return w - r;
     else
-        return kAudioRingBufferSize - (raud - waud);
+        return audiobuffer_size - (r - w);
 }
 
 /**
@@ -1008,10 +1051,10 @@ inline int AudioOutputBase::audiolen()
  */
 int AudioOutputBase::audiofree()
 {
-    return kAudioRingBufferSize - audiolen() - 1;
+    return audiobuffer_size - audiolen() - 1;
     /* There is one wasted byte in the buffer. The case where waud = raud is
        interpreted as an empty buffer, so the fullest the buffer can ever
-       be is kAudioRingBufferSize - 1. */
+       be is audiobuffer_size - 1. */
 }
 
 /**
@@ -1221,7 +1264,7 @@ int AudioOutputBase::CheckFreeSpace(int &frames)
 int AudioOutputBase::CopyWithUpmix(char *buffer, int frames, uint &org_waud)
 {
     int len   = CheckFreeSpace(frames);
-    int bdiff = kAudioRingBufferSize - org_waud;
+    int bdiff = audiobuffer_size - org_waud;
     int bpf   = bytes_per_frame;
     int off   = 0;
 
@@ -1238,7 +1281,7 @@ int AudioOutputBase::CopyWithUpmix(char *buffer, int frames, uint &org_waud)
         }
         if (num > 0)
             memcpy(WPOS, buffer + off, num);
-        org_waud = (org_waud + num) % kAudioRingBufferSize;
+        org_waud = (org_waud + num) % audiobuffer_size;
         return len;
     }
 
@@ -1256,7 +1299,7 @@ int AudioOutputBase::CopyWithUpmix(char *buffer, int frames, uint &org_waud)
         if (frames > 0)
             AudioOutputUtil::MonoToStereo(WPOS, buffer + off, frames);
 
-        org_waud = (org_waud + frames * bpf) % kAudioRingBufferSize;
+        org_waud = (org_waud + frames * bpf) % audiobuffer_size;
         return len;
     }
 
@@ -1277,7 +1320,7 @@ int AudioOutputBase::CopyWithUpmix(char *buffer, int frames, uint &org_waud)
 
         len += CheckFreeSpace(nFrames);
 
-        bdFrames = (kAudioRingBufferSize - org_waud) / bpf;
+        bdFrames = (audiobuffer_size - org_waud) / bpf;
         if (bdFrames < nFrames)
         {
             if ((org_waud % bpf) != 0)
@@ -1293,7 +1336,7 @@ int AudioOutputBase::CopyWithUpmix(char *buffer, int frames, uint &org_waud)
         if (nFrames > 0)
             upmixer->receiveFrames((float *)(WPOS), nFrames);
 
-        org_waud = (org_waud + nFrames * bpf) % kAudioRingBufferSize;
+        org_waud = (org_waud + nFrames * bpf) % audiobuffer_size;
     }
     return len;
 }
@@ -1333,6 +1376,9 @@ bool AudioOutputBase::AddData(void *in_buffer, int in_len,
         return false;
     }
 
+    // the producer is back, running dry is an underrun again
+    m_draining.fetchAndStoreRelaxed(0);
+
     /* See if we're waiting for new samples to be buffered before we unpause
        post channel change, seek, etc. Wait for 4 fragments to be buffered */
     if (unpause_when_ready && pauseaudio && audioready() > fragment_size << 2)
@@ -1346,7 +1392,7 @@ bool AudioOutputBase::AddData(void *in_buffer, int in_len,
 
     uint org_waud = waud;
     int  afree    = audiofree();
-    int  used     = kAudioRingBufferSize - afree;
+    int  used     = audiobuffer_size - afree;
 
     if (passthru && m_spdifenc)
     {
@@ -1491,7 +1537,7 @@ bool AudioOutputBase::AddData(void *in_buffer, int in_len,
         frames = len / bpf;
         frames_final += frames;
 
-        bdiff = kAudioRingBufferSize - waud;
+        bdiff = audiobuffer_size - waud;
         if ((len % bpf) != 0 && bdiff < len)
         {
             VBERROR(QString("AddData: Corruption likely: len = %1 (bpf = %2)")
@@ -1535,7 +1581,7 @@ bool AudioOutputBase::AddData(void *in_buffer, int in_len,
                 nFrames = pSoundStretch->receiveSamples((STST *)(WPOS),
                                                         nFrames);
 
-            org_waud = (org_waud + nFrames * bpf) % kAudioRingBufferSize;
+            org_waud = (org_waud + nFrames * bpf) % audiobuffer_size;
         }
 
         if (internal_vol && SWVolume())
@@ -1553,7 +1599,7 @@ bool AudioOutputBase::AddData(void *in_buffer, int in_len,
             if (num > 0)
                 AudioOutputUtil::AdjustVolume(WPOS, num, volume,
                                               music, needs_upmix && upmixer);
-            org_waud = (org_waud + num) % kAudioRingBufferSize;
+            org_waud = (org_waud + num) % audiobuffer_size;
         }
 
         if (encoder)
@@ -1582,10 +1628,11 @@ bool AudioOutputBase::AddData(void *in_buffer, int in_len,
             if (to_get > 0)
                 encoder->GetFrames(WPOS, to_get);
 
-            org_waud = (org_waud + to_get) % kAudioRingBufferSize;
+            org_waud = (org_waud + to_get) % audiobuffer_size;
         }
 
-        waud = org_waud;
+        // publish the frames to the output thread
+        waud.fetchAndStoreRelease(org_waud);
     }
 
     SetAudiotime(frames_final, timecode);
@@ -1622,8 +1669,32 @@ void AudioOutputBase::Status()
  */
 void AudioOutputBase::GetBufferStatus(uint &fill, uint &total)
 {
-    fill  = kAudioRingBufferSize - audiofree();
-    total = kAudioRingBufferSize;
+    fill  = audiolen();
+    total = audiobuffer_size;
+}
+
+/**
+ * Get the number of times the output ran out of audio while playing
+ */
+uint AudioOutputBase::GetUnderruns(void) const
+{
+    return const_cast<QAtomicInt&>(m_underruns).fetchAndAddRelaxed(0);
+}
+
+/**
+ * Count an underrun when the consumer goes from getting data to not
+ * getting it. Resets clear the state, so refilling after a seek or
+ * channel change isn't counted, and running dry after Drain() at the
+ * end of a stream isn't either.
+ */
+void AudioOutputBase::UpdateUnderruns(bool starved)
+{
+    if (starved && m_flowing && !m_draining)
+    {
+        m_underruns.fetchAndAddRelaxed(1);
+        VBAUDIOTS("Audio buffer underrun");
+    }
+    m_flowing = !starved;
 }
 
 /**
@@ -1678,6 +1749,7 @@ void AudioOutputBase::OutputAudioLoop(void)
         // wait for the buffer to fill with enough to play
         if (fragment_size > ready)
         {
+            UpdateUnderruns(true);
             if (ready > 0)  // only log if we're sending some audio
                 VBAUDIOTS(QString("audio waiting for buffer to fill: "
                                   "have %1 want %2")
@@ -1695,14 +1767,17 @@ void AudioOutputBase::OutputAudioLoop(void)
         // delay setting raud until after phys buffer is filled
         // so GetAudiotime will be accurate without locking
         reset_active.TestAndDeref();
-        volatile uint next_raud = raud;
+        uint cur_raud  = raud;
+        uint next_raud = cur_raud;
         if (GetAudioData(fragment, fragment_size, true, &next_raud))
         {
             if (!reset_active.TestAndDeref())
             {
                 WriteAudio(fragment, fragment_size);
+                // only free the space if nothing emptied the buffer
+                // while we were writing
                 if (!reset_active.TestAndDeref())
-                    raud = next_raud;
+                    raud.testAndSetRelease(cur_raud, next_raud);
             }
         }
 #ifdef AUDIOTSTESTING
@@ -1727,7 +1802,7 @@ void AudioOutputBase::OutputAudioLoop(void)
  * available. Returns the number of bytes copied.
  */
 int AudioOutputBase::GetAudioData(uchar *buffer, int size, bool full_buffer,
-                                  volatile uint *local_raud)
+                                  uint *local_raud)
 {
 
 #define LRPOS audiobuffer + *local_raud
@@ -1737,8 +1812,13 @@ int AudioOutputBase::GetAudioData(uchar *buffer, int size, bool full_buffer,
     int frag_size    = size;
     int written_size = size;
 
-    if (local_raud == NULL)
-        local_raud = &raud;
+    // Without a local position to advance, free the space as soon as
+    // the data is copied out
+    uint cur_raud  = raud;
+    uint next_raud = cur_raud;
+    bool publish   = (local_raud == NULL);
+    if (publish)
+        local_raud = &next_raud;
 
     if (!full_buffer && (size > avail_size))
     {
@@ -1747,10 +1827,12 @@ int AudioOutputBase::GetAudioData(uchar *buffer, int size, bool full_buffer,
         written_size = frag_size;
     }
 
+    UpdateUnderruns(avail_size < size);
+
     if (!avail_size || (frag_size > avail_size))
         return 0;
 
-    int bdiff = kAudioRingBufferSize - raud;
+    int bdiff = audiobuffer_size - *local_raud;
 
     int obytes = output_settings->SampleSize(output_format);
     bool fromFloats = processing && !enc && output_format != FORMAT_FLT;
@@ -1786,6 +1868,9 @@ int AudioOutputBase::GetAudioData(uchar *buffer, int size, bool full_buffer,
 
     *local_raud += frag_size;
 
+    if (publish)
+        raud.testAndSetRelease(cur_raud, next_raud);
+
     // Mute individual channels through mono->stereo duplication
     MuteState mute_state = GetMuteState();
     if (!enc && !passthru &&
@@ -1805,6 +1890,7 @@ int AudioOutputBase::GetAudioData(uchar *buffer, int size, bool full_buffer,
  */
 void AudioOutputBase::Drain()
 {
+    m_draining.fetchAndStoreRelaxed(1);
     while (audioready() > fragment_size)
         usleep(1000);
 }
@@ -12,6 +12,7 @@ using namespace std;
 #include <QString>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QAtomicInt>
 
 // MythTV headers
 #include "audiooutput.h"
@@ -106,6 +107,7 @@ class AudioOutputBase : public AudioOutput, public MThread
     virtual void SetSourceBitrate(int rate);
 
     virtual void GetBufferStatus(uint &fill, uint &total);
+    virtual uint GetUnderruns(void) const;
 
     //  Only really used by the AudioOutputNULL object
     virtual void bufferOutputData(bool y){ buffer_output_data_for_use = y; }
@@ -113,8 +115,14 @@ class AudioOutputBase : public AudioOutput, public MThread
 
     static const uint kAudioSRCInputSize = 16384;
 
-    /// Audio Buffer Size -- should be divisible by 32,24,16,12,10,8,6,4,2..
-    static const uint kAudioRingBufferSize   = 3072000u;
+    /// Audio Buffer Size -- the ring holds this many seconds of audio at
+    /// the output rate as floats, within the limits below. The size is
+    /// always a multiple of kAudioRingBufferAlign so it divides by every
+    /// frame size (32,28,24,16,12,10,8,6,4,2..)
+    static const uint kAudioRingBufferSeconds = 4;
+    static const uint kAudioRingBufferMinSize = 768000u;
+    static const uint kAudioRingBufferMaxSize = 3072000u;
+    static const uint kAudioRingBufferAlign   = 3360u;
 
  protected:
     // Following function must be called from subclass constructor
@@ -140,7 +148,7 @@ class AudioOutputBase : public AudioOutput, public MThread
     virtual void StopOutputThread(void);
 
     int GetAudioData(uchar *buffer, int buf_size, bool fill_buffer,
-                     volatile uint *local_raud = NULL);
+                     uint *local_raud = NULL);
 
     void OutputAudioLoop(void);
 
@@ -203,6 +211,8 @@ class AudioOutputBase : public AudioOutput, public MThread
     AudioOutputSettings* OutputSettings(bool digital = true);
     int CopyWithUpmix(char *buffer, int frames, uint &org_waud);
     void SetAudiotime(int frames, int64_t timecode);
+    void SetRingSize(uint size);
+    void UpdateUnderruns(bool starved);
     AudioOutputSettings *output_settingsraw;
     AudioOutputSettings *output_settings;
     AudioOutputSettings *output_settingsdigitalraw;
@@ -232,7 +242,8 @@ class AudioOutputBase : public AudioOutput, public MThread
 
     /**
      *  Writes to the audiobuffer, reconfigures and audiobuffer resets can only
-     *  take place while holding this lock
+     *  take place while holding this lock. The output thread never takes it,
+     *  it only moves 'raud'.
      */
     QMutex audio_buflock;
 
@@ -248,9 +259,16 @@ class AudioOutputBase : public AudioOutput, public MThread
     int64_t audiotime;
 
     /**
-     * Audio circular buffer
+     * Audio circular buffer read and write positions.
+     *
+     * The buffer has a single producer (AddData) and a single consumer
+     * (the output thread). Each side only moves its own position, and
+     * stores it with release semantics after the data is in place, and
+     * loads the other side's with acquire semantics, so neither needs
+     * a lock. Resets from outside the output thread also reference
+     * 'reset_active' so the consumer drops what it read in the meantime.
      */
-    volatile uint raud, waud;     // read and write positions
+    QAtomicInt raud, waud;
     /**
      * timecode of audio most recently placed into buffer
      */
@@ -273,10 +291,18 @@ class AudioOutputBase : public AudioOutput, public MThread
     int kAudioSRCOutputSize;
     uint memory_corruption_test2;
     /**
-     * main audio buffer
+     * main audio buffer, sized by SetRingSize() for the current format
      */
-    uchar audiobuffer[kAudioRingBufferSize];
-    uint memory_corruption_test3;
+    uchar *audiobuffer;
+    uint   audiobuffer_size;
+    /**
+     * times the consumer ran out of data while playing
+     */
+    QAtomicInt m_underruns;
+    bool       m_flowing;
+    /// set by Drain() until more data is added, the buffer running
+    /// dry then is the end of the stream rather than an underrun
+    QAtomicInt m_draining;
     uint m_configure_succeeded;
     int64_t m_length_last_data;
 
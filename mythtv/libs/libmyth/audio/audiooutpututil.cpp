@@ -8,6 +8,20 @@
 
 #define LOC QString("AOUtil: ")
 
+/*
+ If gcc is not set to support sse (-msse) it will not accept xmm registers
+ in the clobber list for inline asm; XMM_CLOBBERS evaluates to nothing then.
+ Use as ': XMM_CLOBBERS("xmm0",) "memory"' */
+#if HAVE_XMM_CLOBBERS
+#define XMM_CLOBBERS(...)   __VA_ARGS__
+#else
+#define XMM_CLOBBERS(...)
+#endif
+
+// The C loops define the results, the SIMD versions must match them bit for
+// bit. They can be turned off to compare against the C loops.
+static bool simd_enabled = true;
+
 #if ARCH_X86
 static int has_sse2 = -1;
 
@@ -37,6 +51,11 @@ static inline bool sse_check()
     );
     return (bool)has_sse2;
 }
+
+static inline bool use_sse()
+{
+    return simd_enabled && sse_check();
+}
 #endif //ARCH_x86
 
 #if !HAVE_LRINTF
@@ -53,9 +72,14 @@ static inline float clipcheck(float f) {
 }
 
 /*
- All toFloat variants require 16 byte aligned input and output buffers on x86
- The SSE code processes 16 bytes at a time and leaves any remainder for the C
- - there is no remainder in practice */
+ The SSE toFloat variants need 16 byte aligned input and output buffers and
+ fall back to the C loop otherwise. The SSE code processes 16 samples at a
+ time and leaves any remainder for the C - there is no remainder in practice */
+
+static inline bool aligned16(const void *in, const void *out)
+{
+    return (((unsigned long)in | (unsigned long)out) & 0xf) == 0;
+}
 
 static int toFloat8(float *out, uchar *in, int len)
 {
@@ -63,7 +87,7 @@ static int toFloat8(float *out, uchar *in, int len)
     float f = 1.0f / ((1<<7) - 1);
 
 #if ARCH_X86
-    if (sse_check() && len >= 16)
+    if (use_sse() && len >= 16 && aligned16(in, out))
     {
         int loops = len >> 4;
         i = loops << 4;
@@ -110,8 +134,10 @@ static int toFloat8(float *out, uchar *in, int len)
             "add        $64,    %0          \n\t"
             "sub        $1, %%ecx           \n\t"
             "jnz        1b                  \n\t"
-            :"+r"(out),"+r"(in)
-            :"c"(loops), "r"(a), "r"(f)
+            :"+r"(out), "+r"(in), "+c"(loops)
+            :"r"(a), "r"(f)
+            : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",
+                           "xmm4", "xmm5", "xmm6", "xmm7",) "memory"
         );
     }
 #endif //ARCH_x86
@@ -130,27 +156,43 @@ static int fromFloat8(uchar *out, float *in, int len)
     float f = (1<<7) - 1;
 
 #if ARCH_X86
-    if (sse_check() && len >= 16 && ((unsigned long)out & 0xf) == 0)
+    if (use_sse() && len >= 16 && ((unsigned long)out & 0xf) == 0)
     {
+        float o = 1, mo = -1;
         int loops = len >> 4;
         i = loops << 4;
         int a = 0x80808080;
 
+        // clip first, saturating alone would give 0 rather than 1 below -1.0
         __asm__ volatile (
             "movd       %3, %%xmm0          \n\t"
             "movd       %4, %%xmm7          \n\t"
+            "movss      %5, %%xmm5          \n\t"
+            "movss      %6, %%xmm6          \n\t"
             "punpckldq  %%xmm0, %%xmm0      \n\t"
             "punpckldq  %%xmm7, %%xmm7      \n\t"
+            "punpckldq  %%xmm5, %%xmm5      \n\t"
+            "punpckldq  %%xmm6, %%xmm6      \n\t"
             "punpckldq  %%xmm0, %%xmm0      \n\t"
             "punpckldq  %%xmm7, %%xmm7      \n\t"
+            "punpckldq  %%xmm5, %%xmm5      \n\t"
+            "punpckldq  %%xmm6, %%xmm6      \n\t"
             "1:                             \n\t"
             "movups     (%1), %%xmm1        \n\t"
             "movups     16(%1), %%xmm2      \n\t"
-            "mulps      %%xmm7, %%xmm1      \n\t"
+            "minps      %%xmm5, %%xmm1      \n\t"
             "movups     32(%1), %%xmm3      \n\t"
+            "minps      %%xmm5, %%xmm2      \n\t"
+            "movups     48(%1), %%xmm4      \n\t"
+            "maxps      %%xmm6, %%xmm1      \n\t"
+            "minps      %%xmm5, %%xmm3      \n\t"
+            "maxps      %%xmm6, %%xmm2      \n\t"
+            "minps      %%xmm5, %%xmm4      \n\t"
+            "maxps      %%xmm6, %%xmm3      \n\t"
+            "mulps      %%xmm7, %%xmm1      \n\t"
+            "maxps      %%xmm6, %%xmm4      \n\t"
             "mulps      %%xmm7, %%xmm2      \n\t"
             "cvtps2dq   %%xmm1, %%xmm1      \n\t"
-            "movups     48(%1), %%xmm4      \n\t"
             "mulps      %%xmm7, %%xmm3      \n\t"
             "cvtps2dq   %%xmm2, %%xmm2      \n\t"
             "mulps      %%xmm7, %%xmm4      \n\t"
@@ -165,8 +207,10 @@ static int fromFloat8(uchar *out, float *in, int len)
             "add        $16,    %0          \n\t"
             "sub        $1, %%ecx           \n\t"
             "jnz        1b                  \n\t"
-            :"+r"(out),"+r"(in)
-            :"c"(loops), "r"(a), "r"(f)
+            :"+r"(out), "+r"(in), "+c"(loops)
+            :"r"(a), "r"(f), "m"(o), "m"(mo)
+            : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",
+                           "xmm4", "xmm5", "xmm6", "xmm7",) "memory"
         );
     }
 #endif //ARCH_x86
@@ -181,7 +225,7 @@ static int toFloat16(float *out, short *in, int len)
     float f = 1.0f / ((1<<15) - 1);
 
 #if ARCH_X86
-    if (sse_check() && len >= 16)
+    if (use_sse() && len >= 16 && aligned16(in, out))
     {
         int loops = len >> 4;
         i = loops << 4;
@@ -219,8 +263,10 @@ static int toFloat16(float *out, short *in, int len)
             "add        $64, %0             \n\t"
             "sub        $1, %%ecx           \n\t"
             "jnz        1b                  \n\t"
-            :"+r"(out),"+r"(in)
-            :"c"(loops), "r"(f)
+            :"+r"(out), "+r"(in), "+c"(loops)
+            :"r"(f)
+            : XMM_CLOBBERS("xmm1", "xmm2", "xmm3", "xmm4",
+                           "xmm5", "xmm6", "xmm7",) "memory"
         );
     }
 #endif //ARCH_x86
@@ -235,23 +281,39 @@ static int fromFloat16(short *out, float *in, int len)
     float f = (1<<15) - 1;
 
 #if ARCH_X86
-    if (sse_check() && len >= 16 && ((unsigned long)out & 0xf) == 0)
+    if (use_sse() && len >= 16 && ((unsigned long)out & 0xf) == 0)
     {
+        float o = 1, mo = -1;
         int loops = len >> 4;
         i = loops << 4;
 
+        // clip first, saturating alone would give -32768 below -1.0
         __asm__ volatile (
             "movd       %3, %%xmm7          \n\t"
+            "movss      %4, %%xmm5          \n\t"
+            "movss      %5, %%xmm6          \n\t"
             "punpckldq  %%xmm7, %%xmm7      \n\t"
+            "punpckldq  %%xmm5, %%xmm5      \n\t"
+            "punpckldq  %%xmm6, %%xmm6      \n\t"
             "punpckldq  %%xmm7, %%xmm7      \n\t"
+            "punpckldq  %%xmm5, %%xmm5      \n\t"
+            "punpckldq  %%xmm6, %%xmm6      \n\t"
             "1:                             \n\t"
             "movups     (%1), %%xmm1        \n\t"
             "movups     16(%1), %%xmm2      \n\t"
-            "mulps      %%xmm7, %%xmm1      \n\t"
+            "minps      %%xmm5, %%xmm1      \n\t"
             "movups     32(%1), %%xmm3      \n\t"
+            "minps      %%xmm5, %%xmm2      \n\t"
+            "movups     48(%1), %%xmm4      \n\t"
+            "maxps      %%xmm6, %%xmm1      \n\t"
+            "minps      %%xmm5, %%xmm3      \n\t"
+            "maxps      %%xmm6, %%xmm2      \n\t"
+            "minps      %%xmm5, %%xmm4      \n\t"
+            "maxps      %%xmm6, %%xmm3      \n\t"
+            "mulps      %%xmm7, %%xmm1      \n\t"
+            "maxps      %%xmm6, %%xmm4      \n\t"
             "mulps      %%xmm7, %%xmm2      \n\t"
             "cvtps2dq   %%xmm1, %%xmm1      \n\t"
-            "movups     48(%1), %%xmm4      \n\t"
             "mulps      %%xmm7, %%xmm3      \n\t"
             "cvtps2dq   %%xmm2, %%xmm2      \n\t"
             "mulps      %%xmm7, %%xmm4      \n\t"
@@ -265,8 +327,10 @@ static int fromFloat16(short *out, float *in, int len)
             "add        $32,    %0          \n\t"
             "sub        $1, %%ecx           \n\t"
             "jnz        1b                  \n\t"
-            :"+r"(out),"+r"(in)
-            :"c"(loops), "r"(f)
+            :"+r"(out), "+r"(in), "+c"(loops)
+            :"r"(f), "m"(o), "m"(mo)
+            : XMM_CLOBBERS("xmm1", "xmm2", "xmm3", "xmm4",
+                           "xmm5", "xmm6", "xmm7",) "memory"
         );
     }
 #endif //ARCH_x86
@@ -286,7 +350,7 @@ static int toFloat32(AudioFormat format, float *out, int *in, int len)
         shift = 0;
 
 #if ARCH_X86
-    if (sse_check() && len >= 16)
+    if (use_sse() && len >= 16 && aligned16(in, out))
     {
         int loops = len >> 4;
         i = loops << 4;
@@ -321,8 +385,10 @@ static int toFloat32(AudioFormat format, float *out, int *in, int len)
             "add        $64,    %0          \n\t"
             "sub        $1, %%ecx           \n\t"
             "jnz        1b                  \n\t"
-            :"+r"(out),"+r"(in)
-            :"c"(loops), "r"(f), "r"(shift)
+            :"+r"(out), "+r"(in), "+c"(loops)
+            :"r"(f), "r"(shift)
+            : XMM_CLOBBERS("xmm1", "xmm2", "xmm3", "xmm4",
+                           "xmm6", "xmm7",) "memory"
         );
     }
 #endif //ARCH_x86
@@ -342,7 +408,7 @@ static int fromFloat32(AudioFormat format, int *out, float *in, int len)
         shift = 0;
 
 #if ARCH_X86
-    if (sse_check() && len >= 16 && ((unsigned long)out & 0xf) == 0)
+    if (use_sse() && len >= 16 && ((unsigned long)out & 0xf) == 0)
     {
         float o = 1, mo = -1;
         int loops = len >> 4;
@@ -392,8 +458,10 @@ static int fromFloat32(AudioFormat format, int *out, float *in, int len)
             "add        $64,    %0          \n\t"
             "sub        $1, %%ecx           \n\t"
             "jnz        1b                  \n\t"
-            :"+r"(out), "+r"(in)
-            :"c"(loops), "r"(f), "m"(o), "m"(mo), "r"(shift)
+            :"+r"(out), "+r"(in), "+c"(loops)
+            :"r"(f), "m"(o), "m"(mo), "r"(shift)
+            : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",
+                           "xmm4", "xmm5", "xmm6", "xmm7",) "memory"
         );
     }
 #endif //ARCH_x86
@@ -407,7 +475,7 @@ static int fromFloatFLT(float *out, float *in, int len)
     int i = 0;
 
 #if ARCH_X86
-    if (sse_check() && len >= 16 && ((unsigned long)in & 0xf) == 0)
+    if (use_sse() && len >= 16 && ((unsigned long)in & 0xf) == 0)
     {
         int loops = len >> 4;
         float o = 1, mo = -1;
@@ -441,8 +509,10 @@ static int fromFloatFLT(float *out, float *in, int len)
             "add        $64,    %0          \n\t"
             "sub        $1, %%ecx           \n\t"
             "jnz        1b                  \n\t"
-            :"+r"(out), "+r"(in)
-            :"c"(loops), "m"(o), "m"(mo)
+            :"+r"(out), "+r"(in), "+c"(loops)
+            :"m"(o), "m"(mo)
+            : XMM_CLOBBERS("xmm1", "xmm2", "xmm3", "xmm4",
+                           "xmm6", "xmm7",) "memory"
         );
     }
 #endif //ARCH_x86
@@ -464,6 +534,30 @@ bool AudioOutputUtil::has_hardware_fpu()
 #endif
 }
 
+/**
+ * Turn the SIMD versions of the conversion, volume and upmix loops on or off
+ *
+ * They are on by default where the CPU has them; turning them off is only
+ * useful for comparing against or timing the C loops.
+ */
+void AudioOutputUtil::EnableSIMD(bool enable)
+{
+    simd_enabled = enable;
+}
+
+/**
+ * Returns the name of the SIMD instruction set the loops use on this CPU,
+ * or NULL if there is none.
+ */
+const char *AudioOutputUtil::SIMDName(void)
+{
+#if ARCH_X86
+    if (sse_check())
+        return "SSE2";
+#endif
+    return NULL;
+}
+
 /**
  * Convert integer samples to floats
  *
@@ -528,7 +622,39 @@ void AudioOutputUtil::MonoToStereo(void *dst, void *src, int samples)
 {
     float *d = (float *)dst;
     float *s = (float *)src;
-    for (int i = 0; i < samples; i++)
+    int i    = 0;
+
+#if ARCH_X86
+    if (use_sse() && samples >= 8)
+    {
+        int loops = samples >> 3;
+        i = loops << 3;
+
+        __asm__ volatile (
+            "1:                             \n\t"
+            "movups     (%1), %%xmm0        \n\t"
+            "movups     16(%1), %%xmm2      \n\t"
+            "movaps     %%xmm0, %%xmm1      \n\t"
+            "movaps     %%xmm2, %%xmm3      \n\t"
+            "unpcklps   %%xmm0, %%xmm0      \n\t"
+            "unpckhps   %%xmm1, %%xmm1      \n\t"
+            "unpcklps   %%xmm2, %%xmm2      \n\t"
+            "unpckhps   %%xmm3, %%xmm3      \n\t"
+            "movups     %%xmm0, (%0)        \n\t"
+            "movups     %%xmm1, 16(%0)      \n\t"
+            "add        $32,    %1          \n\t"
+            "movups     %%xmm2, 32(%0)      \n\t"
+            "movups     %%xmm3, 48(%0)      \n\t"
+            "add        $64,    %0          \n\t"
+            "sub        $1, %%ecx           \n\t"
+            "jnz        1b                  \n\t"
+            :"+r"(d), "+r"(s), "+c"(loops)
+            :
+            : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",) "memory"
+        );
+    }
+#endif //ARCH_X86
+    for (; i < samples; i++)
     {
         *d++ = *s;
         *d++ = *s++;
@@ -564,7 +690,7 @@ void AudioOutputUtil::AdjustVolume(void *buf, int len, int volume,
         return;
 
 #if ARCH_X86
-    if (sse_check() && samples >= 16)
+    if (use_sse() && samples >= 16)
     {
         int loops = samples >> 4;
         i = loops << 4;
@@ -589,8 +715,9 @@ void AudioOutputUtil::AdjustVolume(void *buf, int len, int volume,
             "add        $64,    %0          \n\t"
             "sub        $1, %%ecx           \n\t"
             "jnz        1b                  \n\t"
-            :"+r"(fptr)
-            :"c"(loops),"m"(g)
+            :"+r"(fptr), "+c"(loops)
+            :"m"(g)
+            : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3", "xmm4",) "memory"
         );
     }
 #endif //ARCH_X86
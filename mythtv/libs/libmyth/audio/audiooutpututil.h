@@ -10,6 +10,8 @@ class MPUBLIC AudioOutputUtil
 {
  public:
     static bool has_hardware_fpu();
+    static void EnableSIMD(bool enable);
+    static const char *SIMDName(void);
     static int  toFloat(AudioFormat format, void *out, void *in, int bytes);
     static int  fromFloat(AudioFormat format, void *out, void *in, int bytes);
     static void MonoToStereo(void *dst, void *src, int samples);
@@ -34,6 +34,7 @@ HEADERS += remoteutil.h
 HEADERS += rawsettingseditor.h
 HEADERS += programinfo.h          programinfoupdater.h
 HEADERS += programtypes.h         recordingtypes.h
+HEADERS += positionmap.h
 HEADERS += mythrssmanager.h       netgrabbermanager.h
 HEADERS += rssparse.h             netutils.h
 
@@ -62,6 +63,7 @@ SOURCES += remoteutil.cpp
 SOURCES += rawsettingseditor.cpp
 SOURCES += programinfo.cpp        programinfoupdater.cpp
 SOURCES += programtypes.cpp       recordingtypes.cpp
+SOURCES += positionmap.cpp
 SOURCES += mythrssmanager.cpp     netgrabbermanager.cpp
 SOURCES += rssparse.cpp           netutils.cpp
 
@@ -112,6 +114,7 @@ inc.files += mythconfigdialogs.h mythconfiggroups.h
 inc.files += mythterminal.h       remoteutil.h
 inc.files += programinfo.h
 inc.files += programtypes.h       recordingtypes.h
+inc.files += positionmap.h
 inc.files += mythrssmanager.h     netgrabbermanager.h
 inc.files += rssparse.h           netutils.h
 
@@ -0,0 +1,164 @@
+// C++ headers
+#include <algorithm>
+
+// MythTV headers
+#include "positionmap.h"
+
+static void write_varint(QByteArray &data, uint64_t val)
+{
+    while (val >= 0x80)
+    {
+        data.append((char) ((val & 0x7f) | 0x80));
+        val >>= 7;
+    }
+    data.append((char) val);
+}
+
+static bool read_varint(const QByteArray &data, int &pos, uint64_t &val)
+{
+    val = 0;
+    for (uint shift = 0; (pos < data.size()) && (shift < 64); shift += 7)
+    {
+        uint8_t byte = data[pos++];
+        val |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/** \brief Adds a keyframe, replacing any entry for the same frame.
+ *
+ *   Appending in frame order is the fast case, anything else is
+ *   inserted in place.
+ */
+void PackedPositionMap::Append(uint64_t frame, uint64_t offset)
+{
+    if (m_frames.empty() || (frame > m_frames.back()))
+    {
+        m_frames.push_back(frame);
+        m_offsets.push_back(offset);
+        return;
+    }
+
+    vector<uint64_t>::iterator it =
+        lower_bound(m_frames.begin(), m_frames.end(), frame);
+    uint i = it - m_frames.begin();
+    if (*it == frame)
+    {
+        m_offsets[i] = offset;
+        return;
+    }
+
+    m_frames.insert(it, frame);
+    m_offsets.insert(m_offsets.begin() + i, offset);
+}
+
+void PackedPositionMap::Append(const frm_pos_map_t &map)
+{
+    m_frames.reserve(m_frames.size() + map.size());
+    m_offsets.reserve(m_offsets.size() + map.size());
+
+    frm_pos_map_t::const_iterator it = map.begin();
+    for (; it != map.end(); ++it)
+        Append(it.key(), *it);
+}
+
+/// Removes the entries from min_frame to max_frame, inclusive.
+void PackedPositionMap::Erase(uint64_t min_frame, uint64_t max_frame)
+{
+    vector<uint64_t>::iterator first =
+        lower_bound(m_frames.begin(), m_frames.end(), min_frame);
+    vector<uint64_t>::iterator last =
+        upper_bound(first, m_frames.end(), max_frame);
+
+    uint i = first - m_frames.begin();
+    uint j = last  - m_frames.begin();
+    m_frames.erase(first, last);
+    m_offsets.erase(m_offsets.begin() + i, m_offsets.begin() + j);
+}
+
+/** \brief Returns the index of the last keyframe at or before frame,
+ *         or -1 if there is none.
+ */
+int PackedPositionMap::Find(uint64_t frame) const
+{
+    vector<uint64_t>::const_iterator it =
+        upper_bound(m_frames.begin(), m_frames.end(), frame);
+    return (it - m_frames.begin()) - 1;
+}
+
+void PackedPositionMap::ToMap(frm_pos_map_t &map) const
+{
+    map.clear();
+    for (uint i = 0; i < m_frames.size(); i++)
+        map.insert(map.end(), m_frames[i], m_offsets[i]);
+}
+
+/** \brief Encodes the entries from index first on.
+ *
+ *   The frame number is shifted up one bit; the low bit is set when the
+ *   entry holds the frame and offset themselves rather than increments.
+ *   The first entry of every chunk is of that kind, so chunks can be
+ *   concatenated and decoded in one go.
+ */
+QByteArray PackedPositionMap::Encode(uint first) const
+{
+    QByteArray data;
+    data.reserve((m_frames.size() - min(first, size())) * 4);
+
+    for (uint i = first; i < m_frames.size(); i++)
+    {
+        if ((i > first) && (m_frames[i] > m_frames[i-1]) &&
+            (m_offsets[i] >= m_offsets[i-1]))
+        {
+            write_varint(data, (m_frames[i] - m_frames[i-1]) << 1);
+            write_varint(data, m_offsets[i] - m_offsets[i-1]);
+        }
+        else
+        {
+            write_varint(data, (m_frames[i] << 1) | 1);
+            write_varint(data, m_offsets[i]);
+        }
+    }
+
+    return data;
+}
+
+/** \brief Appends the entries of one or more encoded chunks.
+ *  \return false if the data is truncated or corrupt; the entries
+ *          before the bad one are still added.
+ */
+bool PackedPositionMap::Decode(const QByteArray &data)
+{
+    uint64_t frame = 0, offset = 0;
+    bool have_base = false;
+    int pos = 0;
+
+    while (pos < data.size())
+    {
+        uint64_t fval, oval;
+        if (!read_varint(data, pos, fval) || !read_varint(data, pos, oval))
+            return false;
+
+        if (fval & 1)
+        {
+            frame  = fval >> 1;
+            offset = oval;
+            have_base = true;
+        }
+        else if (have_base)
+        {
+            frame  += fval >> 1;
+            offset += oval;
+        }
+        else
+        {
+            return false;
+        }
+
+        Append(frame, offset);
+    }
+
+    return true;
+}
@@ -0,0 +1,57 @@
+// -*- Mode: c++ -*-
+#ifndef _POSITION_MAP_H_
+#define _POSITION_MAP_H_
+
+// ANSI C
+#include <stdint.h> // for [u]int[32,64]_t
+
+// C++ headers
+#include <vector>
+using namespace std;
+
+// Qt headers
+#include <QByteArray>
+
+// MythTV headers
+#include "programtypes.h"
+#include "mythexp.h"
+
+/** \class PackedPositionMap
+ *  \brief Keyframe position map kept in two sorted arrays, with a compact
+ *         delta encoding for storing it.
+ *
+ *   Recorders append keyframes in order, and Encode() turns the entries
+ *   added since the last save into a chunk which can be appended to the
+ *   stored map as is. Each entry is a pair of variable length integers,
+ *   the frame and offset increments from the entry before it, so a GOP
+ *   takes about four bytes instead of a table row.
+ */
+class MPUBLIC PackedPositionMap
+{
+  public:
+    PackedPositionMap() {}
+
+    void Append(uint64_t frame, uint64_t offset);
+    void Append(const frm_pos_map_t &map);
+    void Erase(uint64_t min_frame, uint64_t max_frame);
+    void clear(void)              { m_frames.clear(); m_offsets.clear(); }
+
+    bool   empty(void) const      { return m_frames.empty(); }
+    uint   size(void)  const      { return m_frames.size();  }
+    uint64_t FrameAt(uint i) const  { return m_frames[i];  }
+    uint64_t OffsetAt(uint i) const { return m_offsets[i]; }
+    uint64_t LastFrame(void) const
+        { return m_frames.empty() ? 0 : m_frames.back(); }
+
+    int  Find(uint64_t frame) const;
+    void ToMap(frm_pos_map_t &map) const;
+
+    QByteArray Encode(uint first = 0) const;
+    bool Decode(const QByteArray &data);
+
+  private:
+    vector<uint64_t> m_frames;
+    vector<uint64_t> m_offsets;
+};
+
+#endif // _POSITION_MAP_H_
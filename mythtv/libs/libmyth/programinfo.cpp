@@ -28,6 +28,7 @@ using namespace std;
 #include "storagegroup.h"
 #include "mythlogging.h"
 #include "programinfo.h"
+#include "positionmap.h"
 #include "remotefile.h"
 #include "remoteutil.h"
 #include "dialogbox.h"
@@ -1645,8 +1646,7 @@ uint ProgramInfo::GetSecondsInRecording(void) const
 /// \brief Returns last frame in position map or 0
 uint64_t ProgramInfo::QueryLastFrameInPosMap(void) const
 {
-    uint64_t last_frame = 0;
-    frm_pos_map_t posMap;
+    PackedPositionMap posMap;
     QueryPositionMap(posMap, MARK_GOP_BYFRAME);
     if (posMap.empty())
     {
@@ -1654,13 +1654,7 @@ uint64_t ProgramInfo::QueryLastFrameInPosMap(void) const
         if (posMap.empty())
             QueryPositionMap(posMap, MARK_KEYFRAME);
     }
-    if (!posMap.empty())
-    {
-        frm_pos_map_t::const_iterator it = posMap.constEnd();
-        --it;
-        last_frame = it.key();
-    }
-    return last_frame;
+    return posMap.LastFrame();
 }
 
 QString ProgramInfo::toString(const Verbosity v, QString sep, QString grp)
@@ -3302,14 +3296,66 @@ void ProgramInfo::QueryPositionMap(
         return;
     }
 
+    PackedPositionMap packed;
+    QueryPositionMap(packed, type);
+    packed.ToMap(posMap);
+}
+
+/** \brief Loads the position map without building a QMap of it.
+ *
+ *   Recordings keep their position maps in recordedseekmap, packed as
+ *   PackedPositionMap chunks. Recordings made before that was added,
+ *   and videos, still use a row per keyframe.
+ */
+void ProgramInfo::QueryPositionMap(
+    PackedPositionMap &posMap, MarkTypes type) const
+{
     posMap.clear();
+
+    if (positionMapDBReplacement)
+    {
+        QMutexLocker locker(positionMapDBReplacement->lock);
+        posMap.Append(positionMapDBReplacement->map[(MarkTypes)type]);
+
+        return;
+    }
+
     MSqlQuery query(MSqlQuery::InitCon());
 
+    if (!IsVideo() && IsRecording())
+    {
+        query.prepare("SELECT data FROM recordedseekmap"
+                      " WHERE chanid = :CHANID"
+                      " AND starttime = :STARTTIME"
+                      " AND type = :TYPE ;");
+        query.bindValue(":CHANID", chanid);
+        query.bindValue(":STARTTIME", recstartts);
+        query.bindValue(":TYPE", type);
+
+        if (!query.exec())
+        {
+            MythDB::DBError("QueryPositionMap", query);
+            return;
+        }
+
+        if (query.next())
+        {
+            if (!posMap.Decode(query.value(0).toByteArray()))
+            {
+                LOG(VB_GENERAL, LOG_ERR, LOC +
+                    QString("Position map type %1 is corrupt, "
+                            "loaded %2 entries").arg(type).arg(posMap.size()));
+            }
+            return;
+        }
+    }
+
     if (IsVideo())
     {
         query.prepare("SELECT mark, offset FROM filemarkup"
                       " WHERE filename = :PATH"
-                      " AND type = :TYPE ;");
+                      " AND type = :TYPE"
+                      " ORDER BY mark ;");
         query.bindValue(":PATH", StorageGroup::GetRelativePathname(pathname));
     }
     else if (IsRecording())
@@ -3317,7 +3363,8 @@ void ProgramInfo::QueryPositionMap(
         query.prepare("SELECT mark, offset FROM recordedseek"
                       " WHERE chanid = :CHANID"
                       " AND starttime = :STARTTIME"
-                      " AND type = :TYPE ;");
+                      " AND type = :TYPE"
+                      " ORDER BY mark ;");
         query.bindValue(":CHANID", chanid);
         query.bindValue(":STARTTIME", recstartts);
     }
@@ -3334,7 +3381,8 @@ void ProgramInfo::QueryPositionMap(
     }
 
     while (query.next())
-        posMap[query.value(0).toULongLong()] = query.value(1).toULongLong();
+        posMap.Append(query.value(0).toULongLong(),
+                      query.value(1).toULongLong());
 }
 
 void ProgramInfo::ClearPositionMap(MarkTypes type) const
@@ -3357,6 +3405,17 @@ void ProgramInfo::ClearPositionMap(MarkTypes type) const
     }
     else if (IsRecording())
     {
+        query.prepare("DELETE FROM recordedseekmap"
+                      " WHERE chanid = :CHANID"
+                      " AND starttime = :STARTTIME"
+                      " AND type = :TYPE ;");
+        query.bindValue(":CHANID", chanid);
+        query.bindValue(":STARTTIME", recstartts);
+        query.bindValue(":TYPE", type);
+
+        if (!query.exec())
+            MythDB::DBError("clear position map", query);
+
         query.prepare("DELETE FROM recordedseek"
                       " WHERE chanid = :CHANID"
                       " AND starttime = :STARTTIME"
@@ -3423,6 +3482,63 @@ void ProgramInfo::SavePositionMap(
         return;
     }
 
+    if (!IsVideo() && IsRecording())
+    {
+        // Merge into the stored map, and rewrite it as a single chunk
+        PackedPositionMap packed;
+        if ((min_frame >= 0) || (max_frame >= 0))
+        {
+            QueryPositionMap(packed, type);
+            packed.Erase((min_frame >= 0) ? (uint64_t)min_frame : 0,
+                         (max_frame >= 0) ? (uint64_t)max_frame : ~0ULL);
+        }
+
+        frm_pos_map_t::const_iterator it = posMap.begin();
+        for (; it != posMap.end(); ++it)
+        {
+            uint64_t frame = it.key();
+
+            if ((min_frame >= 0) && (frame < (uint64_t)min_frame))
+                continue;
+
+            if ((max_frame >= 0) && (frame > (uint64_t)max_frame))
+                continue;
+
+            packed.Append(frame, *it);
+        }
+
+        MSqlQuery query(MSqlQuery::InitCon());
+        query.prepare(
+            "REPLACE INTO "
+            "recordedseekmap (chanid, starttime, type, entries, data) "
+            " VALUES ( :CHANID , :STARTTIME , :TYPE , :ENTRIES , :DATA )");
+        query.bindValue(":CHANID",    chanid);
+        query.bindValue(":STARTTIME", recstartts);
+        query.bindValue(":TYPE",      type);
+        query.bindValue(":ENTRIES",   packed.size());
+        query.bindValue(":DATA",      packed.Encode());
+
+        if (!query.exec())
+        {
+            MythDB::DBError("position map save", query);
+            return;
+        }
+
+        // Any rows left are an old copy, which is merged in now.
+        query.prepare("DELETE FROM recordedseek"
+                      " WHERE chanid = :CHANID"
+                      " AND starttime = :STARTTIME"
+                      " AND type = :TYPE ;");
+        query.bindValue(":CHANID",    chanid);
+        query.bindValue(":STARTTIME", recstartts);
+        query.bindValue(":TYPE",      type);
+
+        if (!query.exec())
+            MythDB::DBError("position map clear", query);
+
+        return;
+    }
+
     MSqlQuery query(MSqlQuery::InitCon());
     QString comp;
 
@@ -3442,16 +3558,6 @@ void ProgramInfo::SavePositionMap(
                       + comp + ';');
         query.bindValue(":PATH", videoPath);
     }
-    else if (IsRecording())
-    {
-        query.prepare("DELETE FROM recordedseek"
-                      " WHERE chanid = :CHANID"
-                      " AND starttime = :STARTTIME"
-                      " AND type = :TYPE"
-                      + comp + ';');
-        query.bindValue(":CHANID", chanid);
-        query.bindValue(":STARTTIME", recstartts);
-    }
     else
     {
         return;
@@ -3466,23 +3572,11 @@ void ProgramInfo::SavePositionMap(
     if (!query.exec())
         MythDB::DBError("position map clear", query);
 
-    if (IsVideo())
-    {
-        query.prepare(
-            "INSERT INTO "
-            "filemarkup (filename, mark, type, offset) "
-            "VALUES ( :PATH , :MARK , :TYPE , :OFFSET )");
-        query.bindValue(":PATH", videoPath);
-    }
-    else // if (IsRecording())
-    {
-        query.prepare(
-            "INSERT INTO "
-            "recordedseek (chanid, starttime, mark, type, offset) "
-            " VALUES ( :CHANID , :STARTTIME , :MARK , :TYPE , :OFFSET )");
-        query.bindValue(":CHANID",    chanid);
-        query.bindValue(":STARTTIME", recstartts);
-    }
+    query.prepare(
+        "INSERT INTO "
+        "filemarkup (filename, mark, type, offset) "
+        "VALUES ( :PATH , :MARK , :TYPE , :OFFSET )");
+    query.bindValue(":PATH", videoPath);
     query.bindValue(":TYPE", type);
 
     frm_pos_map_t::iterator it;
@@ -3509,6 +3603,11 @@ void ProgramInfo::SavePositionMap(
     }
 }
 
+/** \brief Adds the entries in posMap to the stored position map.
+ *
+ *   For recordings this is a single statement, which appends the
+ *   entries as a packed chunk however many of them there are.
+ */
 void ProgramInfo::SavePositionMapDelta(
     frm_pos_map_t &posMap, MarkTypes type) const
 {
@@ -3524,24 +3623,81 @@ void ProgramInfo::SavePositionMapDelta(
         return;
     }
 
+    if (posMap.empty())
+        return;
+
     MSqlQuery query(MSqlQuery::InitCon());
 
-    if (IsVideo())
+    if (!IsVideo() && IsRecording())
     {
+        PackedPositionMap packed;
+        packed.Append(posMap);
+
         query.prepare(
             "INSERT INTO "
-            "filemarkup (filename, mark, type, offset) "
-            "VALUES ( :PATH , :MARK , :TYPE , :OFFSET )");
-        query.bindValue(":PATH", StorageGroup::GetRelativePathname(pathname));
+            "recordedseekmap (chanid, starttime, type, entries, data) "
+            " VALUES ( :CHANID , :STARTTIME , :TYPE , :ENTRIES , :DATA ) "
+            "ON DUPLICATE KEY UPDATE "
+            " entries = entries + VALUES(entries), "
+            " data = CONCAT(data, VALUES(data))");
+        query.bindValue(":CHANID",    chanid);
+        query.bindValue(":STARTTIME", recstartts);
+        query.bindValue(":TYPE",      type);
+        query.bindValue(":ENTRIES",   packed.size());
+        query.bindValue(":DATA",      packed.Encode());
+
+        if (!query.exec())
+        {
+            MythDB::DBError("delta position map insert", query);
+            return;
+        }
+
+        // One row affected means the packed map was just created. A
+        // recording which started out with a row per keyframe, such as
+        // one in progress during the upgrade to the packed maps, still
+        // has those rows, and the packed map has to start with them.
+        if (query.numRowsAffected() != 1)
+            return;
+
+        query.prepare("SELECT mark, offset FROM recordedseek"
+                      " WHERE chanid = :CHANID"
+                      " AND starttime = :STARTTIME"
+                      " AND type = :TYPE ;");
+        query.bindValue(":CHANID",    chanid);
+        query.bindValue(":STARTTIME", recstartts);
+        query.bindValue(":TYPE",      type);
+
+        if (!query.exec())
+        {
+            MythDB::DBError("delta position map merge", query);
+            return;
+        }
+
+        if (!query.size())
+            return;
+
+        frm_pos_map_t merged;
+        while (query.next())
+            merged[query.value(0).toULongLong()] = query.value(1).toULongLong();
+        for (frm_pos_map_t::const_iterator it = posMap.begin();
+             it != posMap.end(); ++it)
+        {
+            merged[it.key()] = *it;
+        }
+
+        // Rewrites the packed map and removes the old rows
+        SavePositionMap(merged, type);
+
+        return;
     }
-    else if (IsRecording())
+
+    if (IsVideo())
     {
         query.prepare(
             "INSERT INTO "
-            "recordedseek (chanid, starttime, mark, type, offset) "
-            " VALUES ( :CHANID , :STARTTIME , :MARK , :TYPE , :OFFSET )");
-        query.bindValue(":CHANID",    chanid);
-        query.bindValue(":STARTTIME", recstartts);
+            "filemarkup (filename, mark, type, offset) "
+            "VALUES ( :PATH , :MARK , :TYPE , :OFFSET )");
+        query.bindValue(":PATH", StorageGroup::GetRelativePathname(pathname));
     }
     else
     {
@@ -3566,6 +3722,62 @@ void ProgramInfo::SavePositionMapDelta(
     }
 }
 
+/** \brief Writes the position map to the recordedseek table, a row per
+ *         keyframe, for programs which read the table directly.
+ *
+ *   The table is not read back once the packed map exists.
+ *  \return number of rows written, or -1 on error.
+ */
+int ProgramInfo::ExportPositionMap(MarkTypes type) const
+{
+    if (IsVideo() || !IsRecording())
+        return -1;
+
+    PackedPositionMap packed;
+    QueryPositionMap(packed, type);
+
+    MSqlQuery query(MSqlQuery::InitCon());
+    query.prepare("DELETE FROM recordedseek"
+                  " WHERE chanid = :CHANID"
+                  " AND starttime = :STARTTIME"
+                  " AND type = :TYPE ;");
+    query.bindValue(":CHANID",    chanid);
+    query.bindValue(":STARTTIME", recstartts);
+    query.bindValue(":TYPE",      type);
+
+    if (!query.exec())
+    {
+        MythDB::DBError("position map export", query);
+        return -1;
+    }
+
+    // Insert many rows per statement, the values are all numbers
+    const uint kRowsPerInsert = 1000;
+    QString prefix = QString(
+        "INSERT INTO recordedseek (chanid, starttime, mark, type, offset) "
+        "VALUES ");
+    QString start = MythDate::toString(recstartts, MythDate::kDatabase);
+    for (uint i = 0; i < packed.size(); i += kRowsPerInsert)
+    {
+        QStringList rows;
+        uint end = min(packed.size(), i + kRowsPerInsert);
+        for (uint j = i; j < end; j++)
+        {
+            rows << QString("(%1,'%2',%3,%4,%5)")
+                .arg(chanid).arg(start).arg(packed.FrameAt(j))
+                .arg((int)type).arg(packed.OffsetAt(j));
+        }
+
+        if (!query.exec(prefix + rows.join(",")))
+        {
+            MythDB::DBError("position map export", query);
+            return -1;
+        }
+    }
+
+    return packed.size();
+}
+
 /// \brief Store aspect ratio of a frame in the recordedmark table
 /// \note  All frames until the next one with a stored aspect ratio
 ///        are assumed to have the same aspect ratio
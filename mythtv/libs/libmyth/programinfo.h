@@ -65,6 +65,7 @@ typedef AutoDeleteDeque<ProgramInfo*> ProgramList;
 class MSqlQuery;
 class ProgramInfoUpdater;
 class PMapDBReplacement;
+class PackedPositionMap;
 
 class MPUBLIC ProgramInfo
 {
@@ -505,6 +506,7 @@ class MPUBLIC ProgramInfo
         programflags &= ~FL_IGNOREBOOKMARK;
         programflags |= (ignore) ? FL_IGNOREBOOKMARK : 0;
     }
+    void SetProgramFlags(uint32_t flags)          { programflags = flags; }
     void SetRecordingStatus(RecStatusType status) { recstatus = status; }
     void SetRecordingRuleType(RecordingType type) { rectype   = type;   }
     void SetPositionMapDBReplacement(PMapDBReplacement *pmap)
@@ -579,10 +581,12 @@ class MPUBLIC ProgramInfo
 
     // Keyframe positions map
     void QueryPositionMap(frm_pos_map_t &, MarkTypes type) const;
+    void QueryPositionMap(PackedPositionMap &, MarkTypes type) const;
     void ClearPositionMap(MarkTypes type) const;
     void SavePositionMap(frm_pos_map_t &, MarkTypes type,
                          int64_t min_frm = -1, int64_t max_frm = -1) const;
     void SavePositionMapDelta(frm_pos_map_t &, MarkTypes type) const;
+    int  ExportPositionMap(MarkTypes type) const;
 
     /// Sends event out that the ProgramInfo should be reloaded.
     void SendUpdateEvent(void);
@@ -36,6 +36,77 @@ vector<ProgramInfo *> *RemoteGetRecordedList(int sort)
     return info;
 }
 
+/** \brief Gets the recordings changed since the token of the last call.
+ *
+ *  Pass an empty token to get all the recordings. On success the token is
+ *  replaced with the one for the next call, and full is set if all the
+ *  recordings were returned rather than only the changes. The deleted
+ *  recordings are returned as ProgramInfo::MakeUniqueKey() keys.
+ *
+ *  \return false if the request failed, in which case nothing is
+ *          changed. unsupported is then set if that is because the backend
+ *          does not know the command.
+ */
+bool RemoteGetRecordedListDelta(QString &token, bool &full,
+                                vector<ProgramInfo *> &changed,
+                                QStringList &deleted, bool &unsupported)
+{
+    QStringList strlist(QString("QUERY_RECORDINGS_DELTA %1")
+                        .arg(token.isEmpty() ? "0" : token));
+
+    unsupported = false;
+    if (!gCoreContext->SendReceiveStringList(strlist))
+        return false;
+
+    if (!strlist.empty() && strlist[0] == "UNKNOWN_COMMAND")
+    {
+        unsupported = true;
+        return false;
+    }
+
+    if (strlist.size() < 4 || (strlist[1] != "FULL" && strlist[1] != "DELTA"))
+    {
+        LOG(VB_GENERAL, LOG_ERR,
+            "RemoteGetRecordedListDelta() got a malformed reply.");
+        return false;
+    }
+
+    int numrecordings = strlist[2].toInt();
+    if (numrecordings < 0 ||
+        numrecordings * NUMPROGRAMLINES + 4 > (int)strlist.size())
+    {
+        LOG(VB_GENERAL, LOG_ERR,
+            "RemoteGetRecordedListDelta() list size appears to be incorrect.");
+        return false;
+    }
+
+    QStringList::const_iterator it = strlist.begin() + 3;
+    vector<ProgramInfo *> reclist;
+    for (int i = 0; i < numrecordings; i++)
+        reclist.push_back(new ProgramInfo(it, strlist.end()));
+
+    int numdeleted = (it != strlist.end()) ? (*it).toInt() : -1;
+    if (numdeleted < 0 || (strlist.end() - it) != numdeleted + 1)
+    {
+        LOG(VB_GENERAL, LOG_ERR,
+            "RemoteGetRecordedListDelta() list size appears to be incorrect.");
+        while (!reclist.empty())
+        {
+            delete reclist.back();
+            reclist.pop_back();
+        }
+        return false;
+    }
+
+    token = strlist[0];
+    full = strlist[1] == "FULL";
+    changed.insert(changed.end(), reclist.begin(), reclist.end());
+    for (++it; it != strlist.end(); ++it)
+        deleted.push_back(*it);
+
+    return true;
+}
+
 bool RemoteGetLoad(float load[3])
 {
     QStringList strlist(QString("QUERY_LOAD"));
@@ -13,6 +13,10 @@ class ProgramInfo;
 class MythEvent;
 
 MPUBLIC vector<ProgramInfo *> *RemoteGetRecordedList(int sort);
+MPUBLIC bool RemoteGetRecordedListDelta(QString &token, bool &full,
+                                        vector<ProgramInfo *> &changed,
+                                        QStringList &deleted,
+                                        bool &unsupported);
 MPUBLIC bool RemoteGetLoad(float load[3]);
 MPUBLIC bool RemoteGetUptime(time_t &uptime);
 MPUBLIC
@@ -1151,8 +1151,9 @@ bool MythCoreContext::CheckProtoVersion(MythSocket *socket, uint timeout_ms,
     if (!socket)
         return false;
 
-    QStringList strlist(QString("MYTH_PROTO_VERSION %1 %2")
-                        .arg(MYTH_PROTO_VERSION).arg(MYTH_PROTO_TOKEN));
+    QStringList strlist(QString("MYTH_PROTO_VERSION %1 %2 %3")
+                        .arg(MYTH_PROTO_VERSION).arg(MYTH_PROTO_TOKEN)
+                        .arg(MythSocket::GetBinaryProtocolOffer()).trimmed());
     socket->writeStringList(strlist);
 
     if (!socket->readStringList(strlist, timeout_ms) || strlist.empty())
@@ -1185,6 +1186,7 @@ bool MythCoreContext::CheckProtoVersion(MythSocket *socket, uint timeout_ms,
     {
         LOG(VB_GENERAL, LOG_INFO, QString("Using protocol version %1")
                                       .arg(MYTH_PROTO_VERSION));
+        socket->setBinaryProtocol(MythSocket::ParseBinaryProtocol(strlist, 2));
         return true;
     }
 
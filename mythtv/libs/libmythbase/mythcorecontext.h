@@ -25,6 +25,10 @@
 #define MYTH_APPNAME_MYTHSHUTDOWN "mythshutdown"
 #define MYTH_APPNAME_MYTHLCDSERVER "mythlcdserver"
 #define MYTH_APPNAME_MYTHAVTEST "mythavtest"
+#define MYTH_APPNAME_MYTHRECBENCH "mythrecbench"
+#define MYTH_APPNAME_MYTHPROTOBENCH "mythprotobench"
+#define MYTH_APPNAME_MYTHCOMMFLAGBENCH "mythcommflagbench"
+#define MYTH_APPNAME_MYTHAUDIOBENCH "mythaudiobench"
 #define MYTH_APPNAME_MYTHMEDIASERVER "mythmediaserver"
 #define MYTH_APPNAME_MYTHMETADATALOOKUP "mythmetadatalookup"
 #define MYTH_APPNAME_MYTHUTIL "mythutil"
@@ -2,9 +2,16 @@
 
 // ANSI C
 #include <cstdlib>
+#include <cstring>
+
+// C++
+#include <algorithm>
+using namespace std;
 
 // Qt
 #include <QVector>
+#include <QPair>
+#include <QtAlgorithms>
 #include <QSqlDriver>
 #include <QSemaphore>
 #include <QSqlError>
@@ -28,6 +35,10 @@
 #endif
 
 static const uint kPurgeTimeout = 60 * 60;
+/// Number of prepared statements kept open on each connection
+static const int kPreparedCacheSize = 32;
+/// Number of distinct statements MDBManager keeps statistics for
+static const int kMaxStatementStats = 1000;
 
 bool TestDatabase(QString dbHostName,
                   QString dbUserName,
@@ -68,7 +79,7 @@ bool TestDatabase(QString dbHostName,
     return ret;
 }
 
-MSqlDatabase::MSqlDatabase(const QString &name)
+MSqlDatabase::MSqlDatabase(const QString &name) : m_preparedUse(0)
 {
     m_name = name;
     m_name.detach();
@@ -85,6 +96,8 @@ MSqlDatabase::MSqlDatabase(const QString &name)
 
 MSqlDatabase::~MSqlDatabase()
 {
+    ClearPrepared();
+
     if (m_db.isOpen())
     {
         m_db.close();
@@ -228,13 +241,17 @@ bool MSqlDatabase::KickDatabase(void)
     m_lastDBKick = MythDate::current().addSecs(-60);
 
     if (!m_db.isOpen())
+    {
+        ClearPrepared();
         m_db.open();
+    }
 
     return m_db.isOpen();
 }
 
 bool MSqlDatabase::Reconnect()
 {
+    ClearPrepared();
     m_db.close();
     m_db.open();
 
@@ -245,6 +262,80 @@ bool MSqlDatabase::Reconnect()
     return open;
 }
 
+/** \brief Shares a cached statement prepared from query with prepared.
+ *
+ *   The statement stays taken by owner until ReleasePrepared() is called,
+ *   so nested queries on the same connection never share a result set.
+ *
+ *  \return false if the statement is not cached, or is in use.
+ */
+bool MSqlDatabase::TakePrepared(const QString &query, const MSqlQuery *owner,
+                                QSqlQuery &prepared)
+{
+    QHash<QString, PreparedQuery>::iterator it = m_prepared.find(query);
+    if (it == m_prepared.end() || (*it).owner)
+        return false;
+
+    (*it).owner   = owner;
+    (*it).lastUse = ++m_preparedUse;
+    prepared = (*it).query;
+    return true;
+}
+
+/// \brief Caches a statement just prepared by owner, which is using it.
+void MSqlDatabase::AddPrepared(const QString &query, const MSqlQuery *owner,
+                               const QSqlQuery &prepared)
+{
+    if (m_prepared.contains(query))
+        return;
+
+    if (m_prepared.size() >= kPreparedCacheSize)
+    {
+        // Close the least recently used statement which is not in use
+        QHash<QString, PreparedQuery>::iterator it = m_prepared.begin();
+        QHash<QString, PreparedQuery>::iterator oldest = m_prepared.end();
+        for (; it != m_prepared.end(); ++it)
+        {
+            if (!(*it).owner &&
+                (oldest == m_prepared.end() ||
+                 (*it).lastUse < (*oldest).lastUse))
+            {
+                oldest = it;
+            }
+        }
+        if (oldest == m_prepared.end())
+            return;
+        m_prepared.erase(oldest);
+    }
+
+    PreparedQuery entry;
+    entry.query   = prepared;
+    entry.owner   = owner;
+    entry.lastUse = ++m_preparedUse;
+    m_prepared.insert(query, entry);
+}
+
+/// \brief Makes the statement taken by owner available again.
+void MSqlDatabase::ReleasePrepared(const QString &query,
+                                   const MSqlQuery *owner)
+{
+    QHash<QString, PreparedQuery>::iterator it = m_prepared.find(query);
+    if (it == m_prepared.end() || (*it).owner != owner)
+        return;
+
+    // Drop any unread results, but keep the statement prepared
+    (*it).query.finish();
+    (*it).query.setForwardOnly(false);
+    (*it).owner = NULL;
+}
+
+/// \brief Closes all cached statements, they are only valid as long
+///        as the connection is.
+void MSqlDatabase::ClearPrepared(void)
+{
+    m_prepared.clear();
+}
+
 // -----------------------------------------------------------------------
 
 
@@ -256,10 +347,27 @@ MDBManager::MDBManager()
 
     m_schedCon = NULL;
     m_DDCon = NULL;
+
+    m_checkouts = 0;
+    m_reused = 0;
+    m_opened = 0;
+    m_peakConnCount = 0;
+
+    // Statement statistics are logged every MYTHTV_DB_STATS seconds
+    m_statsInterval = 0;
+    m_prepareHits = 0;
+    m_prepareMisses = 0;
+    if (getenv("MYTHTV_DB_STATS"))
+        m_statsInterval = QString(getenv("MYTHTV_DB_STATS")).toInt() * 1000;
+    if (m_statsInterval > 0)
+        m_statsTimer.start();
 }
 
 MDBManager::~MDBManager()
 {
+    if (StatisticsEnabled())
+        LogStatistics();
+
     CloseDatabases();
 
     if (m_connCount != 0 || m_schedCon || m_DDCon)
@@ -282,6 +390,8 @@ MSqlDatabase *MDBManager::popConnection(bool reuse)
 
     MSqlDatabase *db;
 
+    m_checkouts++;
+
 #if REUSE_CONNECTION
     if (reuse)
     {
@@ -289,6 +399,7 @@ MSqlDatabase *MDBManager::popConnection(bool reuse)
         if (db != NULL)
         {
             m_inuse_count[QThread::currentThread()]++;
+            m_reused++;
             m_lock.unlock();
             return db;
         }
@@ -300,6 +411,8 @@ MSqlDatabase *MDBManager::popConnection(bool reuse)
     {
         db = new MSqlDatabase("DBManager" + QString::number(m_nextConnID++));
         ++m_connCount;
+        m_opened++;
+        m_peakConnCount = max(m_peakConnCount, m_connCount);
         LOG(VB_DATABASE, LOG_INFO,
                 QString("New DB connection, total: %1").arg(m_connCount));
     }
@@ -350,6 +463,55 @@ void MDBManager::pushConnection(MSqlDatabase *db)
     m_lock.unlock();
 
     PurgeIdleConnections(true);
+
+    if (StatisticsEnabled())
+    {
+        m_statsLock.lock();
+        bool log = m_statsTimer.elapsed() >= m_statsInterval;
+        if (log)
+            m_statsTimer.restart();
+        m_statsLock.unlock();
+
+        if (log)
+            LogStatistics();
+    }
+}
+
+/** \brief Opens connections for the calling thread until it has count
+ *         idle ones, so that its first queries need not wait for them.
+ */
+void MDBManager::PrewarmConnections(uint count)
+{
+    m_lock.lock();
+    DBList &list = m_pool[QThread::currentThread()];
+    DBList added;
+    while ((uint)(list.size() + added.size()) < count)
+    {
+        added.push_back(new MSqlDatabase(
+                            "DBManager" + QString::number(m_nextConnID++)));
+        ++m_connCount;
+        m_opened++;
+    }
+    m_peakConnCount = max(m_peakConnCount, m_connCount);
+    m_lock.unlock();
+
+    if (added.isEmpty())
+        return;
+
+    // Open them outside the lock, it takes a round trip to the server
+    for (DBList::iterator it = added.begin(); it != added.end(); ++it)
+    {
+        (*it)->OpenDatabase();
+        (*it)->m_lastDBKick = MythDate::current();
+    }
+
+    m_lock.lock();
+    m_pool[QThread::currentThread()] += added;
+    m_lock.unlock();
+
+    LOG(VB_DATABASE, LOG_INFO,
+        QString("Opened %1 DB connections ahead of use, total: %2")
+            .arg(added.size()).arg(m_connCount));
 }
 
 void MDBManager::PurgeIdleConnections(bool leaveOne)
@@ -457,6 +619,7 @@ void MDBManager::CloseDatabases()
     {
         LOG(VB_DATABASE, LOG_INFO,
             "Closing DB connection named '" + (*it)->m_name + "'");
+        (*it)->ClearPrepared();
         (*it)->m_db.close();
         delete (*it);
         m_connCount--;
@@ -469,6 +632,7 @@ void MDBManager::CloseDatabases()
         MSqlDatabase *db = slist.takeFirst();
         LOG(VB_DATABASE, LOG_INFO,
             "Closing DB connection named '" + db->m_name + "'");
+        db->ClearPrepared();
         db->m_db.close();
         delete db;
 
@@ -480,6 +644,99 @@ void MDBManager::CloseDatabases()
     m_lock.unlock();
 }
 
+void MDBManager::CountPrepare(bool cached)
+{
+    QMutexLocker locker(&m_statsLock);
+    if (cached)
+        m_prepareHits++;
+    else
+        m_prepareMisses++;
+}
+
+void MDBManager::CountExec(const QString &query, int ms)
+{
+    QMutexLocker locker(&m_statsLock);
+
+    QHash<QString, MSqlStatementStats>::iterator it = m_statements.find(query);
+    if (it == m_statements.end())
+    {
+        // Queries with their values written into the text are all
+        // different, so past a point they are counted together.
+        MSqlStatementStats empty;
+        memset(&empty, 0, sizeof(empty));
+        if (m_statements.size() < kMaxStatementStats)
+            it = m_statements.insert(query, empty);
+        else
+        {
+            it = m_statements.find("<other statements>");
+            if (it == m_statements.end())
+                it = m_statements.insert("<other statements>", empty);
+        }
+    }
+
+    MSqlStatementStats &stats = *it;
+    stats.count++;
+    stats.totalMs += ms;
+    stats.maxMs = max(stats.maxMs, (uint)ms);
+
+    uint bucket = 0;
+    for (int limit = 1; bucket < MSqlStatementStats::kBuckets - 1 &&
+                        ms >= limit; limit *= 4)
+    {
+        bucket++;
+    }
+    stats.histogram[bucket]++;
+}
+
+static bool stats_by_total(const QPair<QString, MSqlStatementStats> &a,
+                           const QPair<QString, MSqlStatementStats> &b)
+{
+    return a.second.totalMs > b.second.totalMs;
+}
+
+/** \brief Logs the connection pool counters and the top statements by
+ *         total execution time.
+ *
+ *   Statement statistics are only kept when the MYTHTV_DB_STATS environment
+ *   variable is set to the number of seconds between these reports.
+ */
+void MDBManager::LogStatistics(uint top)
+{
+    m_lock.lock();
+    QString pool = QString("DB pool: %1 connections (peak %2), "
+                           "%3 checkouts, %4 shared, %5 opened")
+        .arg(m_connCount).arg(m_peakConnCount).arg(m_checkouts)
+        .arg(m_reused).arg(m_opened);
+    m_lock.unlock();
+
+    QList<QPair<QString, MSqlStatementStats> > list;
+    m_statsLock.lock();
+    pool += QString(", %1 of %2 prepares cached")
+        .arg(m_prepareHits).arg(m_prepareHits + m_prepareMisses);
+    QHash<QString, MSqlStatementStats>::const_iterator it;
+    for (it = m_statements.begin(); it != m_statements.end(); ++it)
+        list.push_back(qMakePair(it.key(), *it));
+    m_statsLock.unlock();
+
+    LOG(VB_GENERAL, LOG_INFO, pool);
+
+    qSort(list.begin(), list.end(), stats_by_total);
+    for (uint i = 0; i < top && i < (uint)list.size(); i++)
+    {
+        const MSqlStatementStats &stats = list[i].second;
+        QString hist;
+        for (uint j = 0; j < MSqlStatementStats::kBuckets; j++)
+            hist += QString(j ? "/%1" : "%1").arg(stats.histogram[j]);
+
+        LOG(VB_GENERAL, LOG_INFO,
+            QString("DB statement %1: %2 runs, %3 ms total, %4 ms avg, "
+                    "%5 ms max, histogram %6: %7")
+                .arg(i + 1).arg(stats.count).arg(stats.totalMs)
+                .arg(stats.totalMs / max(stats.count, 1U)).arg(stats.maxMs)
+                .arg(hist).arg(list[i].first.simplified().left(200)));
+    }
+}
+
 
 // -----------------------------------------------------------------------
 
@@ -497,6 +754,8 @@ MSqlQuery::MSqlQuery(const MSqlQueryInfo &qi)
     m_isConnected = false;
     m_db = qi.db;
     m_returnConnection = qi.returnConnection;
+    m_cached = false;
+    m_reused = false;
 
     m_isConnected = m_db && m_db->isOpen();
 
@@ -507,6 +766,8 @@ MSqlQuery::MSqlQuery(const MSqlQueryInfo &qi)
 
 MSqlQuery::~MSqlQuery()
 {
+    ReleasePrepared();
+
     if (m_returnConnection)
     {
         MDBManager *dbmanager = GetMythDB()->GetDBManager();
@@ -618,6 +879,17 @@ bool MSqlQuery::exec()
         return false;
     }
 
+    // A statement from the cache still holds the values its previous
+    // user bound. If we left any of them unbound, prepare the statement
+    // afresh so the query fails just like it would have without the cache.
+    if (m_reused && !CheckBindings())
+        return false;
+
+    MDBManager *dbmanager = GetMythDB()->GetDBManager();
+    MythTimer timer;
+    if (dbmanager->StatisticsEnabled())
+        timer.start();
+
     bool result = QSqlQuery::exec();
 
     // if the query failed with "MySQL server has gone away"
@@ -655,6 +927,9 @@ bool MSqlQuery::exec()
         }
     }
 
+    if (timer.isRunning())
+        dbmanager->CountExec(m_last_prepared_query, timer.elapsed());
+
     if (VERBOSE_LEVEL_CHECK(VB_DATABASE, LOG_DEBUG))
     {
         QString str = lastQuery();
@@ -701,6 +976,14 @@ bool MSqlQuery::exec(const QString &query)
         return false;
     }
 
+    // QSqlQuery::exec() gives this query a result of its own
+    ReleasePrepared();
+
+    MDBManager *dbmanager = GetMythDB()->GetDBManager();
+    MythTimer timer;
+    if (dbmanager->StatisticsEnabled())
+        timer.start();
+
     bool result = QSqlQuery::exec(query);
 
     // if the query failed with "MySQL server has gone away"
@@ -709,6 +992,9 @@ bool MSqlQuery::exec(const QString &query)
     if (!result && QSqlQuery::lastError().number() == 2006 && Reconnect())
         result = QSqlQuery::exec(query);
 
+    if (timer.isRunning())
+        dbmanager->CountExec(query, timer.elapsed());
+
     LOG(VB_DATABASE, LOG_DEBUG,
             QString("MSqlQuery::exec(%1) %2%3")
                     .arg(m_db->MSqlDatabase::GetConnectionName()).arg(query)
@@ -779,7 +1065,7 @@ bool MSqlQuery::seek(int where, bool relative)
     return seekDebug("seek", QSqlQuery::seek(where, relative), where, relative);
 }
 
-bool MSqlQuery::prepare(const QString& query)
+bool MSqlQuery::prepare(const QString& query, bool cache)
 {
     if (!m_db)
     {
@@ -787,7 +1073,9 @@ bool MSqlQuery::prepare(const QString& query)
         return false;
     }
 
+    ReleasePrepared();
     m_last_prepared_query = query;
+    m_bound.clear();
 
 #ifdef DEBUG_QT4_PORT
     if (query.contains(m_testbindings))
@@ -815,6 +1103,19 @@ bool MSqlQuery::prepare(const QString& query)
         return false;
     }
 
+    // Statements are kept prepared on each connection, so queries which
+    // are run over and over only make the server parse them once.
+    // QSqlQuery shares the prepared result when assigned, and detaches
+    // from it again when prepare() or exec(query) is called.
+    MDBManager *dbmanager = GetMythDB()->GetDBManager();
+    if (cache && m_db->TakePrepared(query, this, *this))
+    {
+        m_cached = true;
+        m_reused = true;
+        dbmanager->CountPrepare(true);
+        return true;
+    }
+
     bool ok = QSqlQuery::prepare(query);
 
     // if the prepare failed with "MySQL server has gone away"
@@ -822,6 +1123,12 @@ bool MSqlQuery::prepare(const QString& query)
     // connects again
     if (!ok && QSqlQuery::lastError().number() == 2006 && Reconnect())
         ok = true;
+    else if (ok && cache)
+    {
+        m_db->AddPrepared(query, this, *this);
+        m_cached = true;
+    }
+    dbmanager->CountPrepare(false);
 
     if (!ok && !(GetMythDB()->SuppressDBMessages()))
     {
@@ -862,6 +1169,7 @@ void MSqlQuery::bindValue(const QString &placeholder, const QVariant &val)
 #endif
 
     QSqlQuery::bindValue(placeholder, val, QSql::In);
+    m_bound.insert(placeholder);
 }
 
 void MSqlQuery::bindValues(const MSqlBindings &bindings)
@@ -878,8 +1186,56 @@ QVariant MSqlQuery::lastInsertId()
     return QSqlQuery::lastInsertId();
 }
 
+/// \brief Prepares the statement taken from the cache afresh, with only
+///        the values bound since prepare(), if a previous user of it bound
+///        any other placeholder.
+/// \return false if preparing it failed.
+bool MSqlQuery::CheckBindings(void)
+{
+    m_reused = false;
+
+    MSqlBindings bound = QSqlQuery::boundValues();
+    MSqlBindings::const_iterator it = bound.begin();
+    for (; it != bound.end(); ++it)
+    {
+        if (!m_bound.contains(it.key()))
+            break;
+    }
+    if (it == bound.end())
+        return true;
+
+    LOG(VB_GENERAL, LOG_WARNING,
+        QString("MSqlQuery: %1 was not bound in: %2")
+            .arg(it.key()).arg(m_last_prepared_query));
+
+    ReleasePrepared();
+    if (!QSqlQuery::prepare(m_last_prepared_query))
+        return false;
+
+    for (it = bound.begin(); it != bound.end(); ++it)
+    {
+        if (m_bound.contains(it.key()))
+            QSqlQuery::bindValue(it.key(), it.value(), QSql::In);
+    }
+    return true;
+}
+
+/// \brief Lets other queries on this connection use the cached statement.
+void MSqlQuery::ReleasePrepared(void)
+{
+    m_reused = false;
+    if (!m_cached)
+        return;
+
+    m_cached = false;
+    if (m_db)
+        m_db->ReleasePrepared(m_last_prepared_query, this);
+}
+
 bool MSqlQuery::Reconnect(void)
 {
+    // Reconnecting closes the cached statements
+    m_cached = false;
     if (!m_db->Reconnect())
         return false;
     if (!m_last_prepared_query.isEmpty())
@@ -10,6 +10,10 @@
 #include <QDateTime>
 #include <QMutex>
 #include <QList>
+#include <QHash>
+#include <QSet>
+
+#include "mythtimer.h"
 
 #include "mythbaseexp.h"
 #include "mythdbparams.h"
@@ -22,6 +26,8 @@ MBASE_PUBLIC bool TestDatabase(QString dbHostName,
                                QString dbName = "mythconverg",
                                int     dbPort = 3306);
 
+class MSqlQuery;
+
 /// \brief QSqlDatabase wrapper, used by MSqlQuery. Do not use directly.
 class MSqlDatabase
 {
@@ -41,13 +47,43 @@ class MSqlDatabase
     QSqlDatabase db(void) const { return m_db; }
     bool Reconnect(void);
 
+    bool TakePrepared(const QString &query, const MSqlQuery *owner,
+                      QSqlQuery &prepared);
+    void AddPrepared(const QString &query, const MSqlQuery *owner,
+                     const QSqlQuery &prepared);
+    void ReleasePrepared(const QString &query, const MSqlQuery *owner);
+    void ClearPrepared(void);
+
   private:
+    /// A statement prepared on this connection, and the query using it.
+    typedef struct PreparedQuery
+    {
+        QSqlQuery        query;
+        const MSqlQuery *owner;
+        uint             lastUse;
+    } PreparedQuery;
+
     QString m_name;
     QSqlDatabase m_db;
     QDateTime m_lastDBKick;
     DatabaseParams m_dbparms;
+    QHash<QString, PreparedQuery> m_prepared;
+    uint m_preparedUse;
 };
 
+/// \brief Execution statistics for one statement, kept by MDBManager.
+typedef struct MSqlStatementStats
+{
+    enum { kBuckets = 8 };
+
+    uint      count;
+    long long totalMs;
+    uint      maxMs;
+    /// Executions taking under 1, 4, 16, 64, 256, 1024 and 4096 ms,
+    /// and the rest.
+    uint      histogram[kBuckets];
+} MSqlStatementStats;
+
 /// \brief DB connection pool, used by MSqlQuery. Do not use directly.
 class MBASE_PUBLIC MDBManager
 {
@@ -58,11 +94,18 @@ class MBASE_PUBLIC MDBManager
 
     void CloseDatabases(void);
     void PurgeIdleConnections(bool leaveOne = false);
+    void PrewarmConnections(uint count);
+
+    void LogStatistics(uint top = 10);
 
   protected:
     MSqlDatabase *popConnection(bool reuse);
     void pushConnection(MSqlDatabase *db);
 
+    bool StatisticsEnabled(void) const { return m_statsInterval > 0; }
+    void CountPrepare(bool cached);
+    void CountExec(const QString &query, int ms);
+
     MSqlDatabase *getSchedCon(void);
     MSqlDatabase *getDDCon(void);
 
@@ -83,6 +126,20 @@ class MBASE_PUBLIC MDBManager
     MSqlDatabase *m_schedCon;
     MSqlDatabase *m_DDCon;
     QHash<QThread*, DBList> m_static_pool;
+
+    // Pool statistics, protected by m_lock
+    uint m_checkouts;
+    uint m_reused;
+    uint m_opened;
+    int  m_peakConnCount;
+
+    // Statement statistics, protected by m_statsLock
+    QMutex m_statsLock;
+    int  m_statsInterval;
+    MythTimer m_statsTimer;
+    uint m_prepareHits;
+    uint m_prepareMisses;
+    QHash<QString, MSqlStatementStats> m_statements;
 };
 
 /// \brief MSqlDatabase Info, used by MSqlQuery. Do not use directly.
@@ -156,7 +213,10 @@ class MBASE_PUBLIC MSqlQuery : private QSqlQuery
     bool exec(const QString &query);
 
     /// \brief QSqlQuery::prepare() is not thread safe in Qt <= 3.3.2
-    bool prepare(const QString &query);
+    ///
+    /// Pass cache = false for statements built with a varying number of
+    /// placeholders, so they don't push others out of the statement cache.
+    bool prepare(const QString &query, bool cache = true);
 
     void bindValue(const QString &placeholder, const QVariant &val);
 
@@ -217,10 +277,15 @@ class MBASE_PUBLIC MSqlQuery : private QSqlQuery
 
     bool seekDebug(const char *type, bool result,
                    int where, bool relative) const;
+    bool CheckBindings(void);
+    void ReleasePrepared(void);
 
     MSqlDatabase *m_db;
     bool m_isConnected;
     bool m_returnConnection;
+    bool m_cached;      // shares a statement from the connection's cache
+    bool m_reused;      // ... which an earlier query may have bound
+    QSet<QString> m_bound; // placeholders bound since prepare()
     QString m_last_prepared_query; // holds a copy of the last prepared query
 #ifdef DEBUG_QT4_PORT
     QRegExp m_testbindings;
@@ -3,12 +3,18 @@
 #include <cassert>
 #include <cerrno>
 
+// C++
+#include <algorithm>
+
 #include "compat.h"
 
 // POSIX
 #ifndef USING_MINGW
 #include <sys/select.h> // for select
 #endif
+#ifdef __linux__
+#include <sys/sendfile.h> // for sendfile
+#endif
 
 // Qt
 #include <QByteArray>
@@ -33,6 +39,20 @@
 #define LOC SLOC(this)
 
 const uint MythSocket::kSocketBufferSize = 128000;
+const int  MythSocket::kFrameHeaderSize = 8;
+/// Binary frame payloads smaller than this are never compressed
+const int  MythSocket::kCompressMinSize = 64 * 1024;
+
+/// First byte of a binary frame header, a text frame header is the
+/// decimal payload size padded with spaces.
+static const char kBinaryFrameMark = 0x01;
+
+/// Type of each field of a binary frame
+enum {
+    kFieldEmpty  = 0, ///< no length or data follows
+    kFieldLatin1 = 1, ///< varint length, one byte per character
+    kFieldUTF16  = 2  ///< varint length, two bytes per character (LE)
+};
 const uint MythSocket::kShortTimeout = kMythSocketShortTimeout;
 const uint MythSocket::kLongTimeout  = kMythSocketLongTimeout;
 
@@ -48,7 +68,8 @@ MythSocket::MythSocket(int socket, MythSocketCBs *cb) :
     m_state(Idle),
     m_addr(),                   m_port(0),
     m_notifyread(false),        m_expectingreply(false),
-    m_isValidated(false),       m_isAnnounced(false)
+    m_isValidated(false),       m_isAnnounced(false),
+    m_binaryProtocol(kBinaryNone)
 {
     LOG(VB_SOCKET, LOG_DEBUG, LOC + "new socket");
 
@@ -298,30 +319,24 @@ bool MythSocket::writeStringList(QStringList &list)
         return false;
     }
 
-    QString str = list.join("[]:[]");
-    if (str.isEmpty())
+    QByteArray payload = EncodeStringList(list, m_binaryProtocol);
+    if (payload.isEmpty())
     {
         LOG(VB_GENERAL, LOG_ERR, LOC +
             "writeStringList: Error, joined null string.");
         return false;
     }
 
-    QByteArray utf8 = str.toUtf8();
-    int size = utf8.length();
+    int size = payload.length();
     int written = 0;
     int written_since_timer_restart = 0;
 
-    QByteArray payload;
-    payload = payload.setNum(size);
-    payload += "        ";
-    payload.truncate(8);
-    payload += utf8;
-    size = payload.length();
-
     if (VERBOSE_LEVEL_CHECK(VB_NETWORK, LOG_INFO))
     {
-        QString msg = QString("write -> %1 %2")
-            .arg(socket(), 2).arg(payload.data());
+        QString msg = QString("write -> %1 %2").arg(socket(), 2)
+            .arg((m_binaryProtocol & kBinaryFrames) ?
+                 QString("[binary %1] %2").arg(size - kFrameHeaderSize)
+                 .arg(list.join("[]:[]")) : QString(payload.data()));
 
         if (logLevel < LOG_DEBUG && msg.length() > 88)
         {
@@ -496,6 +511,90 @@ bool MythSocket::writeData(const char *data, quint64 len)
     return true;
 }
 
+/** \brief Writes up to len bytes of the file fd, starting at offset,
+ *         to the socket.
+ *
+ *  On Linux the data is handed straight from the page cache to the
+ *  socket with sendfile(2), elsewhere it is read into a bounce buffer
+ *  and written with writeData().
+ *
+ *  \return number of bytes written, which is less than len only when
+ *          the end of the file was reached, or -1 on error.
+ */
+qint64 MythSocket::writeFileData(int fd, long long offset, quint64 len)
+{
+    if (state() != Connected)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            "writeFileData: Error, called with unconnected socket.");
+        return -1;
+    }
+
+#ifdef __linux__
+    quint64 written = 0;
+    uint zerocnt = 0;
+    off_t off = offset;
+
+    while (written < len)
+    {
+        size_t btw = len - written >= kSocketBufferSize ?
+                                       kSocketBufferSize : len - written;
+        ssize_t sret = sendfile(socket(), fd, &off, btw);
+        if (sret > 0)
+        {
+            zerocnt = 0;
+            written += sret;
+        }
+        else if (sret == 0)
+        {
+            break; // end of file
+        }
+        else if (errno == EAGAIN || errno == EINTR)
+        {
+            zerocnt++;
+            if (zerocnt > 5000)
+            {
+                LOG(VB_GENERAL, LOG_ERR, LOC +
+                    "writeFileData: Error, zerocnt timeout");
+                return -1;
+            }
+            usleep(1000);
+        }
+        else
+        {
+            LOG(VB_GENERAL, LOG_ERR, LOC +
+                "writeFileData: Error, sendfile: " + ENO);
+            close();
+            return -1;
+        }
+    }
+    return written;
+#else
+    QByteArray buf((int)std::min(len, (quint64)kSocketBufferSize), '\0');
+    quint64 written = 0;
+
+    while (written < len)
+    {
+        size_t btr = std::min(len - written, (quint64)buf.size());
+        if (lseek(fd, offset + written, SEEK_SET) < 0)
+            return -1;
+        ssize_t rret = read(fd, buf.data(), btr);
+        if (rret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (rret == 0)
+            break; // end of file
+        if (!writeData(buf.constData(), rret))
+            return -1;
+        written += rret;
+    }
+    return written;
+#endif
+}
+
 bool MythSocket::readStringList(QStringList &list, uint timeoutMS)
 {
     list.clear();
@@ -511,7 +610,7 @@ bool MythSocket::readStringList(QStringList &list, uint timeoutMS)
     timer.start();
     int elapsed = 0;
 
-    while (waitForMore(5) < 8)
+    while (waitForMore(5) < kFrameHeaderSize)
     {
         elapsed = timer.elapsed();
         if (elapsed >= (int)timeoutMS)
@@ -553,8 +652,8 @@ bool MythSocket::readStringList(QStringList &list, uint timeoutMS)
         }
     }
 
-    QByteArray sizestr(8 + 1, '\0');
-    if (readBlock(sizestr.data(), 8) < 0)
+    QByteArray sizestr(kFrameHeaderSize + 1, '\0');
+    if (readBlock(sizestr.data(), kFrameHeaderSize) < 0)
     {
         LOG(VB_GENERAL, LOG_ERR, LOC +
             QString("readStringList: Error, readBlock return error (%1)")
@@ -563,8 +662,9 @@ bool MythSocket::readStringList(QStringList &list, uint timeoutMS)
         return false;
     }
 
-    QString sizes = sizestr;
-    qint64 btr = sizes.trimmed().toInt();
+    uint frameflags = 0;
+    qint64 btr = DecodeFrameHeader(sizestr.data(), frameflags);
+    qint64 size = btr;
 
     if (btr < 1)
     {
@@ -636,18 +736,23 @@ bool MythSocket::readStringList(QStringList &list, uint timeoutMS)
         }
     }
 
-    QString str = QString::fromUtf8(utf8.data());
-
-    QByteArray payload;
-    payload = payload.setNum(str.length());
-    payload += "        ";
-    payload.truncate(8);
-    payload += str;
+    utf8.truncate(size);
+    if (!DecodeStringList(utf8, frameflags, list))
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("Protocol error: invalid binary frame of %1 bytes.")
+                .arg(size));
+        return false;
+    }
 
     if (VERBOSE_LEVEL_CHECK(VB_NETWORK, LOG_INFO))
     {
-        QString msg = QString("read  <- %1 %2").arg(socket(), 2)
-            .arg(payload.data());
+        QString str = list.join("[]:[]");
+        QString prefix = (frameflags & kFrameBinary) ?
+            QString("[binary %1] ").arg(size) :
+            QString::number(str.length()).leftJustified(8, ' ', true);
+        QString msg = QString("read  <- %1 %2%3").arg(socket(), 2)
+            .arg(prefix).arg(str);
 
         if (logLevel < LOG_DEBUG && msg.length() > 88)
         {
@@ -657,8 +762,6 @@ bool MythSocket::readStringList(QStringList &list, uint timeoutMS)
         LOG(VB_NETWORK, LOG_INFO, LOC + msg);
     }
 
-    list = str.split("[]:[]");
-
     m_notifyread = false;
     s_readyread_thread->WakeReadyReadThread();
     return true;
@@ -848,8 +951,9 @@ bool MythSocket::Validate(uint timeout_ms, bool error_dialog_desired)
     if (m_isValidated)
         return true;
 
-    QStringList strlist(QString("MYTH_PROTO_VERSION %1 %2")
-                            .arg(MYTH_PROTO_VERSION).arg(MYTH_PROTO_TOKEN));
+    QStringList strlist(QString("MYTH_PROTO_VERSION %1 %2 %3")
+                            .arg(MYTH_PROTO_VERSION).arg(MYTH_PROTO_TOKEN)
+                            .arg(GetBinaryProtocolOffer()).trimmed());
     writeStringList(strlist);
 
     if (!readStringList(strlist, timeout_ms) || strlist.empty())
@@ -883,6 +987,7 @@ bool MythSocket::Validate(uint timeout_ms, bool error_dialog_desired)
     {
         LOG(VB_GENERAL, LOG_NOTICE, QString("Using protocol version %1")
                                .arg(MYTH_PROTO_VERSION));
+        setBinaryProtocol(ParseBinaryProtocol(strlist, 2));
         setValidated();
         return true;
     }
@@ -893,6 +998,278 @@ bool MythSocket::Validate(uint timeout_ms, bool error_dialog_desired)
     return false;
 }
 
+/** \brief Returns the tokens a client appends to MYTH_PROTO_VERSION
+ *         to offer the binary string list encoding.
+ *
+ *  Set MYTHTV_PROTO_TEXT in the environment to stay with the text
+ *  encoding, and MYTHTV_PROTO_COMPRESS to also offer compression of
+ *  large frames, which only pays off on slow links.
+ */
+QString MythSocket::GetBinaryProtocolOffer(void)
+{
+    if (getenv("MYTHTV_PROTO_TEXT"))
+        return QString();
+    if (getenv("MYTHTV_PROTO_COMPRESS"))
+        return "BINARY ZLIB";
+    return "BINARY";
+}
+
+/** \brief Returns the BinaryProtocol flags given by the tokens of a
+ *         MYTH_PROTO_VERSION request or its ACCEPT reply.
+ *  \param first index of the first token after the protocol version
+ */
+uint MythSocket::ParseBinaryProtocol(const QStringList &tokens, int first)
+{
+    if (getenv("MYTHTV_PROTO_TEXT"))
+        return kBinaryNone;
+
+    uint flags = kBinaryNone;
+    for (int i = first; i < tokens.size(); i++)
+    {
+        if (tokens[i] == "BINARY")
+            flags |= kBinaryFrames;
+        else if (tokens[i] == "ZLIB")
+            flags |= kBinaryCompress;
+    }
+
+    return (flags & kBinaryFrames) ? flags : kBinaryNone;
+}
+
+/// Returns the tokens a server appends to the ACCEPT reply to agree
+/// to the given BinaryProtocol flags.
+QStringList MythSocket::GetBinaryProtocolTokens(uint flags)
+{
+    QStringList tokens;
+    if (flags & kBinaryFrames)
+    {
+        tokens << "BINARY";
+        if (flags & kBinaryCompress)
+            tokens << "ZLIB";
+    }
+    return tokens;
+}
+
+static inline char *put_varint(char *p, quint64 val)
+{
+    while (val >= 0x80)
+    {
+        *p++ = (char)(val | 0x80);
+        val >>= 7;
+    }
+    *p++ = (char)val;
+    return p;
+}
+
+static inline bool get_varint(const uchar *&p, const uchar *end, quint64 &val)
+{
+    val = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        uchar b = *p++;
+        val |= (quint64)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/** \brief Returns a string list frame, including its header, in the
+ *         encoding given by the BinaryProtocol flags.
+ *
+ *  The text encoding is the size of the payload as 8 ASCII characters
+ *  followed by the strings joined with "[]:[]" in UTF-8.
+ *
+ *  The binary encoding's header is kBinaryFrameMark, the FrameFlags,
+ *  two zero bytes and the payload size as a 32 bit big endian integer.
+ *  The payload is the number of strings as a varint followed by a
+ *  field per string: a type byte, the length in characters as a varint
+ *  and the characters, as Latin-1 if they all fit and otherwise as
+ *  UTF-16. This avoids both the join/split and the UTF-8 conversion.
+ *
+ *  \return an empty QByteArray if the list is a single empty string,
+ *          which can not be sent in the text encoding.
+ */
+QByteArray MythSocket::EncodeStringList(const QStringList &list, uint flags)
+{
+    if (list.empty() || (list.size() == 1 && list[0].isEmpty()))
+        return QByteArray();
+
+    if (!(flags & kBinaryFrames))
+    {
+        QByteArray utf8 = list.join("[]:[]").toUtf8();
+        QByteArray frame;
+        frame.setNum(utf8.length());
+        frame += "        ";
+        frame.truncate(kFrameHeaderSize);
+        frame += utf8;
+        return frame;
+    }
+
+    // Worst case: a type byte, a 5 byte length and 2 bytes per character
+    qint64 maxsize = kFrameHeaderSize + 10;
+    QStringList::const_iterator it = list.begin();
+    for (; it != list.end(); ++it)
+        maxsize += 6 + 2 * (*it).size();
+
+    QByteArray frame;
+    frame.resize(maxsize);
+    char *p = put_varint(frame.data() + kFrameHeaderSize, list.size());
+
+    for (it = list.begin(); it != list.end(); ++it)
+    {
+        int len = (*it).size();
+        if (!len)
+        {
+            *p++ = kFieldEmpty;
+            continue;
+        }
+
+        const ushort *u = (*it).utf16();
+        ushort all = 0;
+        for (int i = 0; i < len; i++)
+            all |= u[i];
+
+        if (all < 0x100)
+        {
+            *p++ = kFieldLatin1;
+            p = put_varint(p, len);
+            for (int i = 0; i < len; i++)
+                *p++ = (char)u[i];
+        }
+        else
+        {
+            *p++ = kFieldUTF16;
+            p = put_varint(p, len);
+            for (int i = 0; i < len; i++)
+            {
+                *p++ = (char)(u[i] & 0xff);
+                *p++ = (char)(u[i] >> 8);
+            }
+        }
+    }
+    frame.truncate(p - frame.constData());
+
+    uint frameflags = kFrameBinary;
+    int size = frame.size() - kFrameHeaderSize;
+    if ((flags & kBinaryCompress) && size >= kCompressMinSize)
+    {
+        // Fastest level, most of this is repeated text
+        QByteArray packed = qCompress(
+            (const uchar*)frame.constData() + kFrameHeaderSize, size, 1);
+        if (packed.size() < size)
+        {
+            frame.truncate(kFrameHeaderSize);
+            frame += packed;
+            size = packed.size();
+            frameflags |= kFrameCompressed;
+        }
+    }
+
+    char *h = frame.data();
+    h[0] = kBinaryFrameMark;
+    h[1] = (char)frameflags;
+    h[2] = 0;
+    h[3] = 0;
+    h[4] = (char)((size >> 24) & 0xff);
+    h[5] = (char)((size >> 16) & 0xff);
+    h[6] = (char)((size >>  8) & 0xff);
+    h[7] = (char)((size      ) & 0xff);
+
+    return frame;
+}
+
+/** \brief Returns the payload size given by a frame header of
+ *         kFrameHeaderSize bytes, or a value below 1 if it is invalid.
+ *  \param frameflags set to the FrameFlags of the frame
+ */
+qint64 MythSocket::DecodeFrameHeader(const char *header, uint &frameflags)
+{
+    if (header[0] == kBinaryFrameMark)
+    {
+        const uchar *h = (const uchar*)header;
+        frameflags = h[1] | kFrameBinary;
+        return ((qint64)h[4] << 24) | (h[5] << 16) | (h[6] << 8) | h[7];
+    }
+
+    frameflags = 0;
+    return QByteArray(header, kFrameHeaderSize).trimmed().toLongLong();
+}
+
+/// Decodes the payload of a frame encoded by EncodeStringList().
+bool MythSocket::DecodeStringList(const QByteArray &payload,
+                                  uint frameflags, QStringList &list)
+{
+    list.clear();
+
+    if (!(frameflags & kFrameBinary))
+    {
+        list = QString::fromUtf8(payload.constData(), payload.size())
+            .split("[]:[]");
+        return true;
+    }
+
+    QByteArray unpacked;
+    const QByteArray *data = &payload;
+    if (frameflags & kFrameCompressed)
+    {
+        unpacked = qUncompress(payload);
+        if (unpacked.isEmpty())
+            return false;
+        data = &unpacked;
+    }
+
+    const uchar *p = (const uchar*)data->constData();
+    const uchar *end = p + data->size();
+
+    // Every field takes at least one byte
+    quint64 count;
+    if (!get_varint(p, end, count) || count > (quint64)(end - p))
+        return false;
+
+    const QString empty = QString::fromLatin1("");
+    for (quint64 i = 0; i < count; i++)
+    {
+        if (p >= end)
+            return false;
+
+        uchar type = *p++;
+        if (type == kFieldEmpty)
+        {
+            list << empty;
+            continue;
+        }
+
+        quint64 len;
+        if (!get_varint(p, end, len))
+            return false;
+
+        if (type == kFieldLatin1)
+        {
+            if (len > (quint64)(end - p))
+                return false;
+            list << QString::fromLatin1((const char*)p, len);
+            p += len;
+        }
+        else if (type == kFieldUTF16)
+        {
+            if (len > (quint64)(end - p) / 2)
+                return false;
+            QString str;
+            str.resize(len);
+            ushort *u = (ushort*)str.data();
+            for (uint j = 0; j < len; j++, p += 2)
+                u[j] = p[0] | (p[1] << 8);
+            list << str;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return p == end;
+}
+
 bool MythSocket::Announce(QStringList &strlist)
 {
     if (!m_isValidated)
@@ -33,6 +33,19 @@ class MBASE_PUBLIC MythSocket :
         Idle
     };
 
+    /// String list encodings negotiated with MYTH_PROTO_VERSION
+    enum BinaryProtocol {
+        kBinaryNone     = 0x00,
+        kBinaryFrames   = 0x01, ///< length prefixed fields, not "[]:[]"
+        kBinaryCompress = 0x02  ///< large frames may be zlib compressed
+    };
+
+    /// Flags of a received frame, see DecodeFrameHeader()
+    enum FrameFlags {
+        kFrameBinary     = 0x01,
+        kFrameCompressed = 0x02
+    };
+
     void close(void);
     bool closedByRemote(void);
     void deleteLater(void);
@@ -58,6 +71,19 @@ class MBASE_PUBLIC MythSocket :
 
     bool isExpectingReply(void)                 { return m_expectingreply; }
 
+    void setBinaryProtocol(uint flags)          { m_binaryProtocol = flags; }
+    uint binaryProtocol(void) const             { return m_binaryProtocol; }
+
+    static QString     GetBinaryProtocolOffer(void);
+    static uint        ParseBinaryProtocol(const QStringList &tokens,
+                                           int first);
+    static QStringList GetBinaryProtocolTokens(uint flags);
+
+    static QByteArray EncodeStringList(const QStringList &list, uint flags);
+    static qint64     DecodeFrameHeader(const char *header, uint &frameflags);
+    static bool       DecodeStringList(const QByteArray &payload,
+                                       uint frameflags, QStringList &list);
+
     void setSocket(int socket, Type type = MSocketDevice::Stream);
     void setCallbacks(MythSocketCBs *cb);
     void useReadyReadCallback(bool useReadyReadCallback = true)
@@ -76,6 +102,7 @@ class MBASE_PUBLIC MythSocket :
     bool SendReceiveStringList(QStringList &list, uint min_reply_length = 0);
     bool readData(char *data, quint64 len);
     bool writeData(const char *data, quint64 len);
+    qint64 writeFileData(int fd, long long offset, quint64 len);
 
     bool connect(const QHostAddress &hadr, quint16 port);
     bool connect(const QString &host, quint16 port);
@@ -86,6 +113,7 @@ class MBASE_PUBLIC MythSocket :
 
     static const uint kShortTimeout;
     static const uint kLongTimeout;
+    static const int  kFrameHeaderSize;
 
   protected:
    ~MythSocket();  // force refcounting
@@ -105,8 +133,10 @@ class MBASE_PUBLIC MythSocket :
     bool            m_isValidated;
     bool            m_isAnnounced;
     QStringList     m_announce;
+    uint            m_binaryProtocol;
 
     static const uint kSocketBufferSize;
+    static const int  kCompressMinSize;
     static QMutex s_readyread_thread_lock;
     static MythSocketThread *s_readyread_thread;
     
@@ -367,9 +367,14 @@ void MythSocketManager::HandleVersion(MythSocket *socket,
         return;
     }
 
+    // The reply is still sent as text, binary frames follow it
+    uint binary = MythSocket::ParseBinaryProtocol(slist, 3);
+
     LOG(VB_SOCKET, LOG_DEBUG, LOC + "Client validated");
-    retlist << "ACCEPT" << MYTH_PROTO_VERSION;
+    retlist << "ACCEPT" << MYTH_PROTO_VERSION
+            << MythSocket::GetBinaryProtocolTokens(binary);
     socket->writeStringList(retlist);
+    socket->setBinaryProtocol(binary);
     socket->setValidated();
 }
 
@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////////
+// Program Name: jobQueueInfo.h
+//
+// Licensed under the GPL v2 or later, see COPYING for details
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef JOBQUEUEINFO_H_
+#define JOBQUEUEINFO_H_
+
+#include <QDateTime>
+#include <QString>
+#include <QVariantList>
+
+#include "serviceexp.h"
+#include "datacontracthelper.h"
+
+#include "jobTypeInfo.h"
+
+namespace DTC
+{
+
+class SERVICE_PUBLIC JobQueueInfo : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO( "version", "1.0" );
+
+    // Q_CLASSINFO Used to augment Metadata for properties.
+    // See datacontracthelper.h for details
+
+    Q_CLASSINFO( "JobTypes", "type=DTC::JobTypeInfo");
+
+    Q_PROPERTY( QString      HostName   READ HostName   WRITE setHostName   )
+    Q_PROPERTY( QDateTime    LastRun    READ LastRun    WRITE setLastRun    )
+    Q_PROPERTY( int          MaxJobs    READ MaxJobs    WRITE setMaxJobs    )
+    Q_PROPERTY( int          Recordings READ Recordings WRITE setRecordings )
+
+    Q_PROPERTY( QVariantList JobTypes   READ JobTypes DESIGNABLE true )
+
+    PROPERTYIMP       ( QString     , HostName   )
+    PROPERTYIMP       ( QDateTime   , LastRun    )
+    PROPERTYIMP       ( int         , MaxJobs    )
+    PROPERTYIMP       ( int         , Recordings )
+
+    PROPERTYIMP_RO_REF( QVariantList, JobTypes   )
+
+    public:
+
+        static void InitializeCustomTypes()
+        {
+            qRegisterMetaType< JobQueueInfo  >();
+            qRegisterMetaType< JobQueueInfo* >();
+
+            JobTypeInfo::InitializeCustomTypes();
+        }
+
+    public:
+
+        JobQueueInfo(QObject *parent = 0)
+            : QObject     ( parent ),
+              m_MaxJobs   ( 0      ),
+              m_Recordings( 0      )
+        {
+        }
+
+        JobQueueInfo( const JobQueueInfo &src )
+        {
+            Copy( src );
+        }
+
+        void Copy( const JobQueueInfo &src )
+        {
+            m_HostName   = src.m_HostName  ;
+            m_LastRun    = src.m_LastRun   ;
+            m_MaxJobs    = src.m_MaxJobs   ;
+            m_Recordings = src.m_Recordings;
+
+            CopyListContents< JobTypeInfo >( this, m_JobTypes, src.m_JobTypes );
+        }
+
+        JobTypeInfo *AddNewJobType()
+        {
+            // We must make sure the object added to the QVariantList has
+            // a parent of 'this'
+
+            JobTypeInfo *pObject = new JobTypeInfo( this );
+            m_JobTypes.append( QVariant::fromValue<QObject *>( pObject ));
+
+            return pObject;
+        }
+
+};
+
+} // namespace DTC
+
+Q_DECLARE_METATYPE( DTC::JobQueueInfo  )
+Q_DECLARE_METATYPE( DTC::JobQueueInfo* )
+
+#endif
@@ -0,0 +1,107 @@
+//////////////////////////////////////////////////////////////////////////////
+// Program Name: jobTypeInfo.h
+//
+// Licensed under the GPL v2 or later, see COPYING for details
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef JOBTYPEINFO_H_
+#define JOBTYPEINFO_H_
+
+#include <QString>
+
+#include "serviceexp.h"
+#include "datacontracthelper.h"
+
+namespace DTC
+{
+
+class SERVICE_PUBLIC JobTypeInfo : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO( "version"    , "1.0" );
+
+    Q_PROPERTY( int        Type            READ Type         WRITE setType        )
+    Q_PROPERTY( QString    Name            READ Name         WRITE setName        )
+    Q_PROPERTY( int        MaxJobs         READ MaxJobs      WRITE setMaxJobs     )
+    Q_PROPERTY( int        Priority        READ Priority     WRITE setPriority    )
+    Q_PROPERTY( int        Waiting         READ Waiting      WRITE setWaiting     )
+    Q_PROPERTY( int        Running         READ Running      WRITE setRunning     )
+    Q_PROPERTY( int        Started         READ Started      WRITE setStarted     )
+    Q_PROPERTY( int        Finished        READ Finished     WRITE setFinished    )
+    Q_PROPERTY( int        Errored         READ Errored      WRITE setErrored     )
+    Q_PROPERTY( int        AvgLatency      READ AvgLatency   WRITE setAvgLatency  )
+    Q_PROPERTY( int        MaxLatency      READ MaxLatency   WRITE setMaxLatency  )
+    Q_PROPERTY( int        AvgRunTime      READ AvgRunTime   WRITE setAvgRunTime  )
+    Q_PROPERTY( int        MaxRunTime      READ MaxRunTime   WRITE setMaxRunTime  )
+
+    PROPERTYIMP( int      , Type       )
+    PROPERTYIMP( QString  , Name       )
+    PROPERTYIMP( int      , MaxJobs    )
+    PROPERTYIMP( int      , Priority   )
+    PROPERTYIMP( int      , Waiting    )
+    PROPERTYIMP( int      , Running    )
+    PROPERTYIMP( int      , Started    )
+    PROPERTYIMP( int      , Finished   )
+    PROPERTYIMP( int      , Errored    )
+    PROPERTYIMP( int      , AvgLatency )
+    PROPERTYIMP( int      , MaxLatency )
+    PROPERTYIMP( int      , AvgRunTime )
+    PROPERTYIMP( int      , MaxRunTime )
+
+    public:
+
+        static void InitializeCustomTypes()
+        {
+            qRegisterMetaType< JobTypeInfo  >();
+            qRegisterMetaType< JobTypeInfo* >();
+        }
+
+    public:
+
+        JobTypeInfo(QObject *parent = 0)
+            : QObject     ( parent ),
+              m_Type      ( 0      ),
+              m_MaxJobs   ( 0      ),
+              m_Priority  ( 0      ),
+              m_Waiting   ( 0      ),
+              m_Running   ( 0      ),
+              m_Started   ( 0      ),
+              m_Finished  ( 0      ),
+              m_Errored   ( 0      ),
+              m_AvgLatency( 0      ),
+              m_MaxLatency( 0      ),
+              m_AvgRunTime( 0      ),
+              m_MaxRunTime( 0      )
+        {
+        }
+
+        JobTypeInfo( const JobTypeInfo &src )
+        {
+            Copy( src );
+        }
+
+        void Copy( const JobTypeInfo &src )
+        {
+            m_Type       = src.m_Type      ;
+            m_Name       = src.m_Name      ;
+            m_MaxJobs    = src.m_MaxJobs   ;
+            m_Priority   = src.m_Priority  ;
+            m_Waiting    = src.m_Waiting   ;
+            m_Running    = src.m_Running   ;
+            m_Started    = src.m_Started   ;
+            m_Finished   = src.m_Finished  ;
+            m_Errored    = src.m_Errored   ;
+            m_AvgLatency = src.m_AvgLatency;
+            m_MaxLatency = src.m_MaxLatency;
+            m_AvgRunTime = src.m_AvgRunTime;
+            m_MaxRunTime = src.m_MaxRunTime;
+        }
+};
+
+} // namespace DTC
+
+Q_DECLARE_METATYPE( DTC::JobTypeInfo  )
+Q_DECLARE_METATYPE( DTC::JobTypeInfo* )
+
+#endif
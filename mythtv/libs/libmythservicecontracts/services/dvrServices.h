@@ -18,6 +18,7 @@
 #include "datacontracts/programList.h"
 #include "datacontracts/encoderList.h"
 #include "datacontracts/recRuleList.h"
+#include "datacontracts/jobQueueInfo.h"
 
 /////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////
@@ -38,7 +39,7 @@
 class SERVICE_PUBLIC DvrServices : public Service  //, public QScriptable ???
 {
     Q_OBJECT
-    Q_CLASSINFO( "version"    , "1.5" );
+    Q_CLASSINFO( "version"    , "1.6" );
     Q_CLASSINFO( "RemoveRecordedItem_Method",                   "POST" )
     Q_CLASSINFO( "AddRecordSchedule_Method",                    "POST" )
     Q_CLASSINFO( "RemoveRecordSchedule_Method",                 "POST" )
@@ -55,6 +56,7 @@ class SERVICE_PUBLIC DvrServices : public Service  //, public QScriptable ???
             DTC::ProgramList::InitializeCustomTypes();
             DTC::EncoderList::InitializeCustomTypes();
             DTC::RecRuleList::InitializeCustomTypes();
+            DTC::JobQueueInfo::InitializeCustomTypes();
         }
 
     public slots:
@@ -88,6 +90,8 @@ class SERVICE_PUBLIC DvrServices : public Service  //, public QScriptable ???
 
         virtual DTC::EncoderList*  GetEncoderList        ( ) = 0;
 
+        virtual DTC::JobQueueInfo* GetJobQueueStats      ( ) = 0;
+
         // Recording Rules
 
         virtual int                AddRecordSchedule     ( int       ChanId,
@@ -11,6 +11,10 @@ using namespace std;
 
 #ifndef USING_MINGW
 #include <sys/poll.h>
+#include <sys/uio.h>
+#endif
+#ifdef __linux__
+#include <sys/eventfd.h>
 #endif
 
 /// Set this to 1 to report on statistics
@@ -18,6 +22,62 @@ using namespace std;
 
 #define LOC QString("DevRdB(%1): ").arg(videodevice)
 
+/// Creates a pollable event, an eventfd where available else a pipe.
+static void open_event(int fds[2])
+{
+    fds[0] = fds[1] = -1;
+#if defined(__linux__)
+    fds[0] = fds[1] = eventfd(0, EFD_NONBLOCK);
+    if (fds[0] < 0)
+        LOG(VB_GENERAL, LOG_ERR, "DevRdB: Failed to create eventfd" + ENO);
+#elif !defined(USING_MINGW)
+    long flags[2];
+    setup_pipe(fds, flags);
+    if (fds[1] >= 0)
+        fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+#endif
+}
+
+static void close_event(int fds[2])
+{
+    if (fds[1] >= 0 && fds[1] != fds[0])
+        ::close(fds[1]);
+    if (fds[0] >= 0)
+        ::close(fds[0]);
+    fds[0] = fds[1] = -1;
+}
+
+static void signal_event(const int fds[2])
+{
+    if (fds[1] < 0)
+        return;
+    uint64_t one = 1;
+    ssize_t ret = ::write(fds[1], &one, sizeof(one));
+    (void) ret; // EAGAIN just means the event is already pending
+}
+
+/// Waits up to timeout ms for the event to be signalled, then clears it.
+static void wait_event(const int fds[2], int timeout)
+{
+#ifndef USING_MINGW
+    if (fds[0] >= 0)
+    {
+        struct pollfd pfd;
+        pfd.fd      = fds[0];
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, timeout) > 0)
+        {
+            char dummy[128];
+            ssize_t ret = ::read(fds[0], dummy, sizeof(dummy));
+            (void) ret;
+        }
+        return;
+    }
+#endif
+    usleep(min(timeout, 5) * 1000);
+}
+
 DeviceReadBuffer::DeviceReadBuffer(
     DeviceReaderCB *cb, bool use_poll, bool error_exit_on_poll_timeout)
     : MThread("DeviceReadBuffer"),
@@ -30,9 +90,10 @@ DeviceReadBuffer::DeviceReadBuffer(
       request_pause(false),         paused(false),
       using_poll(use_poll),
       poll_timeout_is_error(error_exit_on_poll_timeout),
-      max_poll_wait(2500 /*ms*/),
+      max_poll_wait(2500 /*ms*/),   max_read_wait(500 /*ms*/),
 
       size(0),                      used(0),
+      reader_wants(0),              writer_wants(0),
       read_quanta(0),
       dev_read_size(0),             min_read(0),
 
@@ -49,6 +110,9 @@ DeviceReadBuffer::DeviceReadBuffer(
         wake_pipe_flags[i] = 0;
     }
 
+    open_event(data_event);
+    open_event(space_event);
+
 #if defined( USING_MINGW ) && !defined( _MSC_VER )
 #warning mingw DeviceReadBuffer::Poll
     if (using_poll)
@@ -68,6 +132,8 @@ DeviceReadBuffer::~DeviceReadBuffer()
         delete[] buffer;
         buffer = NULL;
     }
+    close_event(data_event);
+    close_event(space_event);
 }
 
 bool DeviceReadBuffer::Setup(const QString &streamName, int streamfd,
@@ -92,12 +158,25 @@ bool DeviceReadBuffer::Setup(const QString &streamName, int streamfd,
     size          = gCoreContext->GetNumSetting(
         "HDRingbufferSize", 50 * read_quanta) * 1024;
     used          = 0;
-    dev_read_size = read_quanta * (using_poll ? 256 : 48);
+    reader_wants  = 0;
+    writer_wants  = 0;
+
+    // Throughput vs. latency: how many packets to read from the device
+    // at once, how many to hand to Read() at once, and how long Read()
+    // may wait for that many before returning what it has.
+    int read_batch = gCoreContext->GetNumSetting("HDRingbufferReadBatch", 0);
+    if (read_batch <= 0)
+        read_batch = using_poll ? 256 : 48;
+    dev_read_size = read_quanta * read_batch;
     dev_read_size = (deviceBufferSize) ?
         min(dev_read_size, (size_t)deviceBufferSize) : dev_read_size;
-    min_read      = read_quanta * 4;
+    dev_read_size = max(dev_read_size, read_quanta);
+    min_read      = read_quanta * max(gCoreContext->GetNumSetting(
+        "HDRingbufferMinRead", 4), 1);
+    max_read_wait = max(gCoreContext->GetNumSetting(
+        "HDRingbufferMaxLatency", 500), 1);
 
-    buffer        = new unsigned char[size + dev_read_size];
+    buffer        = new unsigned char[size];
     readPtr       = buffer;
     writePtr      = buffer;
     endPtr        = buffer + size;
@@ -106,11 +185,10 @@ bool DeviceReadBuffer::Setup(const QString &streamName, int streamfd,
     if (!buffer)
     {
         LOG(VB_GENERAL, LOG_ERR, LOC +
-            QString("Failed to allocate buffer of size %1 = %2 + %3")
-                .arg(size+dev_read_size).arg(size).arg(dev_read_size));
+            QString("Failed to allocate buffer of size %1").arg(size));
         return false;
     }
-    memset(buffer, 0xFF, size + read_quanta);
+    memset(buffer, 0xFF, size);
 
     // Initialize statistics
     max_used      = 0;
@@ -118,7 +196,11 @@ bool DeviceReadBuffer::Setup(const QString &streamName, int streamfd,
     avg_cnt       = 0;
     lastReport.start();
 
-    LOG(VB_RECORD, LOG_INFO, LOC + QString("buffer size %1 KB").arg(size/1024));
+    LOG(VB_RECORD, LOG_INFO, LOC +
+        QString("buffer size %1 KB, read batch %2 KB, min read %3 KB, "
+                "max latency %4 ms")
+            .arg(size/1024).arg(dev_read_size/1024).arg(min_read/1024)
+            .arg(max_read_wait));
 
     return true;
 }
@@ -164,6 +246,8 @@ void DeviceReadBuffer::Reset(const QString &streamName, int streamfd)
     writePtr      = buffer;
 
     error         = false;
+
+    WakeWaiters();
 }
 
 void DeviceReadBuffer::Stop(void)
@@ -175,6 +259,7 @@ void DeviceReadBuffer::Stop(void)
         dorun = false;
         locker.unlock();
         WakePoll();
+        WakeWaiters();
         wait();
     }
     LOG(VB_RECORD, LOG_INFO, LOC + "Stop() -- end");
@@ -185,6 +270,7 @@ void DeviceReadBuffer::SetRequestPause(bool req)
     QMutexLocker locker(&lock);
     request_pause = req;
     WakePoll();
+    WakeWaiters();
 }
 
 void DeviceReadBuffer::SetPaused(bool val)
@@ -197,35 +283,23 @@ void DeviceReadBuffer::SetPaused(bool val)
         unpauseWait.wakeAll();
 }
 
-// The WakePoll code is copied from MythSocketThread::WakeReadyReadThread()
 void DeviceReadBuffer::WakePoll(void) const
 {
-    char buf[1];
-    buf[0] = '0';
-    ssize_t wret = 0;
-    while (isRunning() && (wret <= 0) && (wake_pipe[1] >= 0))
-    {
-        wret = ::write(wake_pipe[1], &buf, 1);
-        if ((wret < 0) && (EAGAIN != errno) && (EINTR != errno))
-        {
-            LOG(VB_GENERAL, LOG_ERR, LOC + "WakePoll failed.");
-            ClosePipes();
-            break;
-        }
-    }
+    if (isRunning())
+        signal_event(wake_pipe);
+}
+
+/// Wakes up both sides of the ring buffer so they re-check their state.
+void DeviceReadBuffer::WakeWaiters(void) const
+{
+    signal_event(data_event);
+    signal_event(space_event);
 }
 
 void DeviceReadBuffer::ClosePipes(void) const
 {
-    for (uint i = 0; i < 2; i++)
-    {
-        if (wake_pipe[i] >= 0)
-        {
-            ::close(wake_pipe[i]);
-            wake_pipe[i] = -1;
-            wake_pipe_flags[i] = 0;
-        }
-    }
+    close_event(wake_pipe);
+    wake_pipe_flags[0] = wake_pipe_flags[1] = 0;
 }
 
 bool DeviceReadBuffer::IsPaused(void) const
@@ -280,41 +354,51 @@ bool DeviceReadBuffer::IsRunning(void) const
 
 uint DeviceReadBuffer::GetUnused(void) const
 {
-    QMutexLocker locker(&lock);
-    return size - used;
+    return size - GetUsed();
 }
 
 uint DeviceReadBuffer::GetUsed(void) const
 {
-    QMutexLocker locker(&lock);
-    return used;
+    return const_cast<QAtomicInt&>(used).fetchAndAddAcquire(0);
 }
 
+/// Only meaningful on the producer side, which owns writePtr.
 uint DeviceReadBuffer::GetContiguousUnused(void) const
 {
-    QMutexLocker locker(&lock);
-    return endPtr - writePtr;
+    return min((size_t)(endPtr - writePtr), (size_t)GetUnused());
 }
 
+/// Producer side: publishes len bytes written at writePtr.
 void DeviceReadBuffer::IncrWritePointer(uint len)
 {
-    QMutexLocker locker(&lock);
-    used     += len;
     writePtr += len;
     writePtr  = (writePtr >= endPtr) ? buffer + (writePtr - endPtr) : writePtr;
+
+    uint now_used = used.fetchAndAddOrdered(len) + len;
 #if REPORT_RING_STATS
-    max_used = max(used, max_used);
-    avg_used = ((avg_used * avg_cnt) + used) / ++avg_cnt;
+    {
+        QMutexLocker locker(&lock);
+        max_used = max((size_t)now_used, max_used);
+        avg_used = ((avg_used * avg_cnt) + now_used) / ++avg_cnt;
+    }
 #endif
-    dataWait.wakeAll();
+
+    int wants = reader_wants.fetchAndAddOrdered(0);
+    if (wants && now_used >= (uint)wants)
+        signal_event(data_event);
 }
 
+/// Consumer side: releases len bytes read at readPtr.
 void DeviceReadBuffer::IncrReadPointer(uint len)
 {
-    QMutexLocker locker(&lock);
-    used    -= len;
     readPtr += len;
     readPtr  = (readPtr == endPtr) ? buffer : readPtr;
+
+    uint now_unused = size - (used.fetchAndAddOrdered(-(int)len) - len);
+
+    int wants = writer_wants.fetchAndAddOrdered(0);
+    if (wants && now_unused >= (uint)wants)
+        signal_event(space_event);
 }
 
 void DeviceReadBuffer::run(void)
@@ -328,7 +412,10 @@ void DeviceReadBuffer::run(void)
     lock.unlock();
 
     if (using_poll)
-        setup_pipe(wake_pipe, wake_pipe_flags);
+    {
+        open_event(wake_pipe);
+        wake_pipe_flags[0] = wake_pipe_flags[1] = O_NONBLOCK;
+    }
 
     while (dorun)
     {
@@ -360,7 +447,25 @@ void DeviceReadBuffer::run(void)
         // if read_size > 0 do the read...
         if (read_size)
         {
+            // Read straight into the free space, which may wrap around
+            // the end of the buffer, in one system call.
+            size_t first = min(read_size, (size_t)(endPtr - writePtr));
+#ifdef USING_MINGW
+            read_size = first;
             ssize_t len = read(_stream_fd, writePtr, read_size);
+#else
+            struct iovec iov[2];
+            int iovcnt = 1;
+            iov[0].iov_base = writePtr;
+            iov[0].iov_len  = first;
+            if (first < read_size)
+            {
+                iov[1].iov_base = buffer;
+                iov[1].iov_len  = read_size - first;
+                iovcnt = 2;
+            }
+            ssize_t len = readv(_stream_fd, iov, iovcnt);
+#endif
             if (!CheckForErrors(len, read_size, errcnt))
             {
                 if (errcnt > 5)
@@ -369,9 +474,6 @@ void DeviceReadBuffer::run(void)
                     continue;
             }
             errcnt = 0;
-            // if we wrote past the official end of the buffer, copy to start
-            if (writePtr + len > endPtr)
-                memcpy(buffer, endPtr, writePtr + len - endPtr);
             IncrWritePointer(len);
         }
     }
@@ -381,11 +483,12 @@ void DeviceReadBuffer::run(void)
     lock.lock();
     eof     = true;
     runWait.wakeAll();
-    dataWait.wakeAll();
     pauseWait.wakeAll();
     unpauseWait.wakeAll();
     lock.unlock();
 
+    WakeWaiters();
+
     RunEpilog();
 }
 
@@ -612,7 +715,7 @@ bool DeviceReadBuffer::CheckForErrors(
  */
 uint DeviceReadBuffer::Read(unsigned char *buf, const uint count)
 {
-    uint avail = WaitForUsed(min(count, (uint)min_read), 500);
+    uint avail = WaitForUsed(min(count, (uint)min_read), max_read_wait);
     size_t cnt = min(count, avail);
 
     if (!cnt)
@@ -622,24 +725,14 @@ uint DeviceReadBuffer::Read(unsigned char *buf, const uint count)
     {
         // Process as two pieces
         size_t len = endPtr - readPtr;
-        if (len)
-        {
-            memcpy(buf, readPtr, len);
-            buf += len;
-            IncrReadPointer(len);
-        }
-        if (cnt > len)
-        {
-            len = cnt - len;
-            memcpy(buf, readPtr, len);
-            IncrReadPointer(len);
-        }
+        memcpy(buf, readPtr, len);
+        memcpy(buf + len, buffer, cnt - len);
     }
     else
     {
         memcpy(buf, readPtr, cnt);
-        IncrReadPointer(cnt);
     }
+    IncrReadPointer(cnt);
 
 #if REPORT_RING_STATS
     ReportStats();
@@ -656,20 +749,24 @@ uint DeviceReadBuffer::WaitForUnused(uint needed) const
 {
     size_t unused = GetUnused();
 
-    if (unused > read_quanta)
+    while (unused < needed)
     {
-        while (unused < needed)
-        {
-            unused = GetUnused();
-            if (IsPauseRequested() || !IsOpen() || !dorun)
-                return 0;
-            usleep(5000);
-        }
         if (IsPauseRequested() || !IsOpen() || !dorun)
             return 0;
+
+        // Announce what we need before re-checking, so the consumer
+        // either sees it and signals us or we see its progress.
+        writer_wants.fetchAndStoreOrdered(needed);
+        unused = GetUnused();
+        if (unused < needed)
+            wait_event(space_event, 100);
+        writer_wants.fetchAndStoreOrdered(0);
         unused = GetUnused();
     }
 
+    if (IsPauseRequested() || !IsOpen() || !dorun)
+        return 0;
+
     return unused;
 }
 
@@ -683,14 +780,27 @@ uint DeviceReadBuffer::WaitForUsed(uint needed, uint max_wait) const
     MythTimer timer;
     timer.start();
 
-    QMutexLocker locker(&lock);
-    size_t avail = used;
-    while ((needed > avail) && isRunning() &&
-           !request_pause && !error && !eof &&
-           (timer.elapsed() < (int)max_wait))
+    size_t avail = GetUsed();
+    while (needed > avail)
     {
-        dataWait.wait(locker.mutex(), 10);
-        avail = used;
+        {
+            QMutexLocker locker(&lock);
+            if (!isRunning() || request_pause || error || eof)
+                break;
+        }
+
+        int left = (int)max_wait - timer.elapsed();
+        if (left <= 0)
+            break;
+
+        // Announce what we need before re-checking, so the producer
+        // either sees it and signals us or we see its progress.
+        reader_wants.fetchAndStoreOrdered(needed);
+        avail = GetUsed();
+        if (needed > avail)
+            wait_event(data_event, left);
+        reader_wants.fetchAndStoreOrdered(0);
+        avail = GetUsed();
     }
     return avail;
 }
@@ -7,6 +7,7 @@
 #include <unistd.h>
 
 #include <QMutex>
+#include <QAtomicInt>
 #include <QWaitCondition>
 #include <QString>
 
@@ -29,6 +30,13 @@ class DeviceReaderCB
  *  This allows us to read the device regularly even in the presence
  *  of long blocking conditions on writing to disk or accessing the
  *  database.
+ *
+ *  The ring buffer has a single producer, the run() thread, and a
+ *  single consumer, the caller of Read(). Each side owns its pointer
+ *  and only the fill level is shared, so no lock is taken per read.
+ *  A side that has to wait for data or for space sleeps on an event
+ *  (an eventfd on Linux), and the other side signals it once its
+ *  requirement is met, rather than both sides polling on a timer.
  */
 class DeviceReadBuffer : protected MThread
 {
@@ -68,6 +76,7 @@ class DeviceReadBuffer : protected MThread
     bool HandlePausing(void);
     bool Poll(void) const;
     void WakePoll(void) const;
+    void WakeWaiters(void) const;
     uint WaitForUnused(uint bytes_needed) const;
     uint WaitForUsed  (uint bytes_needed, uint max_wait /*ms*/) const;
 
@@ -85,6 +94,8 @@ class DeviceReadBuffer : protected MThread
     int              _stream_fd;
     mutable int      wake_pipe[2];
     mutable long     wake_pipe_flags[2];
+    int              data_event[2];     ///< signalled when data is added
+    int              space_event[2];    ///< signalled when data is consumed
 
     DeviceReaderCB  *readerCB;
 
@@ -98,18 +109,20 @@ class DeviceReadBuffer : protected MThread
     bool             using_poll;
     bool             poll_timeout_is_error;
     uint             max_poll_wait;
+    uint             max_read_wait;     ///< latency target for Read(), ms
 
     size_t           size;
-    size_t           used;
+    QAtomicInt       used;              ///< shared between the two sides
+    mutable QAtomicInt reader_wants;    ///< bytes Read() is waiting for
+    mutable QAtomicInt writer_wants;    ///< bytes run() is waiting for
     size_t           read_quanta;
     size_t           dev_read_size;
     size_t           min_read;
     unsigned char   *buffer;
-    unsigned char   *readPtr;
-    unsigned char   *writePtr;
+    unsigned char   *readPtr;           ///< owned by the consumer
+    unsigned char   *writePtr;          ///< owned by the producer
     unsigned char   *endPtr;
 
-    mutable QWaitCondition dataWait;
     QWaitCondition   runWait;
     QWaitCondition   pauseWait;
     QWaitCondition   unpauseWait;
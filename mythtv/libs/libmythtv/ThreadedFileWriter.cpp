@@ -1,3 +1,6 @@
+// C++ headers
+#include <algorithm>
+
 // ANSI C headers
 #include <cstdio>
 #include <cstdlib>
@@ -16,6 +19,8 @@
 
 // MythTV headers
 #include "ThreadedFileWriter.h"
+#include "mythcorecontext.h"
+#include "storagegroup.h"
 #include "mythlogging.h"
 
 #include "mythtimer.h"
@@ -42,6 +47,56 @@ void TFWSyncThread::run(void)
 
 const uint ThreadedFileWriter::kMaxBufferSize = 128 * 1024 * 1024;
 const uint ThreadedFileWriter::kMinWriteSize = 64 * 1024;
+const uint ThreadedFileWriter::kDirectBufferSize = 1024 * 1024;
+const uint ThreadedFileWriter::kDirectAlignment = 4096;
+const uint ThreadedFileWriter::kPreallocSize = 64 * 1024 * 1024;
+
+/// Upper bounds in ms of the write latency histogram buckets.
+static const int kWriteLatencyBounds[] = { 1, 4, 16, 64, 256, 1024 };
+
+/** \brief Returns true if filename is in one of the storage groups
+ *         listed in this host's "DirectIOStorageGroups" setting.
+ */
+static bool use_direct_io(const QString &filename)
+{
+    QStringList groups = gCoreContext->GetSetting("DirectIOStorageGroups")
+        .split(",", QString::SkipEmptyParts);
+
+    for (int i = 0; i < groups.size(); i++)
+    {
+        StorageGroup sgroup(groups[i].trimmed(),
+                            gCoreContext->GetHostName(), false);
+        QStringList dirs = sgroup.GetDirList();
+        for (int j = 0; j < dirs.size(); j++)
+        {
+            QString dir = dirs[j];
+            if (!dir.endsWith("/"))
+                dir += "/";
+            if (filename.startsWith(dir))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+static bool pwrite_all(int fd, const char *data, size_t count, off_t pos)
+{
+    while (count)
+    {
+        ssize_t ret = pwrite(fd, data, count, pos);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data  += ret;
+        count -= ret;
+        pos   += ret;
+    }
+    return true;
+}
 
 /** \class ThreadedFileWriter
  *  \brief This class supports the writing of recordings to disk.
@@ -52,6 +107,13 @@ const uint ThreadedFileWriter::kMinWriteSize = 64 * 1024;
  *   using another thread. The goal here so to block as little as
  *   possible when the classes using this class want to add data
  *   to the stream.
+ *
+ *   For files in the storage groups listed in the host setting
+ *   "DirectIOStorageGroups" the file is opened with O_DIRECT. Data is
+ *   then staged in an aligned buffer and written in whole blocks, and
+ *   disk space is preallocated ahead of the write position, so that
+ *   many concurrent recordings neither fragment the disk nor push
+ *   playback data out of the page cache.
  */
 
 /** \fn ThreadedFileWriter::ThreadedFileWriter(const QString&,int,mode_t)
@@ -66,10 +128,16 @@ ThreadedFileWriter::ThreadedFileWriter(const QString &fname,
     flush(false),                        in_dtor(false),
     ignore_writes(false),                tfw_min_write_size(kMinWriteSize),
     totalBufferUse(0),
+    // O_DIRECT
+    directio(false),                     direct_dirty(false),
+    direct_buf(NULL),                    direct_fill(0),
+    direct_pos(0),                       prealloc(false),
+    prealloc_end(0),
     // threads
     writeThread(NULL),                   syncThread(NULL)
 {
     filename.detach();
+    memset(write_latency, 0, sizeof(write_latency));
 }
 
 /** \fn ThreadedFileWriter::ReOpen(QString)
@@ -84,11 +152,7 @@ bool ThreadedFileWriter::ReOpen(QString newFilename)
 
     buflock.lock();
 
-    if (fd >= 0)
-    {
-        close(fd);
-        fd = -1;
-    }
+    CloseFile();
 
     if (!newFilename.isEmpty())
         filename = newFilename;
@@ -105,13 +169,44 @@ bool ThreadedFileWriter::ReOpen(QString newFilename)
 bool ThreadedFileWriter::Open(void)
 {
     ignore_writes = false;
+    directio = false;
 
     if (filename == "-")
         fd = fileno(stdout);
     else
     {
         QByteArray fname = filename.toLocal8Bit();
-        fd = open(fname.constData(), flags, mode);
+#ifdef O_DIRECT
+        if (use_direct_io(filename))
+        {
+            if (!direct_buf &&
+                posix_memalign((void**)&direct_buf, kDirectAlignment,
+                               kDirectBufferSize) != 0)
+            {
+                direct_buf = NULL;
+            }
+
+            if (direct_buf)
+                fd = open(fname.constData(), flags | O_DIRECT, mode);
+
+            if (fd >= 0)
+            {
+                directio = true;
+                direct_fill = 0;
+                direct_pos = 0;
+                prealloc = true;
+                prealloc_end = 0;
+                LOG(VB_RECORD, LOG_INFO, LOC + "Using O_DIRECT writes");
+            }
+            else
+            {
+                LOG(VB_GENERAL, LOG_WARNING, LOC +
+                    "O_DIRECT not available, using buffered writes" + ENO);
+            }
+        }
+#endif
+        if (fd < 0)
+            fd = open(fname.constData(), flags, mode);
     }
 
     if (fd < 0)
@@ -183,11 +278,35 @@ ThreadedFileWriter::~ThreadedFileWriter()
         syncThread = NULL;
     }
 
-    if (fd >= 0)
+    CloseFile();
+
+    free(direct_buf);
+    direct_buf = NULL;
+}
+
+/** \brief Closes the file, releasing any space preallocated beyond
+ *         the end of it, and logs the write latency histogram.
+ */
+void ThreadedFileWriter::CloseFile(void)
+{
+    if (fd < 0)
+        return;
+
+    if (prealloc)
     {
-        close(fd);
-        fd = -1;
+        // Truncating to the current size lets the filesystem drop the
+        // blocks fallocate() reserved past the end of the file.
+        struct stat st;
+        if (fstat(fd, &st) == 0 && ftruncate(fd, st.st_size) < 0)
+            LOG(VB_FILE, LOG_WARNING, LOC + "ftruncate() failed" + ENO);
     }
+
+    LogWriteLatency();
+
+    close(fd);
+    fd = -1;
+    directio = false;
+    prealloc = false;
 }
 
 /** \fn ThreadedFileWriter::Write(const void*, uint)
@@ -271,7 +390,7 @@ long long ThreadedFileWriter::Seek(long long pos, int whence)
 {
     QMutexLocker locker(&buflock);
     flush = true;
-    while (!writeBuffers.empty())
+    while (!writeBuffers.empty() || direct_dirty)
     {
         bufferHasData.wakeAll();
         if (!bufferEmpty.wait(locker.mutex(), 2000))
@@ -282,6 +401,11 @@ long long ThreadedFileWriter::Seek(long long pos, int whence)
         }
     }
     flush = false;
+
+    // Random access writes can not honour O_DIRECT's alignment rules.
+    if (directio)
+        DisableDirectIO(direct_fill);
+
     return lseek(fd, pos, whence);
 }
 
@@ -292,7 +416,7 @@ void ThreadedFileWriter::Flush(void)
 {
     QMutexLocker locker(&buflock);
     flush = true;
-    while (!writeBuffers.empty())
+    while (!writeBuffers.empty() || direct_dirty)
     {
         bufferHasData.wakeAll();
         if (!bufferEmpty.wait(locker.mutex(), 2000))
@@ -401,6 +525,7 @@ void ThreadedFileWriter::DiskLoop(void)
                 delete emptyBuffers.front();
                 emptyBuffers.pop_front();
             }
+            direct_dirty = false;
             bufferEmpty.wakeAll();
             bufferHasData.wait(locker.mutex());
             continue;
@@ -408,6 +533,8 @@ void ThreadedFileWriter::DiskLoop(void)
 
         if (writeBuffers.empty())
         {
+            if (direct_dirty && flush)
+                DirectFlushTail();
             bufferEmpty.wakeAll();
             bufferHasData.wait(locker.mutex(), 1000);
             TrimEmptyBuffers();
@@ -433,6 +560,8 @@ void ThreadedFileWriter::DiskLoop(void)
         writeBuffers.pop_front();
         totalBufferUse -= buf->data.size();
         minWriteTimer.start();
+        if (directio)
+            direct_dirty = true;
 
         //////////////////////////////////////////
 
@@ -450,6 +579,21 @@ void ThreadedFileWriter::DiskLoop(void)
         MythTimer writeTimer;
         writeTimer.start();
 
+        if (directio)
+        {
+            locker.unlock();
+            bool direct_ok = DirectWrite((const char *)data, sz, tot);
+            locker.relock();
+            if (!direct_ok)
+            {
+                // Write whatever did not make it to disk with the
+                // buffered loop below, which retries.
+                LOG(VB_GENERAL, LOG_ERR, LOC + "File I/O (O_DIRECT), "
+                    "switching to buffered writes" + ENO);
+                DisableDirectIO(direct_fill);
+            }
+        }
+
         while ((tot < sz) && !in_dtor)
         {
             locker.unlock();
@@ -492,6 +636,8 @@ void ThreadedFileWriter::DiskLoop(void)
         buf->lastUsed = MythDate::current();
         emptyBuffers.push_back(buf);
 
+        RecordWriteLatency(writeTimer.elapsed());
+
         if (writeTimer.elapsed() > 1000)
         {
             LOG(VB_GENERAL, LOG_WARNING, LOC +
@@ -552,3 +698,171 @@ void ThreadedFileWriter::TrimEmptyBuffers(void)
         ++it;
     }
 }
+
+/** \brief Appends data to the O_DIRECT staging buffer and writes out
+ *         all complete blocks.
+ *
+ *  Any partial block at the end stays in the staging buffer, and is
+ *  rewritten in place together with the data that follows it. Called
+ *  from DiskLoop() without buflock held.
+ *
+ *  On a write error only the bytes staged before this call are left in
+ *  the staging buffer, and done is set to the number of bytes of data
+ *  which are on disk, so the caller can write the rest another way.
+ */
+bool ThreadedFileWriter::DirectWrite(const char *data, uint count,
+                                     uint &done)
+{
+    uint copied = 0;
+    done = 0;
+
+    while (copied < count)
+    {
+        uint n = min(count - copied, kDirectBufferSize - direct_fill);
+        memcpy(direct_buf + direct_fill, data + copied, n);
+        direct_fill += n;
+        copied      += n;
+
+        uint aligned = direct_fill & ~(kDirectAlignment - 1);
+        if (!aligned)
+            continue;
+
+        Preallocate(direct_pos + aligned);
+
+        if (!pwrite_all(fd, direct_buf, aligned, direct_pos))
+        {
+            // The staging buffer ends with the part of data which has
+            // not been written yet, unstage it.
+            uint staged = min(copied, direct_fill);
+            direct_fill -= staged;
+            done = copied - staged;
+            return false;
+        }
+
+        direct_pos  += aligned;
+        direct_fill -= aligned;
+        memmove(direct_buf, direct_buf + aligned, direct_fill);
+    }
+
+    done = count;
+    return true;
+}
+
+/** \brief Writes the partial block left in the staging buffer.
+ *
+ *  The block is zero padded to satisfy O_DIRECT and the file is then
+ *  truncated back to the real length. Called with buflock held.
+ */
+void ThreadedFileWriter::DirectFlushTail(void)
+{
+    direct_dirty = false;
+
+    if (!directio || !direct_fill)
+        return;
+
+    uint padded = (direct_fill + kDirectAlignment - 1) &
+        ~(kDirectAlignment - 1);
+    memset(direct_buf + direct_fill, 0, padded - direct_fill);
+
+    if (!pwrite_all(fd, direct_buf, padded, direct_pos) ||
+        ftruncate(fd, direct_pos + direct_fill) < 0)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC + "Failed to write final block" + ENO);
+    }
+
+    // The truncate also released the preallocated space.
+    prealloc_end = 0;
+}
+
+/** \brief Switches the file back to buffered writes.
+ *
+ *  The first keep bytes of the staging buffer are written again without
+ *  O_DIRECT, and the file offset is left just after them. Called with
+ *  buflock held.
+ */
+void ThreadedFileWriter::DisableDirectIO(uint keep)
+{
+    int err = errno;
+
+#ifdef O_DIRECT
+    int fl = fcntl(fd, F_GETFL);
+    if (fl >= 0)
+        fcntl(fd, F_SETFL, fl & ~O_DIRECT);
+#endif
+
+    if (keep && !pwrite_all(fd, direct_buf, keep, direct_pos))
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            "Failed to rewrite the staged data" + ENO);
+    }
+    lseek(fd, direct_pos + keep, SEEK_SET);
+
+    directio = false;
+    direct_dirty = false;
+    direct_fill = 0;
+    errno = err;
+
+    LOG(VB_RECORD, LOG_INFO, LOC + "Switched to buffered writes");
+}
+
+/** \brief Reserves disk space up to kPreallocSize past end.
+ *
+ *  FALLOC_FL_KEEP_SIZE is used so the file size readers see is not
+ *  changed. Preallocation is silently disabled on filesystems which
+ *  do not support it.
+ */
+void ThreadedFileWriter::Preallocate(long long end)
+{
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+    if (!prealloc || end + kPreallocSize / 2 <= prealloc_end)
+        return;
+
+    long long start = max(prealloc_end, direct_pos);
+    long long len = end + kPreallocSize - start;
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, start, len) < 0)
+    {
+        LOG(VB_FILE, LOG_INFO, LOC + "Disabling preallocation" + ENO);
+        prealloc = false;
+        return;
+    }
+    prealloc_end = start + len;
+#else
+    (void) end;
+    prealloc = false;
+#endif
+}
+
+void ThreadedFileWriter::RecordWriteLatency(int ms)
+{
+    uint i = 0;
+    while (i < sizeof(kWriteLatencyBounds) / sizeof(int) &&
+           ms >= kWriteLatencyBounds[i])
+    {
+        i++;
+    }
+    write_latency[i]++;
+}
+
+/// Logs the write latency histogram and resets it.
+void ThreadedFileWriter::LogWriteLatency(void)
+{
+    uint64_t total = 0;
+    for (uint i = 0; i < sizeof(write_latency) / sizeof(uint64_t); i++)
+        total += write_latency[i];
+    if (!total)
+        return;
+
+    QString msg = "Write latency:";
+    const uint nbounds = sizeof(kWriteLatencyBounds) / sizeof(int);
+    for (uint i = 0; i < nbounds; i++)
+    {
+        msg += QString(" <%1ms: %2").arg(kWriteLatencyBounds[i])
+            .arg(write_latency[i]);
+    }
+    msg += QString(" >=%1ms: %2").arg(kWriteLatencyBounds[nbounds - 1])
+        .arg(write_latency[nbounds]);
+
+    LOG(VB_RECORD, LOG_INFO, LOC + msg);
+
+    memset(write_latency, 0, sizeof(write_latency));
+}
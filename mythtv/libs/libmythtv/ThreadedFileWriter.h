@@ -61,6 +61,14 @@ class ThreadedFileWriter
     void SyncLoop(void);
     void TrimEmptyBuffers(void);
 
+    void CloseFile(void);
+    bool DirectWrite(const char *data, uint count, uint &done);
+    void DirectFlushTail(void);
+    void DisableDirectIO(uint keep);
+    void Preallocate(long long end);
+    void RecordWriteLatency(int ms);
+    void LogWriteLatency(void);
+
   private:
     // file info
     QString         filename;
@@ -75,6 +83,18 @@ class ThreadedFileWriter
     uint            tfw_min_write_size; // protected by buflock
     uint            totalBufferUse;     // protected by buflock
 
+    // O_DIRECT backend, see DirectWrite()
+    bool            directio;
+    bool            direct_dirty;       // protected by buflock
+    char           *direct_buf;         // aligned staging buffer
+    uint            direct_fill;        // bytes used in direct_buf
+    long long       direct_pos;         // file offset of direct_buf
+    bool            prealloc;
+    long long       prealloc_end;
+
+    // write latency histogram, protected by buflock
+    uint64_t        write_latency[7];
+
     // buffers
     class TFWBuffer
     {
@@ -99,6 +119,12 @@ class ThreadedFileWriter
     static const uint kMaxBufferSize;
     /// Minimum to write to disk in a single write, when not flushing buffer.
     static const uint kMinWriteSize;
+    /// Size of the aligned staging buffer used with O_DIRECT.
+    static const uint kDirectBufferSize;
+    /// Alignment of O_DIRECT buffers, file offsets and transfer sizes.
+    static const uint kDirectAlignment;
+    /// How far ahead of the write position to preallocate disk space.
+    static const uint kPreallocSize;
 };
 
 #endif
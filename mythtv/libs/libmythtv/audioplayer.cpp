@@ -506,6 +506,20 @@ bool AudioPlayer::GetBufferStatus(uint &fill, uint &total)
     return true;
 }
 
+int64_t AudioPlayer::GetAudioBufferedTime(void)
+{
+    if (!m_audioOutput || m_no_audio_out)
+        return 0;
+    return m_audioOutput->GetAudioBufferedTime();
+}
+
+uint AudioPlayer::GetUnderruns(void)
+{
+    if (!m_audioOutput || m_no_audio_out)
+        return 0;
+    return m_audioOutput->GetUnderruns();
+}
+
 bool AudioPlayer::IsBufferAlmostFull(void)
 {
     uint ofill = 0, ototal = 0, othresh = 0;
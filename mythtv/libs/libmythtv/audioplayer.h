@@ -76,6 +76,8 @@ class MTV_PUBLIC AudioPlayer
     int64_t LengthLastData(void);
     bool GetBufferStatus(uint &fill, uint &total);
     bool IsBufferAlmostFull(void);
+    int64_t GetAudioBufferedTime(void);
+    uint GetUnderruns(void);
 
   private:
     void AddVisuals(void);
@@ -2277,6 +2277,27 @@ NULL
             return false;
     }
 
+    if (dbver == "1307")
+    {
+        // Packed position maps, see PackedPositionMap. The recordedseek
+        // rows of existing recordings are still read until they are
+        // rewritten.
+        const char *updates[] = {
+"CREATE TABLE recordedseekmap ("
+"  chanid int(10) unsigned NOT NULL DEFAULT '0',"
+"  starttime datetime NOT NULL DEFAULT '0000-00-00 00:00:00',"
+"  `type` tinyint(4) NOT NULL DEFAULT '0',"
+"  entries int(10) unsigned NOT NULL DEFAULT '0',"
+"  data mediumblob NOT NULL,"
+"  PRIMARY KEY (chanid,starttime,`type`)"
+") ENGINE=MyISAM DEFAULT CHARSET=utf8;",
+NULL
+};
+
+        if (!performActualUpdate(&updates[0], "1308", dbver))
+            return false;
+    }
+
     return true;
 }
 
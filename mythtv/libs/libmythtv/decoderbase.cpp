@@ -12,6 +12,7 @@ using namespace std;
 #include "mythlogging.h"
 #include "decoderbase.h"
 #include "programinfo.h"
+#include "positionmap.h"
 #include "livetvchain.h"
 #include "iso639.h"
 #include "DVD/dvdringbuffer.h"
@@ -118,7 +119,7 @@ bool DecoderBase::PosMapFromDb(void)
         return false;
 
     // Overwrites current positionmap with entire contents of database
-    frm_pos_map_t posMap;
+    PackedPositionMap posMap;
 
     if (ringBuffer->IsDVD())
     {
@@ -128,7 +129,7 @@ bool DecoderBase::PosMapFromDb(void)
         if (fps < 26 && fps > 24)
            keyframedist = 12;
         totframes = (long long)(ringBuffer->DVD()->GetTotalTimeOfTitle() * fps);
-        posMap[totframes] = ringBuffer->DVD()->GetTotalReadPosition();
+        posMap.Append(totframes, ringBuffer->DVD()->GetTotalReadPosition());
     }
     else if (ringBuffer->IsBD())
     {
@@ -138,7 +139,7 @@ bool DecoderBase::PosMapFromDb(void)
         if (fps < 26 && fps > 24)
            keyframedist = 12;
         totframes = (long long)(ringBuffer->BD()->GetTotalTimeOfTitle() * fps);
-        posMap[totframes] = ringBuffer->BD()->GetTotalReadPosition();
+        posMap.Append(totframes, ringBuffer->BD()->GetTotalReadPosition());
 #if 0
         LOG(VB_PLAYBACK, LOG_DEBUG, LOC +
             QString("%1 TotalTimeOfTitle() in ticks, %2 TotalReadPosition() "
@@ -194,10 +195,11 @@ bool DecoderBase::PosMapFromDb(void)
     m_positionMap.clear();
     m_positionMap.reserve(posMap.size());
 
-    for (frm_pos_map_t::const_iterator it = posMap.begin();
-         it != posMap.end(); ++it)
+    for (uint i = 0; i < posMap.size(); i++)
     {
-        PosMapEntry e = {it.key(), it.key() * keyframedist, *it};
+        long long index = posMap.FrameAt(i);
+        PosMapEntry e = {index, index * keyframedist,
+                         (long long) posMap.OffsetAt(i)};
         m_positionMap.push_back(e);
     }
 
@@ -18,12 +18,13 @@ using namespace std;
 #include "streamlisteners.h"
 #include "recorderbase.h"
 #include "H264Parser.h"
+#include "mythtvexp.h"
 
 class MPEGStreamData;
 class TSPacket;
 class QTime;
 
-class DTVRecorder :
+class MTV_PUBLIC DTVRecorder :
     public RecorderBase,
     public MPEGStreamListener,
     public MPEGSingleProgramStreamListener,
@@ -5,22 +5,71 @@
  * License: GPL v2
  */
 
+// POSIX headers
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef USING_MINGW
+#include <sys/mman.h>
+#endif
+
+// C++ headers
+#include <algorithm>
+using namespace std;
+
 #include <QDateTime>
+#include <QStringList>
+#include <QMap>
+#include <QVector>
 
 #include "eitcache.h"
 #include "mythcontext.h"
+#include "mythdirs.h"
 #include "mythdb.h"
 #include "mythlogging.h"
 #include "mythdate.h"
+#include "mythtimer.h"
 
 #define LOC QString("EITCache: ")
 
 // Highest version number. version is 5bits
 const uint EITCache::kVersionMax = 31;
+// Smallest hash table size, must be a power of two
+const uint EITCache::kMinTableSize = 1 << 14;
+// Rows per multi-row statement when writing to the database
+static const int kRowsPerStatement = 500;
+
+/// Header of the snapshot file, followed by the hash table slots and
+/// stamp_count channel stamps.
+typedef struct
+{
+    char     magic[8];
+    uint32_t entry_size;
+    uint32_t table_size;
+    uint32_t entry_count;
+    uint32_t stamp_count;
+    uint32_t reserved[2];
+} eit_snapshot_header_t;
+
+/// Last STATISTIC endtime of a channel the snapshot entries reflect.
+typedef struct
+{
+    uint32_t chanid;
+    uint32_t stamp;
+} eit_snapshot_stamp_t;
+
+static const char kSnapshotMagic[8] = { 'M','Y','T','H','E','I','T','2' };
 
 EITCache::EITCache()
-    : accessCnt(0), hitCnt(0),   tblChgCnt(0),   verChgCnt(0),
-      entryCnt(0), pruneCnt(0), prunedHitCnt(0), wrongChannelHitCnt(0)
+    : table(NULL), tableSize(0), tableUsed(0), mapBase(NULL), mapSize(0),
+      loaded(false), snapshotDirty(false),
+      accessCnt(0), hitCnt(0), missCnt(0), tblChgCnt(0), verChgCnt(0),
+      entryCnt(0), pruneCnt(0), prunedHitCnt(0), wrongChannelHitCnt(0),
+      probeCnt(0), loadTime(0)
 {
     // 24 hours ago
     lastPruneTime = MythDate::current().toUTC().toTime_t() - 86400;
@@ -29,32 +78,41 @@ EITCache::EITCache()
 EITCache::~EITCache()
 {
     WriteToDB();
+    FreeTable();
 }
 
 void EITCache::ResetStatistics(void)
 {
     accessCnt = 0;
     hitCnt    = 0;
+    missCnt   = 0;
     tblChgCnt = 0;
     verChgCnt = 0;
     entryCnt  = 0;
     pruneCnt  = 0;
     prunedHitCnt = 0;
     wrongChannelHitCnt = 0;
+    probeCnt  = 0;
 }
 
 QString EITCache::GetStatistics(void) const
 {
     QMutexLocker locker(&eventMapLock);
+    uint lookups = hitCnt + missCnt + tblChgCnt + verChgCnt;
     return QString(
-        "EITCache::statistics: Accesses: %1, Hits: %2, "
-        "Table Upgrades %3, New Versions: %4, Entries: %5 "
-        "Pruned entries: %6, pruned Hits: %7 Discard channel Hit %8 "
-        "Hit Ratio %9.")
-        .arg(accessCnt).arg(hitCnt).arg(tblChgCnt).arg(verChgCnt)
-        .arg(entryCnt).arg(pruneCnt).arg(prunedHitCnt)
+        "EITCache::statistics: Accesses: %1, Hits: %2, Misses: %3, "
+        "Table Upgrades %4, New Versions: %5, Entries: %6 "
+        "Pruned entries: %7, pruned Hits: %8 Discard channel Hit %9 "
+        "Hit Ratio %10, Slots used: %11 of %12, Probes per lookup: %13, "
+        "Loaded from %14 in %15 ms.")
+        .arg(accessCnt).arg(hitCnt).arg(missCnt).arg(tblChgCnt)
+        .arg(verChgCnt).arg(entryCnt).arg(pruneCnt).arg(prunedHitCnt)
         .arg(wrongChannelHitCnt)
-        .arg((hitCnt+prunedHitCnt+wrongChannelHitCnt)/(double)accessCnt);
+        .arg((hitCnt+prunedHitCnt+wrongChannelHitCnt)/(double)accessCnt)
+        .arg(tableUsed).arg(tableSize)
+        .arg(probeCnt / (double) max(lookups, 1U), 0, 'f', 2)
+        .arg(loadSource.isEmpty() ? QString("nowhere") : loadSource)
+        .arg(loadTime);
 }
 
 static inline uint64_t construct_sig(uint tableid, uint version,
@@ -84,27 +142,96 @@ static inline bool modified(uint64_t sig)
     return sig >> 63;
 }
 
-static void replace_in_db(int chanid, uint eventid, uint64_t sig)
+static inline uint hash_slot(uint chanid, uint eventid, uint mask)
+{
+    uint64_t key = ((uint64_t) chanid << 32) | eventid;
+    key *= 0x9E3779B97F4A7C15ULL;
+    return (uint) (key >> 32) & mask;
+}
+
+/// Returns the smallest table size that holds entries below 70% load.
+static uint table_size_for(uint entries, uint min_size)
 {
+    uint size = min_size;
+    while ((uint64_t) entries * 10 >= (uint64_t) size * 7)
+        size <<= 1;
+    return size;
+}
+
+static void *alloc_map(size_t size)
+{
+#ifndef USING_MINGW
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (p == MAP_FAILED) ? NULL : p;
+#else
+    return calloc(1, size);
+#endif
+}
 
+static void free_map(void *p, size_t size)
+{
+    if (!p)
+        return;
+#ifndef USING_MINGW
+    munmap(p, size);
+#else
+    (void) size;
+    free(p);
+#endif
+}
+
+/// Every backend keeps its own snapshot, they may share eit_cache but
+/// each one only loads the channels it has locked.
+static QString snapshot_filename(void)
+{
+    return GetConfDir() + "/eitcache-" + gCoreContext->GetHostName() + ".dat";
+}
+
+#define EITDATA      0
+#define CHANNEL_LOCK 1
+#define STATISTIC    2
+
+/** \brief Returns the endtime of the newest STATISTIC row of chanid.
+ *
+ *  Every backend writes such a row when it releases a channel, with an
+ *  endtime above the previous one, so a changed stamp tells us that
+ *  somebody else has written entries for the channel since we did.
+ */
+static bool stamp_in_db(uint chanid, uint &stamp)
+{
     MSqlQuery query(MSqlQuery::InitCon());
 
+    query.prepare(
+        "SELECT MAX(endtime) "
+        "FROM eit_cache "
+        "WHERE chanid = :CHANID AND "
+        "      status = :STATUS");
+    query.bindValue(":CHANID", chanid);
+    query.bindValue(":STATUS", STATISTIC);
+
+    if (!query.exec() || !query.next())
+    {
+        MythDB::DBError("Error reading eitcache channel stamp", query);
+        return false;
+    }
+
+    stamp = query.value(0).toUInt();
+    return true;
+}
+
+static void replace_in_db(MSqlQuery &query, const QStringList &rows)
+{
+    if (rows.empty())
+        return;
+
     QString qstr =
         "REPLACE INTO eit_cache "
-        "       ( chanid,  eventid,  tableid,  version,  endtime) "
-        "VALUES (:CHANID, :EVENTID, :TABLEID, :VERSION, :ENDTIME)";
+        "       (chanid, eventid, tableid, version, endtime) "
+        "VALUES " + rows.join(", ");
 
-    query.prepare(qstr);
-    query.bindValue(":CHANID",   chanid);
-    query.bindValue(":EVENTID",  eventid);
-    query.bindValue(":TABLEID",  extract_table_id(sig));
-    query.bindValue(":VERSION",  extract_version(sig));
-    query.bindValue(":ENDTIME",  extract_endtime(sig));
-
-    if (!query.exec())
+    if (!query.exec(qstr))
         MythDB::DBError("Error updating eitcache", query);
-
-    return;
 }
 
 static void delete_in_db(uint endtime)
@@ -125,10 +252,6 @@ static void delete_in_db(uint endtime)
     return;
 }
 
-#define EITDATA      0
-#define CHANNEL_LOCK 1
-#define STATISTIC    2
-
 static bool lock_channel(int chanid, uint lastPruneTime)
 {
     int lock = 1;
@@ -183,43 +306,388 @@ static bool lock_channel(int chanid, uint lastPruneTime)
     return true;
 }
 
-static void unlock_channel(int chanid, uint updated)
+/// Removes the locks of chanids and records how many entries were
+/// written for each of them, stamped with the given endtimes.
+static void unlock_channels(MSqlQuery &query, const QList<uint> &chanids,
+                            const QMap<uint,uint> &updated,
+                            const QMap<uint,uint> &stamps)
 {
-    MSqlQuery query(MSqlQuery::InitCon());
+    for (int first = 0; first < chanids.size(); first += kRowsPerStatement)
+    {
+        int last = min(chanids.size(), first + kRowsPerStatement);
 
-    QString qstr =
-        "DELETE FROM eit_cache "
-        "WHERE chanid  = :CHANID   AND "
-        "      status  = :STATUS";
+        QStringList ids;
+        QStringList stats;
+        for (int i = first; i < last; ++i)
+        {
+            ids.push_back(QString::number(chanids[i]));
+            stats.push_back(QString("(%1, %2, %3, %4)")
+                            .arg(chanids[i]).arg(updated.value(chanids[i]))
+                            .arg(stamps.value(chanids[i])).arg(STATISTIC));
+        }
 
-    query.prepare(qstr);
-    query.bindValue(":CHANID",  chanid);
-    query.bindValue(":STATUS",  CHANNEL_LOCK);
+        QString qstr = QString(
+            "DELETE FROM eit_cache "
+            "WHERE status  = %1 AND "
+            "      chanid IN (%2)").arg(CHANNEL_LOCK).arg(ids.join(", "));
 
-    if (!query.exec())
-        MythDB::DBError("Error deleting channel lock", query);
+        if (!query.exec(qstr))
+            MythDB::DBError("Error deleting channel locks", query);
 
-    // inserting statistics
-    uint now = MythDate::current().toTime_t();
-    qstr = "REPLACE INTO eit_cache "
-           "       ( chanid,  eventid,  endtime,  status) "
-           "VALUES (:CHANID, :EVENTID, :ENDTIME, :STATUS)";
+        // inserting statistics
+        qstr =
+            "REPLACE INTO eit_cache "
+            "       (chanid, eventid, endtime, status) "
+            "VALUES " + stats.join(", ");
 
-    query.prepare(qstr);
-    query.bindValue(":CHANID",   chanid);
-    query.bindValue(":EVENTID",  updated);
-    query.bindValue(":ENDTIME",  now);
-    query.bindValue(":STATUS",   STATISTIC);
+        if (!query.exec(qstr))
+            MythDB::DBError("Error inserting eit statistics", query);
+    }
+}
 
-    if (!query.exec())
-        MythDB::DBError("Error inserting eit statistics", query);
+/// Allocates an empty table, the previous table is left alone.
+bool EITCache::AllocTable(uint size)
+{
+    size_t map_size = sizeof(eit_snapshot_header_t) +
+        (size_t) size * sizeof(eit_cache_entry_t);
+
+    void *base = alloc_map(map_size);
+    if (!base)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("Unable to allocate a table of %1 entries").arg(size));
+        return false;
+    }
+
+    mapBase   = base;
+    mapSize   = map_size;
+    table     = (eit_cache_entry_t*)
+        ((char*) base + sizeof(eit_snapshot_header_t));
+    tableSize = size;
+    tableUsed = 0;
+    return true;
+}
+
+void EITCache::FreeTable(void)
+{
+    free_map(mapBase, mapSize);
+    mapBase   = NULL;
+    mapSize   = 0;
+    table     = NULL;
+    tableSize = 0;
+    tableUsed = 0;
+}
+
+/// Rehashes the table into one of size slots, dropping the entries
+/// which ended before min_endtime.
+void EITCache::Resize(uint size, uint min_endtime)
+{
+    void              *old_base     = mapBase;
+    size_t             old_map_size = mapSize;
+    eit_cache_entry_t *old_table    = table;
+    uint               old_size     = tableSize;
+
+    if (!AllocTable(size))
+        return;
+
+    for (uint i = 0; i < old_size; i++)
+    {
+        if (old_table[i].chanid &&
+            extract_endtime(old_table[i].sig) >= min_endtime)
+        {
+            Insert(old_table[i].chanid, old_table[i].eventid,
+                   old_table[i].sig);
+        }
+    }
+
+    free_map(old_base, old_map_size);
+}
+
+eit_cache_entry_t *EITCache::Find(uint chanid, uint eventid)
+{
+    const uint mask = tableSize - 1;
+    uint i = hash_slot(chanid, eventid, mask);
+    while (table[i].chanid)
+    {
+        probeCnt++;
+        if (table[i].chanid == chanid && table[i].eventid == eventid)
+            return &table[i];
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+void EITCache::Insert(uint chanid, uint eventid, uint64_t sig)
+{
+    if ((uint64_t) (tableUsed + 1) * 10 > (uint64_t) tableSize * 7)
+    {
+        Resize(tableSize << 1, 0);
+        if (tableUsed + 1 >= tableSize)
+            return; // could not grow, and the table is full
+    }
+
+    const uint mask = tableSize - 1;
+    uint i = hash_slot(chanid, eventid, mask);
+    while (table[i].chanid &&
+           (table[i].chanid != chanid || table[i].eventid != eventid))
+    {
+        i = (i + 1) & mask;
+    }
+
+    if (!table[i].chanid)
+        tableUsed++;
+
+    table[i].chanid  = chanid;
+    table[i].eventid = eventid;
+    table[i].sig     = sig;
+}
+
+/** \brief Maps the snapshot written by the last WriteToDB() call.
+ *
+ *  The file is mapped copy-on-write, so the pages are only read in as
+ *  they are used. Whether the entries of a channel are still current is
+ *  checked against its stamp when the channel is locked.
+ */
+bool EITCache::LoadSnapshot(void)
+{
+    QByteArray fname = snapshot_filename().toLocal8Bit();
+    int fd = open(fname.constData(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    eit_snapshot_header_t hdr;
+    struct stat st;
+    bool ok = (read(fd, &hdr, sizeof(hdr)) == (ssize_t) sizeof(hdr)) &&
+        !memcmp(hdr.magic, kSnapshotMagic, sizeof(hdr.magic)) &&
+        (hdr.entry_size  == sizeof(eit_cache_entry_t)) &&
+        (hdr.table_size  >= kMinTableSize) &&
+        !(hdr.table_size & (hdr.table_size - 1)) &&
+        (hdr.entry_count <  hdr.table_size);
+
+    size_t map_size = sizeof(hdr) +
+        (size_t) hdr.table_size * sizeof(eit_cache_entry_t);
+    size_t stamps_size = (size_t) hdr.stamp_count *
+        sizeof(eit_snapshot_stamp_t);
+    ok = ok && (fstat(fd, &st) == 0) &&
+        ((size_t) st.st_size == map_size + stamps_size);
+
+    QVector<eit_snapshot_stamp_t> stamps(ok ? hdr.stamp_count : 0);
+    ok = ok && (lseek(fd, map_size, SEEK_SET) == (off_t) map_size) &&
+        (read(fd, stamps.data(), stamps_size) == (ssize_t) stamps_size);
+
+    if (!ok)
+    {
+        LOG(VB_EIT, LOG_INFO, LOC + "Ignoring unusable snapshot");
+        close(fd);
+        return false;
+    }
+
+#ifndef USING_MINGW
+    void *base = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED)
+        base = NULL;
+#else
+    void *base = alloc_map(map_size);
+    if (base && (lseek(fd, 0, SEEK_SET) != 0 ||
+                 read(fd, base, map_size) != (ssize_t) map_size))
+    {
+        free_map(base, map_size);
+        base = NULL;
+    }
+#endif
+    close(fd);
+
+    if (!base)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC + "Unable to map snapshot" + ENO);
+        return false;
+    }
+
+    mapBase   = base;
+    mapSize   = map_size;
+    table     = (eit_cache_entry_t*) ((char*) base + sizeof(hdr));
+    tableSize = hdr.table_size;
+    tableUsed = hdr.entry_count;
+
+    for (int i = 0; i < stamps.size(); i++)
+        channelStamps[stamps[i].chanid] = stamps[i].stamp;
+
+    return true;
 }
 
+/// Writes the table and the channel stamps to the snapshot file, the
+/// eit_cache table must be in sync with them.
+void EITCache::WriteSnapshot(void)
+{
+    if (!table)
+        return;
+
+    eit_snapshot_header_t *hdr = (eit_snapshot_header_t*) mapBase;
+    memcpy(hdr->magic, kSnapshotMagic, sizeof(hdr->magic));
+    hdr->entry_size  = sizeof(eit_cache_entry_t);
+    hdr->table_size  = tableSize;
+    hdr->entry_count = tableUsed;
+    hdr->stamp_count = channelStamps.size();
+    hdr->reserved[0] = 0;
+    hdr->reserved[1] = 0;
+
+    QVector<eit_snapshot_stamp_t> stamps;
+    stamps.reserve(channelStamps.size());
+    QHash<uint,uint>::const_iterator it = channelStamps.begin();
+    for (; it != channelStamps.end(); ++it)
+    {
+        eit_snapshot_stamp_t stamp = { it.key(), *it };
+        stamps.push_back(stamp);
+    }
+
+    // Write to a temporary file and rename it, the old snapshot
+    // may still be mapped.
+    QByteArray fname = snapshot_filename().toLocal8Bit();
+    QByteArray tname = fname + ".tmp";
+    int fd = open(tname.constData(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC + "Unable to create snapshot" + ENO);
+        return;
+    }
+
+    const char *bufs[2] = { (const char*) mapBase,
+                            (const char*) stamps.constData() };
+    size_t      lens[2] = { mapSize,
+                            stamps.size() * sizeof(eit_snapshot_stamp_t) };
+    size_t left = 0;
+    for (uint i = 0; i < 2 && !left; i++)
+    {
+        const char *buf = bufs[i];
+        left = lens[i];
+        while (left)
+        {
+            ssize_t ret = write(fd, buf, left);
+            if (ret < 0 && errno == EINTR)
+                continue;
+            if (ret <= 0)
+                break;
+            buf  += ret;
+            left -= ret;
+        }
+    }
+    close(fd);
+
+    if (left || rename(tname.constData(), fname.constData()) < 0)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC + "Unable to write snapshot" + ENO);
+        unlink(tname.constData());
+        return;
+    }
+
+    snapshotDirty = false;
+    LOG(VB_EIT, LOG_INFO, LOC + QString("Wrote snapshot of %1 entries")
+        .arg(tableUsed));
+}
 
-event_map_t * EITCache::LoadChannel(uint chanid)
+/// Loads the entries of all channels, from our snapshot if there is one
+/// and with a single query otherwise.
+void EITCache::LoadAll(void)
 {
-    if (!lock_channel(chanid, lastPruneTime))
-        return NULL;
+    loaded = true;
+
+    MythTimer t;
+    t.start();
+
+    if (LoadSnapshot())
+    {
+        loadSource = "snapshot";
+    }
+    else
+    {
+        MSqlQuery query(MSqlQuery::InitCon());
+
+        // Read the stamps first, so that entries written while we load
+        // only make the stamp look stale.
+        query.prepare(
+            "SELECT chanid, MAX(endtime) "
+            "FROM eit_cache "
+            "WHERE status = :STATUS "
+            "GROUP BY chanid");
+        query.bindValue(":STATUS", STATISTIC);
+
+        if (!query.exec() || !query.isActive())
+            MythDB::DBError("Error loading eitcache channel stamps", query);
+
+        while (query.next())
+            channelStamps[query.value(0).toUInt()] = query.value(1).toUInt();
+
+        QString qstr =
+            "SELECT chanid,eventid,tableid,version,endtime "
+            "FROM eit_cache "
+            "WHERE endtime       > :ENDTIME  AND "
+            "      status        = :STATUS";
+
+        query.prepare(qstr);
+        query.bindValue(":ENDTIME",  lastPruneTime);
+        query.bindValue(":STATUS",   EITDATA);
+
+        if (!query.exec() || !query.isActive())
+        {
+            MythDB::DBError("Error loading eitcache", query);
+            channelStamps.clear();
+        }
+
+        uint rows = max(query.size(), 0);
+        if (AllocTable(table_size_for(rows, kMinTableSize)))
+        {
+            while (query.next())
+            {
+                uint chanid  = query.value(0).toUInt();
+                uint eventid = query.value(1).toUInt();
+                uint tableid = query.value(2).toUInt();
+                uint version = query.value(3).toUInt();
+                uint endtime = query.value(4).toUInt();
+
+                Insert(chanid, eventid,
+                       construct_sig(tableid, version, endtime, false));
+            }
+        }
+        else
+        {
+            channelStamps.clear();
+        }
+
+        loadSource    = "database";
+        snapshotDirty = true;
+    }
+
+    loadTime  = t.elapsed();
+    entryCnt += tableUsed;
+
+    LOG(VB_EIT, LOG_INFO, LOC + QString("Loaded %1 entries from %2 in %3 ms")
+        .arg(tableUsed).arg(loadSource).arg(loadTime));
+}
+
+/** \brief Locks chanid for us, the result is remembered until the
+ *         next WriteToDB().
+ *
+ *  When another backend has released the channel since our entries for
+ *  it were loaded, its entries are read again, so that the updates of
+ *  the backends which held the lock before us are seen.
+ */
+bool EITCache::LoadChannel(uint chanid)
+{
+    bool locked = lock_channel(chanid, lastPruneTime);
+    channelLocks[chanid] = locked;
+    if (!locked || !table)
+        return locked;
+
+    uint stamp = 0;
+    bool stamped = stamp_in_db(chanid, stamp);
+
+    // A channel without statistics may have been pruned, never trust it.
+    QHash<uint,uint>::const_iterator sit = channelStamps.find(chanid);
+    if (stamped && stamp && sit != channelStamps.end() && *sit == stamp)
+        return true;
+
+    channelStamps.remove(chanid);
 
     MSqlQuery query(MSqlQuery::InitCon());
 
@@ -235,15 +703,13 @@ event_map_t * EITCache::LoadChannel(uint chanid)
     query.bindValue(":ENDTIME",  lastPruneTime);
     query.bindValue(":STATUS",   EITDATA);
 
-
     if (!query.exec() || !query.isActive())
     {
         MythDB::DBError("Error loading eitcache", query);
-        return NULL;
+        return true;
     }
 
-    event_map_t * eventMap = new event_map_t();
-
+    uint count = 0;
     while (query.next())
     {
         uint eventid = query.value(0).toUInt();
@@ -251,59 +717,101 @@ event_map_t * EITCache::LoadChannel(uint chanid)
         uint version = query.value(2).toUInt();
         uint endtime = query.value(3).toUInt();
 
-        (*eventMap)[eventid] = construct_sig(tableid, version, endtime, false);
+        Insert(chanid, eventid,
+               construct_sig(tableid, version, endtime, false));
+        count++;
     }
 
-    if (eventMap->size())
+    if (count)
         LOG(VB_EIT, LOG_INFO, LOC + QString("Loaded %1 entries for channel %2")
-                .arg(eventMap->size()).arg(chanid));
+                .arg(count).arg(chanid));
 
-    entryCnt += eventMap->size();
-    return eventMap;
+    if (stamped)
+        channelStamps[chanid] = stamp;
+    snapshotDirty = true;
+    entryCnt += count;
+    return true;
 }
 
-void EITCache::WriteChannelToDB(uint chanid)
+void EITCache::WriteToDB(void)
 {
-    event_map_t * eventMap = channelMap[chanid];
+    QMutexLocker locker(&eventMapLock);
 
-    if (!eventMap)
-    {
-        channelMap.remove(chanid);
+    if (!loaded)
         return;
-    }
 
-    uint size    = eventMap->size();
-    uint updated = 0;
+    MSqlQuery query(MSqlQuery::InitCon());
 
-    event_map_t::iterator it = eventMap->begin();
-    while (it != eventMap->end())
+    QMap<uint,uint> updated;
+    uint total = 0;
+    QStringList rows;
+    for (uint i = 0; i < tableSize; i++)
     {
-        if (modified(*it) && extract_endtime(*it) > lastPruneTime)
+        eit_cache_entry_t &entry = table[i];
+        if (!entry.chanid || !modified(entry.sig))
+            continue;
+
+        if (extract_endtime(entry.sig) > lastPruneTime)
         {
-            replace_in_db(chanid, it.key(), *it);
-            updated++;
-            *it &= ~(uint64_t)0 >> 1; // mark as synced
+            rows.push_back(QString("(%1, %2, %3, %4, %5)")
+                           .arg(entry.chanid).arg(entry.eventid)
+                           .arg(extract_table_id(entry.sig))
+                           .arg(extract_version(entry.sig))
+                           .arg(extract_endtime(entry.sig)));
+            updated[entry.chanid]++;
+            total++;
+        }
+        entry.sig &= ~(uint64_t)0 >> 1; // mark as synced
+
+        if (rows.size() >= kRowsPerStatement)
+        {
+            replace_in_db(query, rows);
+            rows.clear();
         }
-        ++it;
     }
-    unlock_channel(chanid, updated);
+    replace_in_db(query, rows);
 
-    if (updated)
-        LOG(VB_EIT, LOG_INFO, LOC + QString("Wrote %1 modified entries of %2 "
-                                      "for channel %3 to database.")
-                .arg(updated).arg(size).arg(chanid));
-}
+    // Forget the channels somebody else had locked, so we try again
+    // on the next access, and release the locks we hold.
+    QList<uint> chanids;
+    QHash<uint,bool>::iterator it = channelLocks.begin();
+    while (it != channelLocks.end())
+    {
+        if (*it)
+        {
+            chanids.push_back(it.key());
+            ++it;
+        }
+        else
+        {
+            it = channelLocks.erase(it);
+        }
+    }
 
-void EITCache::WriteToDB(void)
-{
-    QMutexLocker locker(&eventMapLock);
+    // Stamp the channels above any stamp seen when they were locked,
+    // so that backends with the same clock second still differ.
+    uint now = MythDate::current().toTime_t();
+    QMap<uint,uint> stamps;
+    for (int i = 0; i < chanids.size(); i++)
+    {
+        uint stamp = max(now, channelStamps.value(chanids[i]) + 1);
+        stamps[chanids[i]] = stamp;
+        channelStamps[chanids[i]] = stamp;
+    }
+    unlock_channels(query, chanids, updated, stamps);
 
-    key_map_t::iterator it = channelMap.begin();
-    while (it != channelMap.end())
+    if (total)
     {
-        WriteChannelToDB(it.key());
-        ++it;
+        LOG(VB_EIT, LOG_INFO, LOC + QString("Wrote %1 modified entries "
+                                            "for %2 channels to database.")
+                .arg(total).arg(updated.size()));
     }
+
+    if (total || !chanids.empty())
+        snapshotDirty = true;
+
+    if (snapshotDirty)
+        WriteSnapshot();
 }
 
 
@@ -330,29 +838,33 @@ bool EITCache::IsNewEIT(uint chanid,  uint tableid,   uint version,
         return false;
 
     QMutexLocker locker(&eventMapLock);
-    if (!channelMap.contains(chanid))
-    {
-        channelMap[chanid] = LoadChannel(chanid);
-    }
+    if (!loaded)
+        LoadAll();
 
-    if (!channelMap[chanid])
+    QHash<uint,bool>::const_iterator lit = channelLocks.find(chanid);
+    bool locked = (lit != channelLocks.end()) ? *lit : LoadChannel(chanid);
+    if (!locked)
     {
         wrongChannelHitCnt++;
         return false;
     }
 
-    event_map_t * eventMap = channelMap[chanid];
-    event_map_t::iterator it = eventMap->find(eventid);
-    if (it != eventMap->end())
+    if (!table)
+        return true;
+
+    uint64_t sig = construct_sig(tableid, version, endtime, true);
+
+    eit_cache_entry_t *entry = Find(chanid, eventid);
+    if (entry)
     {
-        if (extract_table_id(*it) > tableid)
+        if (extract_table_id(entry->sig) > tableid)
         {
             // EIT from lower (ie. better) table number
             tblChgCnt++;
         }
-        else if ((extract_table_id(*it) == tableid) &&
-                 ((extract_version(*it) < version) ||
-                  ((extract_version(*it) == kVersionMax) &&
+        else if ((extract_table_id(entry->sig) == tableid) &&
+                 ((extract_version(entry->sig) < version) ||
+                  ((extract_version(entry->sig) == kVersionMax) &&
                    version < kVersionMax)))
         {
             // EIT updated version on current table
@@ -364,9 +876,15 @@ bool EITCache::IsNewEIT(uint chanid,  uint tableid,   uint version,
             hitCnt++;
             return false;
         }
+
+        entry->sig = sig;
+    }
+    else
+    {
+        missCnt++;
+        Insert(chanid, eventid, sig);
     }
 
-    eventMap->insert(eventid, construct_sig(tableid, version, endtime, true));
     entryCnt++;
 
     return true;
@@ -386,15 +904,30 @@ uint EITCache::PruneOldEntries(uint timestamp)
             tmptime.toString(Qt::ISODate));
     }
 
-    lastPruneTime  = timestamp;
+    uint pruned = 0;
 
-    // Write all modified entries to DB and start with a clean cache
-    WriteToDB();
+    {
+        QMutexLocker locker(&eventMapLock);
+
+        lastPruneTime = timestamp;
+
+        if (table)
+        {
+            uint used = tableUsed;
+            Resize(table_size_for(used, kMinTableSize), timestamp);
+            pruned    = used - tableUsed;
+            pruneCnt += pruned;
+            snapshotDirty |= pruned > 0;
+        }
+    }
 
     // Prune old entries in the DB
     delete_in_db(timestamp);
 
-    return 0;
+    // Write all modified entries to the DB
+    WriteToDB();
+
+    return pruned;
 }
 
 
@@ -11,14 +11,33 @@
 // Qt headers
 #include <QString>
 #include <QMutex>
-#include <QMap>
+#include <QHash>
 
 // MythTV headers
 #include "mythtvexp.h"
 
-typedef QMap<uint, uint64_t> event_map_t;
-typedef QMap<uint, event_map_t*> key_map_t;
-
+/// One slot of the EITCache hash table, chanid 0 marks an empty slot.
+typedef struct
+{
+    uint32_t chanid;
+    uint32_t eventid;
+    uint64_t sig;
+} eit_cache_entry_t;
+
+/** \class EITCache
+ *  \brief Remembers which EIT events have already been seen, so that
+ *         unchanged events are not processed again.
+ *
+ *  The events of all channels are kept in a single open addressing hash
+ *  table keyed by (chanid, eventid). The table is loaded in bulk, either
+ *  by memory mapping the snapshot this backend wrote on its last flush or
+ *  with a single query of the eit_cache table, and modified entries are
+ *  written back with multi-row statements.
+ *
+ *  Several backends may share eit_cache. Each release of a channel lock
+ *  leaves a stamp, and a channel is read from the database again when we
+ *  lock it and its stamp is not the one our entries were loaded with.
+ */
 class EITCache
 {
   public:
@@ -35,11 +54,30 @@ class EITCache
     QString GetStatistics(void) const;
 
   private:
-    event_map_t * LoadChannel(uint chanid);
-    void WriteChannelToDB(uint chanid);
-
-    // event key cache
-    key_map_t   channelMap;
+    bool LoadChannel(uint chanid);
+    void LoadAll(void);
+    bool LoadSnapshot(void);
+    void WriteSnapshot(void);
+
+    eit_cache_entry_t *Find(uint chanid, uint eventid);
+    void Insert(uint chanid, uint eventid, uint64_t sig);
+    void Resize(uint size, uint min_endtime);
+    bool AllocTable(uint size);
+    void FreeTable(void);
+
+    // event key cache, flat hash of size tableSize (a power of two)
+    eit_cache_entry_t *table;
+    uint            tableSize;
+    uint            tableUsed;
+    void           *mapBase;
+    size_t          mapSize;
+    bool            loaded;
+    bool            snapshotDirty;
+
+    // channels we have tried to lock, true if we hold the lock
+    QHash<uint, bool> channelLocks;
+    // last stamp of each channel, our entries are current as of it
+    QHash<uint, uint> channelStamps;
 
     mutable QMutex eventMapLock;
     uint            lastPruneTime;
@@ -47,14 +85,19 @@ class EITCache
     // statistics
     uint        accessCnt;
     uint        hitCnt;
+    uint        missCnt;
     uint        tblChgCnt;
     uint        verChgCnt;
     uint        entryCnt;
     uint        pruneCnt;
     uint        prunedHitCnt;
     uint        wrongChannelHitCnt;
+    uint64_t    probeCnt;
+    QString     loadSource;
+    uint        loadTime;
 
     static const uint kVersionMax;
+    static const uint kMinTableSize;
 
   public:
     static MTV_PUBLIC void ClearChannelLocks(void);
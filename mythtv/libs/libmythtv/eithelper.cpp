@@ -23,6 +23,7 @@ using namespace std;
 #include "compat.h" // for gmtime_r on windows.
 
 const uint EITHelper::kChunkSize = 20;
+const uint EITHelper::kBulkChunkSize = 500;
 EITCache *EITHelper::eitcache = new EITCache();
 
 static uint get_chan_id_from_db(uint sourceid,
@@ -36,7 +37,7 @@ static void init_fixup(QMap<uint64_t,uint> &fix);
 EITHelper::EITHelper() :
     eitfixup(new EITFixUp()),
     gps_offset(-1 * GPS_LEAP_SECONDS),
-    sourceid(0)
+    sourceid(0), bulk_insert(false)
 {
     init_fixup(fixup);
 }
@@ -70,19 +71,31 @@ uint EITHelper::ProcessEvents(void)
         return 0;
 
     MSqlQuery query(MSqlQuery::InitCon());
-    for (uint i = 0; (i < kChunkSize) && (db_events.size() > 0); i++)
+    DBEventBatch *batch = bulk_insert ? new DBEventBatch() : NULL;
+    uint chunk_size = bulk_insert ? kBulkChunkSize : kChunkSize;
+    for (uint i = 0; (i < chunk_size) && (db_events.size() > 0); i++)
     {
         DBEventEIT *event = db_events.dequeue();
         eitList_lock.unlock();
 
         eitfixup->Fix(*event);
 
-        insertCount += event->UpdateDB(query, 1000);
+        insertCount += event->UpdateDB(query, 1000, batch);
 
         delete event;
         eitList_lock.lock();
     }
 
+    if (batch)
+    {
+        eitList_lock.unlock();
+        batch->Flush();
+        LOG(VB_EIT, LOG_DEBUG, LOC + "Bulk insert statistics:" +
+            batch->GetStatistics());
+        delete batch;
+        eitList_lock.lock();
+    }
+
     if (!insertCount)
         return 0;
 
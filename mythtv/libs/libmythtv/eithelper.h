@@ -70,6 +70,7 @@ class EITHelper
     void SetFixup(uint atsc_major, uint atsc_minor, uint eitfixup);
     void SetLanguagePreferences(const QStringList &langPref);
     void SetSourceID(uint _sourceid);
+    void SetBulkInsert(bool enable) { bulk_insert = enable; }
 
 #ifdef USING_BACKEND
     void AddEIT(uint atsc_major, uint atsc_minor,
@@ -106,6 +107,7 @@ class EITHelper
 
     int                     gps_offset;
     uint                    sourceid;
+    bool                    bulk_insert;
     QMap<uint64_t,uint>     fixup;
     ATSCSRCToEvents         incomplete_events;
     ATSCSRCToETTs           unmatched_etts;
@@ -116,6 +118,7 @@ class EITHelper
 
     /// Maximum number of DB inserts per ProcessEvents call.
     static const uint kChunkSize;
+    static const uint kBulkChunkSize;
 };
 
 #endif // EIT_HELPER_H
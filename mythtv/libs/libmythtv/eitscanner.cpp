@@ -16,6 +16,7 @@
 #include "mthread.h"
 #include "iso639.h"
 #include "mythdb.h"
+#include "mythcorecontext.h"
 #include "tv_rec.h"
 
 #define LOC QString("EITScanner: ")
@@ -42,6 +43,7 @@ EITScanner::EITScanner(uint _cardnum)
 {
     QStringList langPref = iso639_get_language_list();
     eitHelper->SetLanguagePreferences(langPref);
+    eitHelper->SetBulkInsert(gCoreContext->GetNumSetting("EITBulkInsert", 0));
 
     eventThread->start(QThread::IdlePriority);
 }
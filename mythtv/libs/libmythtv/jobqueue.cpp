@@ -6,12 +6,15 @@
 #include <cstdlib>
 #include <fcntl.h>
 #include <pthread.h>
+#include <algorithm>
 using namespace std;
 
 #include <QDateTime>
 #include <QFileInfo>
 #include <QRegExp>
+#include <QThread>
 #include <QEvent>
+#include <QSet>
 #include <QCoreApplication>
 
 #include "mythconfig.h"
@@ -43,6 +46,31 @@ using namespace std;
 
 #define LOC     QString("JobQueue: ")
 
+/// Returns the name used for jobType in the per job type settings.
+static QString job_setting_name(int jobType)
+{
+    switch (jobType)
+    {
+        case JOB_TRANSCODE: return "Transcode";
+        case JOB_COMMFLAG:  return "CommFlag";
+        case JOB_METADATA:  return "Metadata";
+        default:            break;
+    }
+    return QString("UserJob%1").arg(JobQueue::UserJobTypeToIndex(jobType));
+}
+
+static JobTypeStats &get_type_stats(JobQueueStats &stats, int jobType)
+{
+    QMap<int, JobTypeStats>::iterator it = stats.types.find(jobType);
+    if (it == stats.types.end())
+    {
+        JobTypeStats ts = JobTypeStats();
+        ts.type = jobType;
+        it = stats.types.insert(jobType, ts);
+    }
+    return *it;
+}
+
 JobQueue::JobQueue(bool master) :
     m_hostname(gCoreContext->GetHostName()),
     jobsRunning(0),
@@ -51,10 +79,14 @@ JobQueue::JobQueue(bool master) :
     runningJobsLock(new QMutex(QMutex::Recursive)),
     isMaster(master),
     queueThread(new MThread("JobQueue", this)),
-    processQueue(false)
+    processQueue(false),
+    queueWakeup(false)
 {
     jobQueueCPU = gCoreContext->GetNumSetting("JobQueueCPU", 0);
 
+    stats.maxJobs = 0;
+    stats.recordings = 0;
+
 #ifndef USING_VALGRIND
     QMutexLocker locker(&queueThreadCondLock);
     processQueue = true;
@@ -91,6 +123,15 @@ void JobQueue::customEvent(QEvent *e)
         MythEvent *me = (MythEvent *)e;
         QString message = me->Message();
 
+        if (message.left(10) == "JOB_QUEUED")
+        {
+            // JOB_QUEUED type [hostname]
+            QStringList tokens = message.split(" ", QString::SkipEmptyParts);
+            if (tokens.size() < 3 || tokens[2] == m_hostname)
+                WakeQueue();
+            return;
+        }
+
         if (message.left(9) == "LOCAL_JOB")
         {
             // LOCAL_JOB action ID jobID
@@ -177,26 +218,38 @@ void JobQueue::ProcessQueue(void)
 
     QMap<int, int> jobStatus;
     int maxJobs;
+    int recordings;
     QString message;
     QMap<int, JobQueueEntry> jobs;
+    QList<int> order;
+    QMap<int, int> typeMax;
+    QMap<int, int> typeRunning;
+    QMap<int, int> typeWaiting;
+    QDateTime nextRunTime;
     bool atMax = false;
     bool inTimeWindow = true;
-    bool startedJobAlready = false;
     QMap<int, RunningJobInfo>::Iterator rjiter;
 
     QMutexLocker locker(&queueThreadCondLock);
     while (processQueue)
     {
+        queueWakeup = false;
         locker.unlock();
 
-        startedJobAlready = false;
         sleepTime = gCoreContext->GetNumSetting("JobQueueCheckFrequency", 30);
         maxJobs = gCoreContext->GetNumSetting("JobQueueMaxSimultaneousJobs", 3);
+        recordings = GetActiveRecordings();
         LOG(VB_JOBQUEUE, LOG_INFO, LOC +
-            QString("Currently set to run up to %1 job(s) max.")
-                        .arg(maxJobs));
+            QString("Currently set to run up to %1 job(s) max, "
+                    "%2 recording(s) in progress.")
+                        .arg(maxJobs).arg(recordings));
 
         jobStatus.clear();
+        order.clear();
+        typeMax.clear();
+        typeRunning.clear();
+        typeWaiting.clear();
+        nextRunTime = QDateTime();
 
         runningJobsLock->lock();
         for (rjiter = runningJobs.begin(); rjiter != runningJobs.end();
@@ -222,8 +275,31 @@ void JobQueue::ProcessQueue(void)
                      (status == JOB_STARTING) ||
                      (status == JOB_PAUSED)) &&
                     (hostname == m_hostname))
-                jobsRunning++;
+                {
+                    jobsRunning++;
+                    typeRunning[jobs[x].type]++;
+                }
+                else if ((status == JOB_QUEUED) &&
+                         (hostname.isEmpty() || hostname == m_hostname))
+                {
+                    typeWaiting[jobs[x].type]++;
+                }
+            }
+
+            // Look at the jobs with the highest priority first, and
+            // otherwise in the order they are due to run.
+            QMap<int, QList<int> > byPriority;
+            QMap<int, int> priorities;
+            for (int x = 0; x < jobs.size(); x++)
+            {
+                int type = jobs[x].type;
+                if (!priorities.contains(type))
+                    priorities[type] = GetJobPriority(type);
+                byPriority[-priorities[type]].push_back(x);
             }
+            QMap<int, QList<int> >::const_iterator pit = byPriority.begin();
+            for (; pit != byPriority.end(); ++pit)
+                order += *pit;
 
             message = QString("Currently Running %1 jobs.")
                               .arg(jobsRunning);
@@ -251,9 +327,10 @@ void JobQueue::ProcessQueue(void)
             }
 
 
-            for ( int x = 0;
-                 (x < jobs.size()) && (jobsRunning < maxJobs); x++)
+            for (int i = 0;
+                 (i < order.size()) && (jobsRunning < maxJobs); i++)
             {
+                int x = order[i];
                 jobID = jobs[x].id;
                 cmds = jobs[x].cmds;
                 flags = jobs[x].flags;
@@ -319,6 +396,12 @@ void JobQueue::ProcessQueue(void)
                 // Is this job scheduled for the future
                 if (jobs[x].schedruntime > MythDate::current())
                 {
+                    if (!nextRunTime.isValid() ||
+                        jobs[x].schedruntime < nextRunTime)
+                    {
+                        nextRunTime = jobs[x].schedruntime;
+                    }
+
                     message = QString("Skipping '%1' job for %2, this job is "
                                       "not scheduled to run until %3.")
                                       .arg(JobText(jobs[x].type)).arg(logInfo)
@@ -431,9 +514,19 @@ void JobQueue::ProcessQueue(void)
                     continue;
                 }
 
-                // never start or claim more than one job in a single run
-                if (startedJobAlready)
+                // Is a worker slot free for this type of job?
+                int type = jobs[x].type;
+                if (!typeMax.contains(type))
+                    typeMax[type] = GetMaxJobs(type, maxJobs, recordings);
+                if (typeRunning[type] >= typeMax[type])
+                {
+                    message = QString("Skipping '%1' job for %2, all %3 "
+                                      "'%1' worker slot(s) are busy.")
+                                      .arg(JobText(type)).arg(logInfo)
+                                      .arg(typeMax[type]);
+                    LOG(VB_JOBQUEUE, LOG_INFO, LOC + message);
                     continue;
+                }
 
                 if ((inTimeWindow) &&
                     (hostname.isEmpty()) &&
@@ -461,12 +554,40 @@ void JobQueue::ProcessQueue(void)
                                   .arg(StatusText(status));
                 LOG(VB_JOBQUEUE, LOG_INFO, LOC + message);
 
-                ProcessJob(jobs[x]);
+                if (!ProcessJob(jobs[x]))
+                    continue;
 
-                startedJobAlready = true;
+                jobsRunning++;
+                typeRunning[type]++;
+                typeWaiting[type] = max(typeWaiting[type] - 1, 0);
             }
         }
 
+        statsLock.lock();
+        stats.lastRun = MythDate::current();
+        stats.maxJobs = maxJobs;
+        stats.recordings = recordings;
+        QMap<int, JobTypeStats>::iterator sit = stats.types.begin();
+        for (; sit != stats.types.end(); ++sit)
+        {
+            (*sit).running = 0;
+            (*sit).waiting = 0;
+        }
+        QSet<int> seen = typeRunning.keys().toSet();
+        seen += typeWaiting.keys().toSet();
+        QSet<int>::const_iterator tit = seen.begin();
+        for (; tit != seen.end(); ++tit)
+        {
+            if (!typeMax.contains(*tit))
+                typeMax[*tit] = GetMaxJobs(*tit, maxJobs, recordings);
+            JobTypeStats &ts = get_type_stats(stats, *tit);
+            ts.maxJobs  = typeMax[*tit];
+            ts.priority = GetJobPriority(*tit);
+            ts.running  = typeRunning.value(*tit, 0);
+            ts.waiting  = typeWaiting.value(*tit, 0);
+        }
+        statsLock.unlock();
+
         if (QCoreApplication::applicationName() == MYTH_APPNAME_MYTHJOBQUEUE)
         {
             if (jobsRunning > 0)
@@ -490,16 +611,31 @@ void JobQueue::ProcessQueue(void)
         }
 
 
+        // Queued and finished jobs wake us up, so this is only a
+        // fallback for jobs queued by older clients and other hosts.
         locker.relock();
-        if (processQueue)
+        if (processQueue && !queueWakeup)
         {
-            int st = (startedJobAlready) ? (5 * 1000) : (sleepTime * 1000);
+            int st = sleepTime * 1000;
+            if (nextRunTime.isValid() && st > 0)
+            {
+                int due = MythDate::current().secsTo(nextRunTime) + 1;
+                st = min(st, max(due, 1) * 1000);
+            }
             if (st > 0)
                 queueThreadCond.wait(locker.mutex(), st);
         }
     }
 }
 
+/// Makes ProcessQueue() look at the queue again right away.
+void JobQueue::WakeQueue(void)
+{
+    QMutexLocker locker(&queueThreadCondLock);
+    queueWakeup = true;
+    queueThreadCond.wakeAll();
+}
+
 bool JobQueue::QueueRecordingJobs(const RecordingInfo &recinfo, int jobTypes)
 {
     if (jobTypes == JOB_NONE)
@@ -609,6 +745,13 @@ bool JobQueue::QueueJob(int jobType, uint chanid, const QDateTime &recstartts,
         return false;
     }
 
+    // Let the job queues start it without waiting for their next check
+    if (status == JOB_QUEUED)
+    {
+        gCoreContext->SendMessage(
+            QString("JOB_QUEUED %1 %2").arg(jobType).arg(host).trimmed());
+    }
+
     return true;
 }
 
@@ -1418,6 +1561,66 @@ bool JobQueue::ChangeJobHost(int jobID, QString newHostname)
     return false;
 }
 
+/** \brief Returns the priority of jobType, jobs with a higher priority
+ *         are started first.
+ */
+int JobQueue::GetJobPriority(int jobType)
+{
+    return gCoreContext->GetNumSetting(
+        QString("JobQueuePriority%1").arg(job_setting_name(jobType)), 0);
+}
+
+/** \brief Returns how many jobs of jobType may run at once on this host.
+ *
+ *  If the JobQueueMax<type>Jobs setting is not set, metadata lookups may
+ *  use all maxJobs slots while the CPU bound jobs get one slot per CPU
+ *  not used by a recording in progress, but at least one.
+ */
+int JobQueue::GetMaxJobs(int jobType, int maxJobs, int recordings)
+{
+    int typeMax = gCoreContext->GetNumSetting(
+        QString("JobQueueMax%1Jobs").arg(job_setting_name(jobType)), 0);
+    if (typeMax > 0)
+        return typeMax;
+
+    if (jobType == JOB_METADATA)
+        return maxJobs;
+
+    return max(QThread::idealThreadCount() - recordings, 1);
+}
+
+/// Returns the number of recordings in progress on this host.
+int JobQueue::GetActiveRecordings(void)
+{
+    MSqlQuery query(MSqlQuery::InitCon());
+
+    query.prepare("SELECT COUNT(*) FROM inuseprograms "
+                  "WHERE recusage = :RECUSAGE AND hostname = :HOSTNAME AND "
+                  "      lastupdatetime > :ONEHOURAGO ;");
+    query.bindValue(":RECUSAGE", kRecorderInUseID);
+    query.bindValue(":HOSTNAME", m_hostname);
+    query.bindValue(":ONEHOURAGO", MythDate::current().addSecs(-61 * 60));
+
+    if (!query.exec())
+    {
+        MythDB::DBError("JobQueue::GetActiveRecordings()", query);
+        return 0;
+    }
+
+    if (query.next())
+        return query.value(0).toInt();
+
+    return 0;
+}
+
+/// Returns the worker slots and the queue latency and run time of the
+/// jobs started by this job queue, by job type.
+JobQueueStats JobQueue::GetStats(void)
+{
+    QMutexLocker locker(&statsLock);
+    return stats;
+}
+
 bool JobQueue::AllowedToRun(JobQueueEntry job)
 {
     QString allowSetting;
@@ -1648,7 +1851,9 @@ void JobQueue::CleanupOldJobsInQueue()
     }
 }
 
-void JobQueue::ProcessJob(JobQueueEntry job)
+/// \brief Starts the job on a child thread.
+/// \return false if the job could not be started.
+bool JobQueue::ProcessJob(JobQueueEntry job)
 {
     int jobID = job.id;
     QString name = QString("jobqueue%1%2").arg(jobID).arg(random());
@@ -1657,7 +1862,7 @@ void JobQueue::ProcessJob(JobQueueEntry job)
     {
         LOG(VB_JOBQUEUE, LOG_ERR, LOC +
                 "ProcessJob(): Unable to open database connection");
-        return;
+        return false;
     }
 
     ChangeJobStatus(jobID, JOB_PENDING);
@@ -1679,7 +1884,7 @@ void JobQueue::ProcessJob(JobQueueEntry job)
 
             delete pginfo;
 
-            return;
+            return false;
         }
 
         pginfo->SetPathname(pginfo->GetPlaybackURL());
@@ -1688,6 +1893,7 @@ void JobQueue::ProcessJob(JobQueueEntry job)
 
     runningJobsLock->lock();
 
+    bool started = true;
     ChangeJobStatus(jobID, JOB_STARTING);
     RunningJobInfo jInfo;
     jInfo.type    = job.type;
@@ -1696,6 +1902,7 @@ void JobQueue::ProcessJob(JobQueueEntry job)
     jInfo.desc    = GetJobDescription(job.type);
     jInfo.command = GetJobCommand(jobID, job.type, pginfo);
     jInfo.pginfo  = pginfo;
+    jInfo.starttime = MythDate::current();
 
     runningJobs[jobID] = jInfo;
 
@@ -1707,6 +1914,7 @@ void JobQueue::ProcessJob(JobQueueEntry job)
         ChangeJobStatus(jobID, JOB_CANCELLED,
                         tr("Program has been deleted"));
         RemoveRunningJob(jobID);
+        started = false;
     }
     else if ((job.type == JOB_TRANSCODE) ||
         (runningJobs[jobID].command == "mythtranscode"))
@@ -1732,9 +1940,26 @@ void JobQueue::ProcessJob(JobQueueEntry job)
         ChangeJobStatus(jobID, JOB_ERRORED,
                         tr("UNKNOWN JobType, unable to process!"));
         RemoveRunningJob(jobID);
+        started = false;
+    }
+
+    if (started)
+    {
+        // A deferred job has only been waiting since it was due to run
+        QDateTime queuedtime = max(job.inserttime, job.schedruntime);
+        qint64 latency = max(queuedtime.secsTo(jInfo.starttime), 0);
+
+        statsLock.lock();
+        JobTypeStats &ts = get_type_stats(stats, job.type);
+        ts.started++;
+        ts.latencyTotal += latency;
+        ts.latencyMax = max(ts.latencyMax, latency);
+        statsLock.unlock();
     }
 
     runningJobsLock->unlock();
+
+    return started;
 }
 
 void JobQueue::StartChildJob(void *(*ChildThreadRoutine)(void *), int jobID)
@@ -1829,10 +2054,28 @@ void JobQueue::RemoveRunningJob(int id)
             delete pginfo;
         }
 
+        int status = GetJobStatus(id);
+        qint64 runtime = max(runningJobs[id].starttime.secsTo(
+                                 MythDate::current()), 0);
+
+        statsLock.lock();
+        JobTypeStats &ts = get_type_stats(stats, runningJobs[id].type);
+        ts.done++;
+        if (status == JOB_FINISHED)
+            ts.finished++;
+        else if ((status == JOB_ERRORED) || (status == JOB_ABORTED))
+            ts.errored++;
+        ts.runtimeTotal += runtime;
+        ts.runtimeMax = max(ts.runtimeMax, runtime);
+        statsLock.unlock();
+
         runningJobs.remove(id);
     }
 
     runningJobsLock->unlock();
+
+    // A worker slot is free now
+    WakeQueue();
 }
 
 QString JobQueue::PrettyPrint(off_t bytes)
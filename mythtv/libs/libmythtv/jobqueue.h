@@ -109,8 +109,32 @@ typedef struct runningjobinfo {
     QString      desc;
     QString      command;
     ProgramInfo *pginfo;
+    QDateTime    starttime;
 } RunningJobInfo;
 
+typedef struct jobtypestats {
+    int          type;
+    int          maxJobs;    ///< worker slots of this type on this host
+    int          priority;
+    uint         waiting;    ///< queued for this host at the last run
+    uint         running;
+    uint         started;
+    uint         done;       ///< no longer running, for any reason
+    uint         finished;
+    uint         errored;
+    qint64       latencyTotal; ///< seconds from queued to started
+    qint64       latencyMax;
+    qint64       runtimeTotal; ///< seconds from started to done
+    qint64       runtimeMax;
+} JobTypeStats;
+
+typedef struct jobqueuestats {
+    QDateTime    lastRun;
+    int          maxJobs;
+    int          recordings; ///< local recordings at the last run
+    QMap<int, JobTypeStats> types;
+} JobQueueStats;
+
 class JobQueue;
 
 class MTV_PUBLIC JobQueue : public QObject, public QRunnable
@@ -197,6 +221,9 @@ class MTV_PUBLIC JobQueue : public QObject, public QRunnable
                                       { RecoverQueue(true); }
     static void CleanupOldJobsInQueue();
 
+    static int GetJobPriority(int jobType);
+    JobQueueStats GetStats(void);
+
   private:
     typedef struct jobthreadstruct
     {
@@ -206,10 +233,13 @@ class MTV_PUBLIC JobQueue : public QObject, public QRunnable
 
     void run(void); // QRunnable
     void ProcessQueue(void);
+    void WakeQueue(void);
 
-    void ProcessJob(JobQueueEntry job);
+    bool ProcessJob(JobQueueEntry job);
 
     bool AllowedToRun(JobQueueEntry job);
+    int GetMaxJobs(int jobType, int maxJobs, int recordings);
+    int GetActiveRecordings(void);
 
     static bool InJobRunWindow(int orStartingWithinMins = 0);
 
@@ -252,6 +282,10 @@ class MTV_PUBLIC JobQueue : public QObject, public QRunnable
     QWaitCondition queueThreadCond;
     QMutex queueThreadCondLock;
     bool processQueue;
+    bool queueWakeup;
+
+    QMutex statsLock;
+    JobQueueStats stats;
 };
 
 #endif
@@ -69,6 +69,7 @@ MPEGStreamData::MPEGStreamData(int desiredProgram, bool cacheTables)
       _si_time_offset_indx(0),
       _eit_helper(NULL), _eit_rate(0.0f),
       _listening_disabled(false),
+      _pid_table_dirty(true), _pid_table_generation(0),
       _encryption_lock(QMutex::Recursive), _listener_lock(QMutex::Recursive),
       _cache_tables(cacheTables), _cache_lock(QMutex::Recursive),
       // Single program stuff
@@ -84,6 +85,7 @@ MPEGStreamData::MPEGStreamData(int desiredProgram, bool cacheTables)
       _invalid_pat_seen(false), _invalid_pat_warning(false)
 {
     memset(_si_time_offsets, 0, sizeof(_si_time_offsets));
+    memset(_pid_table, 0, sizeof(_pid_table));
 
     AddListeningPID(MPEG_PAT_PID);
     AddListeningPID(MPEG_CAT_PID);
@@ -191,6 +193,7 @@ void MPEGStreamData::Reset(int desiredProgram)
     _pids_audio.clear();
 
     _pid_video_single_program = _pid_pmt_single_program = 0xffffffff;
+    _pid_table_dirty = true;
 
     _pat_version.clear();
     _pat_section_seen.clear();
@@ -638,11 +641,15 @@ bool MPEGStreamData::CreatePMTSingleProgram(const ProgramMapTable &pmt)
     }
 
     _pids_audio.clear();
+    _pid_table_dirty = true;
     for (uint i = 0; i < audioPIDs.size(); i++)
         AddAudioPID(audioPIDs[i]);
 
     if (videoPIDs.size() >= 1)
+    {
         _pid_video_single_program = videoPIDs[0];
+        _pid_table_dirty = true;
+    }
     for (uint i = 1; i < videoPIDs.size(); i++)
         AddWritingPID(videoPIDs[i]);
 
@@ -1001,6 +1008,10 @@ void MPEGStreamData::HandleTSTables(const TSPacket* tspacket)
 
 int MPEGStreamData::ProcessData(const unsigned char *buffer, int len)
 {
+    // Number of packets classified per pass over the buffer
+    static const int kClassifyBatch = 256;
+    int wanted[kClassifyBatch];
+
     int pos = 0;
     bool resync = false;
 
@@ -1017,23 +1028,56 @@ int MPEGStreamData::ProcessData(const unsigned char *buffer, int len)
                 return TSPacket::kSize;
             pos = newpos;
         }
-
-        const TSPacket *pkt = reinterpret_cast<const TSPacket*>(&buffer[pos]);
-        pos += TSPacket::kSize; // Advance to next TS packet
         resync = false;
-        if (!ProcessTSPacket(*pkt))
+
+        if (_pid_table_dirty)
+            UpdatePIDTable();
+        const uint generation = _pid_table_generation;
+
+        // First pass: walk the run of in-sync packets and keep only the
+        // ones on a PID somebody wants, or with the transport error bit
+        // set so ProcessTSPacket() can report them as before. Packets on
+        // other PIDs never get past this loop.
+        int end = pos;
+        int nwanted = 0;
+        for (int i = 0; i < kClassifyBatch; i++)
         {
-            if (pos + int(TSPacket::kSize) > len)
-                continue;
-            if (buffer[pos] != SYNC_BYTE)
+            if (end + int(TSPacket::kSize) > len || buffer[end] != SYNC_BYTE)
+                break;
+            const unsigned char *p = buffer + end;
+            uint pid = ((p[1] << 8) | p[2]) & 0x1fff;
+            if (_pid_table[pid] || (p[1] & 0x80))
+                wanted[nwanted++] = end;
+            end += TSPacket::kSize;
+        }
+
+        // Second pass: dispatch the wanted packets. Handling a table may
+        // change the PIDs we are listening to, in which case the rest of
+        // this run has to be classified again.
+        int next = end;
+        for (int i = 0; i < nwanted; i++)
+        {
+            const TSPacket *pkt =
+                reinterpret_cast<const TSPacket*>(&buffer[wanted[i]]);
+            int after = wanted[i] + TSPacket::kSize;
+            if (!ProcessTSPacket(*pkt) &&
+                after + int(TSPacket::kSize) <= len &&
+                buffer[after] != SYNC_BYTE)
             {
                 // if ProcessTSPacket fails, and we don't appear to be
                 // in sync on the next packet, then resync. Otherwise
                 // just process the next packet normally.
-                pos -= TSPacket::kSize;
+                next = wanted[i];
                 resync = true;
+                break;
+            }
+            if (_pid_table_dirty || generation != _pid_table_generation)
+            {
+                next = after;
+                break;
             }
         }
+        pos = next;
     }
 
     return len - pos;
@@ -1041,9 +1085,14 @@ int MPEGStreamData::ProcessData(const unsigned char *buffer, int len)
 
 bool MPEGStreamData::ProcessTSPacket(const TSPacket& tspacket)
 {
+    if (_pid_table_dirty)
+        UpdatePIDTable();
+
+    const uint pid = tspacket.PID();
+    const uint flags = _pid_table[pid];
     bool ok = !tspacket.TransportError();
 
-    if (IsEncryptionTestPID(tspacket.PID()))
+    if ((flags & kPIDTableEncryptionTest) && IsEncryptionTestPID(pid))
     {
         ProcessEncryptedPacket(tspacket);
     }
@@ -1054,7 +1103,7 @@ bool MPEGStreamData::ProcessTSPacket(const TSPacket& tspacket)
     if (tspacket.Scrambled())
         return true;
 
-    if (IsVideoPID(tspacket.PID()))
+    if (flags & kPIDTableVideo)
     {
         for (uint j = 0; j < _ts_av_listeners.size(); j++)
             _ts_av_listeners[j]->ProcessVideoTSPacket(tspacket);
@@ -1062,7 +1111,7 @@ bool MPEGStreamData::ProcessTSPacket(const TSPacket& tspacket)
         return true;
     }
 
-    if (IsAudioPID(tspacket.PID()))
+    if (flags & kPIDTableAudio)
     {
         for (uint j = 0; j < _ts_av_listeners.size(); j++)
             _ts_av_listeners[j]->ProcessAudioTSPacket(tspacket);
@@ -1070,13 +1119,13 @@ bool MPEGStreamData::ProcessTSPacket(const TSPacket& tspacket)
         return true;
     }
 
-    if (IsWritingPID(tspacket.PID()))
+    if (flags & kPIDTableWriting)
     {
         for (uint j = 0; j < _ts_writing_listeners.size(); j++)
             _ts_writing_listeners[j]->ProcessTSPacket(tspacket);
     }
 
-    if (IsListeningPID(tspacket.PID()) && tspacket.HasPayload())
+    if ((flags & kPIDTableListening) && tspacket.HasPayload())
     {
         HandleTSTables(&tspacket);
     }
@@ -1084,6 +1133,61 @@ bool MPEGStreamData::ProcessTSPacket(const TSPacket& tspacket)
     return true;
 }
 
+/** \fn MPEGStreamData::UpdatePIDTable(void)
+ *  \brief Rebuilds the flat PID classification table used by
+ *         ProcessData() and ProcessTSPacket() from the PID maps.
+ */
+void MPEGStreamData::UpdatePIDTable(void)
+{
+    // Clear the flag first so changes made while we rebuild are not lost
+    _pid_table_dirty = false;
+    memset(_pid_table, 0, sizeof(_pid_table));
+
+    pid_map_t::const_iterator it;
+    if (!_listening_disabled)
+    {
+        for (it = _pids_listening.begin(); it != _pids_listening.end(); ++it)
+        {
+            if (it.key() < 0x2000)
+                _pid_table[it.key()] |= kPIDTableListening;
+        }
+        for (it = _pids_notlistening.begin();
+             it != _pids_notlistening.end(); ++it)
+        {
+            if (it.key() < 0x2000)
+                _pid_table[it.key()] &= ~kPIDTableListening;
+        }
+    }
+
+    for (it = _pids_writing.begin(); it != _pids_writing.end(); ++it)
+    {
+        if (it.key() < 0x2000)
+            _pid_table[it.key()] |= kPIDTableWriting;
+    }
+
+    for (it = _pids_audio.begin(); it != _pids_audio.end(); ++it)
+    {
+        if (it.key() < 0x2000)
+            _pid_table[it.key()] |= kPIDTableAudio;
+    }
+
+    if (_pid_video_single_program < 0x2000)
+        _pid_table[_pid_video_single_program] |= kPIDTableVideo;
+
+    {
+        QMutexLocker locker(&_encryption_lock);
+        QMap<uint, CryptInfo>::const_iterator eit =
+            _encryption_pid_to_info.begin();
+        for (; eit != _encryption_pid_to_info.end(); ++eit)
+        {
+            if (eit.key() < 0x2000)
+                _pid_table[eit.key()] |= kPIDTableEncryptionTest;
+        }
+    }
+
+    _pid_table_generation++;
+}
+
 int MPEGStreamData::ResyncStream(const unsigned char *buffer, int curr_pos,
                                  int len)
 {
@@ -1826,6 +1930,7 @@ void MPEGStreamData::AddEncryptionTestPID(uint pnum, uint pid, bool isvideo)
     _encryption_pid_to_pnums[pid].push_back(pnum);
     _encryption_pnum_to_pids[pnum].push_back(pid);
     _encryption_pnum_to_status[pnum] = kEncUnknown;
+    _pid_table_dirty = true;
 }
 
 void MPEGStreamData::RemoveEncryptionTestPIDs(uint pnum)
@@ -1870,6 +1975,7 @@ void MPEGStreamData::RemoveEncryptionTestPIDs(uint pnum)
     }
 
     _encryption_pnum_to_pids.remove(pnum);
+    _pid_table_dirty = true;
 }
 
 bool MPEGStreamData::IsEncryptionTestPID(uint pid) const
@@ -1915,6 +2021,7 @@ void MPEGStreamData::ResetDecryptionMonitoringState(void)
     _encryption_pid_to_info.clear();
     _encryption_pid_to_pnums.clear();
     _encryption_pnum_to_pids.clear();
+    _pid_table_dirty = true;
 }
 
 bool MPEGStreamData::IsProgramDecrypted(uint pnum) const
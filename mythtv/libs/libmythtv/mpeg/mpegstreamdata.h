@@ -98,7 +98,8 @@ class MTV_PUBLIC MPEGStreamData : public EITSource
     virtual ~MPEGStreamData();
 
     void SetCaching(bool cacheTables) { _cache_tables = cacheTables; }
-    void SetListeningDisabled(bool lt) { _listening_disabled = lt; }
+    void SetListeningDisabled(bool lt)
+        { _listening_disabled = lt; _pid_table_dirty = true; }
 
     virtual void Reset(void) { Reset(-1); }
     virtual void Reset(int desiredProgram);
@@ -123,26 +124,32 @@ class MTV_PUBLIC MPEGStreamData : public EITSource
     virtual void HandleTSTables(const TSPacket* tspacket);
     virtual bool ProcessTSPacket(const TSPacket& tspacket);
     virtual int  ProcessData(const unsigned char *buffer, int len);
+    static int   ResyncStream(const unsigned char *buffer, int curr_pos,
+                              int len);
     inline  void HandleAdaptationFieldControl(const TSPacket* tspacket);
 
     // Listening
     virtual void AddListeningPID(
         uint pid, PIDPriority priority = kPIDPriorityNormal)
-        { _pids_listening[pid] = priority; }
+        { _pids_listening[pid] = priority; _pid_table_dirty = true; }
     virtual void AddNotListeningPID(uint pid)
-        { _pids_notlistening[pid] = kPIDPriorityNormal; }
+        { _pids_notlistening[pid] = kPIDPriorityNormal;
+          _pid_table_dirty = true; }
     virtual void AddWritingPID(
         uint pid, PIDPriority priority = kPIDPriorityHigh)
-        { _pids_writing[pid] = priority; }
+        { _pids_writing[pid] = priority; _pid_table_dirty = true; }
     virtual void AddAudioPID(
         uint pid, PIDPriority priority = kPIDPriorityHigh)
-        { _pids_audio[pid] = priority; }
+        { _pids_audio[pid] = priority; _pid_table_dirty = true; }
 
-    virtual void RemoveListeningPID(uint pid) { _pids_listening.remove(pid);  }
+    virtual void RemoveListeningPID(uint pid)
+        { _pids_listening.remove(pid); _pid_table_dirty = true; }
     virtual void RemoveNotListeningPID(uint pid)
-        { _pids_notlistening.remove(pid); }
-    virtual void RemoveWritingPID(uint pid) { _pids_writing.remove(pid);    }
-    virtual void RemoveAudioPID(uint pid)   { _pids_audio.remove(pid);      }
+        { _pids_notlistening.remove(pid); _pid_table_dirty = true; }
+    virtual void RemoveWritingPID(uint pid)
+        { _pids_writing.remove(pid); _pid_table_dirty = true; }
+    virtual void RemoveAudioPID(uint pid)
+        { _pids_audio.remove(pid); _pid_table_dirty = true; }
 
     virtual bool IsListeningPID(uint pid) const;
     virtual bool IsNotListeningPID(uint pid) const;
@@ -150,6 +157,13 @@ class MTV_PUBLIC MPEGStreamData : public EITSource
     bool IsVideoPID(uint pid) const
         { return _pid_video_single_program == pid; }
     virtual bool IsAudioPID(uint pid) const;
+    /// True if ProcessTSPacket() does anything with packets on this PID
+    bool IsWantedPID(uint pid)
+    {
+        if (_pid_table_dirty)
+            UpdatePIDTable();
+        return _pid_table[pid & 0x1fff];
+    }
 
     const pid_map_t& ListeningPIDs(void) const
         { return _pids_listening; }
@@ -341,8 +355,6 @@ class MTV_PUBLIC MPEGStreamData : public EITSource
     void ProcessPMT(const ProgramMapTable *pmt);
     void ProcessEncryptedPacket(const TSPacket&);
 
-    static int ResyncStream(const unsigned char *buffer, int curr_pos, int len);
-
     void UpdateTimeOffset(uint64_t si_utc_time);
 
     // Caching
@@ -373,6 +385,22 @@ class MTV_PUBLIC MPEGStreamData : public EITSource
     pid_map_t                 _pids_audio;
     bool                      _listening_disabled;
 
+    // Flat per-PID classification of the listening maps above, rebuilt
+    // lazily from them so ProcessData() can reject unwanted packets
+    // with a single table lookup instead of several QMap searches.
+    enum
+    {
+        kPIDTableListening      = 0x01,
+        kPIDTableWriting        = 0x02,
+        kPIDTableAudio          = 0x04,
+        kPIDTableVideo          = 0x08,
+        kPIDTableEncryptionTest = 0x10,
+    };
+    void UpdatePIDTable(void);
+    unsigned char             _pid_table[0x2000];
+    bool                      _pid_table_dirty;
+    uint                      _pid_table_generation;
+
     // Encryption monitoring
     mutable QMutex            _encryption_lock;
     QMap<uint, CryptInfo>     _encryption_pid_to_info;
@@ -13,10 +13,15 @@ extern "C" {
 }
 
 #include <vector>
-#include <map>
 
 using namespace std;
 
+#include <QThreadStorage>
+#include <QAtomicPointer>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QList>
+
 // return true if complete or broken
 bool PESPacket::AddTSPacket(const TSPacket* packet, bool &broken)
 {
@@ -211,141 +216,283 @@ float SequenceHeader::aspect(bool mpeg1) const
 /////////////////////////////////////////////////////////////////////////
 // Memory allocator to avoid malloc global lock and waste less memory. //
 /////////////////////////////////////////////////////////////////////////
+//
+// Every thread that allocates gets its own PESBlockCache holding slabs of
+// 188 and 4096 byte blocks, so allocations and frees on the owning thread
+// never take a lock. A block freed on another thread is pushed onto the
+// owner's lock-free return stack, which the owner drains the next time
+// its free list runs dry. Each block is preceded by a small header that
+// records the owning cache, so no lookup is needed to free it.
+//
+// A cache holds one reference for its owning thread plus one for each
+// block it has handed out; it is deleted when the thread has exited and
+// the last block has come back.
+
+class PESBlockCache;
+
+struct PESBlockHeader
+{
+    PESBlockCache  *owner;      ///< NULL for blocks from malloc()
+    PESBlockHeader *next;       ///< link in the owner's return stack
+    uint            size_class;
+};
 
-static vector<unsigned char*> mem188;
-static vector<unsigned char*> free188;
-static map<unsigned char*, bool> alloc188;
+#define HEADER_SIZE ((sizeof(PESBlockHeader) + 15) & ~15)
+#define SIZE_CLASSES 2
 
-static vector<unsigned char*> mem4096;
-static vector<unsigned char*> free4096;
-static map<unsigned char*, bool> alloc4096;
+static const uint block_size[SIZE_CLASSES]      = { 188, 4096 };
+static const uint blocks_per_slab[SIZE_CLASSES] = { 512, 128  };
+/// Allocations between publishing a cache's hit and miss counts.
+static const uint kStatsInterval = 1024;
 
-#define BLOCKS188 512
-static unsigned char* get_188_block()
+static inline PESBlockHeader *block_header(unsigned char *ptr)
 {
-    if (free188.empty())
-    {
-        mem188.push_back((unsigned char*) malloc(188 * BLOCKS188));
-        free188.reserve(BLOCKS188);
-        unsigned char* block_start = mem188.back();
-        for (uint i = 0; i < BLOCKS188; ++i)
-            free188.push_back(i*188 + block_start);
-    }
-
-    unsigned char *ptr = free188.back();
-    free188.pop_back();
-    alloc188[ptr] = true;
-    return ptr;
+    return (PESBlockHeader*) (ptr - HEADER_SIZE);
 }
-#undef BLOCKS188
 
-static bool is_188_block(unsigned char* ptr)
+static inline unsigned char *block_data(PESBlockHeader *hdr)
 {
-    return alloc188.find(ptr) != alloc188.end();
+    return ((unsigned char*) hdr) + HEADER_SIZE;
 }
 
-static void return_188_block(unsigned char* ptr)
+static QMutex                 pes_cache_lock;
+static QList<PESBlockCache*>  pes_caches;
+static PESAllocStats          pes_retired_stats;
+
+class PESBlockCache
+{
+  public:
+    PESBlockCache() :
+        remote(NULL), refs(1), remote_frees(0), orphaned(0),
+        pending_hits(0), pending_misses(0), hits(0), misses(0)
+    {
+        QMutexLocker locker(&pes_cache_lock);
+        pes_caches.push_back(this);
+    }
+
+    unsigned char *Alloc(uint size_class);
+    void Free(PESBlockHeader *hdr);
+    void RemoteFree(PESBlockHeader *hdr);
+    void Release(void);
+    void GetStats(PESAllocStats &stats) const;
+
+  private:
+    ~PESBlockCache();
+    void Reclaim(void);
+    void AddSlab(uint size_class);
+    void PublishStats(void);
+
+    vector<unsigned char*>         slabs[SIZE_CLASSES];
+    vector<PESBlockHeader*>        free_list[SIZE_CLASSES];
+    QAtomicPointer<PESBlockHeader> remote;
+    QAtomicInt                     refs;
+    QAtomicInt                     remote_frees;
+    QAtomicInt                     orphaned;
+    // counted by the owning thread, see PublishStats()
+    uint                           pending_hits;
+    uint                           pending_misses;
+    uint64_t                       hits;   // protected by pes_cache_lock
+    uint64_t                       misses; // protected by pes_cache_lock
+};
+
+PESBlockCache::~PESBlockCache()
 {
-    alloc188.erase(ptr);
-    free188.push_back(ptr);
-    // free the allocator only if more than 1 block was used
-    if (alloc188.empty() && mem188.size() > 1)
+    QMutexLocker locker(&pes_cache_lock);
+    pes_caches.removeAll(this);
+    pes_retired_stats.hits         += hits;
+    pes_retired_stats.misses       += misses;
+    pes_retired_stats.remote_frees += (uint) (int) remote_frees;
+
+    for (uint c = 0; c < SIZE_CLASSES; ++c)
     {
         vector<unsigned char*>::iterator it;
-        for (it = mem188.begin(); it != mem188.end(); ++it)
+        for (it = slabs[c].begin(); it != slabs[c].end(); ++it)
             free(*it);
-        mem188.clear();
-        free188.clear();
-#if 0
-        LOG(VB_GENERAL, LOG_DEBUG, "freeing all 188 blocks");
-#endif
     }
 }
 
-#define BLOCKS4096 128
-static unsigned char* get_4096_block()
+void PESBlockCache::AddSlab(uint c)
 {
-    if (free4096.empty())
+    uint slot = block_size[c] + HEADER_SIZE;
+    slot = (slot + 15) & ~15;
+
+    unsigned char *slab = (unsigned char*) malloc(slot * blocks_per_slab[c]);
+    slabs[c].push_back(slab);
+    free_list[c].reserve(free_list[c].size() + blocks_per_slab[c]);
+    for (uint i = 0; i < blocks_per_slab[c]; ++i)
     {
-        mem4096.push_back((unsigned char*) malloc(4096 * BLOCKS4096));
-        free4096.reserve(BLOCKS4096);
-        unsigned char* block_start = mem4096.back();
-        for (uint i = 0; i < BLOCKS4096; ++i)
-            free4096.push_back(i*4096 + block_start);
+        PESBlockHeader *hdr = (PESBlockHeader*) (slab + i * slot);
+        hdr->owner      = this;
+        hdr->next       = NULL;
+        hdr->size_class = c;
+        free_list[c].push_back(hdr);
     }
+}
 
-    unsigned char *ptr = free4096.back();
-    free4096.pop_back();
-    alloc4096[ptr] = true;
-    return ptr;
+/// Moves the owning thread's counts to the ones GetStats() reads.
+void PESBlockCache::PublishStats(void)
+{
+    QMutexLocker locker(&pes_cache_lock);
+    hits          += pending_hits;
+    misses        += pending_misses;
+    pending_hits   = 0;
+    pending_misses = 0;
 }
-#undef BLOCKS4096
 
-static bool is_4096_block(unsigned char* ptr)
+/// Moves blocks returned by other threads back onto the free lists.
+void PESBlockCache::Reclaim(void)
 {
-    return alloc4096.find(ptr) != alloc4096.end();
+    PESBlockHeader *hdr = remote.fetchAndStoreAcquire(NULL);
+    while (hdr)
+    {
+        PESBlockHeader *next = hdr->next;
+        free_list[hdr->size_class].push_back(hdr);
+        hdr = next;
+    }
 }
 
-static void return_4096_block(unsigned char* ptr)
+unsigned char *PESBlockCache::Alloc(uint c)
 {
-    alloc4096.erase(ptr);
-    free4096.push_back(ptr);
-
-#if 0 // enable this to debug memory leaks
-        LOG(VB_GENERAL, LOG_DEBUG, QString("%1 4096 blocks remain")
-            .arg(alloc4096.size()));
-        map<unsigned char*, bool>::iterator it;
-        for (it = alloc4096.begin(); it != alloc4096.end(); ++it)
-        {
-            TSPacket *ts = (TSPacket*) it->first;
-            LGO(VB_GENERAL, LOG_DEBUG, QString("PES Packet: pid(0x%1)")
-                .arg(ts->PID(),0,16));
-            if (ts->PID() == 0x1ffb)
-            {
-                LOG(VB_GENERAL, LOG_DEBUG, QString(" tid(0x%1) ext(0x%2)")
-                    .arg(PSIPTable::View(*ts).TableID(),0,16)
-                    .arg(PSIPTable::View(*ts).TableIDExtension(),0,16));
-            }
-        }
-#endif
+    if (free_list[c].empty())
+        Reclaim();
 
-    // free the allocator only if more than 1 block was used
-    if (alloc4096.empty() && mem4096.size() > 1)
+    if (free_list[c].empty())
+    {
+        AddSlab(c);
+        pending_misses++;
+    }
+    else
+    {
+        pending_hits++;
+    }
+
+    // publish on every miss, they are rare and malloc() anyway
+    if (pending_misses || pending_hits >= kStatsInterval)
+        PublishStats();
+
+    PESBlockHeader *hdr = free_list[c].back();
+    free_list[c].pop_back();
+    refs.ref();
+    return block_data(hdr);
+}
+
+void PESBlockCache::Free(PESBlockHeader *hdr)
+{
+    uint c = hdr->size_class;
+    free_list[c].push_back(hdr);
+    refs.deref(); // never the last reference, the owner holds one
+
+    // free the slabs only if more than 1 was used and all are unused
+    if (slabs[c].size() > 1 &&
+        free_list[c].size() == slabs[c].size() * blocks_per_slab[c])
     {
         vector<unsigned char*>::iterator it;
-        for (it = mem4096.begin(); it != mem4096.end(); ++it)
+        for (it = slabs[c].begin(); it != slabs[c].end(); ++it)
             free(*it);
-        mem4096.clear();
-        free4096.clear();
-#if 0
-        LOG(VB_GENERAL, LOG_DEBUG, "freeing all 4096 blocks");
-#endif
+        slabs[c].clear();
+        free_list[c].clear();
     }
 }
 
-static QMutex pes_alloc_mutex;
+void PESBlockCache::RemoteFree(PESBlockHeader *hdr)
+{
+    PESBlockHeader *head;
+    do
+    {
+        head = remote;
+        hdr->next = head;
+    } while (!remote.testAndSetRelease(head, hdr));
+
+    remote_frees.ref();
+
+    if (!refs.deref())
+        delete this;
+}
+
+/// Drops the owning thread's reference, called when that thread exits.
+void PESBlockCache::Release(void)
+{
+    PublishStats();
+    orphaned.fetchAndStoreRelease(1);
+    if (!refs.deref())
+        delete this;
+}
+
+/// Adds this cache's counters to stats, pes_cache_lock must be held.
+/// The hits of a live cache lag by up to kStatsInterval allocations.
+void PESBlockCache::GetStats(PESAllocStats &stats) const
+{
+    stats.hits         += hits;
+    stats.misses       += misses;
+    stats.remote_frees += (uint) (int) remote_frees;
+    stats.outstanding  += (int) refs - ((int) orphaned ? 0 : 1);
+}
+
+class PESBlockCacheOwner
+{
+  public:
+    PESBlockCacheOwner() : cache(new PESBlockCache()) {}
+    ~PESBlockCacheOwner() { cache->Release(); }
+    PESBlockCache *cache;
+};
+
+static QThreadStorage<PESBlockCacheOwner*> pes_thread_cache;
+
+static inline PESBlockCache *local_cache(void)
+{
+    if (!pes_thread_cache.hasLocalData())
+        pes_thread_cache.setLocalData(new PESBlockCacheOwner());
+    return pes_thread_cache.localData()->cache;
+}
 
 unsigned char *pes_alloc(uint size)
 {
-    QMutexLocker locker(&pes_alloc_mutex);
 #ifndef USING_VALGRIND
-    if (size <= 188)
-        return get_188_block();
-    else if (size <= 4096)
-        return get_4096_block();
-#endif // USING_VALGRIND
+    if (size <= block_size[0])
+        return local_cache()->Alloc(0);
+    else if (size <= block_size[1])
+        return local_cache()->Alloc(1);
+
+    PESBlockHeader *hdr = (PESBlockHeader*) malloc(HEADER_SIZE + size);
+    hdr->owner      = NULL;
+    hdr->next       = NULL;
+    hdr->size_class = SIZE_CLASSES;
+    return block_data(hdr);
+#else // if USING_VALGRIND
     return (unsigned char*) malloc(size);
+#endif // USING_VALGRIND
 }
 
 void pes_free(unsigned char *ptr)
 {
-    QMutexLocker locker(&pes_alloc_mutex);
 #ifndef USING_VALGRIND
-    if (is_188_block(ptr))
-        return_188_block(ptr);
-    else if (is_4096_block(ptr))
-        return_4096_block(ptr);
+    if (!ptr)
+        return;
+
+    PESBlockHeader *hdr = block_header(ptr);
+    if (!hdr->owner)
+        free(hdr);
+    else if (pes_thread_cache.hasLocalData() &&
+             pes_thread_cache.localData()->cache == hdr->owner)
+        hdr->owner->Free(hdr);
     else
+        hdr->owner->RemoteFree(hdr);
+#else // if USING_VALGRIND
+    free(ptr);
 #endif // USING_VALGRIND
-        free(ptr);
+}
+
+PESAllocStats pes_alloc_stats(void)
+{
+    QMutexLocker locker(&pes_cache_lock);
+
+    PESAllocStats stats = pes_retired_stats;
+    QList<PESBlockCache*>::const_iterator it = pes_caches.begin();
+    for (; it != pes_caches.end(); ++it)
+    {
+        (*it)->GetStats(stats);
+        stats.caches++;
+    }
+
+    return stats;
 }
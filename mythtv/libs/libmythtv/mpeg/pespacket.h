@@ -8,6 +8,8 @@
   max length of private_section = 4096 bytes
 */
 
+#include <stdint.h>
+
 #include <vector>
 using namespace std;
 
@@ -17,6 +19,22 @@ using namespace std;
 unsigned char *pes_alloc(uint size);
 void pes_free(unsigned char *ptr);
 
+/// Counters for the per-thread PES block caches used by pes_alloc().
+class PESAllocStats
+{
+  public:
+    PESAllocStats() :
+        hits(0), misses(0), remote_frees(0), outstanding(0), caches(0) {}
+
+    uint64_t hits;         ///< allocations served from a free list
+    uint64_t misses;       ///< allocations that needed a new slab
+    uint64_t remote_frees; ///< blocks freed by a thread other than the owner
+    int64_t  outstanding;  ///< pooled blocks currently in use
+    uint     caches;       ///< live per-thread caches
+};
+
+MTV_PUBLIC PESAllocStats pes_alloc_stats(void);
+
 /** \class PESPacket
  *  \brief Allows us to transform TS packets to PES packets, which
  *         are used to hold PSIP tables as well as multimedia streams.
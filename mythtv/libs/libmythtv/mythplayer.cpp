@@ -4543,6 +4543,16 @@ void MythPlayer::GetPlaybackData(InfoMap &infoMap)
         QString::number(player_ctx->buffer->GetBufferSize() >> 20));
     infoMap.insert("avsync",
             QString::number((float)avsync_avg / (float)frame_interval, 'f', 2));
+    uint audiofill = 0, audiototal = 0;
+    if (audio.GetBufferStatus(audiofill, audiototal) && audiototal)
+    {
+        infoMap.insert("audiobuffer",
+            QString("%1%").arg(audiofill * 100 / audiototal));
+        infoMap.insert("audiolatency",
+            QString::number(audio.GetAudioBufferedTime()));
+        infoMap.insert("audiounderruns",
+            QString::number(audio.GetUnderruns()));
+    }
     if (videoOutput)
     {
         QString frames = QString("%1/%2").arg(videoOutput->ValidVideoFrames())
@@ -0,0 +1,505 @@
+// C++ headers
+#include <algorithm>
+using namespace std;
+
+// POSIX headers
+#include <sys/types.h> // for utime
+#include <utime.h>     // for utime
+
+// Qt headers
+#include <QCryptographicHash>
+#include <QTemporaryFile>
+#include <QMutexLocker>
+#include <QFileInfo>
+#include <QImage>
+#include <QFile>
+#include <QDir>
+
+// MythTV headers
+#include "previewgenerator.h"
+#include "previewcache.h"
+#include "myth_imgconvert.h"
+#include "mythcorecontext.h"
+#include "programinfo.h"
+#include "positionmap.h"
+#include "mythlogging.h"
+#include "mythmiscutil.h"
+#include "mythdirs.h"
+
+extern "C" {
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+}
+
+#define LOC QString("PreviewCache: ")
+
+/// Bytes of the recording at the keyframe which name a cache entry
+static const int kKeyDataSize = 64 * 1024;
+/// Video packets read after the seek before giving up on the keyframe
+static const int kMaxPackets  = 512;
+
+static bool in_break(const frm_dir_map_t &marks, uint64_t frame,
+                     MarkTypes start)
+{
+    frm_dir_map_t::const_iterator it = marks.upperBound(frame);
+    if (it == marks.begin())
+        return false;
+    --it;
+    return *it == start;
+}
+
+/// Copies src to dst through a temporary file, so readers of dst
+/// never see a partial image.
+static bool copy_file(const QString &src, const QString &dst)
+{
+    QFile in(src);
+    if (!in.open(QIODevice::ReadOnly))
+        return false;
+    QByteArray data = in.readAll();
+    in.close();
+
+    QTemporaryFile f(QFileInfo(dst).absoluteFilePath()+".XXXXXX");
+    f.setAutoRemove(false);
+    if (f.open() && (f.write(data) == data.size()))
+    {
+        f.close();
+        makeFileAccessible(f.fileName().toLocal8Bit().constData());
+        QFile of(dst);
+        of.remove();
+        if (f.rename(dst))
+            return true;
+    }
+    f.remove();
+
+    return false;
+}
+
+/**
+ *  \param pginfo   Recording the previews are made from.
+ *  \param filename Local file containing the recording.
+ */
+PreviewCache::PreviewCache(const ProgramInfo &pginfo,
+                           const QString &filename) :
+    m_pginfo(pginfo), m_filename(filename),
+    m_keyframe(-1), m_offset(-1)
+{
+}
+
+QString PreviewCache::GetCacheDir(void)
+{
+    return GetConfDir() + "/previewcache";
+}
+
+/**
+ *  \brief Finds the keyframe a preview at seektime is made from, and the
+ *         cache entry for it.
+ *
+ *   Unless absolute is set, commercial breaks and cuts are skipped the
+ *   way MythPlayer::GetScreenGrab() skips them.
+ *
+ *  \return false if the recording has no seek table, in which case
+ *          the preview has to be made by a player.
+ */
+bool PreviewCache::Seek(long long seektime, bool time_in_secs, bool absolute)
+{
+    m_keyframe = m_offset = -1;
+    m_key.clear();
+
+    if (!m_pginfo.IsRecording() || m_filename.left(1) != "/")
+        return false;
+
+    PackedPositionMap posMap;
+    m_pginfo.QueryPositionMap(posMap, MARK_GOP_BYFRAME);
+    if (posMap.empty())
+    {
+        LOG(VB_PLAYBACK, LOG_INFO, LOC +
+            QString("No seek table for '%1'").arg(m_filename));
+        return false;
+    }
+
+    uint64_t lastframe = posMap.LastFrame();
+    double fps = m_pginfo.QueryAverageFrameRate() * 0.001;
+    if (fps < 1.0)
+        fps = 29.97;
+
+    uint64_t frame = max(seektime, 0LL);
+    if (time_in_secs)
+    {
+        // Prefer the recorded durations, which are right across
+        // frame rate changes, to the average frame rate.
+        frm_pos_map_t durMap;
+        m_pginfo.QueryPositionMap(durMap, MARK_DURATION_MS);
+        uint64_t msec = frame * 1000;
+        frm_pos_map_t::const_iterator it = durMap.begin();
+        uint64_t durframe = 0, durmsec = 0;
+        for (; it != durMap.end() && *it <= msec; ++it)
+        {
+            durframe = it.key();
+            durmsec  = *it;
+        }
+        frame = durframe + (uint64_t) ((msec - durmsec) * fps * 0.001);
+    }
+
+    if (frame > lastframe)
+    {
+        LOG(VB_PLAYBACK, LOG_ERR, LOC +
+            "Preview requested for frame number beyond end of file.");
+        frame = lastframe / 2;
+    }
+
+    if (!absolute)
+    {
+        frm_dir_map_t breaks, cuts;
+        m_pginfo.QueryCommBreakList(breaks);
+        m_pginfo.QueryCutList(cuts);
+
+        uint64_t oldframe = frame;
+        bool started_in_break = false;
+        while (in_break(breaks, frame, MARK_COMM_START) ||
+               in_break(cuts, frame, MARK_CUT_START))
+        {
+            started_in_break = true;
+            frame += (uint64_t) (30 * fps);
+            if (frame >= lastframe)
+            {
+                frame = oldframe;
+                break;
+            }
+        }
+
+        // Advance a few seconds from the end of the break
+        if (started_in_break && (frame + (uint64_t) (10 * fps) < lastframe))
+            frame += (uint64_t) (10 * fps);
+    }
+
+    int idx = max(posMap.Find(frame), 0);
+    m_keyframe = posMap.FrameAt(idx);
+    m_offset   = posMap.OffsetAt(idx);
+
+    QFile file(m_filename);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(m_offset))
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("Could not read '%1' at %2")
+                .arg(m_filename).arg(m_offset));
+        return false;
+    }
+
+    QByteArray data = file.read(kKeyDataSize);
+    if (data.size() < kKeyDataSize / 16)
+    {
+        LOG(VB_PLAYBACK, LOG_ERR, LOC +
+            QString("Keyframe %1 is at the end of '%2'")
+                .arg(m_keyframe).arg(m_filename));
+        return false;
+    }
+
+    m_key = QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+
+    LOG(VB_PLAYBACK, LOG_DEBUG, LOC +
+        QString("Frame %1 -> keyframe %2 at %3, entry %4")
+            .arg(frame).arg(m_keyframe).arg(m_offset).arg(m_key));
+
+    return true;
+}
+
+/**
+ *  \brief Saves a preview of the keyframe found by Seek() to outname.
+ *
+ *   Sizes are handled like PreviewGenerator::SavePreview() does, with
+ *   negative sizes meaning the size of the video.
+ *
+ *  \param decode If false, only previews which can be made from the
+ *                cache are saved, and no video is decoded.
+ */
+bool PreviewCache::GetPreview(const QString &outname, const QSize &size,
+                              bool decode)
+{
+    if (m_key.isEmpty())
+        return false;
+
+    QString dir = GetCacheDir() + "/" + m_key;
+    QString sizefile = dir + "/" + SizeName(size) + ".png";
+
+    if (QFileInfo(sizefile).isReadable())
+    {
+        // Mark the entry as used, for Prune()
+        utime(dir.toLocal8Bit().constData(), NULL);
+        bool ok = copy_file(sizefile, outname);
+        if (ok)
+        {
+            LOG(VB_PLAYBACK, LOG_INFO, LOC +
+                QString("Saved cached preview '%1' of keyframe %2")
+                    .arg(outname).arg(m_keyframe));
+        }
+        return ok;
+    }
+
+    QImage image;
+    float aspect = 0.0f;
+    if (!LoadFrame(dir, image, aspect))
+    {
+        if (!decode)
+            return false;
+
+        if (!DecodeFrame(image, aspect))
+            return false;
+
+        if (SaveFrame(dir, image, aspect))
+            Prune();
+    }
+
+    int dw = (size.width()  < 0) ? image.width()  : size.width();
+    int dh = (size.height() < 0) ? image.height() : size.height();
+
+    const unsigned char *data = image.bits();
+    if (QDir().mkpath(dir) &&
+        PreviewGenerator::SavePreview(sizefile, data,
+                                      image.width(), image.height(),
+                                      aspect, dw, dh))
+    {
+        return copy_file(sizefile, outname);
+    }
+
+    // The cache is not writable, save the preview directly
+    return PreviewGenerator::SavePreview(outname, data,
+                                         image.width(), image.height(),
+                                         aspect, dw, dh);
+}
+
+/**
+ *  \brief Removes the least recently used cache entries until the cache
+ *         is no bigger than the "PreviewCacheSize" setting, in MB.
+ */
+void PreviewCache::Prune(void)
+{
+    qint64 maxsize = gCoreContext->GetNumSetting("PreviewCacheSize", 512);
+    maxsize *= 1024 * 1024;
+
+    QDir cachedir(GetCacheDir());
+    QFileInfoList entries = cachedir.entryInfoList(
+        QDir::Dirs | QDir::NoDotAndDotDot, QDir::Time);
+
+    qint64 total = 0;
+    uint removed = 0;
+    QFileInfoList::const_iterator it = entries.begin();
+    for (; it != entries.end(); ++it)
+    {
+        QDir entry((*it).absoluteFilePath());
+        QFileInfoList files = entry.entryInfoList(QDir::Files);
+        QFileInfoList::const_iterator fit = files.begin();
+        for (; fit != files.end(); ++fit)
+            total += (*fit).size();
+
+        if (total <= maxsize)
+            continue;
+
+        for (fit = files.begin(); fit != files.end(); ++fit)
+            entry.remove((*fit).fileName());
+        cachedir.rmdir((*it).fileName());
+        removed++;
+    }
+
+    if (removed)
+    {
+        LOG(VB_FILE, LOG_INFO, LOC +
+            QString("Removed %1 of %2 entries").arg(removed)
+                .arg(entries.size()));
+    }
+}
+
+bool PreviewCache::LoadFrame(const QString &dir,
+                             QImage &image, float &aspect) const
+{
+    QString framefile = dir + "/frame.png";
+    if (!QFileInfo(framefile).isReadable() || !image.load(framefile, "PNG"))
+        return false;
+
+    aspect = image.text("Aspect").toFloat();
+    image = image.convertToFormat(QImage::Format_RGB32);
+
+    return !image.isNull();
+}
+
+bool PreviewCache::SaveFrame(const QString &dir,
+                             const QImage &image, float aspect) const
+{
+    if (!QDir().mkpath(dir))
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("Could not create '%1'").arg(dir));
+        return false;
+    }
+
+    QImage copy = image;
+    copy.setText("Aspect", QString::number(aspect));
+
+    QString framefile = dir + "/frame.png";
+    QTemporaryFile f(framefile + ".XXXXXX");
+    f.setAutoRemove(false);
+    if (f.open() && copy.save(&f, "PNG"))
+    {
+        f.close();
+        QFile of(framefile);
+        of.remove();
+        if (f.rename(framefile))
+            return true;
+    }
+    f.remove();
+
+    return false;
+}
+
+/**
+ *  \brief Decodes the keyframe at the offset found by Seek() into an
+ *         RGB32 image.
+ */
+bool PreviewCache::DecodeFrame(QImage &image, float &aspect) const
+{
+    {
+        QMutexLocker locker(avcodeclock);
+        av_register_all();
+    }
+
+    QByteArray fname = m_filename.toLocal8Bit();
+    AVFormatContext *ic = NULL;
+    if (avformat_open_input(&ic, fname.constData(), NULL, NULL) < 0)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("Could not open '%1'").arg(m_filename));
+        return false;
+    }
+
+    AVCodec *codec = NULL;
+    int stream = -1;
+    int found;
+    {
+        // avformat_find_stream_info() opens and closes decoders
+        QMutexLocker locker(avcodeclock);
+        found = avformat_find_stream_info(ic, NULL);
+    }
+    if (found >= 0)
+        stream = av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (stream < 0 || !codec)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("No video stream in '%1'").arg(m_filename));
+        avformat_close_input(&ic);
+        return false;
+    }
+
+    AVStream *st = ic->streams[stream];
+    AVCodecContext *ctx = st->codec;
+    ctx->thread_count = 1;
+
+    int ret;
+    {
+        QMutexLocker locker(avcodeclock);
+        ret = avcodec_open2(ctx, codec, NULL);
+    }
+    if (ret < 0)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC +
+            QString("Could not open the %1 decoder").arg(codec->name));
+        avformat_close_input(&ic);
+        return false;
+    }
+
+    bool ok = false;
+    AVFrame *frame = avcodec_alloc_frame();
+    if (frame && av_seek_frame(ic, stream, m_offset, AVSEEK_FLAG_BYTE) >= 0)
+    {
+        avcodec_flush_buffers(ctx);
+
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        int packets = 0;
+        bool gotkeyframe = false;
+        while (!gotkeyframe && (packets < kMaxPackets) &&
+               (av_read_frame(ic, &pkt) >= 0))
+        {
+            if (pkt.stream_index == stream)
+            {
+                int gotpicture = 0;
+                packets++;
+                if (avcodec_decode_video2(ctx, frame, &gotpicture, &pkt) >= 0)
+                {
+                    gotkeyframe = gotpicture && (frame->key_frame ||
+                        frame->pict_type == AV_PICTURE_TYPE_I);
+                }
+            }
+            av_free_packet(&pkt);
+        }
+
+        int width  = ctx->width;
+        int height = ctx->height;
+        if (gotkeyframe && (width > 0) && (height > 0))
+        {
+            AVPicture orig;
+            for (uint i = 0; i < 4; i++)
+            {
+                orig.data[i]     = frame->data[i];
+                orig.linesize[i] = frame->linesize[i];
+            }
+
+            if (ctx->pix_fmt == PIX_FMT_YUV420P)
+            {
+                avpicture_deinterlace(&orig, &orig, PIX_FMT_YUV420P,
+                                      width, height);
+            }
+
+            image = QImage(width, height, QImage::Format_RGB32);
+
+            AVPicture retbuf;
+            avpicture_fill(&retbuf, image.bits(), PIX_FMT_RGB32,
+                           width, height);
+            ok = myth_sws_img_convert(&retbuf, PIX_FMT_RGB32,
+                                      &orig, ctx->pix_fmt,
+                                      width, height) >= 0;
+
+            AVRational sar = av_guess_sample_aspect_ratio(ic, st, frame);
+            aspect = (float) width / height;
+            if (sar.num && sar.den)
+                aspect *= av_q2d(sar);
+        }
+        else
+        {
+            LOG(VB_GENERAL, LOG_ERR, LOC +
+                QString("No keyframe in %1 packets at %2 of '%3'")
+                    .arg(packets).arg(m_offset).arg(m_filename));
+        }
+    }
+
+    av_free(frame);
+    {
+        QMutexLocker locker(avcodeclock);
+        avcodec_close(ctx);
+    }
+    avformat_close_input(&ic);
+
+    if (ok)
+    {
+        LOG(VB_GENERAL, LOG_INFO, LOC +
+            QString("Decoded keyframe %1 of '%2' %3x%4")
+                .arg(m_keyframe).arg(m_filename)
+                .arg(image.width()).arg(image.height()));
+    }
+
+    return ok;
+}
+
+/// Cache file name of a preview size. SavePreview() uses the preview
+/// size settings when no size is given, so those are in the name too.
+QString PreviewCache::SizeName(const QSize &size)
+{
+    QString name = QString("%1x%2").arg(size.width()).arg(size.height());
+    if (!size.width() && !size.height())
+    {
+        name += QString("-%1x%2")
+            .arg(gCoreContext->GetNumSetting("PreviewPixmapWidth",  320))
+            .arg(gCoreContext->GetNumSetting("PreviewPixmapHeight", 240));
+    }
+    return name;
+}
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -0,0 +1,51 @@
+// -*- Mode: c++ -*-
+#ifndef PREVIEW_CACHE_H_
+#define PREVIEW_CACHE_H_
+
+#include <QString>
+#include <QSize>
+
+#include "mythtvexp.h"
+
+class ProgramInfo;
+class QImage;
+
+/** \class PreviewCache
+ *  \brief Makes previews from a single keyframe, and keeps the decoded
+ *         keyframe and every size made from it in an on-disk cache.
+ *
+ *   The keyframe is found with the recording's seek table, so no player
+ *   is needed. Cache entries are named by a hash of the recording data at
+ *   the keyframe, so previews for any time in the same GOP, and for any
+ *   size, are made without decoding the video again.
+ */
+class MTV_PUBLIC PreviewCache
+{
+  public:
+    PreviewCache(const ProgramInfo &pginfo, const QString &filename);
+
+    bool Seek(long long seektime, bool time_in_secs, bool absolute);
+    bool GetPreview(const QString &outname, const QSize &size, bool decode);
+
+    long long GetKeyframe(void) const { return m_keyframe; }
+    QString   GetKey(void) const      { return m_key; }
+
+    static QString GetCacheDir(void);
+    static void Prune(void);
+
+  private:
+    bool LoadFrame(const QString &dir, QImage &image, float &aspect) const;
+    bool DecodeFrame(QImage &image, float &aspect) const;
+    bool SaveFrame(const QString &dir,
+                   const QImage &image, float aspect) const;
+    static QString SizeName(const QSize &size);
+
+  private:
+    const ProgramInfo &m_pginfo;
+    QString            m_filename;
+    long long          m_keyframe;
+    long long          m_offset;
+    QString            m_key;
+};
+
+#endif // PREVIEW_CACHE_H_
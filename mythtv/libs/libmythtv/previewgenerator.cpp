@@ -22,6 +22,7 @@
 #include "ringbuffer.h"
 #include "mythplayer.h"
 #include "previewgenerator.h"
+#include "previewcache.h"
 #include "tv_rec.h"
 #include "mythsocket.h"
 #include "remotefile.h"
@@ -200,7 +201,16 @@ bool PreviewGenerator::Run(void)
     bool local_ok = ((IsLocal() || !!(mode & kForceLocal)) &&
                      (!!(mode & kLocal)) &&
                      QFileInfo(command).isExecutable());
-    if (!local_ok)
+    if (local_ok && CachedPreviewRun())
+    {
+        ok = true;
+        msg = QString("Generated from cache on %1 in %2 seconds, "
+                      "starting at %3")
+            .arg(gCoreContext->GetHostName())
+            .arg(tm.elapsed()*0.001)
+            .arg(tm.toString(Qt::ISODate));
+    }
+    else if (!local_ok)
     {
         if (!!(mode & kRemote))
         {
@@ -598,15 +608,15 @@ bool PreviewGenerator::SavePreview(QString filename,
     return false;
 }
 
-bool PreviewGenerator::LocalPreviewRun(void)
+/**
+ *  \brief Returns the time of the preview, in seconds or frames as set
+ *         in in_seconds, from the time asked for, the bookmark or the
+ *         scheduled times of the program.
+ */
+long long PreviewGenerator::GetPreviewTime(bool &in_seconds) const
 {
-    programInfo.MarkAsInUse(true, kPreviewGeneratorInUseID);
-
-    float aspect = 0;
-    int   width, height, sz;
     long long captime = captureTime;
-
-    QDateTime dt = MythDate::current();
+    in_seconds = timeInSeconds;
 
     if (captime > 0)
         LOG(VB_GENERAL, LOG_INFO, "Preview from time spec");
@@ -616,7 +626,7 @@ bool PreviewGenerator::LocalPreviewRun(void)
         captime = programInfo.QueryBookmark();
         if (captime > 0)
         {
-            timeInSeconds = false;
+            in_seconds = false;
             LOG(VB_GENERAL, LOG_INFO,
                 QString("Preview from bookmark (frame %1)").arg(captime));
         }
@@ -626,7 +636,7 @@ bool PreviewGenerator::LocalPreviewRun(void)
 
     if (captime <= 0)
     {
-        timeInSeconds = true;
+        in_seconds = true;
         int startEarly = 0;
         int programDuration = 0;
         int preroll =  gCoreContext->GetNumSetting("RecordPreRoll", 0);
@@ -657,18 +667,76 @@ bool PreviewGenerator::LocalPreviewRun(void)
             QString("Preview at calculated offset (%1 seconds)").arg(captime));
     }
 
-    width = height = sz = 0;
-    unsigned char *data = (unsigned char*)
-        GetScreenGrab(programInfo, pathname,
-                      captime, timeInSeconds,
-                      sz, width, height, aspect);
+    return captime;
+}
+
+/**
+ *  \brief Saves a preview from the preview cache, without starting
+ *         a player or decoding any video.
+ */
+bool PreviewGenerator::CachedPreviewRun(void)
+{
+    if (!gCoreContext->GetNumSetting("PreviewUseKeyframeCache", 1))
+        return false;
 
+    bool in_seconds;
+    long long captime = GetPreviewTime(in_seconds);
+    QDateTime dt = MythDate::current();
+
+    PreviewCache cache(programInfo, pathname);
     QString outname = CreateAccessibleFilename(pathname, outFileName);
+    if (!cache.Seek(captime, in_seconds, !in_seconds) ||
+        !cache.GetPreview(outname, outSize, false))
+    {
+        return false;
+    }
 
-    int dw = (outSize.width()  < 0) ? width  : outSize.width();
-    int dh = (outSize.height() < 0) ? height : outSize.height();
+    // Backdate file to start of preview time in case a bookmark was made
+    // while we were generating the preview.
+    struct utimbuf times;
+    times.actime = times.modtime = dt.toTime_t();
+    utime(outname.toLocal8Bit().constData(), &times);
+
+    return true;
+}
+
+bool PreviewGenerator::LocalPreviewRun(void)
+{
+    programInfo.MarkAsInUse(true, kPreviewGeneratorInUseID);
+
+    float aspect = 0;
+    int   width, height, sz;
+    long long captime = GetPreviewTime(timeInSeconds);
+
+    QDateTime dt = MythDate::current();
 
-    bool ok = SavePreview(outname, data, width, height, aspect, dw, dh);
+    QString outname = CreateAccessibleFilename(pathname, outFileName);
+
+    // Seek with the keyframe map and decode just the keyframe when we
+    // can, and fall back to a player for recordings without one.
+    bool ok = false;
+    if (gCoreContext->GetNumSetting("PreviewUseKeyframeCache", 1))
+    {
+        PreviewCache cache(programInfo, pathname);
+        ok = cache.Seek(captime, timeInSeconds, !timeInSeconds) &&
+            cache.GetPreview(outname, outSize, true);
+    }
+
+    if (!ok)
+    {
+        width = height = sz = 0;
+        unsigned char *data = (unsigned char*)
+            GetScreenGrab(programInfo, pathname,
+                          captime, timeInSeconds,
+                          sz, width, height, aspect);
+
+        int dw = (outSize.width()  < 0) ? width  : outSize.width();
+        int dh = (outSize.height() < 0) ? height : outSize.height();
+
+        ok = SavePreview(outname, data, width, height, aspect, dw, dh);
+
+        delete[] data;
+    }
 
     if (ok)
     {
@@ -679,8 +747,6 @@ bool PreviewGenerator::LocalPreviewRun(void)
         utime(outname.toLocal8Bit().constData(), &times);
     }
 
-    delete[] data;
-
     programInfo.MarkAsInUse(false, kPreviewGeneratorInUseID);
 
     return ok;
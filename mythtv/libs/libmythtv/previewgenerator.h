@@ -32,6 +32,7 @@ class MTV_PUBLIC PreviewGenerator : public QObject, public MThread
                               const QSize   &previewSize,
                               const QString &infile,
                               const QString &outfile);
+    friend class PreviewCache;
 
     Q_OBJECT
 
@@ -76,6 +77,8 @@ class MTV_PUBLIC PreviewGenerator : public QObject, public MThread
 
     bool RemotePreviewRun(void);
     bool LocalPreviewRun(void);
+    bool CachedPreviewRun(void);
+    long long GetPreviewTime(bool &in_seconds) const;
     bool IsLocal(void) const;
 
     bool RunReal(void);
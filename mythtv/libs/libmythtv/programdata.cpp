@@ -10,6 +10,7 @@ using namespace std;
 #include "channelutil.h"
 #include "mythdb.h"
 #include "mythlogging.h"
+#include "mythtimer.h"
 #include "programinfo.h"
 #include "programdata.h"
 #include "dvbdescriptors.h"
@@ -208,15 +209,20 @@ bool DBEvent::HasTimeConflict(const DBEvent &o) const
 }
 
 uint DBEvent::UpdateDB(
-    MSqlQuery &query, uint chanid, int match_threshold) const
+    MSqlQuery &query, uint chanid, int match_threshold,
+    DBEventBatch *batch) const
 {
+    // the overlap check below must see any rows still queued in the batch
+    if (batch && batch->IsPending(chanid, starttime, endtime))
+        batch->Flush();
+
     vector<DBEvent> programs;
     uint count = GetOverlappingPrograms(query, chanid, programs);
     int  match = INT_MIN;
     int  i     = -1;
 
     if (!count)
-        return InsertDB(query, chanid);
+        return batch ? AddToBatch(*batch, chanid) : InsertDB(query, chanid);
 
     // move overlapping programs out of the way and update existing if possible
     match = GetMatch(programs, i);
@@ -226,7 +232,7 @@ uint DBEvent::UpdateDB(
         LOG(VB_EIT, LOG_DEBUG,
             QString("EIT: accept match[%1]: %2 '%3' vs. '%4'")
                 .arg(i).arg(match).arg(title).arg(programs[i].title));
-        return UpdateDB(query, chanid, programs, i);
+        return UpdateDB(query, chanid, programs, i, batch);
     }
     else
     {
@@ -236,7 +242,7 @@ uint DBEvent::UpdateDB(
                 QString("EIT: reject match[%1]: %2 '%3' vs. '%4'")
                     .arg(i).arg(match).arg(title).arg(programs[i].title));
         }
-        return UpdateDB(query, chanid, programs, -1);
+        return UpdateDB(query, chanid, programs, -1, batch);
     }
 }
 
@@ -444,7 +450,8 @@ int DBEvent::GetMatch(const vector<DBEvent> &programs, int &bestmatch) const
 }
 
 uint DBEvent::UpdateDB(
-    MSqlQuery &q, uint chanid, const vector<DBEvent> &p, int match) const
+    MSqlQuery &q, uint chanid, const vector<DBEvent> &p, int match,
+    DBEventBatch *batch) const
 {
     // adjust/delete overlaps;
     bool ok = true;
@@ -460,14 +467,15 @@ uint DBEvent::UpdateDB(
 
     // if no match, insert current item
     if ((match < 0) || ((uint)match >= p.size()))
-        return InsertDB(q, chanid);
+        return batch ? AddToBatch(*batch, chanid) : InsertDB(q, chanid);
 
     // update matched item with current data
-    return UpdateDB(q, chanid, p[match]);
+    return UpdateDB(q, chanid, p[match], batch);
 }
 
 uint DBEvent::UpdateDB(
-    MSqlQuery &query, uint chanid, const DBEvent &match) const
+    MSqlQuery &query, uint chanid, const DBEvent &match,
+    DBEventBatch *batch) const
 {
     QString  ltitle     = title;
     QString  lsubtitle  = subtitle;
@@ -577,7 +585,11 @@ uint DBEvent::UpdateDB(
         return 0;
     }
 
-    if (credits)
+    if (credits && batch)
+    {
+        batch->AddCredits(chanid, starttime, endtime, *credits);
+    }
+    else if (credits)
     {
         for (uint i = 0; i < credits->size(); i++)
             (*credits)[i].InsertDB(query, chanid, starttime);
@@ -750,6 +762,55 @@ uint DBEvent::InsertDB(MSqlQuery &query, uint chanid) const
     return 1;
 }
 
+/// Returns the values of a program table row in the column order used
+/// by DBEventBatch.
+QVariantList DBEvent::GetProgramRow(
+    uint chanid, const QVariant &_stars, const QString &showtype,
+    const QString &title_pronounce, const QString &colorcode) const
+{
+    QVariantList row;
+    row << chanid
+        << denullify(title)
+        << denullify(subtitle)
+        << denullify(description)
+        << denullify(category)
+        << myth_category_type_to_string(categoryType)
+        << starttime
+        << endtime
+        << (subtitleType & SUB_HARDHEAR ? true : false)
+        << (audioProps   & AUD_STEREO   ? true : false)
+        << (videoProps   & VID_HDTV     ? true : false)
+        << (subtitleType & SUB_NORMAL   ? true : false)
+        << subtitleType
+        << audioProps
+        << videoProps
+        << _stars
+        << partnumber
+        << parttotal
+        << denullify(syndicatedepisodenumber)
+        << (airdate ? QString::number(airdate) : "0000")
+        << originalairdate
+        << listingsource
+        << denullify(seriesId)
+        << denullify(programId)
+        << previouslyshown
+        << denullify(showtype)
+        << denullify(title_pronounce)
+        << denullify(colorcode);
+    return row;
+}
+
+uint DBEvent::AddToBatch(DBEventBatch &batch, uint chanid) const
+{
+    batch.AddProgram(chanid, starttime, endtime,
+                     GetProgramRow(chanid, stars, "", "", ""));
+
+    if (credits)
+        batch.AddCredits(chanid, starttime, endtime, *credits);
+
+    return 1;
+}
+
 ProgInfo::ProgInfo(const ProgInfo &other) :
     DBEvent(other.listingsource)
 {
@@ -900,6 +961,336 @@ uint ProgInfo::InsertDB(MSqlQuery &query, uint chanid) const
     return 1;
 }
 
+uint ProgInfo::AddToBatch(DBEventBatch &batch, uint chanid) const
+{
+    LOG(VB_XMLTV, LOG_INFO,
+        QString("Queueing new program     : %1 - %2 %3 %4")
+            .arg(starttime.toString(Qt::ISODate))
+            .arg(endtime.toString(Qt::ISODate))
+            .arg(channel)
+            .arg(title));
+
+    batch.AddProgram(chanid, starttime, endtime,
+                     GetProgramRow(chanid, stars, showtype,
+                                   title_pronounce, colorcode));
+
+    QList<EventRating>::const_iterator j = ratings.begin();
+    for (; j != ratings.end(); ++j)
+        batch.AddRating(chanid, starttime, *j);
+
+    if (credits)
+        batch.AddCredits(chanid, starttime, endtime, *credits);
+
+    return 1;
+}
+
+const uint DBEventBatch::kRowsPerStatement = 100;
+
+DBEventBatch::DBEventBatch(uint _max_programs) :
+    query(MSqlQuery::InitCon()),
+    max_programs(max(_max_programs, 1U))
+{
+}
+
+DBEventBatch::~DBEventBatch()
+{
+    Flush();
+}
+
+void DBEventBatch::AddPending(
+    uint chanid, const QDateTime &starttime, const QDateTime &endtime)
+{
+    PendingSpan span;
+    span.chanid    = chanid;
+    span.starttime = starttime;
+    span.endtime   = endtime;
+    pending.push_back(span);
+}
+
+void DBEventBatch::AddProgram(
+    uint chanid, const QDateTime &starttime, const QDateTime &endtime,
+    const QVariantList &row)
+{
+    programs.push_back(row);
+    AddPending(chanid, starttime, endtime);
+
+    if ((uint)programs.size() >= max_programs)
+        Flush();
+}
+
+void DBEventBatch::AddRating(
+    uint chanid, const QDateTime &starttime, const EventRating &rating)
+{
+    QVariantList row;
+    row << chanid << starttime << rating.system << rating.rating;
+    ratings.push_back(row);
+}
+
+void DBEventBatch::AddCredits(
+    uint chanid, const QDateTime &starttime, const QDateTime &endtime,
+    const DBCredits &_credits)
+{
+    for (uint i = 0; i < _credits.size(); ++i)
+    {
+        PendingCredit credit;
+        credit.chanid    = chanid;
+        credit.starttime = starttime;
+        credit.name      = _credits[i].GetName();
+        credit.role      = _credits[i].GetRole();
+        credits.push_back(credit);
+    }
+    AddPending(chanid, starttime, endtime);
+}
+
+/** \brief Returns true if any queued row on chanid overlaps the given
+ *         time span, in which case the batch must be flushed before the
+ *         program table is queried or modified for that span.
+ */
+bool DBEventBatch::IsPending(
+    uint chanid, const QDateTime &starttime, const QDateTime &endtime) const
+{
+    QList<PendingSpan>::const_iterator it = pending.begin();
+    for (; it != pending.end(); ++it)
+    {
+        if ((*it).chanid != chanid)
+            continue;
+        if ((*it).starttime == starttime ||
+            ((*it).starttime < endtime && starttime < (*it).endtime))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DBEventBatch::AddPhaseTime(const QString &phase, uint rows, int msecs)
+{
+    if (!phases.contains(phase))
+        phase_order.push_back(phase);
+
+    PhaseStats &stats = phases[phase];
+    stats.rows  += rows;
+    stats.msecs += msecs;
+}
+
+bool DBEventBatch::ExecRows(
+    const QString &phase, const QString &statement, const QString &columns,
+    const QList<QVariantList> &rows)
+{
+    bool ok = true;
+    MythTimer timer;
+    timer.start();
+
+    for (int first = 0; first < rows.size(); first += kRowsPerStatement)
+    {
+        int last = min(rows.size(), first + (int)kRowsPerStatement);
+
+        QString sql = statement + " (" + columns + ") VALUES ";
+        MSqlBindings bindings;
+        for (int i = first; i < last; ++i)
+        {
+            QStringList holders;
+            for (int j = 0; j < rows[i].size(); ++j)
+            {
+                QString holder = QString(":R%1C%2").arg(i - first).arg(j);
+                holders.push_back(holder);
+                bindings[holder] = rows[i][j];
+            }
+            sql += QString((i == first) ? "(" : ", (") +
+                holders.join(",") + ")";
+        }
+
+        query.prepare(sql, false);
+        query.bindValues(bindings);
+
+        if (!query.exec())
+        {
+            MythDB::DBError(QString("DBEventBatch %1").arg(phase), query);
+            ok = false;
+        }
+    }
+
+    AddPhaseTime(phase, rows.size(), timer.elapsed());
+
+    return ok;
+}
+
+/// Folds name the way the people.name collation compares names, which
+/// ignores case and trailing spaces.
+static QString person_key(const QString &name)
+{
+    int len = name.size();
+    while (len > 0 && name[len - 1] == QChar(' '))
+        len--;
+    return name.left(len).toLower();
+}
+
+/// Makes sure every queued credit name exists in the people table and
+/// returns the person ids for them, keyed by the queued names.
+bool DBEventBatch::FlushPeople(QMap<QString,uint> &personids)
+{
+    QMap<QString,bool> names;
+    QList<PendingCredit>::const_iterator it = credits.begin();
+    for (; it != credits.end(); ++it)
+        names[(*it).name] = true;
+
+    QList<QVariantList> rows;
+    QMap<QString,bool>::const_iterator nit = names.begin();
+    for (; nit != names.end(); ++nit)
+        rows.push_back(QVariantList() << nit.key());
+
+    bool ok = ExecRows("people insert", "INSERT IGNORE INTO people",
+                       "name", rows);
+
+    MythTimer timer;
+    timer.start();
+
+    // INSERT IGNORE skips names the collation finds equal to an existing
+    // one, so the names returned need not match the queued ones exactly.
+    QMap<QString,uint> keyids;
+    for (int first = 0; first < rows.size(); first += kRowsPerStatement)
+    {
+        int last = min(rows.size(), first + (int)kRowsPerStatement);
+
+        QStringList holders;
+        MSqlBindings bindings;
+        for (int i = first; i < last; ++i)
+        {
+            QString holder = QString(":NAME%1").arg(i - first);
+            holders.push_back(holder);
+            bindings[holder] = rows[i][0];
+        }
+
+        query.prepare(
+            "SELECT person, name "
+            "FROM people "
+            "WHERE name IN (" + holders.join(",") + ")", false);
+        query.bindValues(bindings);
+
+        if (!query.exec())
+        {
+            MythDB::DBError("DBEventBatch people select", query);
+            ok = false;
+            continue;
+        }
+
+        while (query.next())
+            keyids[person_key(query.value(1).toString())] =
+                query.value(0).toUInt();
+    }
+
+    for (nit = names.begin(); nit != names.end(); ++nit)
+    {
+        uint personid = keyids.value(person_key(nit.key()), 0);
+        if (!personid)
+        {
+            // Let the database compare names folded differently here,
+            // such as ones with accents.
+            query.prepare(
+                "SELECT person "
+                "FROM people "
+                "WHERE name = :NAME");
+            query.bindValue(":NAME", nit.key());
+
+            if (!query.exec())
+            {
+                MythDB::DBError("DBEventBatch people select", query);
+                ok = false;
+            }
+            else if (query.next())
+            {
+                personid = query.value(0).toUInt();
+            }
+        }
+
+        if (personid)
+            personids[nit.key()] = personid;
+    }
+
+    AddPhaseTime("people select", rows.size(), timer.elapsed());
+
+    return ok;
+}
+
+/** \brief Writes all queued rows to the database.
+ *
+ *  The tables are locked for the duration of the flush so the MyISAM
+ *  key buffers are only written out once per batch.
+ */
+bool DBEventBatch::Flush(void)
+{
+    if (programs.empty() && ratings.empty() && credits.empty())
+    {
+        pending.clear();
+        return true;
+    }
+
+    bool locked = query.exec(
+        "LOCK TABLES program WRITE, programrating WRITE, "
+        "            people WRITE,  credits WRITE");
+    if (!locked)
+        MythDB::DBError("DBEventBatch lock", query);
+
+    bool ok = ExecRows(
+        "program", "REPLACE INTO program",
+        "chanid, title, subtitle, description, category, category_type, "
+        "starttime, endtime, closecaptioned, stereo, hdtv, subtitled, "
+        "subtitletypes, audioprop, videoprop, stars, partnumber, parttotal, "
+        "syndicatedepisodenumber, airdate, originalairdate, listingsource, "
+        "seriesid, programid, previouslyshown, "
+        "showtype, title_pronounce, colorcode",
+        programs);
+
+    ok &= ExecRows("programrating", "INSERT IGNORE INTO programrating",
+                   "chanid, starttime, system, rating", ratings);
+
+    if (!credits.empty())
+    {
+        QMap<QString,uint> personids;
+        ok &= FlushPeople(personids);
+
+        QList<QVariantList> rows;
+        QList<PendingCredit>::const_iterator it = credits.begin();
+        for (; it != credits.end(); ++it)
+        {
+            uint personid = personids.value((*it).name, 0);
+            if (!personid)
+                continue;
+            rows.push_back(QVariantList() << personid << (*it).chanid
+                           << (*it).starttime << (*it).role);
+        }
+
+        ok &= ExecRows("credits", "REPLACE INTO credits",
+                       "person, chanid, starttime, role", rows);
+    }
+
+    if (locked && !query.exec("UNLOCK TABLES"))
+        MythDB::DBError("DBEventBatch unlock", query);
+
+    programs.clear();
+    ratings.clear();
+    credits.clear();
+    pending.clear();
+
+    return ok;
+}
+
+QString DBEventBatch::GetStatistics(void) const
+{
+    QString msg;
+    QStringList::const_iterator it = phase_order.begin();
+    for (; it != phase_order.end(); ++it)
+    {
+        const PhaseStats &stats = phases[*it];
+        double rate = (stats.msecs > 0) ?
+            stats.rows * 1000.0 / stats.msecs : 0.0;
+        msg += QString("\n    %1: %2 rows in %3 ms (%4 rows/s)")
+            .arg(*it, -14).arg(stats.rows).arg(stats.msecs)
+            .arg(rate, 0, 'f', 0);
+    }
+    return msg;
+}
+
 bool ProgramData::ClearDataByChannel(
     uint chanid, const QDateTime &from, const QDateTime &to,
     bool use_channel_time_offset)
@@ -1052,82 +1443,138 @@ void ProgramData::FixProgramList(QList<ProgInfo*> &fixlist)
 }
 
 void ProgramData::HandlePrograms(
-    uint sourceid, QMap<QString, QList<ProgInfo> > &proglist)
+    uint sourceid, QMap<QString, QList<ProgInfo> > &proglist,
+    bool bulk_insert)
 {
     uint unchanged = 0, updated = 0;
+    DBEventBatch *batch = bulk_insert ? new DBEventBatch() : NULL;
 
-    MSqlQuery query(MSqlQuery::InitCon());
+    MythTimer timer;
+    timer.start();
 
-    QMap<QString, QList<ProgInfo> >::const_iterator mapiter;
+    QMap<QString, QList<ProgInfo> >::iterator mapiter;
     for (mapiter = proglist.begin(); mapiter != proglist.end(); ++mapiter)
     {
-        if (mapiter.key().isEmpty())
-            continue;
+        HandleChannelPrograms(sourceid, mapiter.key(), *mapiter,
+                              unchanged, updated, batch);
+    }
 
-        query.prepare(
-            "SELECT chanid "
-            "FROM channel "
-            "WHERE sourceid = :ID AND "
-            "      xmltvid  = :XMLTVID");
-        query.bindValue(":ID",      sourceid);
-        query.bindValue(":XMLTVID", mapiter.key());
+    int msecs = timer.elapsed();
 
-        if (!query.exec())
-        {
-            MythDB::DBError("ProgramData::HandlePrograms", query);
-            continue;
-        }
+    LOG(VB_GENERAL, LOG_INFO,
+        QString("Updated programs: %1 Unchanged programs: %2")
+                .arg(updated) .arg(unchanged));
+    LOG(VB_GENERAL, LOG_INFO,
+        QString("Program update took %1 ms (%2 programs/s)%3")
+            .arg(msecs)
+            .arg((msecs > 0) ? (updated + unchanged) * 1000.0 / msecs : 0.0,
+                 0, 'f', 0)
+            .arg(batch ? batch->GetStatistics() : QString()));
 
-        vector<uint> chanids;
-        while (query.next())
-            chanids.push_back(query.value(0).toUInt());
+    delete batch;
+}
 
-        if (chanids.empty())
-        {
-            LOG(VB_GENERAL, LOG_NOTICE,
-                QString("Unknown xmltv channel identifier: %1"
-                        " - Skipping channel.").arg(mapiter.key()));
-            continue;
-        }
+/** \brief Inserts the programs of a single XMLTV channel into the database.
+ *
+ *  This allows callers that parse listings incrementally to hand over
+ *  each channel's programs as soon as they are complete, rather than
+ *  building a map of the entire listings first.
+ */
+void ProgramData::HandleChannelPrograms(
+    uint sourceid, const QString &xmltvid, QList<ProgInfo> &list,
+    uint &unchanged, uint &updated, DBEventBatch *batch)
+{
+    if (xmltvid.isEmpty())
+        return;
 
-        QList<ProgInfo> &list = proglist[mapiter.key()];
-        QList<ProgInfo*> sortlist;
-        QList<ProgInfo>::iterator it = list.begin();
-        for (; it != list.end(); ++it)
-            sortlist.push_back(&(*it));
+    MSqlQuery query(MSqlQuery::InitCon());
 
-        FixProgramList(sortlist);
+    query.prepare(
+        "SELECT chanid "
+        "FROM channel "
+        "WHERE sourceid = :ID AND "
+        "      xmltvid  = :XMLTVID");
+    query.bindValue(":ID",      sourceid);
+    query.bindValue(":XMLTVID", xmltvid);
 
-        for (uint i = 0; i < chanids.size(); ++i)
-        {
-            HandlePrograms(query, chanids[i], sortlist, unchanged, updated);
-        }
+    if (!query.exec())
+    {
+        MythDB::DBError("ProgramData::HandleChannelPrograms", query);
+        return;
     }
 
-    LOG(VB_GENERAL, LOG_INFO,
-        QString("Updated programs: %1 Unchanged programs: %2")
-                .arg(updated) .arg(unchanged));
+    vector<uint> chanids;
+    while (query.next())
+        chanids.push_back(query.value(0).toUInt());
+
+    if (chanids.empty())
+    {
+        LOG(VB_GENERAL, LOG_NOTICE,
+            QString("Unknown xmltv channel identifier: %1"
+                    " - Skipping channel.").arg(xmltvid));
+        return;
+    }
+
+    QList<ProgInfo*> sortlist;
+    QList<ProgInfo>::iterator it = list.begin();
+    for (; it != list.end(); ++it)
+        sortlist.push_back(&(*it));
+
+    FixProgramList(sortlist);
+
+    for (uint i = 0; i < chanids.size(); ++i)
+    {
+        HandlePrograms(query, chanids[i], sortlist, unchanged, updated,
+                       batch);
+    }
+
+    // one batch write per channel
+    if (batch)
+        batch->Flush();
 }
 
 void ProgramData::HandlePrograms(MSqlQuery             &query,
                                  uint                   chanid,
                                  const QList<ProgInfo*> &sortlist,
                                  uint &unchanged,
-                                 uint &updated)
+                                 uint &updated,
+                                 DBEventBatch *batch)
 {
+    MythTimer timer;
+
     QList<ProgInfo*>::const_iterator it = sortlist.begin();
     for (; it != sortlist.end(); ++it)
     {
-        if (IsUnchanged(query, chanid, **it))
+        if (batch)
+        {
+            if (batch->IsPending(chanid, (*it)->starttime, (*it)->endtime))
+                batch->Flush();
+            timer.start();
+        }
+
+        bool is_unchanged = IsUnchanged(query, chanid, **it);
+
+        if (batch)
+            batch->AddPhaseTime("unchanged check", 1, timer.restart());
+
+        if (is_unchanged)
         {
             unchanged++;
             continue;
         }
 
-        if (!DeleteOverlaps(query, chanid, **it))
+        bool ok = DeleteOverlaps(query, chanid, **it);
+
+        if (batch)
+            batch->AddPhaseTime("overlap delete", 1, timer.restart());
+
+        if (!ok)
             continue;
 
-        updated += (*it)->InsertDB(query, chanid);
+        if (batch)
+            updated += (*it)->AddToBatch(*batch, chanid);
+        else
+            updated += (*it)->InsertDB(query, chanid);
     }
 }
 
@@ -13,12 +13,14 @@ using namespace std;
 #include <QDateTime>
 #include <QList>
 #include <QMap>
+#include <QVariant>
 
 // MythTV headers
 #include "mythtvexp.h"
+#include "mythdbcon.h"
 #include "listingsources.h"
 
-class MSqlQuery;
+class DBEventBatch;
 
 class MTV_PUBLIC DBPerson
 {
@@ -44,6 +46,7 @@ class MTV_PUBLIC DBPerson
     DBPerson(const QString &_role, const QString &_name);
 
     QString GetRole(void) const;
+    QString GetName(void) const { return name; }
 
     uint InsertDB(MSqlQuery &query, uint chanid,
                   const QDateTime &starttime) const;
@@ -125,7 +128,8 @@ class MTV_PUBLIC DBEvent
     void AddPerson(DBPerson::Role, const QString &name);
     void AddPerson(const QString &role, const QString &name);
 
-    uint UpdateDB(MSqlQuery &query, uint chanid, int match_threshold) const;
+    uint UpdateDB(MSqlQuery &query, uint chanid, int match_threshold,
+                  DBEventBatch *batch = NULL) const;
 
     bool HasCredits(void) const { return credits; }
     bool HasTimeConflict(const DBEvent &other) const;
@@ -138,12 +142,19 @@ class MTV_PUBLIC DBEvent
     int  GetMatch(
         const vector<DBEvent> &programs, int &bestmatch) const;
     uint UpdateDB(
-        MSqlQuery&, uint chanid, const vector<DBEvent> &p, int match) const;
+        MSqlQuery&, uint chanid, const vector<DBEvent> &p, int match,
+        DBEventBatch *batch) const;
     uint UpdateDB(
-        MSqlQuery&, uint chanid, const DBEvent &match) const;
+        MSqlQuery&, uint chanid, const DBEvent &match,
+        DBEventBatch *batch) const;
     bool MoveOutOfTheWayDB(
         MSqlQuery&, uint chanid, const DBEvent &nonmatch) const;
     virtual uint InsertDB(MSqlQuery&, uint chanid) const;
+    virtual uint AddToBatch(DBEventBatch &batch, uint chanid) const;
+    QVariantList GetProgramRow(uint chanid, const QVariant &stars,
+                               const QString &showtype,
+                               const QString &title_pronounce,
+                               const QString &colorcode) const;
     virtual void Squeeze(void);
 
   public:
@@ -206,9 +217,10 @@ class MTV_PUBLIC DBEventEIT : public DBEvent
     {
     }
 
-    uint UpdateDB(MSqlQuery &query, int match_threshold) const
+    uint UpdateDB(MSqlQuery &query, int match_threshold,
+                  DBEventBatch *batch = NULL) const
     {
-        return DBEvent::UpdateDB(query, chanid, match_threshold);
+        return DBEvent::UpdateDB(query, chanid, match_threshold, batch);
     }
 
   public:
@@ -235,6 +247,7 @@ class MTV_PUBLIC ProgInfo : public DBEvent
     ProgInfo(const ProgInfo &other);
 
     uint InsertDB(MSqlQuery &query, uint chanid) const;
+    uint AddToBatch(DBEventBatch &batch, uint chanid) const;
 
     void Squeeze(void);
 
@@ -253,11 +266,86 @@ class MTV_PUBLIC ProgInfo : public DBEvent
     QString       clumpmax;
 };
 
+/** \brief Collects program, rating and credit rows and writes them to the
+ *         database with multi-row statements.
+ *
+ *  Rows are written when Flush() is called or when the number of queued
+ *  programs reaches the batch size. Callers that read back the program
+ *  table must call IsPending() first and flush if it returns true, so the
+ *  batched writes are never observable out of order.
+ */
+class MTV_PUBLIC DBEventBatch
+{
+  public:
+    DBEventBatch(uint max_programs = 500);
+    ~DBEventBatch();
+
+    void AddProgram(uint chanid, const QDateTime &starttime,
+                    const QDateTime &endtime, const QVariantList &row);
+    void AddRating(uint chanid, const QDateTime &starttime,
+                   const EventRating &rating);
+    void AddCredits(uint chanid, const QDateTime &starttime,
+                    const QDateTime &endtime, const DBCredits &credits);
+
+    bool IsPending(uint chanid, const QDateTime &starttime,
+                   const QDateTime &endtime) const;
+    bool Flush(void);
+
+    void AddPhaseTime(const QString &phase, uint rows, int msecs);
+    QString GetStatistics(void) const;
+
+  private:
+    void AddPending(uint chanid, const QDateTime &starttime,
+                    const QDateTime &endtime);
+    bool ExecRows(const QString &phase, const QString &statement,
+                  const QString &columns, const QList<QVariantList> &rows);
+    bool FlushPeople(QMap<QString,uint> &personids);
+
+  private:
+    struct PendingSpan
+    {
+        uint      chanid;
+        QDateTime starttime;
+        QDateTime endtime;
+    };
+
+    struct PendingCredit
+    {
+        uint      chanid;
+        QDateTime starttime;
+        QString   name;
+        QString   role;
+    };
+
+    struct PhaseStats
+    {
+        PhaseStats() : rows(0), msecs(0) {}
+        uint rows;
+        int  msecs;
+    };
+
+    MSqlQuery             query;
+    uint                  max_programs;
+    QList<QVariantList>   programs;
+    QList<QVariantList>   ratings;
+    QList<PendingCredit>  credits;
+    QList<PendingSpan>    pending;
+    QStringList           phase_order;
+    QMap<QString,PhaseStats> phases;
+
+    static const uint kRowsPerStatement;
+};
+
 class MTV_PUBLIC ProgramData
 {
   public:
     static void HandlePrograms(uint sourceid,
-                               QMap<QString, QList<ProgInfo> > &proglist);
+                               QMap<QString, QList<ProgInfo> > &proglist,
+                               bool bulk_insert = false);
+    static void HandleChannelPrograms(uint sourceid, const QString &xmltvid,
+                                      QList<ProgInfo> &proglist,
+                                      uint &unchanged, uint &updated,
+                                      DBEventBatch *batch = NULL);
 
     static int  fix_end_times(void);
     static bool ClearDataByChannel(
@@ -276,7 +364,8 @@ class MTV_PUBLIC ProgramData
     static void HandlePrograms(
         MSqlQuery &query, uint chanid,
         const QList<ProgInfo*> &sortlist,
-        uint &unchanged, uint &updated);
+        uint &unchanged, uint &updated,
+        DBEventBatch *batch);
     static bool IsUnchanged(
         MSqlQuery &query, uint chanid, const ProgInfo &pi);
     static bool DeleteOverlaps(
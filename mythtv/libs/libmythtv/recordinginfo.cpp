@@ -901,6 +901,14 @@ void RecordingInfo::StartedRecording(QString ext)
     if (!query.exec() || !query.isActive())
         MythDB::DBError("Clear seek info on record", query);
 
+    query.prepare("DELETE FROM recordedseekmap WHERE chanid = :CHANID"
+                  " AND starttime = :START;");
+    query.bindValue(":CHANID", chanid);
+    query.bindValue(":START", recstartts);
+
+    if (!query.exec() || !query.isActive())
+        MythDB::DBError("Clear seek map on record", query);
+
     query.prepare("DELETE FROM recordedmarkup WHERE chanid = :CHANID"
                   " AND starttime = :START;");
     query.bindValue(":CHANID", chanid);
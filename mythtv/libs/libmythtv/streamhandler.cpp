@@ -1,5 +1,8 @@
 // -*- Mode: c++ -*-
 
+// C++ headers
+#include <algorithm>
+
 // MythTV headers
 #include "streamhandler.h"
 
@@ -20,7 +23,10 @@ StreamHandler::StreamHandler(const QString &device) :
     _pid_lock(QMutex::Recursive),
     _open_pid_filters(0),
 
-    _listener_lock(QMutex::Recursive)
+    _listener_lock(QMutex::Recursive),
+    _demux_bytes_parsed(0),
+    _demux_bytes_delivered(0),
+    _demux_bytes_unshared(0)
 {
 }
 
@@ -78,6 +84,7 @@ void StreamHandler::AddListener(MPEGStreamData *data,
     else
     {
         _stream_data_list[data] = output_file;
+        _demux_listeners.push_back(data);
     }
 
     if (!output_file.isEmpty())
@@ -115,10 +122,13 @@ void StreamHandler::RemoveListener(MPEGStreamData *data)
         if (!(*it).isEmpty())
             RemoveNamedOutputFile(*it);
         _stream_data_list.erase(it);
+        _demux_listeners.erase(find(_demux_listeners.begin(),
+                                    _demux_listeners.end(), data));
     }
 
     if (_stream_data_list.empty())
     {
+        LogDemuxStats();
         _listener_lock.unlock();
         Stop();
     }
@@ -374,3 +384,95 @@ PIDPriority StreamHandler::GetPIDPriority(uint pid) const
 
     return tmp;
 }
+
+/** \brief Demultiplexes a buffer of TS packets for all the listeners.
+ *
+ *  The buffer is walked once, checking sync bytes and extracting the
+ *  PID of each packet a single time, and each listener is handed only
+ *  the packets on PIDs it wants, in place in the shared buffer. This
+ *  replaces having every listener run ProcessData() over the whole
+ *  buffer, which made recording several channels from one multiplex
+ *  pay the full parsing cost once per recording.
+ *
+ *  \note _listener_lock must be held by the caller.
+ *  \return number of bytes at the end of the buffer that were not
+ *          processed, as for MPEGStreamData::ProcessData()
+ */
+int StreamHandler::ProcessTSData(const unsigned char *buffer, int len)
+{
+    const uint nlisteners = _demux_listeners.size();
+    uint64_t delivered = 0;
+    int pos = 0;
+    bool resync = false;
+
+    while (pos + int(TSPacket::kSize) <= len)
+    { // while we have a whole packet left...
+        if (buffer[pos] != SYNC_BYTE || resync)
+        {
+            int newpos = MPEGStreamData::ResyncStream(buffer, pos+1, len);
+            if (newpos == -1)
+                break;
+            if (newpos == -2)
+            {
+                pos = len - TSPacket::kSize;
+                break;
+            }
+            pos = newpos;
+        }
+        resync = false;
+
+        const unsigned char *p = buffer + pos;
+        const TSPacket *pkt = reinterpret_cast<const TSPacket*>(p);
+        const uint pid = ((p[1] << 8) | p[2]) & 0x1fff;
+        const bool error = p[1] & 0x80;
+
+        bool ok = true;
+        for (uint i = 0; i < nlisteners; i++)
+        {
+            if (error || _demux_listeners[i]->IsWantedPID(pid))
+            {
+                ok &= _demux_listeners[i]->ProcessTSPacket(*pkt);
+                delivered += TSPacket::kSize;
+            }
+        }
+
+        pos += TSPacket::kSize; // Advance to next TS packet
+        if (!ok && (pos + int(TSPacket::kSize) <= len) &&
+            (buffer[pos] != SYNC_BYTE))
+        {
+            // if ProcessTSPacket fails, and we don't appear to be
+            // in sync on the next packet, then resync. Otherwise
+            // just process the next packet normally.
+            pos -= TSPacket::kSize;
+            resync = true;
+        }
+    }
+
+    _demux_bytes_parsed    += pos;
+    _demux_bytes_unshared  += (uint64_t) pos * nlisteners;
+    _demux_bytes_delivered += delivered;
+
+    return len - pos;
+}
+
+/** \brief Logs how much data the shared demux parsed and delivered
+ *         since the last call, and resets the counters.
+ *  \note _listener_lock must be held by the caller.
+ */
+void StreamHandler::LogDemuxStats(void)
+{
+    if (!_demux_bytes_unshared)
+        return;
+
+    LOG(VB_RECORD, LOG_INFO, LOC +
+        QString("Demux: parsed %1 KB once instead of %2 KB, "
+                "delivered %3 KB to listeners (%4%)")
+        .arg(_demux_bytes_parsed / 1024)
+        .arg(_demux_bytes_unshared / 1024)
+        .arg(_demux_bytes_delivered / 1024)
+        .arg(_demux_bytes_delivered * 100 / _demux_bytes_unshared));
+
+    _demux_bytes_parsed    = 0;
+    _demux_bytes_delivered = 0;
+    _demux_bytes_unshared  = 0;
+}
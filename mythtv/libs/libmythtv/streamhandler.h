@@ -15,6 +15,7 @@ using namespace std;
 #include "mpegstreamdata.h" // for PIDPriority
 #include "mthread.h"
 #include "mythdate.h"
+#include "mythtvexp.h"
 
 //#define DEBUG_PID_FILTERS
 
@@ -47,7 +48,7 @@ typedef QMap<uint,PIDInfo*> PIDInfoMap;
 // locking order
 // _pid_lock -> _listener_lock -> _start_stop_lock
 
-class StreamHandler : protected MThread, public DeviceReaderCB
+class MTV_PUBLIC StreamHandler : protected MThread, public DeviceReaderCB
 {
   public:
     virtual void AddListener(MPEGStreamData *data,
@@ -79,6 +80,9 @@ class StreamHandler : protected MThread, public DeviceReaderCB
 
     PIDPriority GetPIDPriority(uint pid) const;
 
+    int  ProcessTSData(const unsigned char *buffer, int len);
+    void LogDemuxStats(void);
+
     // DeviceReaderCB
     virtual void ReaderPaused(int fd) { (void) fd; }
     virtual void PriorityEvent(int fd) { (void) fd; }
@@ -118,6 +122,12 @@ class StreamHandler : protected MThread, public DeviceReaderCB
     typedef QMap<MPEGStreamData*,QString> StreamDataList;
     mutable QMutex    _listener_lock;
     StreamDataList    _stream_data_list;
+
+    // Shared demux, protected by _listener_lock
+    vector<MPEGStreamData*> _demux_listeners;
+    uint64_t          _demux_bytes_parsed;
+    uint64_t          _demux_bytes_delivered;
+    uint64_t          _demux_bytes_unshared;
 };
 
 #endif // _STREAM_HANDLER_H_
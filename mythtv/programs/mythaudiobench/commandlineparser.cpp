@@ -0,0 +1,33 @@
+#include "commandlineparser.h"
+#include "mythcorecontext.h"
+
+MythAudioBenchCommandLineParser::MythAudioBenchCommandLineParser() :
+    MythCommandLineParser(MYTH_APPNAME_MYTHAUDIOBENCH)
+{
+    LoadArguments();
+}
+
+void MythAudioBenchCommandLineParser::LoadArguments(void)
+{
+    addHelp();
+    addVersion();
+    addLogging("none", LOG_ERR);
+    add("--frames", "frames", 1536,
+            "Number of frames in each packet (default: 1536).", "");
+    add("--packets", "packets", 2000,
+            "Number of packets in each run (default: 2000).", "");
+    add("--iterations", "iterations", 5,
+            "Number of times each step is run (default: 5).",
+            "The fastest run of each step is reported.");
+    add("--checkonly", "checkonly", false,
+            "Only check that the SIMD loops give the same results.", "");
+}
+
+QString MythAudioBenchCommandLineParser::GetHelpHeader(void) const
+{
+    return
+        "MythAudioBench times the sample conversion, volume and upmix\n"
+        "loops of the audio output for 16, 24 and 32 bit integer and float\n"
+        "samples at 2, 6 and 8 channels, with and without the SIMD versions,\n"
+        "and checks that the SIMD versions give the same results as C.";
+}
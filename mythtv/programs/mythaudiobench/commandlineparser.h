@@ -0,0 +1,19 @@
+// -*- Mode: c++ -*-
+
+#ifndef _MYTH_AUDIOBENCH_COMMAND_LINE_PARSER_H_
+#define _MYTH_AUDIOBENCH_COMMAND_LINE_PARSER_H_
+
+#include "mythcommandlineparser.h"
+
+class MythAudioBenchCommandLineParser : public MythCommandLineParser
+{
+  public:
+    MythAudioBenchCommandLineParser();
+    void LoadArguments(void);
+  protected:
+    QString GetHelpHeader(void) const;
+};
+
+#endif // _MYTH_AUDIOBENCH_COMMAND_LINE_PARSER_H_
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
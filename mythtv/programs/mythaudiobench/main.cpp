@@ -0,0 +1,338 @@
+// -*- Mode: c++ -*-
+
+// C++ headers
+#include <climits>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+using namespace std;
+
+// Qt headers
+#include <QCoreApplication>
+#include <QByteArray>
+#include <QString>
+
+// FFmpeg headers
+extern "C" {
+#include "libavutil/mem.h"
+}
+
+// MythTV headers
+#include "audiooutpututil.h"
+#include "audiooutputsettings.h"
+#include "commandlineparser.h"
+#include "mythcorecontext.h"
+#include "mythlogging.h"
+#include "mythtimer.h"
+#include "exitcodes.h"
+
+static const AudioFormat kFormats[] =
+{
+    FORMAT_S16, FORMAT_S24, FORMAT_S32, FORMAT_FLT,
+};
+static const int kNumFormats = sizeof(kFormats) / sizeof(*kFormats);
+
+static const int kChannels[] = { 2, 6, 8 };
+static const int kNumChannels = sizeof(kChannels) / sizeof(*kChannels);
+
+static const char *FormatName(AudioFormat format)
+{
+    switch (format)
+    {
+        case FORMAT_S16: return "S16";
+        case FORMAT_S24: return "S24";
+        case FORMAT_S32: return "S32";
+        case FORMAT_FLT: return "FLT";
+        default:         return "?";
+    }
+}
+
+/// The buffers AudioOutputBase uses for a packet, 16 byte aligned like its
+/// own, with room for a stereo copy of every sample.
+class Packet
+{
+  public:
+    Packet(AudioFormat format, int samples) :
+        m_format(format), m_samples(samples),
+        m_bytes(samples * AudioOutputSettings::SampleSize(format))
+    {
+        m_in     = (uchar *)av_malloc(samples * sizeof(float) + 16);
+        m_floats = (float *)av_malloc(samples * sizeof(float) + 16);
+        m_out    = (uchar *)av_malloc(samples * sizeof(float) + 16);
+        m_stereo = (float *)av_malloc(2 * samples * sizeof(float) + 16);
+    }
+
+    ~Packet()
+    {
+        av_free(m_stereo);
+        av_free(m_out);
+        av_free(m_floats);
+        av_free(m_in);
+    }
+
+    AudioFormat m_format;
+    int         m_samples;
+    int         m_bytes;
+    uchar      *m_in;
+    float      *m_floats;
+    uchar      *m_out;
+    float      *m_stereo;
+};
+
+/// A slightly clipping sine sweep with some noise, in the packet's format.
+static void make_samples(Packet &packet)
+{
+    unsigned int seed = 12345;
+    int bits = AudioOutputSettings::FormatToBits(packet.m_format);
+
+    for (int ii = 0; ii < packet.m_samples; ii++)
+    {
+        seed = seed * 1103515245 + 12345;
+        double noise = (double)((seed >> 16) & 0x3ff) / 0x3ff - 0.5;
+        double val = 1.05 * sin(ii * (0.01 + ii * 1e-6)) + noise * 0.01;
+        double clipped = max(-1.0, min(val, 1.0));
+
+        switch (packet.m_format)
+        {
+            case FORMAT_S16:
+                ((short *)packet.m_in)[ii] = (short)(clipped * 32767);
+                break;
+            case FORMAT_S24:
+            case FORMAT_S32:
+                ((int *)packet.m_in)[ii] =
+                    (int)(clipped * ((1U << (bits - 1)) - 128)) <<
+                    (32 - bits);
+                break;
+            default:
+                ((float *)packet.m_in)[ii] = val;
+                break;
+        }
+        // out of range values, and some exactly between two integers
+        packet.m_floats[ii] = (ii % 97) ? val : (ii % 2 ? 0.5 : -0.5) / 32767;
+    }
+}
+
+enum BenchStep
+{
+    kStepToFloat,
+    kStepFromFloat,
+    kStepVolume,
+    kStepMonoToStereo,
+    kStepCount
+};
+
+static const char *kStepNames[kStepCount] =
+{
+    "to float", "from float", "volume", "mono to stereo",
+};
+
+static void run_step(BenchStep step, Packet &packet)
+{
+    switch (step)
+    {
+        case kStepToFloat:
+            AudioOutputUtil::toFloat(packet.m_format, packet.m_out,
+                                     packet.m_in, packet.m_bytes);
+            break;
+        case kStepFromFloat:
+            AudioOutputUtil::fromFloat(packet.m_format, packet.m_out,
+                                       packet.m_floats,
+                                       packet.m_samples * sizeof(float));
+            break;
+        case kStepVolume:
+            AudioOutputUtil::AdjustVolume(packet.m_floats,
+                                          packet.m_samples * sizeof(float),
+                                          99, false, false);
+            break;
+        default:
+            AudioOutputUtil::MonoToStereo(packet.m_stereo, packet.m_floats,
+                                          packet.m_samples);
+            break;
+    }
+}
+
+/// Runs every step once on fresh samples, and keeps what they produced.
+static QByteArray run_steps(AudioFormat format, int samples)
+{
+    Packet packet(format, samples);
+    QByteArray out;
+
+    make_samples(packet);
+    run_step(kStepToFloat, packet);
+    out.append((const char *)packet.m_out, samples * sizeof(float));
+
+    run_step(kStepFromFloat, packet);
+    out.append((const char *)packet.m_out, packet.m_bytes);
+
+    run_step(kStepMonoToStereo, packet);
+    out.append((const char *)packet.m_stereo, 2 * samples * sizeof(float));
+
+    for (int volume = 20; volume <= 100; volume += 40)
+    {
+        for (int flags = 0; flags < 4; flags++)
+        {
+            AudioOutputUtil::AdjustVolume(packet.m_floats,
+                                          samples * sizeof(float), volume,
+                                          flags & 1, flags & 2);
+        }
+    }
+    out.append((const char *)packet.m_floats, samples * sizeof(float));
+
+    return out;
+}
+
+/// Checks that the SIMD loops give the results of the C loops.
+static bool check_simd(AudioFormat format, int channels, int frames)
+{
+    bool ok = true;
+
+    // Odd sizes too, for the samples left over by the SIMD loops
+    int sizes[] = { frames * channels, frames * channels - 5, 7 };
+    for (uint ii = 0; ii < sizeof(sizes) / sizeof(*sizes); ii++)
+    {
+        AudioOutputUtil::EnableSIMD(false);
+        QByteArray expected = run_steps(format, sizes[ii]);
+        AudioOutputUtil::EnableSIMD(true);
+        if (run_steps(format, sizes[ii]) != expected)
+        {
+            cerr << qPrintable(QString("%1 %2ch: %3 differs from C "
+                                       "for %4 samples")
+                               .arg(FormatName(format)).arg(channels)
+                               .arg(AudioOutputUtil::SIMDName())
+                               .arg(sizes[ii])) << endl;
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+/// Best time in ms of running step on packets packets.
+static int time_step(BenchStep step, Packet &packet,
+                     uint packets, uint iterations)
+{
+    int best = INT_MAX;
+    for (uint ii = 0; ii < iterations; ii++)
+    {
+        // AdjustVolume() works in place, start each run from the same data
+        make_samples(packet);
+
+        MythTimer t;
+        t.start();
+        for (uint jj = 0; jj < packets; jj++)
+            run_step(step, packet);
+        best = min(best, t.elapsed());
+    }
+
+    return best;
+}
+
+static int RunBench(int frames, uint packets, uint iterations, bool checkonly)
+{
+    const char *simd = AudioOutputUtil::SIMDName();
+    if (!simd)
+    {
+        cout << "No SIMD loops for this CPU, timing the C loops only"
+             << endl;
+    }
+    else
+    {
+        bool ok = true;
+        for (int ii = 0; ii < kNumFormats; ii++)
+            for (int jj = 0; jj < kNumChannels; jj++)
+                ok &= check_simd(kFormats[ii], kChannels[jj], frames);
+        if (!ok)
+            return GENERIC_EXIT_NOT_OK;
+
+        cout << qPrintable(QString("%1 results match C").arg(simd)) << endl;
+
+        if (checkonly)
+            return GENERIC_EXIT_OK;
+    }
+
+    cout << qPrintable(QString("%1 frames per packet, %2 packets per run, "
+                               "best of %3 runs")
+                       .arg(frames).arg(packets).arg(iterations)) << endl;
+
+    for (int ii = 0; ii < kNumFormats; ii++)
+    {
+        for (int jj = 0; jj < kNumChannels; jj++)
+        {
+            Packet packet(kFormats[ii], frames * kChannels[jj]);
+            cout << FormatName(kFormats[ii]) << ' ' << kChannels[jj] << "ch"
+                 << endl;
+
+            for (int step = 0; step < kStepCount; step++)
+            {
+                // Mono to stereo doesn't depend on the format
+                if (step == kStepMonoToStereo && ii > 0)
+                    continue;
+
+                AudioOutputUtil::EnableSIMD(false);
+                int celapsed = time_step((BenchStep)step, packet,
+                                         packets, iterations);
+                QString line = QString("  %1 C %2 ms")
+                    .arg(QString(kStepNames[step]) + ':', -16)
+                    .arg(celapsed, 5);
+
+                if (simd)
+                {
+                    AudioOutputUtil::EnableSIMD(true);
+                    int elapsed = time_step((BenchStep)step, packet,
+                                            packets, iterations);
+                    line += QString(", %1 %2 ms (%3x)")
+                        .arg(simd).arg(elapsed, 5)
+                        .arg(double(max(celapsed, 1)) / max(elapsed, 1),
+                             0, 'f', 1);
+                }
+                cout << qPrintable(line) << endl;
+            }
+        }
+    }
+
+    AudioOutputUtil::EnableSIMD(true);
+    return GENERIC_EXIT_OK;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCoreApplication::setApplicationName(MYTH_APPNAME_MYTHAUDIOBENCH);
+
+    MythAudioBenchCommandLineParser cmdline;
+    if (!cmdline.Parse(argc, argv))
+    {
+        cmdline.PrintHelp();
+        return GENERIC_EXIT_INVALID_CMDLINE;
+    }
+
+    if (cmdline.toBool("showhelp"))
+    {
+        cmdline.PrintHelp();
+        return GENERIC_EXIT_OK;
+    }
+
+    if (cmdline.toBool("showversion"))
+    {
+        cmdline.PrintVersion();
+        return GENERIC_EXIT_OK;
+    }
+
+    int retval = cmdline.ConfigureLogging("none");
+    if (retval != GENERIC_EXIT_OK)
+        return retval;
+
+    int frames = cmdline.toInt("frames");
+    int packets = cmdline.toInt("packets");
+    int iterations = cmdline.toInt("iterations");
+    if (frames < 16 || packets < 1 || iterations < 1)
+    {
+        cerr << "Invalid --frames, --packets or --iterations" << endl;
+        return GENERIC_EXIT_INVALID_CMDLINE;
+    }
+
+    return RunBench(frames, packets, iterations, cmdline.toBool("checkonly"));
+}
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -0,0 +1,18 @@
+include ( ../../settings.pro )
+include ( ../../version.pro )
+include ( ../programs-libs.pro )
+
+QT += network xml sql
+
+TEMPLATE = app
+CONFIG += thread
+TARGET = mythaudiobench
+target.path = $${PREFIX}/bin
+INSTALLS = target
+
+QMAKE_CLEAN += $(TARGET)
+
+# Input
+HEADERS += commandlineparser.h
+
+SOURCES += main.cpp commandlineparser.cpp
@@ -1,3 +1,12 @@
+// ANSI C headers
+#include <ctime>
+
+// POSIX headers
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QFileInfo>
@@ -8,6 +17,35 @@
 #include "mythsocket.h"
 #include "programinfo.h"
 #include "mythlogging.h"
+#include "mythcorecontext.h"
+
+// Files modified more recently than this are assumed to still be recording
+static const int kZeroCopyMinIdleSecs = 30;
+
+/// Returns true if a recorder may still be writing to the recording,
+/// even though the file has not grown for a while.
+static bool is_being_recorded(const ProgramInfo *pginfo)
+{
+    if (!pginfo || !pginfo->IsRecording())
+        return false;
+
+    if (pginfo->GetRecordingEndTime() > MythDate::current())
+        return true;
+
+    QStringList byWho;
+    pginfo->QueryIsInUse(byWho);
+    for (int i = 0; i + 2 < byWho.size(); i += 3)
+    {
+        if (byWho[i] == kRecorderInUseID ||
+            byWho[i] == kImportRecorderInUseID ||
+            byWho[i] == kTranscoderInUseID)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
 
 FileTransfer::FileTransfer(QString &filename, MythSocket *remote,
                            bool usereadahead, int timeout_ms) :
@@ -15,11 +53,13 @@ FileTransfer::FileTransfer(QString &filename, MythSocket *remote,
     readthreadlive(true), readsLocked(false),
     rbuffer(RingBuffer::Create(filename, false, usereadahead, timeout_ms, true)),
     sock(remote), ateof(false), lock(QMutex::NonRecursive),
+    zerocopy(false), zerocopyfd(-1), zerocopypos(0),
     writemode(false)
 {
     pginfo = new ProgramInfo(filename);
     pginfo->MarkAsInUse(true, kFileTransferInUseID);
     rbuffer->Start();
+    InitZeroCopy();
 }
 
 FileTransfer::FileTransfer(QString &filename, MythSocket *remote, bool write) :
@@ -27,6 +67,7 @@ FileTransfer::FileTransfer(QString &filename, MythSocket *remote, bool write) :
     readthreadlive(true), readsLocked(false),
     rbuffer(RingBuffer::Create(filename, write)),
     sock(remote), ateof(false), lock(QMutex::NonRecursive),
+    zerocopy(false), zerocopyfd(-1), zerocopypos(0),
     writemode(write)
 {
     pginfo = new ProgramInfo(filename);
@@ -41,6 +82,9 @@ FileTransfer::~FileTransfer()
 {
     Stop();
 
+    if (zerocopyfd >= 0)
+        close(zerocopyfd);
+
     if (rbuffer)
     {
         delete rbuffer;
@@ -103,10 +147,13 @@ void FileTransfer::Pause(void)
 
 void FileTransfer::Unpause(void)
 {
-    LOG(VB_FILE, LOG_INFO, "calling StartReads()");
-    rbuffer->StartReads();
     {
         QMutexLocker locker(&lock);
+        if (!zerocopy)
+        {
+            LOG(VB_FILE, LOG_INFO, "calling StartReads()");
+            rbuffer->StartReads();
+        }
         readsLocked = false;
     }
     readsUnlockedCond.wakeAll();
@@ -127,6 +174,14 @@ int FileTransfer::RequestBlock(int size)
     while (readsLocked)
         readsUnlockedCond.wait(&lock, 100 /*ms*/);
 
+    if (zerocopy && RequestBlockZeroCopy(size, tot))
+    {
+        if (pginfo)
+            pginfo->UpdateInUseMark();
+
+        return tot;
+    }
+
     requestBuffer.resize(max((size_t)max(size,0) + 128, requestBuffer.size()));
     char *buf = &requestBuffer[0];
     while (tot < size && !rbuffer->GetStopReads() && readthreadlive)
@@ -155,6 +210,98 @@ int FileTransfer::RequestBlock(int size)
     return (ret < 0) ? -1 : tot;
 }
 
+/** \brief Decides whether reads can bypass the RingBuffer.
+ *
+ *  This is only done for plain local files which are not being written
+ *  to; remote storage groups, discs and recordings in progress keep
+ *  using the RingBuffer, which knows how to wait for more data. A file
+ *  counts as written to while it keeps growing, while the recording is
+ *  scheduled to go on, or while a recorder has it marked in use, which
+ *  covers recorders stalled by a loss of signal.
+ */
+void FileTransfer::InitZeroCopy(void)
+{
+#ifdef __linux__
+    if (!rbuffer || !rbuffer->IsOpen() || rbuffer->IsDisc() ||
+        !gCoreContext->GetNumSetting("FileTransferZeroCopy", 1))
+    {
+        return;
+    }
+
+    QString filename = rbuffer->GetFilename();
+    QFileInfo fi(filename);
+    if (!fi.isFile() ||
+        fi.lastModified().secsTo(QDateTime::currentDateTime()) <
+        kZeroCopyMinIdleSecs || is_being_recorded(pginfo))
+    {
+        return;
+    }
+
+    zerocopyfd = open(filename.toLocal8Bit().constData(), O_RDONLY);
+    if (zerocopyfd < 0)
+        return;
+
+    QMutexLocker locker(&lock);
+    zerocopypos = rbuffer->GetReadPosition();
+    zerocopy = true;
+    rbuffer->StopReads();
+
+    LOG(VB_FILE, LOG_INFO, QString("Using zero-copy transfers for '%1'")
+        .arg(filename));
+#endif
+}
+
+/** \brief Sends as much of a block as possible straight from the file.
+ *
+ *  Must be called with lock held. On return tot holds the number of
+ *  bytes sent, or -1 on a socket error.
+ *  \return false if the rest of the block must be read via the RingBuffer
+ */
+bool FileTransfer::RequestBlockZeroCopy(int size, int &tot)
+{
+    qint64 ret = sock->writeFileData(zerocopyfd, zerocopypos, max(size, 0));
+    if (ret < 0)
+    {
+        tot = -1;
+        return true;
+    }
+
+    zerocopypos += ret;
+    tot = (int) ret;
+    if (tot >= size)
+        return true;
+
+    // A short read is either the end of the file, or the file started
+    // growing again after we opened it.
+    struct stat st;
+    if (fstat(zerocopyfd, &st) == 0 && st.st_size <= zerocopypos &&
+        time(NULL) - st.st_mtime >= kZeroCopyMinIdleSecs &&
+        !is_being_recorded(pginfo))
+    {
+        return true;
+    }
+
+    LOG(VB_FILE, LOG_INFO, QString("'%1' is growing, leaving zero-copy mode")
+        .arg(rbuffer->GetFilename()));
+    StopZeroCopy();
+    return false;
+}
+
+/// Hands reading back to the RingBuffer. Must be called with lock held.
+void FileTransfer::StopZeroCopy(void)
+{
+    if (!zerocopy)
+        return;
+
+    zerocopy = false;
+    close(zerocopyfd);
+    zerocopyfd = -1;
+
+    rbuffer->Seek(zerocopypos, SEEK_SET);
+    if (!readsLocked && readthreadlive)
+        rbuffer->StartReads();
+}
+
 int FileTransfer::WriteBlock(int size)
 {
     if (!writemode || !rbuffer)
@@ -200,6 +347,23 @@ long long FileTransfer::Seek(long long curpos, long long pos, int whence)
 
     ateof = false;
 
+    {
+        QMutexLocker locker(&lock);
+        if (zerocopy)
+        {
+            if (whence == SEEK_CUR)
+                pos += curpos;
+            else if (whence == SEEK_END)
+                pos += GetFileSize();
+
+            if (pos < 0)
+                return -1;
+
+            zerocopypos = pos;
+            return pos;
+        }
+    }
+
     Pause();
 
     if (whence == SEEK_CUR)
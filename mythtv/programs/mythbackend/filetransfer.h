@@ -50,6 +50,10 @@ class FileTransfer : public ReferenceCounter
   private:
    ~FileTransfer();
 
+    void InitZeroCopy(void);
+    bool RequestBlockZeroCopy(int size, int &tot);
+    void StopZeroCopy(void);
+
     volatile bool  readthreadlive;
     bool           readsLocked;
     QWaitCondition readsUnlockedCond;
@@ -61,6 +65,12 @@ class FileTransfer : public ReferenceCounter
 
     vector<char> requestBuffer;
 
+    // Finished local files are sent with sendfile() from zerocopyfd,
+    // bypassing rbuffer, which is kept stopped until we fall back to it.
+    bool      zerocopy;
+    int       zerocopyfd;
+    long long zerocopypos;
+
     QMutex lock;
 
     bool writemode;
@@ -589,6 +589,7 @@ void HouseKeeper::CleanupRecordedTables(void)
         { "recordedcredits", "progstart" },
         { "recordedmarkup", "starttime" },
         { "recordedseek", "starttime" },
+        { "recordedseekmap", "starttime" },
         { "", "" } }; // This blank entry must exist, do not remove.
     QString table = tables[tableIndex][0];
     QString column = tables[tableIndex][1];
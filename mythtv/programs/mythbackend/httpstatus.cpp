@@ -40,6 +40,7 @@
 #include "jobqueue.h"
 #include "upnp.h"
 #include "mythdate.h"
+#include "pespacket.h"
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -429,11 +430,22 @@ void HttpStatus::FillStatusXML( QDomDocument *pDoc )
     QDomElement storage = pDoc->createElement("Storage"    );
     QDomElement load    = pDoc->createElement("Load"       );
     QDomElement guide   = pDoc->createElement("Guide"      );
+    QDomElement pesmem  = pDoc->createElement("PESAllocator");
 
     root.appendChild (mInfo  );
     mInfo.appendChild(storage);
     mInfo.appendChild(load   );
     mInfo.appendChild(guide  );
+    mInfo.appendChild(pesmem );
+
+    // PES/PSIP block allocator ---------------------
+
+    PESAllocStats pesStats = pes_alloc_stats();
+    pesmem.setAttribute("caches",      pesStats.caches);
+    pesmem.setAttribute("hits",        (qulonglong) pesStats.hits);
+    pesmem.setAttribute("misses",      (qulonglong) pesStats.misses);
+    pesmem.setAttribute("remoteFrees", (qulonglong) pesStats.remote_frees);
+    pesmem.setAttribute("outstanding", (qlonglong) pesStats.outstanding);
 
     // drive space   ---------------------
 
@@ -1439,6 +1451,25 @@ int HttpStatus::PrintMachineInfo( QTextStream &os, QDomElement info )
                 os << "<br />\r\n    DataDirect Status: " << sMsg;
         }
     }
+
+    // PES/PSIP block allocator ---------------------
+
+    node = info.namedItem( "PESAllocator" );
+
+    if (!node.isNull())
+    {
+        QDomElement e = node.toElement();
+
+        if (!e.isNull())
+        {
+            os << "<br />\r\n    PES block allocator: "
+               << e.attribute( "outstanding", "0" ) << " blocks in use by "
+               << e.attribute( "caches"     , "0" ) << " threads, "
+               << e.attribute( "hits"       , "0" ) << " hits, "
+               << e.attribute( "misses"     , "0" ) << " misses, "
+               << e.attribute( "remoteFrees", "0" ) << " cross-thread frees.";
+        }
+    }
     os << "\r\n  </div>\r\n";
 
     return( 1 );
@@ -223,6 +223,62 @@ class FreeSpaceUpdater : public QRunnable
 const int FreeSpaceUpdater::kRequeryTimeout = 15000;
 const int FreeSpaceUpdater::kExitTimeout = 61000;
 
+/// Asks a slave backend for the file sizes of a batch of its recordings.
+class SlaveFillRunnable : public QRunnable
+{
+  public:
+    SlaveFillRunnable(PlaybackSock *slave, const QString &playbackhost,
+                      QMutex &lock, QWaitCondition &wait, int &left) :
+        m_slave(slave), m_playbackhost(playbackhost),
+        m_lock(lock), m_wait(wait), m_left(left)
+    {
+        m_slave->IncrRef();
+    }
+
+    virtual ~SlaveFillRunnable()
+    {
+        if (m_slave)
+            m_slave->DecrRef();
+    }
+
+    void AddProgram(ProgramInfo *pginfo) { m_list.push_back(pginfo); }
+
+    virtual void run(void)
+    {
+        vector<ProgramInfo*>::iterator it = m_list.begin();
+        for (; it != m_list.end(); ++it)
+        {
+            ProgramInfo *proginfo = *it;
+            if (!m_slave->FillProgramInfo(*proginfo, m_playbackhost))
+            {
+                LOG(VB_GENERAL, LOG_ERR,
+                    "MainServer::FillRecordingPaths()"
+                    "\n\t\t\tCould not fill program info "
+                    "from backend");
+            }
+            else if (proginfo->GetRecordingEndTime() < MythDate::current())
+            {
+                proginfo->SaveFilesize(proginfo->GetFilesize());
+            }
+        }
+
+        m_slave->DecrRef();
+        m_slave = NULL;
+
+        QMutexLocker locker(&m_lock);
+        m_left--;
+        m_wait.wakeAll();
+    }
+
+  private:
+    PlaybackSock         *m_slave;
+    QString               m_playbackhost;
+    vector<ProgramInfo*>  m_list;
+    QMutex               &m_lock;
+    QWaitCondition       &m_wait;
+    int                  &m_left;
+};
+
 MainServer::MainServer(bool master, int port,
                        QMap<int, EncoderLink *> *tvList,
                        Scheduler *sched, AutoExpire *expirer) :
@@ -448,6 +504,13 @@ void MainServer::ProcessRequestWork(MythSocket *sock)
         else
             HandleQueryRecordings(tokens[1], pbs);
     }
+    else if (command == "QUERY_RECORDINGS_DELTA")
+    {
+        if (tokens.size() != 2)
+            LOG(VB_GENERAL, LOG_ERR, "Bad QUERY_RECORDINGS_DELTA query");
+        else
+            HandleQueryRecordingsDelta(tokens[1], pbs);
+    }
     else if (command == "QUERY_RECORDING")
     {
         HandleQueryRecording(tokens, pbs);
@@ -833,6 +896,9 @@ void MainServer::customEvent(QEvent *e)
 
         QString message = me->Message();
         QString error;
+
+        m_recListCache.HandleEvent(message);
+
         if ((message == "PREVIEW_SUCCESS" || message == "PREVIEW_QUEUED") &&
             me->ExtraDataCount() >= 5)
         {
@@ -1288,8 +1354,13 @@ void MainServer::HandleVersion(MythSocket *socket, const QStringList &slist)
         return;
     }
 
-    retlist << "ACCEPT" << MYTH_PROTO_VERSION;
+    // The reply is still sent as text, binary frames follow it
+    uint binary = MythSocket::ParseBinaryProtocol(slist, 3);
+
+    retlist << "ACCEPT" << MYTH_PROTO_VERSION
+            << MythSocket::GetBinaryProtocolTokens(binary);
     socket->writeStringList(retlist);
+    socket->setBinaryProtocol(binary);
 }
 
 /**
@@ -1459,6 +1530,9 @@ void MainServer::HandleAnnounce(QStringList &slist, QStringList commands,
         playbackList.push_back(pbs);
         sockListLock.unlock();
 
+        // The slave's recordings now have playback URLs
+        m_recListCache.Invalidate();
+
         autoexpireUpdateTimer->start(1000);
 
         gCoreContext->SendSystemEvent(
@@ -1670,14 +1744,6 @@ void MainServer::HandleQueryRecordings(QString type, PlaybackSock *pbs)
     MythSocket *pbssock = pbs->getSocket();
     QString playbackhost = pbs->getHostname();
 
-    QMap<QString,ProgramInfo*> recMap;
-    if (m_sched)
-        recMap = m_sched->GetRecording();
-
-    QMap<QString,uint32_t> inUseMap = ProgramInfo::QueryInUseMap();
-    QMap<QString,bool> isJobRunning =
-        ProgramInfo::QueryJobsRunning(JOB_COMMFLAG);
-
     int sort = 0;
     // Allow "Play" and "Delete" for backwards compatibility with protocol
     // version 56 and below.
@@ -1686,31 +1752,173 @@ void MainServer::HandleQueryRecordings(QString type, PlaybackSock *pbs)
     else if ((type == "Descending") || (type == "Delete"))
         sort = -1;
 
+    if (type != "Recording")
+    {
+        RecordingListCache::Selection sel;
+        {
+            QMutexLocker locker(&m_recListCache.GetLock());
+            UpdateRecordingListCache();
+            m_recListCache.SelectList(sort, sel);
+        }
+        FillRecordingPaths(sel.list, playbackhost);
+        m_recListCache.SetFilesizes(sel);
+
+        QStringList outputlist;
+        sel.ToStringList(outputlist);
+        SendResponse(pbssock, outputlist);
+        return;
+    }
+
+    QMap<QString,ProgramInfo*> recMap;
+    if (m_sched)
+        recMap = m_sched->GetRecording();
+
+    QMap<QString,uint32_t> inUseMap = ProgramInfo::QueryInUseMap();
+    QMap<QString,bool> isJobRunning =
+        ProgramInfo::QueryJobsRunning(JOB_COMMFLAG);
+
     ProgramList destination;
     LoadFromRecorded(
-        destination, (type == "Recording"),
-        inUseMap, isJobRunning, recMap, sort);
+        destination, true, inUseMap, isJobRunning, recMap, sort);
 
     QMap<QString,ProgramInfo*>::iterator mit = recMap.begin();
     for (; mit != recMap.end(); mit = recMap.erase(mit))
         delete *mit;
 
+    FillRecordingPaths(destination, playbackhost);
+
     QStringList outputlist(QString::number(destination.size()));
+    ProgramList::iterator it = destination.begin();
+    for (; it != destination.end(); ++it)
+        (*it)->ToStringList(outputlist);
+
+    SendResponse(pbssock, outputlist);
+}
+
+/**
+ * \addtogroup myth_network_protocol
+ * \par        QUERY_RECORDINGS_DELTA \e token
+ * Returns a new token, "FULL" or "DELTA", the number of changed recordings
+ * followed by their programinfo, and the number of deleted recordings
+ * followed by their chanid_starttime keys. Pass "0" as the \e token to get
+ * all recordings, and after that the token of the previous response to get
+ * only the recordings that changed since. If the backend can not tell what
+ * changed since the \e token, all recordings are returned with "FULL".
+ */
+void MainServer::HandleQueryRecordingsDelta(QString token, PlaybackSock *pbs)
+{
+    MythSocket *pbssock = pbs->getSocket();
+
+    RecordingListCache::Selection sel;
+    {
+        QMutexLocker locker(&m_recListCache.GetLock());
+        UpdateRecordingListCache();
+        m_recListCache.SelectChanges(token, sel);
+    }
+    // The slave backends are asked for file sizes without the lock held
+    FillRecordingPaths(sel.list, pbs->getHostname());
+    m_recListCache.SetFilesizes(sel);
+
+    QStringList outputlist;
+    sel.ToStringList(outputlist);
+    SendResponse(pbssock, outputlist);
+}
+
+/** \brief Brings the recording list cache up to date.
+ *
+ *  Only the recordings named by events since the last request are
+ *  reloaded, unless the whole list was invalidated. The pathnames are
+ *  left for FillRecordingPaths() on each request, as they depend on the
+ *  client. The caller must hold the cache lock.
+ */
+void MainServer::UpdateRecordingListCache(void)
+{
+    QMap<QString,ProgramInfo*> recMap;
+    if (m_sched)
+        recMap = m_sched->GetRecording();
+
+    QMap<QString,uint32_t> inUseMap = ProgramInfo::QueryInUseMap();
+    QMap<QString,bool> isJobRunning =
+        ProgramInfo::QueryJobsRunning(JOB_COMMFLAG);
+
+    ProgramList list;
+    if (m_recListCache.TakeInvalid())
+    {
+        // The in use and recording status are applied by Refresh()
+        LoadFromRecorded(list, false, QMap<QString,uint32_t>(),
+                         isJobRunning, QMap<QString,ProgramInfo*>(), 0);
+        m_recListCache.Fill(list);
+    }
+    else
+    {
+        QStringList changed = m_recListCache.TakeChanged();
+        QStringList deleted;
+
+        QStringList::const_iterator it = changed.begin();
+        for (; it != changed.end(); ++it)
+        {
+            uint chanid;
+            QDateTime recstartts;
+            if (!ProgramInfo::ExtractKey(*it, chanid, recstartts))
+                continue;
+
+            ProgramInfo *pginfo = new ProgramInfo(chanid, recstartts);
+            if (pginfo->GetChanID())
+            {
+                list.push_back(pginfo);
+            }
+            else
+            {
+                delete pginfo;
+                deleted.push_back(*it);
+            }
+        }
+
+        m_recListCache.Update(list, deleted);
+    }
+
+    m_recListCache.Refresh(inUseMap, isJobRunning, recMap);
+
+    QMap<QString,ProgramInfo*>::iterator mit = recMap.begin();
+    for (; mit != recMap.end(); mit = recMap.erase(mit))
+        delete *mit;
+}
+
+/** \brief Sets the playback URL of the recordings, and the file size
+ *         of those which do not have one yet.
+ *
+ *  The slave backends are asked for file sizes concurrently, with one
+ *  batch of recordings per slave.
+ */
+void MainServer::FillRecordingPaths(ProgramList &list,
+                                    const QString &playbackhost)
+{
     QMap<QString, QString> backendIpMap;
     QMap<QString, QString> backendPortMap;
     QString ip   = gCoreContext->GetBackendServerIP();
     QString port = gCoreContext->GetSetting("BackendServerPort");
 
-    ProgramList::iterator it = destination.begin();
-    for (it = destination.begin(); it != destination.end(); ++it)
+    QMap<QString, PlaybackSock*> slaves;
+    QMap<QString, SlaveFillRunnable*> fills;
+    QMutex fillLock;
+    QWaitCondition fillWait;
+    int fillsLeft = 0;
+
+    ProgramList::iterator it = list.begin();
+    for (; it != list.end(); ++it)
     {
         ProgramInfo *proginfo = *it;
+        QString hostname = proginfo->GetHostname();
         PlaybackSock *slave = NULL;
 
-        if (proginfo->GetHostname() != gCoreContext->GetHostName())
-            slave = GetSlaveByHostname(proginfo->GetHostname());
+        if (hostname != gCoreContext->GetHostName())
+        {
+            if (!slaves.contains(hostname))
+                slaves[hostname] = GetSlaveByHostname(hostname);
+            slave = slaves[hostname];
+        }
 
-        if ((proginfo->GetHostname() == gCoreContext->GetHostName()) ||
+        if ((hostname == gCoreContext->GetHostName()) ||
             (!slave && masterBackendOverride))
         {
             proginfo->SetPathname(gCoreContext->GenMythURL(ip,port,proginfo->GetBasename()));
@@ -1738,7 +1946,7 @@ void MainServer::HandleQueryRecordings(QString type, PlaybackSock *pbs)
             if (proginfo->GetPathname().isEmpty())
             {
                 LOG(VB_GENERAL, LOG_ERR, LOC +
-                    QString("HandleQueryRecordings() "
+                    QString("FillRecordingPaths() "
                             "Couldn't find backend for:\n\t\t\t%1")
                         .arg(proginfo->toString(ProgramInfo::kTitleSubtitle)));
 
@@ -1746,50 +1954,59 @@ void MainServer::HandleQueryRecordings(QString type, PlaybackSock *pbs)
                 proginfo->SetPathname("file not found");
             }
         }
-        else
+        else if (!proginfo->GetFilesize())
         {
-            if (!proginfo->GetFilesize())
-            {
-                if (!slave->FillProgramInfo(*proginfo, playbackhost))
-                {
-                    LOG(VB_GENERAL, LOG_ERR,
-                        "MainServer::HandleQueryRecordings()"
-                        "\n\t\t\tCould not fill program info "
-                        "from backend");
-                }
-                else
-                {
-                    if (proginfo->GetRecordingEndTime() <
-                        MythDate::current())
-                    {
-                        proginfo->SaveFilesize(proginfo->GetFilesize());
-                    }
-                }
-            }
-            else
+            if (!fills.contains(hostname))
             {
-                ProgramInfo *p = proginfo;
-                if (!backendIpMap.contains(p->GetHostname()))
-                    backendIpMap[p->GetHostname()] =
-                        gCoreContext->GetSettingOnHost("BackendServerIp",
-                                                   p->GetHostname());
-                if (!backendPortMap.contains(p->GetHostname()))
-                    backendPortMap[p->GetHostname()] =
-                        gCoreContext->GetSettingOnHost("BackendServerPort",
-                                                   p->GetHostname());
-                p->SetPathname(gCoreContext->GenMythURL(backendIpMap[p->GetHostname()],
-                                                        backendPortMap[p->GetHostname()],
-                                                        p->GetBasename()));
+                fills[hostname] = new SlaveFillRunnable(
+                    slave, playbackhost, fillLock, fillWait, fillsLeft);
             }
+            fills[hostname]->AddProgram(proginfo);
         }
+        else
+        {
+            if (!backendIpMap.contains(hostname))
+                backendIpMap[hostname] =
+                    gCoreContext->GetSettingOnHost("BackendServerIp",
+                                                   hostname);
+            if (!backendPortMap.contains(hostname))
+                backendPortMap[hostname] =
+                    gCoreContext->GetSettingOnHost("BackendServerPort",
+                                                   hostname);
+            proginfo->SetPathname(gCoreContext->GenMythURL(backendIpMap[hostname],
+                                                           backendPortMap[hostname],
+                                                           proginfo->GetBasename()));
+        }
+    }
 
-        if (slave)
-            slave->DecrRef();
-
-        proginfo->ToStringList(outputlist);
+    if (fills.size() == 1)
+    {
+        // No need for another thread
+        fillsLeft = 1;
+        SlaveFillRunnable *fill = *fills.begin();
+        fill->run();
+        delete fill;
+    }
+    else if (!fills.empty())
+    {
+        QMutexLocker locker(&fillLock);
+        fillsLeft = fills.size();
+        QMap<QString, SlaveFillRunnable*>::iterator fit = fills.begin();
+        for (; fit != fills.end(); ++fit)
+        {
+            MThreadPool::globalInstance()->startReserved(
+                *fit, "SlaveFillProgramInfo");
+        }
+        while (fillsLeft > 0)
+            fillWait.wait(&fillLock);
     }
 
-    SendResponse(pbssock, outputlist);
+    QMap<QString, PlaybackSock*>::iterator sit = slaves.begin();
+    for (; sit != slaves.end(); ++sit)
+    {
+        if (*sit)
+            (*sit)->DecrRef();
+    }
 }
 
 /**
@@ -2144,6 +2361,18 @@ void MainServer::DoDeleteInDB(DeleteStruct *ds)
         LOG(VB_GENERAL, LOG_ERR, QString("Error deleting recordedseek for %1.")
                                       .arg(logInfo));
     }
+
+    query.prepare("DELETE FROM recordedseekmap "
+                  "WHERE chanid = :CHANID AND starttime = :STARTTIME;");
+    query.bindValue(":CHANID", ds->m_chanid);
+    query.bindValue(":STARTTIME", ds->m_recstartts);
+
+    if (!query.exec())
+    {
+        MythDB::DBError("Recorded program delete recordedseekmap", query);
+        LOG(VB_GENERAL, LOG_ERR,
+            QString("Error deleting recordedseekmap for %1.") .arg(logInfo));
+    }
 }
 
 /**
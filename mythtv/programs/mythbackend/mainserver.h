@@ -20,6 +20,7 @@ using namespace std;
 #include "scheduler.h"
 #include "livetvchain.h"
 #include "autoexpire.h"
+#include "recordinglistcache.h"
 #include "mythsocket.h"
 #include "mythdeque.h"
 #include "mythdownloadmanager.h"
@@ -149,6 +150,9 @@ class MainServer : public QObject, public MythSocketCBs
     bool HandleDeleteFile(QString filename, QString storagegroup,
                           PlaybackSock *pbs = NULL);
     void HandleQueryRecordings(QString type, PlaybackSock *pbs);
+    void HandleQueryRecordingsDelta(QString token, PlaybackSock *pbs);
+    void UpdateRecordingListCache(void);
+    void FillRecordingPaths(ProgramList &list, const QString &playbackhost);
     void HandleQueryRecording(QStringList &slist, PlaybackSock *pbs);
     void HandleStopRecording(QStringList &slist, PlaybackSock *pbs);
     void DoHandleStopRecording(RecordingInfo &recinfo, PlaybackSock *pbs);
@@ -293,6 +297,8 @@ class MainServer : public QObject, public MythSocketCBs
     Scheduler *m_sched;
     AutoExpire *m_expirer;
 
+    RecordingListCache m_recListCache;
+
     struct DeferredDeleteStruct
     {
         PlaybackSock *sock;
@@ -0,0 +1,409 @@
+// C++ headers
+#include <algorithm>
+using namespace std;
+
+// MythTV headers
+#include "recordinglistcache.h"
+#include "mythcorecontext.h"
+#include "mythlogging.h"
+#include "mythdate.h"
+
+#define LOC QString("RecListCache: ")
+
+static const uint32_t kInUseFlags =
+    FL_INUSERECORDING | FL_INUSEPLAYING | FL_INUSEOTHER;
+
+/// Deleted keys kept for delta requests; older tokens get the full list
+static const int kMaxDeleted = 1000;
+
+// The fields of ProgramInfo::ToStringList() set per request
+static const int kPathnameField = 10;
+static const int kFilesizeField = 11;
+
+RecordingListCache::RecordingListCache() :
+    m_orderDirty(false),
+    m_epoch(MythDate::current().toTime_t()),
+    m_generation(0), m_fillGeneration(0),
+    m_invalid(true)
+{
+}
+
+RecordingListCache::~RecordingListCache()
+{
+    QMutexLocker locker(&m_lock);
+    Clear();
+}
+
+/** \brief Notes the recordings changed by a RECORDING_LIST_CHANGE,
+ *         MASTER_UPDATE_PROG_INFO or UPDATE_FILE_SIZE event.
+ */
+void RecordingListCache::HandleEvent(const QString &message)
+{
+    QStringList tokens = message.simplified().split(" ");
+
+    if (tokens[0] == "RECORDING_LIST_CHANGE")
+    {
+        if (tokens.size() == 1)
+        {
+            Invalidate();
+            return;
+        }
+
+        if ((tokens[1] != "ADD" && tokens[1] != "DELETE") ||
+            tokens.size() < 4)
+        {
+            return;
+        }
+
+        tokens.removeFirst();
+    }
+    else if (tokens[0] != "MASTER_UPDATE_PROG_INFO" &&
+             tokens[0] != "UPDATE_FILE_SIZE")
+    {
+        return;
+    }
+
+    if (tokens.size() < 3)
+        return;
+
+    uint chanid = tokens[1].toUInt();
+    QDateTime recstartts = MythDate::fromString(tokens[2]);
+    if (!chanid || !recstartts.isValid())
+        return;
+
+    QString key = ProgramInfo::MakeUniqueKey(chanid, recstartts);
+
+    QMutexLocker locker(&m_eventLock);
+    if (tokens[0] == "UPDATE_FILE_SIZE" && tokens.size() >= 4)
+        m_filesizes[key] = tokens[3].toULongLong();
+    else
+        m_changed.insert(key);
+}
+
+/// Reloads the whole list on the next request.
+void RecordingListCache::Invalidate(void)
+{
+    QMutexLocker locker(&m_eventLock);
+    m_invalid = true;
+}
+
+/// Returns true if the whole list has to be reloaded.
+bool RecordingListCache::TakeInvalid(void)
+{
+    QMutexLocker locker(&m_eventLock);
+    bool invalid = m_invalid;
+    if (invalid)
+    {
+        m_changed.clear();
+        m_filesizes.clear();
+    }
+    m_invalid = false;
+    return invalid;
+}
+
+/// Returns the keys of the recordings which have to be reloaded.
+QStringList RecordingListCache::TakeChanged(void)
+{
+    QMutexLocker locker(&m_eventLock);
+    QStringList changed = m_changed.toList();
+    m_changed.clear();
+    return changed;
+}
+
+void RecordingListCache::Clear(void)
+{
+    QHash<QString, Entry*>::iterator it = m_entries.begin();
+    for (; it != m_entries.end(); ++it)
+        delete *it;
+    m_entries.clear();
+    m_order.clear();
+    m_deleted.clear();
+}
+
+void RecordingListCache::Insert(ProgramInfo *pginfo)
+{
+    QString key = pginfo->MakeUniqueKey();
+
+    Entry *entry = new Entry(pginfo);
+    entry->baseflags = pginfo->GetProgramFlags() & ~kInUseFlags;
+    entry->generation = m_generation;
+
+    QHash<QString, Entry*>::iterator it = m_entries.find(key);
+    if (it != m_entries.end())
+    {
+        m_order.removeOne(*it);
+        delete *it;
+        *it = entry;
+    }
+    else
+    {
+        m_entries.insert(key, entry);
+    }
+
+    m_order.push_back(entry);
+    m_orderDirty = true;
+    m_deleted.remove(key);
+}
+
+/// Replaces the whole list, taking ownership of the ProgramInfos.
+void RecordingListCache::Fill(ProgramList &list)
+{
+    Clear();
+
+    m_generation++;
+    m_fillGeneration = m_generation;
+
+    ProgramList::iterator it = list.begin();
+    for (; it != list.end(); ++it)
+        Insert(*it);
+
+    list.setAutoDelete(false);
+    list.clear();
+
+    LOG(VB_GENERAL, LOG_DEBUG, LOC + QString("Loaded %1 recordings")
+        .arg(m_entries.size()));
+}
+
+/// Replaces the changed recordings, taking ownership of the ProgramInfos,
+/// and removes the deleted ones.
+void RecordingListCache::Update(ProgramList &list, const QStringList &deleted)
+{
+    if (list.empty() && deleted.empty())
+        return;
+
+    m_generation++;
+
+    ProgramList::iterator it = list.begin();
+    for (; it != list.end(); ++it)
+        Insert(*it);
+
+    list.setAutoDelete(false);
+    list.clear();
+
+    QStringList::const_iterator dit = deleted.begin();
+    for (; dit != deleted.end(); ++dit)
+    {
+        QHash<QString, Entry*>::iterator eit = m_entries.find(*dit);
+        if (eit == m_entries.end())
+            continue;
+        m_order.removeOne(*eit);
+        delete *eit;
+        m_entries.erase(eit);
+        m_deleted[*dit] = m_generation;
+    }
+
+    PruneDeleted();
+}
+
+/** \brief Forgets the oldest deleted keys once there are too many.
+ *
+ *  Tokens from before the last generation forgotten get the full list.
+ */
+void RecordingListCache::PruneDeleted(void)
+{
+    if (m_deleted.size() <= kMaxDeleted)
+        return;
+
+    QList<uint> generations = m_deleted.values();
+    sort(generations.begin(), generations.end());
+    uint last = generations[generations.size() - kMaxDeleted / 2 - 1];
+
+    QMap<QString, uint>::iterator it = m_deleted.begin();
+    while (it != m_deleted.end())
+    {
+        if (*it <= last)
+            it = m_deleted.erase(it);
+        else
+            ++it;
+    }
+
+    m_fillGeneration = max(m_fillGeneration, last);
+}
+
+/** \brief Applies the state which changes without an event, and
+ *         serializes the recordings which changed.
+ */
+void RecordingListCache::Refresh(const QMap<QString,uint32_t> &inUseMap,
+                                 const QMap<QString,bool> &isJobRunning,
+                                 const QMap<QString,ProgramInfo*> &recMap)
+{
+    QMap<QString, uint64_t> filesizes;
+    {
+        QMutexLocker locker(&m_eventLock);
+        filesizes.swap(m_filesizes);
+    }
+
+    QDateTime rectime = MythDate::current().addSecs(
+        -gCoreContext->GetNumSetting("RecordOverTime"));
+    bool changed = false;
+
+    QHash<QString, Entry*>::iterator it = m_entries.begin();
+    for (; it != m_entries.end(); ++it)
+    {
+        Entry *entry = *it;
+        ProgramInfo *pginfo = entry->pginfo;
+
+        // Same as LoadFromRecorded()
+        uint32_t flags = entry->baseflags | inUseMap.value(it.key(), 0);
+        if ((flags & FL_COMMPROCESSING) && !isJobRunning.contains(it.key()))
+            flags &= ~FL_COMMPROCESSING;
+        flags &= ~FL_EDITING;
+        if ((flags & FL_REALLYEDITING) || (flags & COMM_FLAG_PROCESSING))
+            flags |= FL_EDITING;
+
+        RecStatusType recstatus = rsRecorded;
+        if (pginfo->GetRecordingEndTime() > rectime &&
+            recMap.contains(it.key()))
+        {
+            recstatus = rsRecording;
+        }
+
+        QMap<QString, uint64_t>::const_iterator fit =
+            filesizes.find(it.key());
+        if (fit != filesizes.end() && *fit != pginfo->GetFilesize())
+        {
+            pginfo->SetFilesize(*fit);
+            entry->strlist.clear();
+        }
+
+        if (flags != pginfo->GetProgramFlags() ||
+            recstatus != pginfo->GetRecordingStatus())
+        {
+            pginfo->SetProgramFlags(flags);
+            pginfo->SetRecordingStatus(recstatus);
+            entry->strlist.clear();
+        }
+
+        if (entry->strlist.empty())
+        {
+            if (!changed)
+            {
+                m_generation++;
+                changed = true;
+            }
+            pginfo->ToStringList(entry->strlist);
+            entry->generation = m_generation;
+        }
+    }
+}
+
+bool RecordingListCache::comp_start(const Entry *a, const Entry *b)
+{
+    if (a->pginfo->GetScheduledStartTime() !=
+        b->pginfo->GetScheduledStartTime())
+    {
+        return (a->pginfo->GetScheduledStartTime() <
+                b->pginfo->GetScheduledStartTime());
+    }
+    return a->pginfo->GetChanID() < b->pginfo->GetChanID();
+}
+
+/// Adds a copy of the recording to sel.
+void RecordingListCache::Select(const Entry *entry, Selection &sel)
+{
+    sel.list.push_back(new ProgramInfo(*entry->pginfo));
+    sel.offsets.push_back(sel.body.size());
+    sel.body += entry->strlist;
+}
+
+/** \brief Selects the QUERY_RECORDINGS response, sorted by program
+ *         start time in descending order if sort is negative, or else
+ *         ascending.
+ */
+void RecordingListCache::SelectList(int sort, Selection &sel)
+{
+    if (m_orderDirty)
+    {
+        stable_sort(m_order.begin(), m_order.end(), comp_start);
+        m_orderDirty = false;
+    }
+
+    if (sort < 0)
+    {
+        QList<Entry*>::const_iterator it = m_order.end();
+        while (it != m_order.begin())
+            Select(*--it, sel);
+    }
+    else
+    {
+        QList<Entry*>::const_iterator it = m_order.begin();
+        for (; it != m_order.end(); ++it)
+            Select(*it, sel);
+    }
+}
+
+QString RecordingListCache::GetToken(void) const
+{
+    return QString("%1-%2").arg(m_epoch).arg(m_generation);
+}
+
+/** \brief Selects the QUERY_RECORDINGS_DELTA response.
+ *
+ *  This is the new token, "FULL" or "DELTA", the number of recordings
+ *  followed by them, and the number of deleted recordings followed by
+ *  their ProgramInfo::MakeUniqueKey() keys. All recordings are returned
+ *  if the token is not from the current list.
+ */
+void RecordingListCache::SelectChanges(const QString &token, Selection &sel)
+{
+    QStringList parts = token.split('-');
+    bool ok = parts.size() == 2 && parts[0].toUInt() == m_epoch;
+    uint since = ok ? parts[1].toUInt(&ok) : 0;
+    bool full = !ok || since < m_fillGeneration || since > m_generation;
+
+    sel.head << GetToken() << (full ? "FULL" : "DELTA");
+
+    QHash<QString, Entry*>::const_iterator it = m_entries.begin();
+    for (; it != m_entries.end(); ++it)
+    {
+        if (full || (*it)->generation > since)
+            Select(*it, sel);
+    }
+
+    QMap<QString, uint>::const_iterator dit = m_deleted.begin();
+    for (; !full && dit != m_deleted.end(); ++dit)
+    {
+        if (*dit > since)
+            sel.deleted << dit.key();
+    }
+}
+
+/// Keeps the file sizes the caller found for the selected recordings,
+/// so they are not looked up again.
+void RecordingListCache::SetFilesizes(const Selection &sel)
+{
+    QMutexLocker locker(&m_eventLock);
+    for (uint i = 0; i < sel.list.size(); ++i)
+    {
+        const ProgramInfo *pginfo = sel.list[i];
+        uint64_t cached =
+            sel.body[sel.offsets[i] + kFilesizeField].toULongLong();
+        if (pginfo->GetFilesize() && pginfo->GetFilesize() != cached)
+            m_filesizes[pginfo->MakeUniqueKey()] = pginfo->GetFilesize();
+    }
+}
+
+/// Serializes the selected recordings, with their current pathnames.
+void RecordingListCache::Selection::ToStringList(QStringList &strlist) const
+{
+    strlist += head;
+    strlist << QString::number(list.size());
+
+    int first = strlist.size();
+    strlist += body;
+    for (uint i = 0; i < list.size(); ++i)
+    {
+        const ProgramInfo *pginfo = list[i];
+        strlist[first + offsets[i] + kPathnameField] = pginfo->GetPathname();
+        strlist[first + offsets[i] + kFilesizeField] =
+            QString::number(pginfo->GetFilesize());
+    }
+
+    if (!head.empty())
+    {
+        strlist << QString::number(deleted.size());
+        strlist += deleted;
+    }
+}
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -0,0 +1,122 @@
+#ifndef _RECORDINGLISTCACHE_H
+#define _RECORDINGLISTCACHE_H
+
+// C++ headers
+#include <stdint.h>
+
+// Qt headers
+#include <QStringList>
+#include <QDateTime>
+#include <QString>
+#include <QMutex>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QSet>
+
+// MythTV headers
+#include "programinfo.h"
+
+/** \class RecordingListCache
+ *  \brief Keeps the serialized QUERY_RECORDINGS response of every
+ *         recording between requests.
+ *
+ *  The list is loaded from the database once and then only the
+ *  recordings named by RECORDING_LIST_CHANGE ADD/DELETE,
+ *  MASTER_UPDATE_PROG_INFO and UPDATE_FILE_SIZE events are reloaded.
+ *  A plain RECORDING_LIST_CHANGE reloads everything. The in use, commflag
+ *  job and recording status are applied on every request, as they change
+ *  without an event.
+ *
+ *  Every change is numbered with a generation, so a client can ask for
+ *  the changes since the token it got with its last list.
+ *
+ *  The pathnames depend on the client asking, so they are not cached.
+ *  SelectList() or SelectChanges() copies the recordings to send into a
+ *  Selection, and the caller sets their pathnames, without the lock held,
+ *  before serializing it.
+ *
+ *  The event functions and SetFilesizes() may be called from any thread.
+ *  All the others must be called with GetLock() held.
+ */
+class RecordingListCache
+{
+  public:
+    RecordingListCache();
+    ~RecordingListCache();
+
+    void HandleEvent(const QString &message);
+    void Invalidate(void);
+
+    /// The recordings of one response, and the response but for their
+    /// pathnames and file sizes.
+    class Selection
+    {
+      public:
+        Selection() : list(true) {}
+
+        void ToStringList(QStringList &strlist) const;
+
+        ProgramList  list;      ///< copies, for the caller to fill in
+        QStringList  head;      ///< the token and "FULL" or "DELTA"
+        QStringList  body;      ///< the serialized recordings
+        QList<int>   offsets;   ///< where each recording starts in body
+        QStringList  deleted;   ///< keys of the deleted recordings
+    };
+
+    QMutex &GetLock(void) { return m_lock; }
+
+    bool TakeInvalid(void);
+    QStringList TakeChanged(void);
+
+    void Fill(ProgramList &list);
+    void Update(ProgramList &list, const QStringList &deleted);
+    void Refresh(const QMap<QString,uint32_t> &inUseMap,
+                 const QMap<QString,bool> &isJobRunning,
+                 const QMap<QString,ProgramInfo*> &recMap);
+
+    void SelectList(int sort, Selection &sel);
+    void SelectChanges(const QString &token, Selection &sel);
+    void SetFilesizes(const Selection &sel);
+
+  private:
+    class Entry
+    {
+      public:
+        Entry(ProgramInfo *p) : pginfo(p), baseflags(0), generation(0) {}
+        ~Entry() { delete pginfo; }
+
+        ProgramInfo *pginfo;
+        uint32_t     baseflags;  ///< without the in use flags
+        QStringList  strlist;    ///< pginfo->ToStringList(), if current,
+                                 ///< but for the pathname and file size
+        uint         generation;
+    };
+
+    void Clear(void);
+    void Insert(ProgramInfo *pginfo);
+    static void Select(const Entry *entry, Selection &sel);
+    void PruneDeleted(void);
+    QString GetToken(void) const;
+
+    static bool comp_start(const Entry *a, const Entry *b);
+
+    QMutex                  m_lock;
+    QHash<QString, Entry*>  m_entries;   ///< by ProgramInfo::MakeUniqueKey()
+    QList<Entry*>           m_order;     ///< by program start time
+    bool                    m_orderDirty;
+    QMap<QString, uint>     m_deleted;   ///< generation of deleted keys
+    uint                    m_epoch;
+    uint                    m_generation;
+    uint                    m_fillGeneration; ///< oldest valid delta token
+
+    /// protects the members set by the event functions
+    QMutex                  m_eventLock;
+    bool                    m_invalid;
+    QSet<QString>           m_changed;
+    QMap<QString, uint64_t> m_filesizes;
+};
+
+#endif
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -0,0 +1,349 @@
+// C++ headers
+#include <algorithm>
+
+// MythTV headers
+#include "recordmatcher.h"
+#include "mythlogging.h"
+#include "mythdate.h"
+#include "mythdb.h"
+
+/// Programs which ended longer ago than this are not matched,
+/// as in Scheduler::UpdateMatches().
+static const int kMatchPastSecs = 480 * 60;
+
+/// Approximates the default MySQL collation used by the '=' comparisons
+/// of the SQL matching: case insensitive, ignoring trailing spaces.
+static QString match_key(const QString &str)
+{
+    QString key = str.toLower();
+    int len = key.size();
+    while (len > 0 && key[len - 1] == ' ')
+        len--;
+    key.truncate(len);
+    return key;
+}
+
+/// Same as the MySQL TO_DAYS() function.
+static int to_days(const QDate &date)
+{
+    return QDate(1970, 1, 1).daysTo(date) + 719528;
+}
+
+/// Same as progdupinit in scheduler.cpp
+static int match_dupinit(RecordingType type, int generic)
+{
+    switch (type)
+    {
+        case kSingleRecord:
+        case kOverrideRecord:
+        case kDontRecord:
+            return 0;
+        case kFindOneRecord:
+        case kFindDailyRecord:
+        case kFindWeeklyRecord:
+            return -1;
+        default:
+            return generic - 1;
+    }
+}
+
+/// Same as progfindid in scheduler.cpp
+static int match_findid(const RecordMatchRule &rule,
+                        const QDateTime &localstart)
+{
+    switch (rule.type)
+    {
+        case kFindOneRecord:
+        case kOverrideRecord:
+            return rule.findid;
+        case kFindDailyRecord:
+        case kFindWeeklyRecord:
+            break;
+        default:
+            return 0;
+    }
+
+    int offset = 0;
+    if (rule.findtime.isValid())
+        offset = rule.findtime.hour() * 3600 + rule.findtime.minute() * 60;
+    int days = to_days(localstart.addSecs(-offset).date());
+
+    if (rule.type == kFindDailyRecord)
+        return days;
+
+    int weeks = days - rule.findday;
+    weeks = (weeks >= 0) ? weeks / 7 : -((6 - weeks) / 7);
+    return weeks * 7 + rule.findday;
+}
+
+/// Returns the seconds since the guide was last loaded completely,
+/// or -1 if it is not loaded.
+int RecordMatcher::GetAge(void) const
+{
+    if (!m_loaded)
+        return -1;
+    return m_loadTime.secsTo(MythDate::current());
+}
+
+void RecordMatcher::Clear(void)
+{
+    m_loaded = false;
+    m_programs.clear();
+    m_titleIndex.clear();
+    m_seriesIndex.clear();
+}
+
+bool RecordMatcher::InWindow(const Program &p, uint sourceid, uint mplexid,
+                             const QDateTime &maxstarttime) const
+{
+    return ((!sourceid || p.sourceid == sourceid) &&
+            (!mplexid  || p.mplexid  == mplexid) &&
+            (!maxstarttime.isValid() || p.starttime <= maxstarttime));
+}
+
+/** \brief Loads the guide data the plain rules are matched against.
+ *
+ *  If the guide is already loaded and a source, multiplex or maximum
+ *  start time is given, only the programs in that window are reloaded.
+ */
+bool RecordMatcher::Load(MSqlQuery &query, uint sourceid, uint mplexid,
+                         const QDateTime &maxstarttime)
+{
+    bool partial = m_loaded &&
+        (sourceid || mplexid || maxstarttime.isValid());
+    QDateTime minendtime = MythDate::current().addSecs(-kMatchPastSecs);
+
+    QString window;
+    if (partial && sourceid)
+        window += " AND channel.sourceid = :SOURCEID";
+    if (partial && mplexid)
+        window += " AND channel.mplexid = :MPLEXID";
+    if (partial && maxstarttime.isValid())
+        window += " AND program.starttime <= :MAXSTARTTIME";
+
+    query.prepare(
+        "SELECT program.chanid, program.starttime, program.endtime, "
+        "       program.title, program.seriesid, program.generic, "
+        "       channel.callsign, channel.sourceid, channel.mplexid "
+        "FROM program INNER JOIN channel "
+        "     ON channel.chanid = program.chanid "
+        "WHERE channel.visible = 1 AND "
+        "      program.manualid = 0 AND "
+        "      program.endtime > :MINENDTIME" + window + " "
+        "ORDER BY program.starttime");
+    query.bindValue(":MINENDTIME", minendtime);
+    if (partial && sourceid)
+        query.bindValue(":SOURCEID", sourceid);
+    if (partial && mplexid)
+        query.bindValue(":MPLEXID", mplexid);
+    if (partial && maxstarttime.isValid())
+        query.bindValue(":MAXSTARTTIME", maxstarttime);
+
+    if (!query.exec())
+    {
+        MythDB::DBError("RecordMatcher::Load", query);
+        Clear();
+        return false;
+    }
+
+    vector<Program> programs;
+    programs.reserve(max((int) m_programs.size(), query.size()));
+
+    if (partial)
+    {
+        vector<Program>::const_iterator it = m_programs.begin();
+        for (; it != m_programs.end(); ++it)
+        {
+            if ((*it).endtime > minendtime &&
+                !InWindow(*it, sourceid, mplexid, maxstarttime))
+            {
+                programs.push_back(*it);
+            }
+        }
+    }
+    uint kept = programs.size();
+
+    while (query.next())
+    {
+        Program p;
+        p.chanid     = query.value(0).toUInt();
+        p.starttime  = MythDate::as_utc(query.value(1).toDateTime());
+        p.endtime    = MythDate::as_utc(query.value(2).toDateTime());
+        p.title      = match_key(query.value(3).toString());
+        p.seriesid   = match_key(query.value(4).toString());
+        p.generic    = query.value(5).toInt();
+        p.callsign   = match_key(query.value(6).toString());
+        p.sourceid   = query.value(7).toUInt();
+        p.mplexid    = query.value(8).toUInt();
+        p.localstart = p.starttime.toLocalTime();
+        programs.push_back(p);
+    }
+
+    LOG(VB_SCHEDULE, LOG_INFO,
+        QString("RecordMatcher: kept %1 and loaded %2 programs")
+        .arg(kept).arg(programs.size() - kept));
+
+    inplace_merge(programs.begin(), programs.begin() + kept, programs.end());
+    m_programs.swap(programs);
+
+    BuildIndexes();
+
+    if (!partial)
+        m_loadTime = MythDate::current();
+    m_loaded = true;
+
+    return true;
+}
+
+void RecordMatcher::BuildIndexes(void)
+{
+    m_titleIndex.clear();
+    m_seriesIndex.clear();
+
+    for (uint i = 0; i < m_programs.size(); i++)
+    {
+        m_titleIndex[m_programs[i].title].push_back(i);
+        if (!m_programs[i].seriesid.isEmpty())
+            m_seriesIndex[m_programs[i].seriesid].push_back(i);
+    }
+}
+
+/// Loads the rules which can be matched in memory: the ones without a
+/// search that use none of the given recording filters.
+bool RecordMatcher::LoadRules(MSqlQuery &query, const QString &table,
+                              uint recordid, uint filters,
+                              QList<RecordMatchRule> &rules)
+{
+    QString qstr = QString(
+        "SELECT recordid, type, title, seriesid, station, "
+        "       startdate, starttime, findid, findday, findtime "
+        "FROM %1 "
+        "WHERE search = :SEARCH AND "
+        "      type  <> :TEMPLATE AND "
+        "      (filter & :FILTERS) = 0").arg(table);
+    if (recordid)
+        qstr += " AND recordid = :RECORDID";
+
+    query.prepare(qstr);
+    query.bindValue(":SEARCH",   kNoSearch);
+    query.bindValue(":TEMPLATE", kTemplateRecord);
+    query.bindValue(":FILTERS",  filters);
+    if (recordid)
+        query.bindValue(":RECORDID", recordid);
+
+    if (!query.exec())
+    {
+        MythDB::DBError("RecordMatcher::LoadRules", query);
+        return false;
+    }
+
+    while (query.next())
+    {
+        RecordMatchRule rule;
+        rule.recordid = query.value(0).toUInt();
+        rule.type     = RecordingType(query.value(1).toInt());
+        rule.title    = match_key(query.value(2).toString());
+        rule.seriesid = match_key(query.value(3).toString());
+        rule.station  = match_key(query.value(4).toString());
+        rule.startts  = QDateTime(query.value(5).toDate(),
+                                  query.value(6).toTime(), Qt::UTC);
+        rule.findid   = query.value(7).toInt();
+        rule.findday  = query.value(8).toInt();
+        rule.findtime = query.value(9).toTime();
+        rules.push_back(rule);
+    }
+
+    return true;
+}
+
+/// The channel and time part of the SQL matching.
+bool RecordMatcher::MatchProgram(const RecordMatchRule &rule,
+                                 const QString &station,
+                                 const QDateTime &localstart,
+                                 const Program &p) const
+{
+    switch (rule.type)
+    {
+        case kAllRecord:
+        case kFindOneRecord:
+        case kFindDailyRecord:
+        case kFindWeeklyRecord:
+            return true;
+        default:
+            break;
+    }
+
+    if (p.callsign != station)
+        return false;
+    if (rule.type == kChannelRecord)
+        return true;
+
+    if (p.localstart.time() != localstart.time())
+        return false;
+    if (rule.type == kTimeslotRecord)
+        return true;
+
+    if (p.localstart.date().dayOfWeek() != localstart.date().dayOfWeek())
+        return false;
+    if (rule.type == kWeekslotRecord)
+        return true;
+
+    return (p.starttime == rule.startts) && (rule.type != kNotRecording);
+}
+
+/// Appends the recordmatch rows of rule in the given window to rows.
+void RecordMatcher::Match(const RecordMatchRule &rule, uint sourceid,
+                          uint mplexid, const QDateTime &maxstarttime,
+                          QList<RecordMatchRow> &rows) const
+{
+    QDateTime minendtime = MythDate::current().addSecs(-kMatchPastSecs);
+    QDateTime localstart = rule.startts.toLocalTime();
+
+    // Title matches first, then the seriesid matches that
+    // have a different title.
+    const QList<uint> *lists[2] = { NULL, NULL };
+    QHash<QString, QList<uint> >::const_iterator it;
+    it = m_titleIndex.find(rule.title);
+    if (it != m_titleIndex.end())
+        lists[0] = &(*it);
+    if (!rule.seriesid.isEmpty())
+    {
+        it = m_seriesIndex.find(rule.seriesid);
+        if (it != m_seriesIndex.end())
+            lists[1] = &(*it);
+    }
+
+    for (uint l = 0; l < 2; l++)
+    {
+        if (!lists[l])
+            continue;
+
+        QList<uint>::const_iterator pit = lists[l]->begin();
+        for (; pit != lists[l]->end(); ++pit)
+        {
+            const Program &p = m_programs[*pit];
+
+            if (maxstarttime.isValid() && p.starttime > maxstarttime)
+                break; // the lists are sorted by start time
+            if (p.endtime <= minendtime ||
+                !InWindow(p, sourceid, mplexid, maxstarttime))
+            {
+                continue;
+            }
+            if (l == 1 && p.title == rule.title)
+                continue;
+            if (!MatchProgram(rule, rule.station, localstart, p))
+                continue;
+
+            RecordMatchRow row;
+            row.recordid        = rule.recordid;
+            row.chanid          = p.chanid;
+            row.starttime       = p.starttime;
+            row.oldrecduplicate = match_dupinit(rule.type, p.generic);
+            row.findid          = match_findid(rule, p.localstart);
+            rows.push_back(row);
+        }
+    }
+}
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -0,0 +1,109 @@
+#ifndef _RECORDMATCHER_H
+#define _RECORDMATCHER_H
+
+// C++ headers
+#include <vector>
+using namespace std;
+
+// Qt headers
+#include <QDateTime>
+#include <QString>
+#include <QHash>
+#include <QList>
+
+// MythTV headers
+#include "recordingtypes.h"
+#include "mythdbcon.h"
+
+/// The fields of a recording rule needed to match it in memory.
+class RecordMatchRule
+{
+  public:
+    uint          recordid;
+    RecordingType type;
+    QString       title;
+    QString       seriesid;
+    QString       station;
+    QDateTime     startts;   ///< UTC
+    int           findid;
+    int           findday;
+    QTime         findtime;
+};
+
+/// One row of the recordmatch table.
+class RecordMatchRow
+{
+  public:
+    uint      recordid;
+    uint      chanid;
+    QDateTime starttime;     ///< UTC
+    int       oldrecduplicate;
+    int       findid;
+};
+
+/** \class RecordMatcher
+ *  \brief Matches the plain (no search, no filter) recording rules
+ *         against an in-memory copy of the program guide.
+ *
+ *  This computes the same recordmatch rows the title and seriesid
+ *  queries in Scheduler::UpdateMatches() do. The guide is indexed by
+ *  title and by seriesid, with each index list sorted by start time,
+ *  and only the part of the guide affected by a MATCH request needs
+ *  to be reloaded.
+ */
+class RecordMatcher
+{
+  public:
+    RecordMatcher() : m_loaded(false) {}
+
+    bool IsLoaded(void) const { return m_loaded; }
+    int  GetAge(void) const;
+    uint GetProgramCount(void) const { return m_programs.size(); }
+
+    bool Load(MSqlQuery &query, uint sourceid, uint mplexid,
+              const QDateTime &maxstarttime);
+    void Clear(void);
+
+    static bool LoadRules(MSqlQuery &query, const QString &table,
+                          uint recordid, uint filters,
+                          QList<RecordMatchRule> &rules);
+
+    void Match(const RecordMatchRule &rule, uint sourceid, uint mplexid,
+               const QDateTime &maxstarttime,
+               QList<RecordMatchRow> &rows) const;
+
+  private:
+    class Program
+    {
+      public:
+        bool operator<(const Program &other) const
+            { return starttime < other.starttime; }
+
+        uint      chanid;
+        uint      sourceid;
+        uint      mplexid;
+        QDateTime starttime; ///< UTC
+        QDateTime endtime;   ///< UTC
+        QDateTime localstart;
+        QString   callsign;  ///< normalized with match_key()
+        QString   title;     ///< normalized with match_key()
+        QString   seriesid;  ///< normalized with match_key()
+        int       generic;
+    };
+
+    bool InWindow(const Program &p, uint sourceid, uint mplexid,
+                  const QDateTime &maxstarttime) const;
+    bool MatchProgram(const RecordMatchRule &rule, const QString &station,
+                      const QDateTime &localstart, const Program &p) const;
+    void BuildIndexes(void);
+
+    bool                    m_loaded;
+    QDateTime               m_loadTime;
+    vector<Program>         m_programs;    ///< sorted by start time
+    QHash<QString, QList<uint> > m_titleIndex;
+    QHash<QString, QList<uint> > m_seriesIndex;
+};
+
+#endif
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
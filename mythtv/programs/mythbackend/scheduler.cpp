@@ -25,6 +25,10 @@ using namespace std;
 #include <QMutex>
 #include <QFile>
 #include <QMap>
+#include <QHash>
+#include <QThread>
+#include <QRunnable>
+#include <QAtomicInt>
 
 #include "mythmiscutil.h"
 #include "mythsystem.h"
@@ -46,6 +50,8 @@ using namespace std;
 #include "mythdb.h"
 #include "mythsystemevent.h"
 #include "mythlogging.h"
+#include "mythtimer.h"
+#include "mthreadpool.h"
 
 #define LOC QString("Scheduler: ")
 #define LOC_WARN QString("Scheduler, Warning: ")
@@ -60,6 +66,7 @@ Scheduler::Scheduler(bool runthread, QMap<int, EncoderLink *> *tvList,
     priorityTable("powerpriority"),
     schedLock(),
     m_queueLock(),
+    m_placementPool(NULL),
     reclist_changed(false),
     specsched(master_sched),
     schedMoveHigher(false),
@@ -135,6 +142,9 @@ Scheduler::~Scheduler()
         worklist.pop_back();
     }
 
+    delete m_placementPool;
+    m_placementPool = NULL;
+
     locker.unlock();
     wait();
 }
@@ -358,6 +368,69 @@ static bool comp_priority(RecordingInfo *a, RecordingInfo *b)
     return a->GetRecordingRuleID() < b->GetRecordingRuleID();
 }
 
+/// Orders indexes into a RecList by the start time of the showings.
+class comp_index_start
+{
+  public:
+    comp_index_start(const RecList &list) : m_list(list) {}
+    bool operator()(uint a, uint b) const
+    {
+        return (m_list[a]->GetRecordingStartTime() <
+                m_list[b]->GetRecordingStartTime());
+    }
+  private:
+    const RecList &m_list;
+};
+
+static bool comp_placement_size(const SchedPlacement *a,
+                                const SchedPlacement *b)
+{
+    return a->conflictlist.size() > b->conflictlist.size();
+}
+
+static uint uf_find(vector<uint> &parent, uint i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+/// Joins the sets of a and b, keeping the lowest index as the root.
+static void uf_union(vector<uint> &parent, uint a, uint b)
+{
+    a = uf_find(parent, a);
+    b = uf_find(parent, b);
+    if (a < b)
+        parent[b] = a;
+    else if (b < a)
+        parent[a] = b;
+}
+
+/// Places the independent parts of a schedule, see SchedNewRecords().
+class SchedPlacementRunner : public QRunnable
+{
+  public:
+    SchedPlacementRunner(Scheduler *sched, QList<SchedPlacement*> &parts,
+                         QAtomicInt &next, int openEnd) :
+        m_sched(sched), m_parts(parts), m_next(next), m_openEnd(openEnd) {}
+
+    virtual void run(void)
+    {
+        int i;
+        while ((i = m_next.fetchAndAddOrdered(1)) < m_parts.size())
+            m_sched->PlaceRecordings(*m_parts[i], m_openEnd);
+    }
+
+  private:
+    Scheduler              *m_sched;
+    QList<SchedPlacement*> &m_parts;
+    QAtomicInt             &m_next;
+    int                     m_openEnd;
+};
+
 bool Scheduler::FillRecordList(void)
 {
     schedMoveHigher = (bool)gCoreContext->GetNumSetting("SchedMoveHigher");
@@ -918,10 +991,12 @@ void Scheduler::PruneOverlaps(void)
     erase_nulls(worklist);
 }
 
-void Scheduler::BuildListMaps(void)
+static void build_list_maps(SchedPlacement &pl, const RecList &list)
 {
-    RecIter i = worklist.begin();
-    for ( ; i != worklist.end(); ++i)
+    pl.worklist = list;
+
+    RecConstIter i = list.begin();
+    for ( ; i != list.end(); ++i)
     {
         RecordingInfo *p = *i;
         if (p->GetRecordingStatus() == rsRecording ||
@@ -929,35 +1004,37 @@ void Scheduler::BuildListMaps(void)
             p->GetRecordingStatus() == rsWillRecord ||
             p->GetRecordingStatus() == rsUnknown)
         {
-            conflictlist.push_back(p);
-            titlelistmap[p->GetTitle().toLower()].push_back(p);
-            recordidlistmap[p->GetRecordingRuleID()].push_back(p);
+            pl.conflictlist.push_back(p);
+            pl.titlelistmap[p->GetTitle().toLower()].push_back(p);
+            pl.recordidlistmap[p->GetRecordingRuleID()].push_back(p);
         }
     }
 }
 
+void Scheduler::BuildListMaps(void)
+{
+    build_list_maps(m_placement, worklist);
+}
+
 void Scheduler::ClearListMaps(void)
 {
-    conflictlist.clear();
-    titlelistmap.clear();
-    recordidlistmap.clear();
-    cache_is_same_program.clear();
+    m_placement = SchedPlacement();
 }
 
-bool Scheduler::IsSameProgram(
+bool Scheduler::IsSameProgram(SchedPlacement &pl,
     const RecordingInfo *a, const RecordingInfo *b) const
 {
     IsSameKey X(a,b);
-    IsSameCacheType::const_iterator it = cache_is_same_program.find(X);
-    if (it != cache_is_same_program.end())
+    IsSameCacheType::const_iterator it = pl.cache_is_same_program.find(X);
+    if (it != pl.cache_is_same_program.end())
         return *it;
 
     IsSameKey Y(b,a);
-    it = cache_is_same_program.find(Y);
-    if (it != cache_is_same_program.end())
+    it = pl.cache_is_same_program.find(Y);
+    if (it != pl.cache_is_same_program.end())
         return *it;
 
-    return cache_is_same_program[X] = a->IsSameProgram(*b);
+    return pl.cache_is_same_program[X] = a->IsSameProgram(*b);
 }
 
 bool Scheduler::FindNextConflict(
@@ -1043,38 +1120,40 @@ bool Scheduler::FindNextConflict(
 }
 
 const RecordingInfo *Scheduler::FindConflict(
+    const SchedPlacement       &pl,
     const RecordingInfo        *p,
     int openend) const
 {
-    RecConstIter k = conflictlist.begin();
-    if (FindNextConflict(conflictlist, p, k, openend))
+    RecConstIter k = pl.conflictlist.begin();
+    if (FindNextConflict(pl.conflictlist, p, k, openend))
         return *k;
 
     return NULL;
 }
 
-void Scheduler::MarkOtherShowings(RecordingInfo *p)
+void Scheduler::MarkOtherShowings(SchedPlacement &pl, RecordingInfo *p)
 {
     RecList *showinglist;
 
-    showinglist = &titlelistmap[p->GetTitle().toLower()];
-    MarkShowingsList(*showinglist, p);
+    showinglist = &pl.titlelistmap[p->GetTitle().toLower()];
+    MarkShowingsList(pl, *showinglist, p);
 
     if (p->GetRecordingRuleType() == kFindOneRecord ||
         p->GetRecordingRuleType() == kFindDailyRecord ||
         p->GetRecordingRuleType() == kFindWeeklyRecord)
     {
-        showinglist = &recordidlistmap[p->GetRecordingRuleID()];
-        MarkShowingsList(*showinglist, p);
+        showinglist = &pl.recordidlistmap[p->GetRecordingRuleID()];
+        MarkShowingsList(pl, *showinglist, p);
     }
     else if (p->GetRecordingRuleType() == kOverrideRecord && p->GetFindID())
     {
-        showinglist = &recordidlistmap[p->GetParentRecordingRuleID()];
-        MarkShowingsList(*showinglist, p);
+        showinglist = &pl.recordidlistmap[p->GetParentRecordingRuleID()];
+        MarkShowingsList(pl, *showinglist, p);
     }
 }
 
-void Scheduler::MarkShowingsList(RecList &showinglist, RecordingInfo *p)
+void Scheduler::MarkShowingsList(SchedPlacement &pl, RecList &showinglist,
+                                 RecordingInfo *p)
 {
     RecIter i = showinglist.begin();
     for ( ; i != showinglist.end(); ++i)
@@ -1091,7 +1170,7 @@ void Scheduler::MarkShowingsList(RecList &showinglist, RecordingInfo *p)
             q->SetRecordingStatus(rsLaterShowing);
         else if (q->GetRecordingRuleType() != kSingleRecord &&
                  q->GetRecordingRuleType() != kOverrideRecord &&
-                 IsSameProgram(q,p))
+                 IsSameProgram(pl,q,p))
         {
             if (q->GetRecordingStartTime() < p->GetRecordingStartTime())
                 q->SetRecordingStatus(rsLaterShowing);
@@ -1101,28 +1180,28 @@ void Scheduler::MarkShowingsList(RecList &showinglist, RecordingInfo *p)
     }
 }
 
-void Scheduler::BackupRecStatus(void)
+void Scheduler::BackupRecStatus(SchedPlacement &pl)
 {
-    RecIter i = worklist.begin();
-    for ( ; i != worklist.end(); ++i)
+    RecIter i = pl.worklist.begin();
+    for ( ; i != pl.worklist.end(); ++i)
     {
         RecordingInfo *p = *i;
         p->savedrecstatus = p->GetRecordingStatus();
     }
 }
 
-void Scheduler::RestoreRecStatus(void)
+void Scheduler::RestoreRecStatus(SchedPlacement &pl)
 {
-    RecIter i = worklist.begin();
-    for ( ; i != worklist.end(); ++i)
+    RecIter i = pl.worklist.begin();
+    for ( ; i != pl.worklist.end(); ++i)
     {
         RecordingInfo *p = *i;
         p->SetRecordingStatus(p->savedrecstatus);
     }
 }
 
-bool Scheduler::TryAnotherShowing(RecordingInfo *p, bool samePriority,
-                                   bool preserveLive)
+bool Scheduler::TryAnotherShowing(SchedPlacement &pl, RecordingInfo *p,
+                                  bool samePriority, bool preserveLive)
 {
     PrintRec(p, "     >");
 
@@ -1130,7 +1209,7 @@ bool Scheduler::TryAnotherShowing(RecordingInfo *p, bool samePriority,
         p->GetRecordingStatus() == rsTuning)
         return false;
 
-    RecList *showinglist = &recordidlistmap[p->GetRecordingRuleID()];
+    RecList *showinglist = &pl.recordidlistmap[p->GetRecordingRuleID()];
 
     RecStatusType oldstatus = p->GetRecordingStatus();
     p->SetRecordingStatus(rsLaterShowing);
@@ -1161,7 +1240,7 @@ bool Scheduler::TryAnotherShowing(RecordingInfo *p, bool samePriority,
 
         if (!p->IsSameTimeslot(*q))
         {
-            if (!IsSameProgram(p,q))
+            if (!IsSameProgram(pl,p,q))
                 continue;
             if ((p->GetRecordingRuleType() == kSingleRecord ||
                  p->GetRecordingRuleType() == kOverrideRecord))
@@ -1188,15 +1267,15 @@ bool Scheduler::TryAnotherShowing(RecordingInfo *p, bool samePriority,
 
             // It is pointless to preempt another livetv session.
             // (the retrylist contains dummy livetv pginfo's)
-            RecConstIter k = retrylist.begin();
-            if (FindNextConflict(retrylist, q, k))
+            RecConstIter k = pl.retrylist.begin();
+            if (FindNextConflict(pl.retrylist, q, k))
             {
                 PrintRec(*k, "       L!");
                 continue;
             }
         }
 
-        const RecordingInfo *conflict = FindConflict(q);
+        const RecordingInfo *conflict = FindConflict(pl, q);
         if (conflict)
         {
             PrintRec(conflict, "        !");
@@ -1235,7 +1314,7 @@ bool Scheduler::TryAnotherShowing(RecordingInfo *p, bool samePriority,
         }
 
         q->SetRecordingStatus(rsWillRecord);
-        MarkOtherShowings(q);
+        MarkOtherShowings(pl, q);
         PrintRec(p, "     -");
         PrintRec(q, "     +");
         return true;
@@ -1271,36 +1350,214 @@ void Scheduler::SchedNewRecords(void)
 
     int openEnd = gCoreContext->GetNumSetting("SchedOpenEnd", 0);
 
-    RecIter i = worklist.begin();
-    while (i != worklist.end())
+    // The debugging output only makes sense in order, so the
+    // parallel placement is only used without it.
+    int threads = QThread::idealThreadCount();
+    if (threads > 1 &&
+        m_placement.conflictlist.size() >= 256 &&
+        !debugConflicts &&
+        !VERBOSE_LEVEL_CHECK(VB_SCHEDULE, LOG_DEBUG) &&
+        gCoreContext->GetNumSetting("SchedParallelPlacement", 1))
+    {
+        QList<SchedPlacement*> parts;
+        SplitPlacement(parts);
+
+        if (parts.size() > 1)
+        {
+            MythTimer timer;
+            timer.start();
+
+            if (!m_placementPool)
+                m_placementPool = new MThreadPool("SchedPlacement");
+            m_placementPool->setMaxThreadCount(threads);
+
+            QAtomicInt next(0);
+            threads = min(threads, parts.size());
+            for (int t = 0; t < threads; t++)
+            {
+                m_placementPool->start(
+                    new SchedPlacementRunner(this, parts, next, openEnd),
+                    "SchedPlacement");
+            }
+            m_placementPool->waitForDone();
+
+            LOG(VB_SCHEDULE, LOG_INFO,
+                QString("Placed %1 showings in %2 independent parts "
+                        "(largest %3) on %4 threads in %5 ms")
+                .arg(m_placement.conflictlist.size()).arg(parts.size())
+                .arg(parts[0]->conflictlist.size()).arg(threads)
+                .arg(timer.elapsed()));
+
+            // Merge in the same order the serial placement would.
+            QList<SchedPlacement*>::iterator it = parts.begin();
+            for (; it != parts.end(); ++it)
+            {
+                AddPending(**it);
+                delete *it;
+            }
+            return;
+        }
+
+        while (!parts.empty())
+            delete parts.takeFirst();
+    }
+
+    PlaceRecordings(m_placement, openEnd);
+    AddPending(m_placement);
+}
+
+/** \brief Splits the placement into parts which do not affect each other.
+ *
+ *  Two showings are in the same part if they have the same title, rule
+ *  or parent rule, since placing one marks the others, or if they are
+ *  on the same card or input group and overlap or touch in time, since
+ *  they may then conflict. Each part keeps the priority order of the
+ *  worklist, so placing them separately gives the same result as placing
+ *  them together. The parts are returned largest first.
+ */
+void Scheduler::SplitPlacement(QList<SchedPlacement*> &parts)
+{
+    const RecList &items = m_placement.conflictlist;
+    uint count = items.size();
+    vector<uint> parent(count);
+    for (uint i = 0; i < count; i++)
+        parent[i] = i;
+
+    QHash<QString, uint> firsttitle;
+    QHash<uint, uint> firstrule;
+    for (uint i = 0; i < count; i++)
+    {
+        const RecordingInfo *p = items[i];
+
+        QString title = p->GetTitle().toLower();
+        QHash<QString, uint>::const_iterator tit = firsttitle.find(title);
+        if (tit == firsttitle.end())
+            firsttitle[title] = i;
+        else
+            uf_union(parent, *tit, i);
+
+        QHash<uint, uint>::const_iterator rit =
+            firstrule.find(p->GetRecordingRuleID());
+        if (rit == firstrule.end())
+            firstrule[p->GetRecordingRuleID()] = i;
+        else
+            uf_union(parent, *rit, i);
+    }
+
+    for (uint i = 0; i < count; i++)
+    {
+        const RecordingInfo *p = items[i];
+        if (p->GetRecordingRuleType() != kOverrideRecord || !p->GetFindID())
+            continue;
+        QHash<uint, uint>::const_iterator rit =
+            firstrule.find(p->GetParentRecordingRuleID());
+        if (rit != firstrule.end())
+            uf_union(parent, *rit, i);
+    }
+
+    // Sweep through the showings by start time, keeping the ones which
+    // have not ended yet.
+    vector<uint> bystart(count);
+    for (uint i = 0; i < count; i++)
+        bystart[i] = i;
+    stable_sort(bystart.begin(), bystart.end(), comp_index_start(items));
+
+    QHash<quint64, bool> shared;
+    list<uint> active;
+    for (uint n = 0; n < count; n++)
+    {
+        uint i = bystart[n];
+        const RecordingInfo *p = items[i];
+
+        list<uint>::iterator ait = active.begin();
+        while (ait != active.end())
+        {
+            const RecordingInfo *q = items[*ait];
+            if (q->GetRecordingEndTime() < p->GetRecordingStartTime())
+            {
+                ait = active.erase(ait);
+                continue;
+            }
+
+            if (uf_find(parent, *ait) != uf_find(parent, i))
+            {
+                bool conflicts = (p->GetCardID() == q->GetCardID());
+                if (!conflicts)
+                {
+                    quint64 key = (quint64(p->GetInputID()) << 32) |
+                        q->GetInputID();
+                    QHash<quint64, bool>::const_iterator sit =
+                        shared.find(key);
+                    if (sit == shared.end())
+                    {
+                        sit = shared.insert(
+                            key, igrp.GetSharedInputGroup(
+                                p->GetInputID(), q->GetInputID()));
+                    }
+                    conflicts = *sit;
+                }
+                if (conflicts)
+                    uf_union(parent, *ait, i);
+            }
+            ++ait;
+        }
+
+        active.push_back(i);
+    }
+
+    QMap<uint, RecList> lists;
+    for (uint i = 0; i < count; i++)
+        lists[uf_find(parent, i)].push_back(items[i]);
+
+    QMap<uint, RecList>::const_iterator lit = lists.begin();
+    for (; lit != lists.end(); ++lit)
+    {
+        SchedPlacement *pl = new SchedPlacement();
+        build_list_maps(*pl, *lit);
+        parts.push_back(pl);
+    }
+
+    stable_sort(parts.begin(), parts.end(), comp_placement_size);
+}
+
+/// Adds the showings starting soon found by PlaceRecordings().
+void Scheduler::AddPending(const SchedPlacement &pl)
+{
+    QStringList::const_iterator it = pl.pending.begin();
+    for (; it != pl.pending.end(); ++it)
+    {
+        if (!recPendingList.contains(*it))
+            recPendingList[*it] = false;
+
+        livetvTime = (livetvTime < schedTime) ? schedTime : livetvTime;
+    }
+}
+
+void Scheduler::PlaceRecordings(SchedPlacement &pl, int openEnd)
+{
+    RecIter i = pl.worklist.begin();
+    while (i != pl.worklist.end())
     {
         RecordingInfo *p = *i;
         if (p->GetRecordingStatus() == rsRecording ||
             p->GetRecordingStatus() == rsTuning)
-            MarkOtherShowings(p);
+            MarkOtherShowings(pl, p);
         else if (p->GetRecordingStatus() == rsUnknown)
         {
-            const RecordingInfo *conflict = FindConflict(p, openEnd);
+            const RecordingInfo *conflict = FindConflict(pl, p, openEnd);
             if (!conflict)
             {
                 p->SetRecordingStatus(rsWillRecord);
 
                 if (p->GetRecordingStartTime() < schedTime.addSecs(90))
-                {
-                    QString id = p->MakeUniqueSchedulerKey();
-                    if (!recPendingList.contains(id))
-                        recPendingList[id] = false;
-
-                    livetvTime = (livetvTime < schedTime) ?
-                        schedTime : livetvTime;
-                }
+                    pl.pending.push_back(p->MakeUniqueSchedulerKey());
 
-                MarkOtherShowings(p);
+                MarkOtherShowings(pl, p);
                 PrintRec(p, "  +");
             }
             else
             {
-                retrylist.push_front(p);
+                pl.retrylist.push_front(p);
                 PrintRec(p, "  #");
                 PrintRec(conflict, "     !");
             }
@@ -1308,18 +1565,19 @@ void Scheduler::SchedNewRecords(void)
 
         int lastpri = p->GetRecordingPriority();
         ++i;
-        if (i == worklist.end() || lastpri != (*i)->GetRecordingPriority())
+        if (i == pl.worklist.end() ||
+            lastpri != (*i)->GetRecordingPriority())
         {
-            MoveHigherRecords();
-            retrylist.clear();
+            MoveHigherRecords(pl);
+            pl.retrylist.clear();
         }
     }
 }
 
-void Scheduler::MoveHigherRecords(bool move_this)
+void Scheduler::MoveHigherRecords(SchedPlacement &pl, bool move_this)
 {
-    RecIter i = retrylist.begin();
-    for ( ; move_this && i != retrylist.end(); ++i)
+    RecIter i = pl.retrylist.begin();
+    for ( ; move_this && i != pl.retrylist.end(); ++i)
     {
         RecordingInfo *p = *i;
         if (p->GetRecordingStatus() != rsUnknown)
@@ -1327,16 +1585,16 @@ void Scheduler::MoveHigherRecords(bool move_this)
 
         PrintRec(p, "  /");
 
-        BackupRecStatus();
+        BackupRecStatus(pl);
         p->SetRecordingStatus(rsWillRecord);
-        MarkOtherShowings(p);
+        MarkOtherShowings(pl, p);
 
-        RecConstIter k = conflictlist.begin();
-        for ( ; FindNextConflict(conflictlist, p, k); ++k)
+        RecConstIter k = pl.conflictlist.begin();
+        for ( ; FindNextConflict(pl.conflictlist, p, k); ++k)
         {
-            if (!TryAnotherShowing(*k, true))
+            if (!TryAnotherShowing(pl, *k, true))
             {
-                RestoreRecStatus();
+                RestoreRecStatus(pl);
                 break;
             }
         }
@@ -1345,8 +1603,8 @@ void Scheduler::MoveHigherRecords(bool move_this)
             PrintRec(p, "  +");
     }
 
-    i = retrylist.begin();
-    for ( ; i != retrylist.end(); ++i)
+    i = pl.retrylist.begin();
+    for ( ; i != pl.retrylist.end(); ++i)
     {
         RecordingInfo *p = *i;
         if (p->GetRecordingStatus() != rsUnknown)
@@ -1354,22 +1612,22 @@ void Scheduler::MoveHigherRecords(bool move_this)
 
         PrintRec(p, "  ?");
 
-        if (move_this && TryAnotherShowing(p, false))
+        if (move_this && TryAnotherShowing(pl, p, false))
             continue;
 
-        BackupRecStatus();
+        BackupRecStatus(pl);
         p->SetRecordingStatus(rsWillRecord);
         if (move_this)
-            MarkOtherShowings(p);
+            MarkOtherShowings(pl, p);
 
-        RecConstIter k = conflictlist.begin();
-        for ( ; FindNextConflict(conflictlist, p, k); ++k)
+        RecConstIter k = pl.conflictlist.begin();
+        for ( ; FindNextConflict(pl.conflictlist, p, k); ++k)
         {
             if ((p->GetRecordingPriority() < (*k)->GetRecordingPriority() &&
                  !schedMoveHigher && move_this) ||
-                !TryAnotherShowing(*k, false, !move_this))
+                !TryAnotherShowing(pl, *k, false, !move_this))
             {
-                RestoreRecStatus();
+                RestoreRecStatus(pl);
                 break;
             }
         }
@@ -1769,6 +2027,9 @@ void Scheduler::run(void)
 
     dbConn = MSqlQuery::SchedCon();
 
+    // The scheduling queries nest, have their connections open up front
+    GetMythDB()->GetDBManager()->PrewarmConnections(2);
+
     // Notify constructor that we're actually running
     {
         QMutexLocker lockit(&schedLock);
@@ -3314,9 +3575,17 @@ void Scheduler::UpdateManuals(uint recordid)
     }
 }
 
+/** \brief Builds the matching queries of the search rules and, depending
+ *         on plainfilters, of the plain title and seriesid rules.
+ *
+ *  If plainfilters is negative all plain rules are matched, if it is 0
+ *  none are, and otherwise only those using one of the filters in the
+ *  plainfilters mask. The others are matched by the RecordMatcher.
+ */
 void Scheduler::BuildNewRecordsQueries(uint recordid, QStringList &from,
                                        QStringList &where,
-                                       MSqlBindings &bindings)
+                                       MSqlBindings &bindings,
+                                       int plainfilters)
 {
     MSqlQuery result(dbConn);
     QString query;
@@ -3417,36 +3686,52 @@ void Scheduler::BuildNewRecordsQueries(uint recordid, QStringList &from,
         count++;
     }
 
-    if (recordid == 0 || from.count() == 0)
-    {
-        QString recidmatch = "";
-        if (recordid != 0)
-            recidmatch = "RECTABLE.recordid = :NRRECORDID AND ";
-        QString s1 = recidmatch +
-            "RECTABLE.type <> :NRTEMPLATE AND "
-            "RECTABLE.search = :NRST AND "
-            "program.manualid = 0 AND "
-            "program.title = RECTABLE.title ";
-        s1.replace("RECTABLE", recordTable);
-        QString s2 = recidmatch +
-            "RECTABLE.type <> :NRTEMPLATE AND "
-            "RECTABLE.search = :NRST AND "
-            "program.manualid = 0 AND "
-            "program.seriesid <> '' AND "
-            "program.seriesid = RECTABLE.seriesid ";
-        s2.replace("RECTABLE", recordTable);
-
-        from << "";
-        where << s1;
-        from << "";
-        where << s2;
-        bindings[":NRTEMPLATE"] = kTemplateRecord;
-        bindings[":NRST"] = kNoSearch;
-        if (recordid != 0)
-            bindings[":NRRECORDID"] = recordid;
+    if (plainfilters != 0 && (recordid == 0 || from.count() == 0))
+    {
+        QString filtermatch;
+        if (plainfilters > 0)
+        {
+            filtermatch = QString("(RECTABLE.filter & %1) <> 0 AND ")
+                .arg(plainfilters);
+        }
+        BuildPlainRecordsQueries(recordid, filtermatch, from, where,
+                                 bindings);
     }
 }
 
+void Scheduler::BuildPlainRecordsQueries(uint recordid,
+                                         const QString &filtermatch,
+                                         QStringList &from,
+                                         QStringList &where,
+                                         MSqlBindings &bindings)
+{
+    QString recidmatch = "";
+    if (recordid != 0)
+        recidmatch = "RECTABLE.recordid = :NRRECORDID AND ";
+    QString s1 = recidmatch + filtermatch +
+        "RECTABLE.type <> :NRTEMPLATE AND "
+        "RECTABLE.search = :NRST AND "
+        "program.manualid = 0 AND "
+        "program.title = RECTABLE.title ";
+    s1.replace("RECTABLE", recordTable);
+    QString s2 = recidmatch + filtermatch +
+        "RECTABLE.type <> :NRTEMPLATE AND "
+        "RECTABLE.search = :NRST AND "
+        "program.manualid = 0 AND "
+        "program.seriesid <> '' AND "
+        "program.seriesid = RECTABLE.seriesid ";
+    s2.replace("RECTABLE", recordTable);
+
+    from << "";
+    where << s1;
+    from << "";
+    where << s2;
+    bindings[":NRTEMPLATE"] = kTemplateRecord;
+    bindings[":NRST"] = kNoSearch;
+    if (recordid != 0)
+        bindings[":NRRECORDID"] = recordid;
+}
+
 static QString progdupinit = QString(
 "(CASE "
 "  WHEN RECTABLE.type IN (%1, %2, %3) THEN  0 "
@@ -3476,6 +3761,58 @@ static QString progfindid = QString(
         .arg(kFindWeeklyRecord)
         .arg(kOverrideRecord);
 
+/// The SELECT part of the queries which fill the recordmatch table.
+static QString build_match_select(const QString &from, const QString &where,
+                                  const QString &filterClause)
+{
+    return QString(
+"SELECT RECTABLE.recordid, program.chanid, program.starttime, "
+" IF(search = %1, RECTABLE.recordid, 0), ").arg(kManualSearch) +
+        progdupinit + ", " + progfindid + QString(
+"FROM (RECTABLE, program INNER JOIN channel "
+"      ON channel.chanid = program.chanid) ") + from + QString(
+" WHERE ") + where +
+        QString(" AND channel.visible = 1 ") +
+        filterClause + QString(" AND "
+
+"((RECTABLE.type = %1 " // allrecord
+"OR RECTABLE.type = %2 " // findonerecord
+"OR RECTABLE.type = %3 " // finddailyrecord
+"OR RECTABLE.type = %4) " // findweeklyrecord
+" OR "
+" ((RECTABLE.station = channel.callsign) " // channel matches
+"  AND "
+"  ((RECTABLE.type = %5) " // channelrecord
+"   OR"
+"   (( TIME(CONVERT_TZ(ADDTIME(RECTABLE.startdate, RECTABLE.starttime), 'UTC', 'SYSTEM')) = TIME(CONVERT_TZ(program.starttime, 'UTC', 'SYSTEM'))) " // timeslot matches
+"    AND "
+"    ((RECTABLE.type = %6) " // timeslotrecord
+"     OR"
+"     ((DAYOFWEEK(CONVERT_TZ(ADDTIME(RECTABLE.startdate, RECTABLE.starttime), 'UTC', 'SYSTEM')) = DAYOFWEEK(CONVERT_TZ(program.starttime, 'UTC', 'SYSTEM')) "
+"      AND "
+"      ((RECTABLE.type = %7) " // weekslotrecord
+"       OR"
+"       ((ADDTIME(RECTABLE.startdate, RECTABLE.starttime) = program.starttime) " // date/time matches
+"        AND (RECTABLE.type <> %8)" // single,override,don't,etc.
+"        )"
+"       )"
+"      )"
+"     )"
+"    )"
+"   )"
+"  )"
+" )"
+") ")
+        .arg(kAllRecord)
+        .arg(kFindOneRecord)
+        .arg(kFindDailyRecord)
+        .arg(kFindWeeklyRecord)
+        .arg(kChannelRecord)
+        .arg(kTimeslotRecord)
+        .arg(kWeekslotRecord)
+        .arg(kNotRecording);
+}
+
 void Scheduler::UpdateMatches(uint recordid, uint sourceid, uint mplexid,
                               const QDateTime maxstarttime)
 {
@@ -3534,10 +3871,12 @@ void Scheduler::UpdateMatches(uint recordid, uint sourceid, uint mplexid,
         MythDB::DBError("UpdateMatches2", query);
         return;
     }
+    uint filters = 0;
     while (query.next())
     {
         filterClause += QString(" AND (((RECTABLE.filter & %1) = 0) OR (%2))")
             .arg(1 << query.value(0).toInt()).arg(query.value(1).toString());
+        filters |= 1 << query.value(0).toInt();
     }
 
     // Make sure all FindOne rules have a valid findid before scheduling.
@@ -3562,10 +3901,24 @@ void Scheduler::UpdateMatches(uint recordid, uint sourceid, uint mplexid,
             MythDB::DBError("UpdateMatches4", query);
     }
 
+    // The plain rules which use none of the filters are matched in memory
+    // by the master scheduler, the rest is left to the database.
+    bool inmemory = doRun && !specsched && recordTable == "record" &&
+        gCoreContext->GetNumSetting("SchedInMemoryMatch", 0);
+    if (inmemory)
+    {
+        QList<RecordMatchRow> rows;
+        inmemory = UpdateMatchesInMemory(recordid, sourceid, mplexid,
+                                         maxstarttime, filters, rows);
+        if (inmemory && gCoreContext->GetNumSetting("SchedVerifyMatches", 0))
+            VerifyMatches(recordid, filterClause, bindings, filters, rows);
+    }
+
     int clause;
     QStringList fromclauses, whereclauses;
 
-    BuildNewRecordsQueries(recordid, fromclauses, whereclauses, bindings);
+    BuildNewRecordsQueries(recordid, fromclauses, whereclauses, bindings,
+                           inmemory ? (int) filters : -1);
 
     if (VERBOSE_LEVEL_CHECK(VB_SCHEDULE, LOG_INFO))
     {
@@ -3581,52 +3934,9 @@ void Scheduler::UpdateMatches(uint recordid, uint sourceid, uint mplexid,
     {
         QString query = QString(
 "REPLACE INTO recordmatch (recordid, chanid, starttime, manualid, "
-"                          oldrecduplicate, findid) "
-"SELECT RECTABLE.recordid, program.chanid, program.starttime, "
-" IF(search = %1, RECTABLE.recordid, 0), ").arg(kManualSearch) +
-            progdupinit + ", " + progfindid + QString(
-"FROM (RECTABLE, program INNER JOIN channel "
-"      ON channel.chanid = program.chanid) ") + fromclauses[clause] + QString(
-" WHERE ") + whereclauses[clause] +
-    QString(" AND channel.visible = 1 ") +
-    filterClause + QString(" AND "
-
-"((RECTABLE.type = %1 " // allrecord
-"OR RECTABLE.type = %2 " // findonerecord
-"OR RECTABLE.type = %3 " // finddailyrecord
-"OR RECTABLE.type = %4) " // findweeklyrecord
-" OR "
-" ((RECTABLE.station = channel.callsign) " // channel matches
-"  AND "
-"  ((RECTABLE.type = %5) " // channelrecord
-"   OR"
-"   (( TIME(CONVERT_TZ(ADDTIME(RECTABLE.startdate, RECTABLE.starttime), 'UTC', 'SYSTEM')) = TIME(CONVERT_TZ(program.starttime, 'UTC', 'SYSTEM'))) " // timeslot matches
-"    AND "
-"    ((RECTABLE.type = %6) " // timeslotrecord
-"     OR"
-"     ((DAYOFWEEK(CONVERT_TZ(ADDTIME(RECTABLE.startdate, RECTABLE.starttime), 'UTC', 'SYSTEM')) = DAYOFWEEK(CONVERT_TZ(program.starttime, 'UTC', 'SYSTEM')) "
-"      AND "
-"      ((RECTABLE.type = %7) " // weekslotrecord
-"       OR"
-"       ((ADDTIME(RECTABLE.startdate, RECTABLE.starttime) = program.starttime) " // date/time matches
-"        AND (RECTABLE.type <> %8)" // single,override,don't,etc.
-"        )"
-"       )"
-"      )"
-"     )"
-"    )"
-"   )"
-"  )"
-" )"
-") ")
-            .arg(kAllRecord)
-            .arg(kFindOneRecord)
-            .arg(kFindDailyRecord)
-            .arg(kFindWeeklyRecord)
-            .arg(kChannelRecord)
-            .arg(kTimeslotRecord)
-            .arg(kWeekslotRecord)
-            .arg(kNotRecording);
+"                          oldrecduplicate, findid) ") +
+            build_match_select(fromclauses[clause], whereclauses[clause],
+                               filterClause);
 
         query.replace("RECTABLE", recordTable);
 
@@ -3662,6 +3972,184 @@ void Scheduler::UpdateMatches(uint recordid, uint sourceid, uint mplexid,
     LOG(VB_SCHEDULE, LOG_INFO, " +-- Done.");
 }
 
+/** \brief Matches the plain rules using none of the given filters with
+ *         the RecordMatcher and writes the results to recordmatch.
+ *
+ *  The guide data is reloaded completely for a MATCH of everything, or
+ *  when the copy is older than an hour, and otherwise only for the
+ *  source, multiplex and start time window of the request.
+ *
+ *  \return false if the guide or the rules could not be loaded, in which
+ *          case the caller falls back to matching in the database.
+ */
+bool Scheduler::UpdateMatchesInMemory(uint recordid, uint sourceid,
+                                      uint mplexid,
+                                      const QDateTime &maxstarttime,
+                                      uint filters,
+                                      QList<RecordMatchRow> &rows)
+{
+    MSqlQuery query(dbConn);
+    MythTimer timer;
+    timer.start();
+
+    bool window = sourceid || mplexid || maxstarttime.isValid();
+    int age = m_matcher.GetAge();
+    bool ok = true;
+
+    if (age < 0 || age > 3600 || (!recordid && !window))
+        ok = m_matcher.Load(query, 0, 0, QDateTime());
+    else if (window)
+        ok = m_matcher.Load(query, sourceid, mplexid, maxstarttime);
+    if (!ok)
+        return false;
+
+    int loadtime = timer.restart();
+
+    QList<RecordMatchRule> rules;
+    if (!RecordMatcher::LoadRules(query, recordTable, recordid, filters,
+                                  rules))
+    {
+        return false;
+    }
+
+    int rulestime = timer.restart();
+
+    QList<RecordMatchRule>::const_iterator rit = rules.begin();
+    for (; rit != rules.end(); ++rit)
+        m_matcher.Match(*rit, sourceid, mplexid, maxstarttime, rows);
+
+    int matchtime = timer.restart();
+
+    // Write the matches in batches of multi-row statements.
+    static const int kRowsPerQuery = 500;
+    for (int i = 0; i < rows.size(); i += kRowsPerQuery)
+    {
+        QStringList values;
+        for (int j = i; j < rows.size() && j < i + kRowsPerQuery; j++)
+        {
+            const RecordMatchRow &row = rows[j];
+            values << QString("(%1,%2,'%3',0,%4,%5)")
+                .arg(row.recordid).arg(row.chanid)
+                .arg(MythDate::toString(row.starttime, MythDate::kDatabase))
+                .arg(row.oldrecduplicate).arg(row.findid);
+        }
+
+        if (!query.exec("REPLACE INTO recordmatch (recordid, chanid, "
+                        "starttime, manualid, oldrecduplicate, findid) "
+                        "VALUES " + values.join(",")))
+        {
+            MythDB::DBError("UpdateMatchesInMemory", query);
+            return false;
+        }
+    }
+
+    LOG(VB_SCHEDULE, LOG_INFO,
+        QString(" |-- In memory: %1 rules, %2 programs, %3 matches; "
+                "load %4 ms, rules %5 ms, match %6 ms, write %7 ms")
+        .arg(rules.size()).arg(m_matcher.GetProgramCount())
+        .arg(rows.size()).arg(loadtime).arg(rulestime).arg(matchtime)
+        .arg(timer.elapsed()));
+
+    return true;
+}
+
+/** \brief Matches the rules handled by UpdateMatchesInMemory() in the
+ *         database too, and logs any difference in the results.
+ */
+void Scheduler::VerifyMatches(uint recordid, const QString &filterClause,
+                              const MSqlBindings &bindings, uint filters,
+                              const QList<RecordMatchRow> &rows)
+{
+    MythTimer timer;
+    timer.start();
+
+    QStringList fromclauses, whereclauses;
+    MSqlBindings verifybindings = bindings;
+    BuildPlainRecordsQueries(recordid,
+                             QString("(RECTABLE.filter & %1) = 0 AND ")
+                             .arg(filters),
+                             fromclauses, whereclauses, verifybindings);
+
+    QMap<QString, QString> expected;
+    for (int clause = 0; clause < fromclauses.count(); ++clause)
+    {
+        QString query = build_match_select(fromclauses[clause],
+                                           whereclauses[clause],
+                                           filterClause);
+        query.replace("RECTABLE", recordTable);
+
+        MSqlQuery result(dbConn);
+        result.prepare(query);
+        MSqlBindings::const_iterator it;
+        for (it = verifybindings.begin(); it != verifybindings.end(); ++it)
+        {
+            if (query.contains(it.key()))
+                result.bindValue(it.key(), it.value());
+        }
+
+        if (!result.exec())
+        {
+            MythDB::DBError("VerifyMatches", result);
+            return;
+        }
+
+        while (result.next())
+        {
+            QString key = QString("%1 %2 %3").arg(result.value(0).toUInt())
+                .arg(result.value(1).toUInt())
+                .arg(MythDate::toString(
+                         MythDate::as_utc(result.value(2).toDateTime()),
+                         MythDate::ISODate));
+            expected[key] = QString("%1 %2").arg(result.value(4).toInt())
+                .arg(result.value(5).toInt());
+        }
+    }
+
+    QMap<QString, QString> actual;
+    QList<RecordMatchRow>::const_iterator rit = rows.begin();
+    for (; rit != rows.end(); ++rit)
+    {
+        QString key = QString("%1 %2 %3").arg((*rit).recordid)
+            .arg((*rit).chanid)
+            .arg(MythDate::toString((*rit).starttime, MythDate::ISODate));
+        actual[key] = QString("%1 %2").arg((*rit).oldrecduplicate)
+            .arg((*rit).findid);
+    }
+
+    QStringList diffs;
+    QMap<QString, QString>::const_iterator it;
+    for (it = expected.begin(); it != expected.end(); ++it)
+    {
+        if (!actual.contains(it.key()))
+            diffs << QString("missing %1 (%2)").arg(it.key()).arg(*it);
+        else if (actual[it.key()] != *it)
+        {
+            diffs << QString("%1 is (%2) instead of (%3)")
+                .arg(it.key()).arg(actual[it.key()]).arg(*it);
+        }
+    }
+    for (it = actual.begin(); it != actual.end(); ++it)
+    {
+        if (!expected.contains(it.key()))
+            diffs << QString("extra %1 (%2)").arg(it.key()).arg(*it);
+    }
+
+    if (diffs.empty())
+    {
+        LOG(VB_SCHEDULE, LOG_INFO,
+            QString(" |-- Verified %1 in memory matches in %2 ms")
+            .arg(actual.size()).arg(timer.elapsed()));
+        return;
+    }
+
+    LOG(VB_GENERAL, LOG_WARNING,
+        QString("VerifyMatches: %1 in memory and %2 database matches, "
+                "%3 differences")
+        .arg(actual.size()).arg(expected.size()).arg(diffs.size()));
+    for (int i = 0; i < diffs.size() && i < 10; i++)
+        LOG(VB_GENERAL, LOG_WARNING, "VerifyMatches: " + diffs[i]);
+}
+
 void Scheduler::CreateTempTables(void)
 {
     MSqlQuery result(dbConn);
@@ -5140,19 +5628,19 @@ void Scheduler::SchedPreserveLiveTV(void)
         dummy->SetInputID(in.inputid);
         dummy->SetRecordingStatus(rsUnknown);
 
-        retrylist.push_front(dummy);
+        m_placement.retrylist.push_front(dummy);
     }
 
-    if (retrylist.empty())
+    if (m_placement.retrylist.empty())
         return;
 
-    MoveHigherRecords(false);
+    MoveHigherRecords(m_placement, false);
 
-    while (!retrylist.empty())
+    while (!m_placement.retrylist.empty())
     {
-        RecordingInfo *p = retrylist.back();
+        RecordingInfo *p = m_placement.retrylist.back();
         delete p;
-        retrylist.pop_back();
+        m_placement.retrylist.pop_back();
     }
 }
 
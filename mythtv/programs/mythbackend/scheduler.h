@@ -9,6 +9,7 @@ using namespace std;
 // Qt headers
 #include <QWaitCondition>
 #include <QObject>
+#include <QStringList>
 #include <QString>
 #include <QMutex>
 #include <QMap>
@@ -23,15 +24,41 @@ using namespace std;
 #include "mythscheduler.h"
 #include "mthread.h"
 #include "scheduledrecording.h"
+#include "recordmatcher.h"
 
 class EncoderLink;
 class MainServer;
 class AutoExpire;
+class MThreadPool;
 
 class Scheduler;
 
+// cache IsSameProgram()
+typedef pair<const RecordingInfo*,const RecordingInfo*> IsSameKey;
+typedef QMap<IsSameKey,bool> IsSameCacheType;
+
+/** \class SchedPlacement
+ *  \brief The lists used while placing recordings.
+ *
+ *  SchedNewRecords() places the whole worklist with one of these, or
+ *  each independent part of it with its own when placing in parallel.
+ */
+class SchedPlacement
+{
+  public:
+    RecList worklist;           ///< showings to place, by priority
+    RecList retrylist;
+    RecList conflictlist;
+    QMap<uint, RecList> recordidlistmap;
+    QMap<QString, RecList> titlelistmap;
+    IsSameCacheType cache_is_same_program;
+    QStringList pending;        ///< new recPendingList keys
+};
+
 class Scheduler : public MThread, public MythScheduler
 {
+    friend class SchedPlacementRunner;
+
   public:
     Scheduler(bool runthread, QMap<int, EncoderLink *> *tvList,
               QString recordTbl = "record", Scheduler *master_sched = NULL);
@@ -114,28 +141,44 @@ class Scheduler : public MThread, public MythScheduler
     void AddNewRecords(void);
     void AddNotListed(void);
     void BuildNewRecordsQueries(uint recordid, QStringList &from, 
-                                QStringList &where, MSqlBindings &bindings);
+                                QStringList &where, MSqlBindings &bindings,
+                                int plainfilters = -1);
+    void BuildPlainRecordsQueries(uint recordid, const QString &filtermatch,
+                                  QStringList &from, QStringList &where,
+                                  MSqlBindings &bindings);
+    bool UpdateMatchesInMemory(uint recordid, uint sourceid, uint mplexid,
+                               const QDateTime &maxstarttime, uint filters,
+                               QList<RecordMatchRow> &rows);
+    void VerifyMatches(uint recordid, const QString &filterClause,
+                       const MSqlBindings &bindings, uint filters,
+                       const QList<RecordMatchRow> &rows);
     void PruneOverlaps(void);
     void BuildListMaps(void);
     void ClearListMaps(void);
 
     bool IsBusyRecording(const RecordingInfo *rcinfo);
 
-    bool IsSameProgram(const RecordingInfo *a, const RecordingInfo *b) const;
+    bool IsSameProgram(SchedPlacement &pl, const RecordingInfo *a,
+                       const RecordingInfo *b) const;
 
     bool FindNextConflict(const RecList &cardlist,
                           const RecordingInfo *p, RecConstIter &iter,
                           int openEnd = 0) const;
-    const RecordingInfo *FindConflict(const RecordingInfo *p, int openEnd = 0)
-        const;
-    void MarkOtherShowings(RecordingInfo *p);
-    void MarkShowingsList(RecList &showinglist, RecordingInfo *p);
-    void BackupRecStatus(void);
-    void RestoreRecStatus(void);
-    bool TryAnotherShowing(RecordingInfo *p,  bool samePriority,
-                           bool preserveLive = false);
+    const RecordingInfo *FindConflict(const SchedPlacement &pl,
+                                      const RecordingInfo *p,
+                                      int openEnd = 0) const;
+    void MarkOtherShowings(SchedPlacement &pl, RecordingInfo *p);
+    void MarkShowingsList(SchedPlacement &pl, RecList &showinglist,
+                          RecordingInfo *p);
+    void BackupRecStatus(SchedPlacement &pl);
+    void RestoreRecStatus(SchedPlacement &pl);
+    bool TryAnotherShowing(SchedPlacement &pl, RecordingInfo *p,
+                           bool samePriority, bool preserveLive = false);
     void SchedNewRecords(void);
-    void MoveHigherRecords(bool move_this = true);
+    void SplitPlacement(QList<SchedPlacement*> &parts);
+    void PlaceRecordings(SchedPlacement &pl, int openEnd);
+    void AddPending(const SchedPlacement &pl);
+    void MoveHigherRecords(SchedPlacement &pl, bool move_this = true);
     void SchedPreserveLiveTV(void);
     void PruneRedundants(void);
     void UpdateNextRecord(void);
@@ -210,11 +253,10 @@ class Scheduler : public MThread, public MythScheduler
     QWaitCondition reschedWait;
     RecList reclist;
     RecList worklist;
-    RecList retrylist;
-    RecList conflictlist;
-    QMap<uint, RecList> recordidlistmap;
-    QMap<QString, RecList> titlelistmap;
+    SchedPlacement m_placement;
+    MThreadPool *m_placementPool;
     InputGroupMap igrp;
+    RecordMatcher m_matcher;
 
     QDateTime schedTime;
     bool reclist_changed;
@@ -251,11 +293,6 @@ class Scheduler : public MThread, public MythScheduler
     int livetvpriority;
     int prefinputpri;
     QMap<QString, bool> hasLaterList;
-
-    // cache IsSameProgram()
-    typedef pair<const RecordingInfo*,const RecordingInfo*> IsSameKey;
-    typedef QMap<IsSameKey,bool> IsSameCacheType;
-    mutable IsSameCacheType cache_is_same_program;
 };
 
 #endif
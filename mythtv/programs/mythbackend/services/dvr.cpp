@@ -44,6 +44,7 @@
 
 extern QMap<int, EncoderLink *> tvList;
 extern AutoExpire  *expirer;
+extern JobQueue    *jobqueue;
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -310,6 +311,52 @@ DTC::EncoderList* Dvr::GetEncoderList()
 //
 /////////////////////////////////////////////////////////////////////////////
 
+DTC::JobQueueInfo* Dvr::GetJobQueueStats()
+{
+    if (!jobqueue)
+        throw( QString("Job Queue is not running on this backend."));
+
+    JobQueueStats stats = jobqueue->GetStats();
+
+    DTC::JobQueueInfo *pInfo = new DTC::JobQueueInfo();
+
+    pInfo->setHostName  ( gCoreContext->GetHostName() );
+    pInfo->setLastRun   ( stats.lastRun                );
+    pInfo->setMaxJobs   ( stats.maxJobs                );
+    pInfo->setRecordings( stats.recordings             );
+
+    QMap<int, JobTypeStats>::const_iterator it = stats.types.begin();
+    for (; it != stats.types.end(); ++it)
+    {
+        const JobTypeStats &ts = *it;
+        DTC::JobTypeInfo *pType = pInfo->AddNewJobType();
+
+        pType->setType      ( ts.type                     );
+        pType->setName      ( JobQueue::JobText( ts.type ) );
+        pType->setMaxJobs   ( ts.maxJobs                  );
+        pType->setPriority  ( ts.priority                 );
+        pType->setWaiting   ( ts.waiting                  );
+        pType->setRunning   ( ts.running                  );
+        pType->setStarted   ( ts.started                  );
+        pType->setFinished  ( ts.finished                 );
+        pType->setErrored   ( ts.errored                  );
+        pType->setMaxLatency( ts.latencyMax               );
+        pType->setMaxRunTime( ts.runtimeMax               );
+
+        if (ts.started)
+            pType->setAvgLatency( ts.latencyTotal / ts.started );
+
+        if (ts.done)
+            pType->setAvgRunTime( ts.runtimeTotal / ts.done );
+    }
+
+    return pInfo;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+/////////////////////////////////////////////////////////////////////////////
+
 DTC::ProgramList* Dvr::GetUpcomingList( int  nStartIndex,
                                         int  nCount,
                                         bool bShowAll )
@@ -69,6 +69,8 @@ class Dvr : public DvrServices
 
         DTC::EncoderList* GetEncoderList      ( );
 
+        DTC::JobQueueInfo* GetJobQueueStats   ( );
+
         // Recording Rules
 
         int               AddRecordSchedule   ( int       ChanId,
@@ -184,6 +186,8 @@ class ScriptableDvr : public QObject
 
         QObject* GetEncoderList     () { return m_obj.GetEncoderList(); }
 
+        QObject* GetJobQueueStats   () { return m_obj.GetJobQueueStats(); }
+
 
 };
 
@@ -0,0 +1,332 @@
+// ANSI C headers
+#include <cstring>
+
+// C++ headers
+#include <algorithm>
+using namespace std;
+
+// Qt headers
+#include <QSet>
+
+// FFmpeg headers
+extern "C" {
+#include "libavutil/mem.h"
+}
+
+// MythTV headers
+#include "mythlogging.h"
+
+// Commercial Flagging headers
+#include "AnalyzerPipeline.h"
+#include "CommDetector2.h"
+
+using namespace commDetector2;
+
+/* Frames queued per group before the decoder has to wait. */
+static const uint kMaxQueuedFrames = 8;
+
+SharedFrame::SharedFrame(const VideoFrame *src)
+    : ReferenceCounter("SharedFrame")
+{
+    vframe = *src;
+    vframe.buf = (unsigned char *)av_malloc(src->size);
+    if (vframe.buf)
+        memcpy(vframe.buf, src->buf, src->size);
+
+    /* These belong to the decoder. */
+    vframe.qscale_table = NULL;
+    vframe.qstride = 0;
+    memset(vframe.priv, 0, sizeof(vframe.priv));
+}
+
+SharedFrame::~SharedFrame(void)
+{
+    av_free(vframe.buf);
+}
+
+AnalyzerGroup::AnalyzerGroup(const FrameAnalyzerItem &_analyzers, int groupno,
+        uint _maxqueued)
+    : MThread(QString("CommFlagAnalyzer%1").arg(groupno))
+    , maxqueued(_maxqueued)
+    , stopping(false)
+    , analyzers(_analyzers)
+    , lastframe(-1)
+    , skipframes(false)
+{
+}
+
+AnalyzerGroup::~AnalyzerGroup(void)
+{
+    lock.lock();
+    stopping = true;
+    cond.wakeAll();
+    lock.unlock();
+
+    wait();
+
+    while (!queue.empty())
+        queue.dequeue()->DecrRef();
+}
+
+/*
+ * Queue a frame for the analyzers, waiting while the queue is full.
+ * Returns false if all the analyzers are done.
+ */
+bool
+AnalyzerGroup::push(SharedFrame *frame)
+{
+    QMutexLocker locker(&lock);
+
+    while (!analyzers.empty() && (uint)queue.size() >= maxqueued)
+        cond.wait(&lock);
+
+    if (analyzers.empty())
+        return false;
+
+    frame->IncrRef();
+    queue.enqueue(frame);
+    cond.wakeAll();
+    return true;
+}
+
+/* Wait until all the queued frames have been analyzed. */
+void
+AnalyzerGroup::drain(void)
+{
+    QMutexLocker locker(&lock);
+    while (!queue.empty())
+        cond.wait(&lock);
+}
+
+/* The last frame analyzed while some analyzers were still running. */
+long long
+AnalyzerGroup::lastFrame(void)
+{
+    QMutexLocker locker(&lock);
+    return lastframe;
+}
+
+/*
+ * Whether the analyzers asked for a frame other than the next one, which
+ * they are only given by a serial pass.
+ */
+bool
+AnalyzerGroup::skipping(void)
+{
+    QMutexLocker locker(&lock);
+    return skipframes;
+}
+
+FrameAnalyzerItem
+AnalyzerGroup::remaining(void)
+{
+    QMutexLocker locker(&lock);
+    return analyzers;
+}
+
+void
+AnalyzerGroup::takeDone(QList<Done> &_finished, QList<Done> &_dead)
+{
+    QMutexLocker locker(&lock);
+    _finished += finished;
+    _dead += dead;
+    finished.clear();
+    dead.clear();
+}
+
+void
+AnalyzerGroup::run(void)
+{
+    RunProlog();
+
+    QMutexLocker locker(&lock);
+    while (true)
+    {
+        while (!stopping && queue.empty())
+            cond.wait(&lock);
+        if (stopping)
+            break;
+
+        /* Leave the frame queued, so drain() waits for it. */
+        SharedFrame *frame = queue.head();
+        FrameAnalyzerItem pass = analyzers;
+        locker.unlock();
+
+        long long frameno = frame->frame()->frameNumber;
+        FrameAnalyzerItem finishedNow, deadNow;
+        long long nextframe = frameno + 1;
+        if (!pass.empty())
+        {
+            nextframe = processFrame(pass, finishedNow, deadNow,
+                    frame->frame(), frameno);
+        }
+
+        locker.relock();
+        if (!analyzers.empty())
+            lastframe = frameno;
+        if (!pass.empty() && nextframe != frameno + 1)
+            skipframes = true;
+        analyzers = pass;
+
+        FrameAnalyzerItem::const_iterator it;
+        for (it = finishedNow.begin(); it != finishedNow.end(); ++it)
+            finished.push_back(Done(frameno, *it));
+        for (it = deadNow.begin(); it != deadNow.end(); ++it)
+            dead.push_back(Done(frameno, *it));
+
+        queue.dequeue();
+        frame->DecrRef();
+        cond.wakeAll();
+    }
+
+    RunEpilog();
+}
+
+/*
+ * Split the pass into the groups given by groupOf, and start a thread for
+ * each of them.
+ */
+AnalyzerPipeline::AnalyzerPipeline(const FrameAnalyzerItem &pass,
+        const QMap<const FrameAnalyzer*, int> &groupOf)
+    : order(pass)
+{
+    QMap<int, FrameAnalyzerItem> items;
+    FrameAnalyzerItem::const_iterator it = pass.begin();
+    for (; it != pass.end(); ++it)
+        items[groupOf.value(*it, 0)].push_back(*it);
+
+    QMap<int, FrameAnalyzerItem>::const_iterator git = items.begin();
+    for (; git != items.end(); ++git)
+    {
+        AnalyzerGroup *group =
+            new AnalyzerGroup(*git, git.key(), kMaxQueuedFrames);
+        group->start();
+        analyzerGroups.push_back(group);
+    }
+
+    LOG(VB_COMMFLAG, LOG_INFO,
+        QString("AnalyzerPipeline: %1 analyzers on %2 threads")
+            .arg(pass.size()).arg(analyzerGroups.size()));
+}
+
+AnalyzerPipeline::~AnalyzerPipeline(void)
+{
+    while (!analyzerGroups.empty())
+        delete analyzerGroups.takeFirst();
+}
+
+/*
+ * Hand a copy of the frame to every group which still has analyzers.
+ * Returns false if all the analyzers are done.
+ */
+bool
+AnalyzerPipeline::push(const VideoFrame *frame)
+{
+    SharedFrame *shared = new SharedFrame(frame);
+    bool pushed = false;
+
+    QList<AnalyzerGroup*>::iterator it = analyzerGroups.begin();
+    for (; it != analyzerGroups.end(); ++it)
+        pushed = (*it)->push(shared) || pushed;
+
+    shared->DecrRef();
+    return pushed;
+}
+
+void
+AnalyzerPipeline::drain(void)
+{
+    QList<AnalyzerGroup*>::iterator it = analyzerGroups.begin();
+    for (; it != analyzerGroups.end(); ++it)
+        (*it)->drain();
+}
+
+/*
+ * The frame at which a serial pass would have stopped, if all the analyzers
+ * are done.
+ */
+long long
+AnalyzerPipeline::lastFrame(void)
+{
+    long long lastframe = -1;
+
+    QList<AnalyzerGroup*>::iterator it = analyzerGroups.begin();
+    for (; it != analyzerGroups.end(); ++it)
+        lastframe = max(lastframe, (*it)->lastFrame());
+
+    return lastframe;
+}
+
+bool
+AnalyzerPipeline::skipping(void)
+{
+    QList<AnalyzerGroup*>::iterator it = analyzerGroups.begin();
+    for (; it != analyzerGroups.end(); ++it)
+    {
+        if ((*it)->skipping())
+            return true;
+    }
+
+    return false;
+}
+
+/*
+ * Wait for the queued frames, and then update the pass and the finished
+ * and dead analyzers the way a serial pass would have: the analyzers which
+ * are done in the order of the frame at which they were done, and then
+ * in pass order.
+ */
+void
+AnalyzerPipeline::sync(FrameAnalyzerItem &pass,
+        FrameAnalyzerItem &finishedAnalyzers,
+        FrameAnalyzerItem &deadAnalyzers)
+{
+    typedef QMap<QPair<long long, int>, FrameAnalyzer*> DoneMap;
+
+    drain();
+
+    QSet<FrameAnalyzer*> running;
+    DoneMap finished, dead;
+
+    QList<AnalyzerGroup*>::iterator it = analyzerGroups.begin();
+    for (; it != analyzerGroups.end(); ++it)
+    {
+        FrameAnalyzerItem remaining = (*it)->remaining();
+        FrameAnalyzerItem::const_iterator rit = remaining.begin();
+        for (; rit != remaining.end(); ++rit)
+            running.insert(*rit);
+
+        QList<AnalyzerGroup::Done> groupFinished, groupDead;
+        (*it)->takeDone(groupFinished, groupDead);
+
+        QList<AnalyzerGroup::Done>::const_iterator dit;
+        for (dit = groupFinished.begin(); dit != groupFinished.end(); ++dit)
+        {
+            int index = find(order.begin(), order.end(), (*dit).second) -
+                order.begin();
+            finished.insert(qMakePair((*dit).first, index), (*dit).second);
+        }
+        for (dit = groupDead.begin(); dit != groupDead.end(); ++dit)
+        {
+            int index = find(order.begin(), order.end(), (*dit).second) -
+                order.begin();
+            dead.insert(qMakePair((*dit).first, index), (*dit).second);
+        }
+    }
+
+    pass.clear();
+    FrameAnalyzerItem::const_iterator oit = order.begin();
+    for (; oit != order.end(); ++oit)
+    {
+        if (running.contains(*oit))
+            pass.push_back(*oit);
+    }
+
+    DoneMap::const_iterator mit;
+    for (mit = finished.begin(); mit != finished.end(); ++mit)
+        finishedAnalyzers.push_back(*mit);
+    for (mit = dead.begin(); mit != dead.end(); ++mit)
+        deadAnalyzers.push_back(*mit);
+}
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -0,0 +1,107 @@
+/*
+ * AnalyzerPipeline
+ *
+ * Run the frame analyzers of a CommDetector2 pass on worker threads, while
+ * the player decodes the next frames.
+ */
+
+#ifndef __ANALYZERPIPELINE_H__
+#define __ANALYZERPIPELINE_H__
+
+// Qt headers
+#include <QWaitCondition>
+#include <QMutex>
+#include <QQueue>
+#include <QList>
+#include <QPair>
+#include <QMap>
+
+// MythTV headers
+#include "referencecounter.h"
+#include "mthread.h"
+#include "frame.h"
+
+// Commercial Flagging headers
+#include "FrameAnalyzer.h"
+
+/*
+ * A copy of a decoded frame, which is deleted when the last analyzer
+ * group is done with it.
+ */
+class SharedFrame : public ReferenceCounter
+{
+public:
+    SharedFrame(const VideoFrame *src);
+
+    const VideoFrame *frame(void) const { return &vframe; }
+
+protected:
+    virtual ~SharedFrame(void);
+
+private:
+    VideoFrame      vframe;
+};
+
+/*
+ * Analyzers sharing no state with the analyzers of other groups. They see
+ * every frame in order, on their own thread.
+ */
+class AnalyzerGroup : public MThread
+{
+public:
+    /* An analyzer and the frame at which it finished or died. */
+    typedef QPair<long long, FrameAnalyzer*> Done;
+
+    AnalyzerGroup(const FrameAnalyzerItem &analyzers, int groupno,
+            uint maxqueued);
+    ~AnalyzerGroup(void);
+
+    bool push(SharedFrame *frame);
+    void drain(void);
+
+    long long lastFrame(void);
+    bool skipping(void);
+    FrameAnalyzerItem remaining(void);
+    void takeDone(QList<Done> &finished, QList<Done> &dead);
+
+protected:
+    virtual void run(void);
+
+private:
+    QMutex              lock;
+    QWaitCondition      cond;
+    QQueue<SharedFrame*> queue;         /* head is being analyzed */
+    uint                maxqueued;
+    bool                stopping;
+
+    FrameAnalyzerItem   analyzers;
+    QList<Done>         finished;       /* frame they finished at */
+    QList<Done>         dead;
+    long long           lastframe;      /* last frame analyzed */
+    bool                skipframes;     /* an analyzer asked to skip */
+};
+
+class AnalyzerPipeline
+{
+public:
+    AnalyzerPipeline(const FrameAnalyzerItem &pass,
+            const QMap<const FrameAnalyzer*, int> &groupOf);
+    ~AnalyzerPipeline(void);
+
+    bool push(const VideoFrame *frame);
+    void drain(void);
+    long long lastFrame(void);
+    bool skipping(void);
+    void sync(FrameAnalyzerItem &pass, FrameAnalyzerItem &finishedAnalyzers,
+            FrameAnalyzerItem &deadAnalyzers);
+
+    unsigned int groups(void) const { return analyzerGroups.size(); }
+
+private:
+    FrameAnalyzerItem       order;      /* analyzers in pass order */
+    QList<AnalyzerGroup*>   analyzerGroups;
+};
+
+#endif  /* !__ANALYZERPIPELINE_H__ */
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -32,6 +32,7 @@ using namespace std;
 #include "SceneChangeDetector.h"
 #include "TemplateFinder.h"
 #include "TemplateMatcher.h"
+#include "AnalyzerPipeline.h"
 
 namespace {
 
@@ -115,6 +116,39 @@ bool MythPlayerInited(FrameAnalyzerItem &pass,
     return true;
 }
 
+int passFinished(FrameAnalyzerItem &pass, long long nframes, bool final)
+{
+    FrameAnalyzerItem::iterator it = pass.begin();
+    for (; it != pass.end(); ++it)
+        (void)(*it)->finished(nframes, final);
+
+    return 0;
+}
+
+int passReportTime(const FrameAnalyzerItem &pass)
+{
+    FrameAnalyzerItem::const_iterator it = pass.begin();
+    for (; it != pass.end(); ++it)
+        (void)(*it)->reportTime();
+
+    return 0;
+}
+
+bool searchingForLogo(TemplateFinder *tf, const FrameAnalyzerItem &pass)
+{
+    if (!tf)
+        return false;
+
+    FrameAnalyzerItem::const_iterator it =
+        std::find(pass.begin(), pass.end(), tf);
+
+    return it != pass.end();
+}
+
+};  // namespace
+
+namespace commDetector2 {
+
 long long processFrame(FrameAnalyzerItem &pass,
                        FrameAnalyzerItem &finishedAnalyzers,
                        FrameAnalyzerItem &deadAnalyzers,
@@ -164,39 +198,6 @@ long long processFrame(FrameAnalyzerItem &pass,
     return minNextFrame;
 }
 
-int passFinished(FrameAnalyzerItem &pass, long long nframes, bool final)
-{
-    FrameAnalyzerItem::iterator it = pass.begin();
-    for (; it != pass.end(); ++it)
-        (void)(*it)->finished(nframes, final);
-
-    return 0;
-}
-
-int passReportTime(const FrameAnalyzerItem &pass)
-{
-    FrameAnalyzerItem::const_iterator it = pass.begin();
-    for (; it != pass.end(); ++it)
-        (void)(*it)->reportTime();
-
-    return 0;
-}
-
-bool searchingForLogo(TemplateFinder *tf, const FrameAnalyzerItem &pass)
-{
-    if (!tf)
-        return false;
-
-    FrameAnalyzerItem::const_iterator it =
-        std::find(pass.begin(), pass.end(), tf);
-
-    return it != pass.end();
-}
-
-};  // namespace
-
-namespace commDetector2 {
-
 QString debugDirectory(int chanid, const QDateTime& recstartts)
 {
     /*
@@ -312,16 +313,18 @@ CommDetector2::CommDetector2(
     const QDateTime   &endts_in,
     const QDateTime   &recstartts_in,
     const QDateTime   &recendts_in,
-    bool               useDB) :
+    bool               useDB,
+    bool               pipeline_in) :
     commDetectMethod((enum SkipTypes)(commDetectMethod_in & ~COMM_DETECT_2)),
     showProgress(showProgress_in),  fullSpeed(fullSpeed_in),
-    player(player_in),
+    pipeline(pipeline_in),          player(player_in),
     startts(startts_in),            endts(endts_in),
     recstartts(recstartts_in),      recendts(recendts_in),
     isRecording(MythDate::current() < recendts),
     sendBreakMapUpdates(false),     breakMapUpdateRequested(false),
     finished(false),                currentFrameNumber(0),
     logoFinder(NULL),               logoMatcher(NULL),
+    matcherPgmConverter(NULL),
     blankFrameDetector(NULL),       sceneChangeDetector(NULL),
     debugdir("")
 {
@@ -414,9 +417,17 @@ CommDetector2::CommDetector2(
 
         if (!logoMatcher)
         {
-            logoMatcher = new TemplateMatcher(pgmConverter, cannyEdgeDetector,
-                    logoFinder, debugdir);
+            /*
+             * When pipelined, the matcher runs on its own thread, so it can't
+             * share the PGM converter with the histogram analyzer.
+             */
+            if (pipeline)
+                matcherPgmConverter = new PGMConverter();
+            logoMatcher = new TemplateMatcher(
+                    pipeline ? matcherPgmConverter : pgmConverter,
+                    cannyEdgeDetector, logoFinder, debugdir);
             pass1.push_back(logoMatcher);
+            analyzerGroup[logoMatcher] = 1;
         }
     }
 
@@ -428,6 +439,11 @@ CommDetector2::CommDetector2(
     frameAnalyzers.push_back(pass1);
 }
 
+CommDetector2::~CommDetector2()
+{
+    delete matcherPgmConverter;
+}
+
 void CommDetector2::reportState(int elapsedms, long long frameno,
         long long nframes, unsigned int passno, unsigned int npasses)
 {
@@ -576,10 +592,20 @@ bool CommDetector2::go(void)
             return false;
         }
 
+        /*
+         * Analyze the frames on worker threads while the player decodes the
+         * next ones. The logo search skips frames, so it stays serial, as
+         * does the rest of a pass once any analyzer asks to skip frames.
+         */
+        AnalyzerPipeline *analyzerPipeline = NULL;
+        if (pipeline && !searchingForLogo(logoFinder, *currentPass))
+            analyzerPipeline = new AnalyzerPipeline(*currentPass, analyzerGroup);
+
         player->DiscardVideoFrame(player->GetRawVideoFrame(0));
         long long nextFrame = -1;
         currentFrameNumber = 0;
         long long lastLoggedFrame = currentFrameNumber;
+        long long passFrames = 0;
         QTime passTime, clock;
         struct timeval getframetime;
 
@@ -621,6 +647,7 @@ bool CommDetector2::go(void)
                 if (m_bStop)
                 {
                     player->DiscardVideoFrame(currentFrame);
+                    delete analyzerPipeline;
                     return false;
                 }
             }
@@ -639,9 +666,35 @@ bool CommDetector2::go(void)
                         nframes, passno, npasses);
             }
 
-            nextFrame = processFrame(
-                *currentPass, finishedAnalyzers,
-                deadAnalyzers, currentFrame, currentFrameNumber);
+            if (analyzerPipeline)
+            {
+                /* The pipelined analyzers all want the next frame. */
+                if (!analyzerPipeline->push(currentFrame))
+                {
+                    player->DiscardVideoFrame(currentFrame);
+                    break;
+                }
+                nextFrame = currentFrameNumber + 1;
+
+                if (analyzerPipeline->skipping())
+                {
+                    LOG(VB_COMMFLAG, LOG_INFO,
+                        QString("Analyzers skip frames after frame %1, "
+                                "analyzing the rest of the pass serially")
+                            .arg(currentFrameNumber));
+                    analyzerPipeline->sync(*currentPass, finishedAnalyzers,
+                            deadAnalyzers);
+                    delete analyzerPipeline;
+                    analyzerPipeline = NULL;
+                }
+            }
+            else
+            {
+                nextFrame = processFrame(
+                    *currentPass, finishedAnalyzers,
+                    deadAnalyzers, currentFrame, currentFrameNumber);
+            }
+            passFrames++;
 
             if (((currentFrameNumber >= 1) &&
                  (((nextFrame * 10) / nframes) !=
@@ -677,6 +730,11 @@ bool CommDetector2::go(void)
             {
                 frm_dir_map_t breakMap;
 
+                if (analyzerPipeline)
+                {
+                    analyzerPipeline->sync(*currentPass, finishedAnalyzers,
+                            deadAnalyzers);
+                }
                 GetCommercialBreakList(breakMap);
 
                 frm_dir_map_t::const_iterator ii, jj;
@@ -703,6 +761,31 @@ bool CommDetector2::go(void)
             player->DiscardVideoFrame(currentFrame);
         }
 
+        int passElapsed = passTime.elapsed();
+        unsigned int analyzerThreads = 0;
+        if (analyzerPipeline)
+        {
+            analyzerPipeline->sync(*currentPass, finishedAnalyzers,
+                    deadAnalyzers);
+            analyzerThreads = analyzerPipeline->groups();
+
+            /* Where a serial pass would have stopped. */
+            if (analyzerPipeline->lastFrame() >= 0)
+                currentFrameNumber = analyzerPipeline->lastFrame();
+
+            delete analyzerPipeline;
+            analyzerPipeline = NULL;
+        }
+
+        LOG(VB_GENERAL, LOG_INFO,
+            QString("CommDetector2 pass %1: %2 frames in %3 ms, %4 fps (%5)")
+                .arg(passno + 1).arg(passFrames).arg(passElapsed)
+                .arg(passElapsed ? passFrames * 1000.0 / passElapsed : 0.0,
+                     0, 'f', 2)
+                .arg(analyzerThreads ?
+                     QString("%1 analyzer threads").arg(analyzerThreads) :
+                     QString("serial")));
+
         // Save total duration only on the last pass, which hopefully does
         // no skipping.
         if (passno + 1 == npasses)
@@ -16,6 +16,7 @@ using namespace std;
 #include "FrameAnalyzer.h"
 
 class MythPlayer;
+class PGMConverter;
 class TemplateFinder;
 class TemplateMatcher;
 class BlankFrameDetector;
@@ -23,6 +24,9 @@ class SceneChangeDetector;
 
 namespace commDetector2 {
 
+long long processFrame(FrameAnalyzerItem &pass,
+        FrameAnalyzerItem &finishedAnalyzers, FrameAnalyzerItem &deadAnalyzers,
+        const VideoFrame *frame, long long frameno);
 QString debugDirectory(int chanid, const QDateTime& recstartts);
 void createDebugDirectory(QString dirname, QString comment);
 QString frameToTimestamp(long long frameno, float fps);
@@ -31,9 +35,6 @@ QString strftimeval(const struct timeval *tv);
 
 };  /* namespace */
 
-typedef vector<FrameAnalyzer*>    FrameAnalyzerItem;
-typedef vector<FrameAnalyzerItem> FrameAnalyzerList;
-
 class CommDetector2 : public CommDetectorBase
 {
   public:
@@ -41,7 +42,8 @@ class CommDetector2 : public CommDetectorBase
         SkipType commDetectMethod,
         bool showProgress, bool fullSpeed, MythPlayer* player,
         int chanid, const QDateTime& startts, const QDateTime& endts,
-        const QDateTime& recstartts, const QDateTime& recendts, bool useDB);
+        const QDateTime& recstartts, const QDateTime& recendts, bool useDB,
+        bool pipeline);
     virtual bool go(void);
     virtual void GetCommercialBreakList(frm_dir_map_t &comms);
     virtual void recordingFinished(long long totalFileSize);
@@ -50,7 +52,7 @@ class CommDetector2 : public CommDetectorBase
         ostream &out, const frm_dir_map_t *comm_breaks, bool verbose) const;
 
   private:
-    virtual ~CommDetector2() {}
+    virtual ~CommDetector2();
 
     void reportState(int elapsed_sec, long long frameno, long long nframes,
             unsigned int passno, unsigned int npasses);
@@ -60,6 +62,7 @@ class CommDetector2 : public CommDetectorBase
     enum SkipTypes          commDetectMethod;
     bool                    showProgress;
     bool                    fullSpeed;
+    bool                    pipeline;           /* threaded analyzers */
     MythPlayer             *player;
     QDateTime               startts, endts, recstartts, recendts;
 
@@ -72,11 +75,13 @@ class CommDetector2 : public CommDetectorBase
     FrameAnalyzerList       frameAnalyzers;     /* one list per scan of file */
     FrameAnalyzerList::iterator currentPass;
     FrameAnalyzerItem       finishedAnalyzers;
+    QMap<const FrameAnalyzer*, int> analyzerGroup;  /* pipeline thread */
 
     FrameAnalyzer::FrameMap breaks;
 
     TemplateFinder          *logoFinder;
     TemplateMatcher         *logoMatcher;
+    PGMConverter            *matcherPgmConverter;   /* when pipelined */
     BlankFrameDetector      *blankFrameDetector;
     SceneChangeDetector     *sceneChangeDetector;
 
@@ -16,7 +16,8 @@ CommDetectorFactory::makeCommDetector(
     const QDateTime& stopsAt,
     const QDateTime& recordingStartedAt,
     const QDateTime& recordingStopsAt,
-    bool useDB)
+    bool useDB,
+    bool pipeline)
 {
     if(commDetectMethod & COMM_DETECT_PREPOSTROLL)
     {
@@ -30,7 +31,7 @@ CommDetectorFactory::makeCommDetector(
         return new CommDetector2(
             commDetectMethod, showProgress, fullSpeed,
             player, chanid, startedAt, stopsAt,
-            recordingStartedAt, recordingStopsAt, useDB);
+            recordingStartedAt, recordingStopsAt, useDB, pipeline);
     }
 
     return new ClassicCommDetector(commDetectMethod, showProgress, fullSpeed,
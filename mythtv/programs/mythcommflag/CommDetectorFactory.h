@@ -23,7 +23,8 @@ class CommDetectorFactory
         const QDateTime& stopsAt,
         const QDateTime& recordingStartedAt,
         const QDateTime& recordingStopsAt,
-        bool useDB);
+        bool useDB,
+        bool pipeline);
 };
 
 #endif
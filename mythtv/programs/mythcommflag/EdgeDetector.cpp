@@ -1,5 +1,6 @@
 // ANSI C headers
 #include <cstdlib>
+#include <cstring>
 
 // C++ headers
 #include <algorithm>
@@ -19,10 +20,23 @@ extern "C" {
 // Commercial Flagging headers
 #include "FrameAnalyzer.h"
 #include "EdgeDetector.h"
+#include "FrameKernels.h"
 
 namespace edgeDetector {
 
-using namespace frameAnalyzer;
+/* The columns [*cc1, *cc2) of row "rr" which are in the excluded area. */
+static bool
+excluded_cols(int rr, int width,
+        int excluderow, int excludecol, int excludewidth, int excludeheight,
+        int *cc1, int *cc2)
+{
+    if (rr < excluderow || rr >= excluderow + excludeheight)
+        return false;
+
+    *cc1 = min(max(0, excludecol), width);
+    *cc2 = min(max(0, excludecol + excludewidth), width);
+    return *cc1 < *cc2;
+}
 
 unsigned int *
 sgm_init_exclude(unsigned int *sgm, const AVPicture *src, int srcheight,
@@ -35,28 +49,27 @@ sgm_init_exclude(unsigned int *sgm, const AVPicture *src, int srcheight,
      * Intuitively, the SGM of a pixel is a measure of the "edge intensity" of
      * that pixel: how much it differs from its neighbors.
      */
+    const frameKernels::Kernels *kernels = frameKernels::kernels();
     const int       srcwidth = src->linesize[0];
-    int             rr, cc, dx, dy, rr2, cc2;
-    unsigned char   *rr0, *rr1;
+    int             rr, rr2, cc1, cc2;
+
+    if (srcheight <= 0)
+        return sgm;
 
-    memset(sgm, 0, srcwidth * srcheight * sizeof(*sgm));
     rr2 = srcheight - 1;
-    cc2 = srcwidth - 1;
     for (rr = 0; rr < rr2; rr++)
     {
-        for (cc = 0; cc < cc2; cc++)
-        {
-            if (!rrccinrect(rr, cc, excluderow, excludecol,
-                        excludewidth, excludeheight))
-            {
-                rr0 = &src->data[0][rr * srcwidth + cc];
-                rr1 = &src->data[0][(rr + 1) * srcwidth + cc];
-                dx = rr1[1] - rr0[0];   /* southeast - northwest */
-                dy = rr1[0] - rr0[1];   /* southwest - northeast */
-                sgm[rr * srcwidth + cc] = dx * dx + dy * dy;
-            }
-        }
+        unsigned int *row = sgm + rr * srcwidth;
+
+        kernels->sgm_row(row, src->data[0] + rr * srcwidth,
+                src->data[0] + (rr + 1) * srcwidth, srcwidth - 1);
+        row[srcwidth - 1] = 0;
+
+        if (excluded_cols(rr, srcwidth - 1, excluderow, excludecol,
+                    excludewidth, excludeheight, &cc1, &cc2))
+            memset(row + cc1, 0, (cc2 - cc1) * sizeof(*sgm));
     }
+    memset(sgm + rr2 * srcwidth, 0, srcwidth * sizeof(*sgm));
     return sgm;
 }
 
@@ -68,16 +81,9 @@ sgm_init(unsigned int *sgm, const AVPicture *src, int srcheight)
 }
 #endif /* LATER */
 
-static int sort_ascending(const void *aa, const void *bb)
-{
-    return *(unsigned int*)aa - *(unsigned int*)bb;
-}
-
-static int
-edge_mark(AVPicture *dst, int dstheight,
-        int extratop, int extraright, int extrabottom, int extraleft,
-        const unsigned int *sgm, unsigned int *sgmsorted, int percentile,
-        int excluderow, int excludecol, int excludewidth, int excludeheight)
+int
+sgm_threshold(unsigned int *sgmvals, int nn, int percentile,
+        unsigned int *pthresholdval)
 {
     /*
      * TUNABLE:
@@ -89,92 +95,104 @@ edge_mark(AVPicture *dst, int dstheight,
      */
     static const int    MINTHRESHOLDPCT = 95;
 
+    unsigned int        thresholdval, nextval;
+    int                 ii, first, last, nless, nequal;
+
+    /*
+     * Only the value at the percentile and the values next to it matter, so
+     * select it rather than sorting all of them.
+     */
+    ii = percentile * nn / 100;
+    nth_element(sgmvals, sgmvals + ii, sgmvals + nn);
+    thresholdval = sgmvals[ii];
+
+    /*
+     * Try not to pick up too many edges, and eliminate degenerate edge-less
+     * cases.
+     */
+    frameKernels::kernels()->sgm_rank(sgmvals, nn, thresholdval,
+            &nless, &nequal, &nextval);
+    first = nless;
+    if (first * 100 / nn < MINTHRESHOLDPCT)
+    {
+        last = nless + nequal - 1;
+        if (last == nn - 1)
+        {
+            /* Degenerate case; no edges (e.g., blank frame). */
+            return -1;
+        }
+
+        thresholdval = nextval;
+    }
+
+    *pthresholdval = thresholdval;
+    return 0;
+}
+
+static int
+edge_mark(AVPicture *dst, int dstheight,
+        int extratop, int extraright, int extrabottom, int extraleft,
+        const unsigned int *sgm, unsigned int *sgmsorted, int percentile,
+        int excluderow, int excludecol, int excludewidth, int excludeheight)
+{
+    const frameKernels::Kernels *kernels = frameKernels::kernels();
     const int           dstwidth = dst->linesize[0];
     const int           padded_width = extraleft + dstwidth + extraright;
     unsigned int        thresholdval;
-    int                 nn, dstnn, ii, rr, cc, first, last, last2;
+    int                 nn, dstnn, rr, cc1, cc2;
 
     (void)extrabottom;  /* gcc */
 
     /*
      * sgm: SGM values of padded (convolved) image
      *
-     * sgmsorted: sorted SGM values of unexcluded areas of unpadded image (same
+     * sgmsorted: SGM values of unexcluded areas of unpadded image (same
      * dimensions as "dst").
      */
     nn = 0;
     for (rr = 0; rr < dstheight; rr++)
     {
-        for (cc = 0; cc < dstwidth; cc++)
+        const unsigned int *row = sgm + (extratop + rr) * padded_width +
+            extraleft;
+
+        if (excluded_cols(rr, dstwidth, excluderow, excludecol,
+                    excludewidth, excludeheight, &cc1, &cc2))
+        {
+            memcpy(sgmsorted + nn, row, cc1 * sizeof(*sgmsorted));
+            nn += cc1;
+            memcpy(sgmsorted + nn, row + cc2,
+                    (dstwidth - cc2) * sizeof(*sgmsorted));
+            nn += dstwidth - cc2;
+        }
+        else
         {
-            if (!rrccinrect(rr, cc, excluderow, excludecol,
-                        excludewidth, excludeheight))
-            {
-                sgmsorted[nn++] = sgm[(extratop + rr) * padded_width +
-                    extraleft + cc];
-            }
+            memcpy(sgmsorted + nn, row, dstwidth * sizeof(*sgmsorted));
+            nn += dstwidth;
         }
     }
 
     dstnn = dstwidth * dstheight;
-#if 0
-    assert(nn == dstnn -
-            (min(max(0, excluderow + excludeheight), dstheight) -
-                min(max(0, excluderow), dstheight)) *
-            (min(max(0, excludecol + excludewidth), dstwidth) -
-                min(max(0, excludecol), dstwidth)));
-#endif
-    memset(dst->data[0], 0, dstnn * sizeof(*dst->data[0]));
-
-    if (!nn)
+    if (!nn || sgm_threshold(sgmsorted, nn, percentile, &thresholdval))
     {
-            /* Degenerate case (entire area excluded from analysis). */
-            return 0;
-    }
-
-    qsort(sgmsorted, nn, sizeof(*sgmsorted), sort_ascending);
-
-    ii = percentile * nn / 100;
-    thresholdval = sgmsorted[ii];
-
-    /*
-     * Try not to pick up too many edges, and eliminate degenerate edge-less
-     * cases.
-     */
-    for (first = ii; first > 0 && sgmsorted[first] == thresholdval; first--) ;
-    if (sgmsorted[first] != thresholdval)
-        first++;
-    if (first * 100 / nn < MINTHRESHOLDPCT)
-    {
-        unsigned int    newthresholdval;
-
-        last2 = nn - 1;
-        for (last = ii; last < last2 && sgmsorted[last] == thresholdval;
-                last++) ;
-        if (sgmsorted[last] != thresholdval)
-            last--;
-
-        newthresholdval = sgmsorted[min(last + 1, nn - 1)];
-        if (thresholdval == newthresholdval)
-        {
-            /* Degenerate case; no edges (e.g., blank frame). */
-            return 0;
-        }
-
-        thresholdval = newthresholdval;
+        /*
+         * Degenerate cases (entire area excluded from analysis, or no edges).
+         */
+        memset(dst->data[0], 0, dstnn * sizeof(*dst->data[0]));
+        return 0;
     }
 
     /* sgm is a padded matrix; dst is the unpadded matrix. */
     for (rr = 0; rr < dstheight; rr++)
     {
-        for (cc = 0; cc < dstwidth; cc++)
-        {
-            if (!rrccinrect(rr, cc, excluderow, excludecol,
-                        excludewidth, excludeheight) &&
-                    sgm[(extratop + rr) * padded_width + extraleft + cc] >=
-                        thresholdval)
-                dst->data[0][rr * dstwidth + cc] = UCHAR_MAX;
-        }
+        unsigned char *row = dst->data[0] + rr * dstwidth;
+
+        kernels->mark_row(row,
+                sgm + (extratop + rr) * padded_width + extraleft,
+                dstwidth, thresholdval);
+
+        if (excluded_cols(rr, dstwidth, excluderow, excludecol,
+                    excludewidth, excludeheight, &cc1, &cc2))
+            memset(row + cc1, 0, (cc2 - cc1) * sizeof(*row));
     }
     return 0;
 }
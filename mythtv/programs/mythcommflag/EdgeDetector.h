@@ -18,6 +18,13 @@ unsigned int *sgm_init_exclude(unsigned int *sgm,
         const AVPicture *src, int srcheight,
         int excluderow, int excludecol, int excludewidth, int excludeheight);
 
+/*
+ * Pick the SGM value at "percentile" of "sgmvals" (which get reordered) as
+ * the edge threshold. Returns -1 if there are no edges.
+ */
+int sgm_threshold(unsigned int *sgmvals, int nn, int percentile,
+        unsigned int *pthresholdval);
+
 int edge_mark_uniform_exclude(AVPicture *dst, int dstheight, int extramargin,
         const unsigned int *sgm, unsigned int *sgmsorted, int percentile,
         int excluderow, int excludecol, int excludewidth, int excludeheight);
@@ -11,6 +11,9 @@
 
 #include <limits.h>
 
+#include <vector>
+using namespace std;
+
 #include <QMap>
 
 /*  
@@ -69,6 +72,9 @@ public:
     virtual FrameMap GetMap(unsigned int) const = 0;
 };
 
+typedef vector<FrameAnalyzer*>    FrameAnalyzerItem;
+typedef vector<FrameAnalyzerItem> FrameAnalyzerList;
+
 namespace frameAnalyzer {
 
 bool rrccinrect(int rr, int cc, int rrow, int rcol, int rwidth, int rheight);
@@ -0,0 +1,409 @@
+// ANSI C headers
+#include <climits>
+#include <cstring>
+
+#include "mythconfig.h"
+
+#if ARCH_X86 && defined(__SSE2__)
+#define USING_SSE2_KERNELS
+#include <emmintrin.h>
+#endif
+
+// Qt headers
+#include <QAtomicPointer>
+
+// avlib/ffmpeg headers
+extern "C" {
+#include "libavutil/cpu.h"
+}
+
+// MythTV headers
+#include "mythlogging.h"
+
+// Commercial Flagging headers
+#include "FrameKernels.h"
+
+namespace frameKernels {
+
+/*
+ * Portable C versions. These are the original loops of pgm.cpp,
+ * EdgeDetector.cpp and Histogram.cpp, and define the results of the SIMD
+ * versions.
+ */
+
+static void
+convolve_col_c(unsigned char *dst, const unsigned char *src, int srcwidth,
+        int width, const double *mask, int mask_width)
+{
+    for (int cc = 0; cc < width; cc++)
+    {
+        double sum = 0;
+        for (int ii = 0; ii < mask_width; ii++)
+            sum += mask[ii] * src[ii * srcwidth + cc];
+        dst[cc] = (unsigned char)(sum + 0.5);
+    }
+}
+
+static void
+convolve_row_c(unsigned char *dst, const unsigned char *src, int width,
+        const double *mask, int mask_width)
+{
+    for (int cc = 0; cc < width; cc++)
+    {
+        double sum = 0;
+        for (int ii = 0; ii < mask_width; ii++)
+            sum += mask[ii] * src[cc + ii];
+        dst[cc] = (unsigned char)(sum + 0.5);
+    }
+}
+
+static void
+sgm_row_c(unsigned int *sgm, const unsigned char *rr0,
+        const unsigned char *rr1, int width)
+{
+    /* Use a 45-degree rotated set of axes. */
+    for (int cc = 0; cc < width; cc++)
+    {
+        int dx = rr1[cc + 1] - rr0[cc];     /* southeast - northwest */
+        int dy = rr1[cc] - rr0[cc + 1];     /* southwest - northeast */
+        sgm[cc] = dx * dx + dy * dy;
+    }
+}
+
+static void
+mark_row_c(unsigned char *dst, const unsigned int *sgm, int width,
+        unsigned int thresholdval)
+{
+    for (int cc = 0; cc < width; cc++)
+        dst[cc] = sgm[cc] >= thresholdval ? UCHAR_MAX : 0;
+}
+
+static void
+sgm_rank_c(const unsigned int *sgm, int nn, unsigned int val,
+        int *nless, int *nequal, unsigned int *next)
+{
+    int             less = 0, equal = 0;
+    unsigned int    above = UINT_MAX;
+
+    for (int ii = 0; ii < nn; ii++)
+    {
+        if (sgm[ii] < val)
+            less++;
+        else if (sgm[ii] == val)
+            equal++;
+        else if (sgm[ii] < above)
+            above = sgm[ii];
+    }
+
+    *nless = less;
+    *nequal = equal;
+    *next = above;
+}
+
+static void
+histogram_c(int *counts, const unsigned char *src, int srcwidth,
+        int nrows, int rowstep, int ncols, int colstep)
+{
+    for (int rr = 0; rr < nrows; rr++)
+    {
+        const unsigned char *row = src + rr * rowstep * srcwidth;
+        for (int cc = 0; cc < ncols; cc++)
+            counts[row[cc * colstep]]++;
+    }
+}
+
+static const Kernels kernels_c = {
+    "C",
+    convolve_col_c,
+    convolve_row_c,
+    sgm_row_c,
+    mark_row_c,
+    sgm_rank_c,
+    histogram_c,
+};
+
+#ifdef USING_SSE2_KERNELS
+
+/*
+ * SSE2 versions. The convolutions do the same double precision multiplies
+ * and adds in the same order as the C version, two pixels to a register,
+ * so they round the same way.
+ */
+
+static inline void
+store_rounded(unsigned char *dst, __m128d s0, __m128d s1, __m128d s2,
+        __m128d s3)
+{
+    /* (unsigned char)(sum + 0.5) of 8 pixels. */
+    const __m128d   half = _mm_set1_pd(0.5);
+
+    __m128i lo = _mm_unpacklo_epi64(
+            _mm_cvttpd_epi32(_mm_add_pd(s0, half)),
+            _mm_cvttpd_epi32(_mm_add_pd(s1, half)));
+    __m128i hi = _mm_unpacklo_epi64(
+            _mm_cvttpd_epi32(_mm_add_pd(s2, half)),
+            _mm_cvttpd_epi32(_mm_add_pd(s3, half)));
+    __m128i px = _mm_packs_epi32(lo, hi);
+    _mm_storel_epi64((__m128i *)dst, _mm_packus_epi16(px, px));
+}
+
+static inline void
+accumulate(const unsigned char *src, __m128d mm, __m128d *s0, __m128d *s1,
+        __m128d *s2, __m128d *s3)
+{
+    /* sum += mask * pixel, for 8 pixels. */
+    const __m128i   zero = _mm_setzero_si128();
+
+    __m128i px = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)src),
+            zero);
+    __m128i lo = _mm_unpacklo_epi16(px, zero);
+    __m128i hi = _mm_unpackhi_epi16(px, zero);
+
+    *s0 = _mm_add_pd(*s0, _mm_mul_pd(mm, _mm_cvtepi32_pd(lo)));
+    *s1 = _mm_add_pd(*s1, _mm_mul_pd(mm,
+                _mm_cvtepi32_pd(_mm_unpackhi_epi64(lo, lo))));
+    *s2 = _mm_add_pd(*s2, _mm_mul_pd(mm, _mm_cvtepi32_pd(hi)));
+    *s3 = _mm_add_pd(*s3, _mm_mul_pd(mm,
+                _mm_cvtepi32_pd(_mm_unpackhi_epi64(hi, hi))));
+}
+
+static void
+convolve_col_sse2(unsigned char *dst, const unsigned char *src, int srcwidth,
+        int width, const double *mask, int mask_width)
+{
+    int cc;
+
+    for (cc = 0; cc + 8 <= width; cc += 8)
+    {
+        __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+        __m128d s2 = _mm_setzero_pd(), s3 = _mm_setzero_pd();
+
+        for (int ii = 0; ii < mask_width; ii++)
+        {
+            accumulate(src + ii * srcwidth + cc, _mm_set1_pd(mask[ii]),
+                    &s0, &s1, &s2, &s3);
+        }
+        store_rounded(dst + cc, s0, s1, s2, s3);
+    }
+
+    convolve_col_c(dst + cc, src + cc, srcwidth, width - cc, mask, mask_width);
+}
+
+static void
+convolve_row_sse2(unsigned char *dst, const unsigned char *src, int width,
+        const double *mask, int mask_width)
+{
+    int cc;
+
+    for (cc = 0; cc + 8 <= width; cc += 8)
+    {
+        __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+        __m128d s2 = _mm_setzero_pd(), s3 = _mm_setzero_pd();
+
+        for (int ii = 0; ii < mask_width; ii++)
+        {
+            accumulate(src + cc + ii, _mm_set1_pd(mask[ii]),
+                    &s0, &s1, &s2, &s3);
+        }
+        store_rounded(dst + cc, s0, s1, s2, s3);
+    }
+
+    convolve_row_c(dst + cc, src + cc, width - cc, mask, mask_width);
+}
+
+static void
+sgm_row_sse2(unsigned int *sgm, const unsigned char *rr0,
+        const unsigned char *rr1, int width)
+{
+    const __m128i   zero = _mm_setzero_si128();
+    int             cc;
+
+    for (cc = 0; cc + 8 <= width; cc += 8)
+    {
+        __m128i nw = _mm_unpacklo_epi8(
+                _mm_loadl_epi64((const __m128i *)(rr0 + cc)), zero);
+        __m128i ne = _mm_unpacklo_epi8(
+                _mm_loadl_epi64((const __m128i *)(rr0 + cc + 1)), zero);
+        __m128i sw = _mm_unpacklo_epi8(
+                _mm_loadl_epi64((const __m128i *)(rr1 + cc)), zero);
+        __m128i se = _mm_unpacklo_epi8(
+                _mm_loadl_epi64((const __m128i *)(rr1 + cc + 1)), zero);
+        __m128i dx = _mm_sub_epi16(se, nw);
+        __m128i dy = _mm_sub_epi16(sw, ne);
+
+        /* Interleave dx and dy, so pmaddwd gives dx * dx + dy * dy. */
+        __m128i lo = _mm_unpacklo_epi16(dx, dy);
+        __m128i hi = _mm_unpackhi_epi16(dx, dy);
+        _mm_storeu_si128((__m128i *)(sgm + cc), _mm_madd_epi16(lo, lo));
+        _mm_storeu_si128((__m128i *)(sgm + cc + 4), _mm_madd_epi16(hi, hi));
+    }
+
+    sgm_row_c(sgm + cc, rr0 + cc, rr1 + cc, width - cc);
+}
+
+static void
+mark_row_sse2(unsigned char *dst, const unsigned int *sgm, int width,
+        unsigned int thresholdval)
+{
+    /* SGM values fit in a signed int, so signed compares will do. */
+    const __m128i   threshold = _mm_set1_epi32(thresholdval);
+    const __m128i   ones = _mm_set1_epi8(-1);
+    int             cc;
+
+    for (cc = 0; cc + 16 <= width; cc += 16)
+    {
+        const __m128i *pp = (const __m128i *)(sgm + cc);
+        __m128i lt0 = _mm_cmpgt_epi32(threshold, _mm_loadu_si128(pp));
+        __m128i lt1 = _mm_cmpgt_epi32(threshold, _mm_loadu_si128(pp + 1));
+        __m128i lt2 = _mm_cmpgt_epi32(threshold, _mm_loadu_si128(pp + 2));
+        __m128i lt3 = _mm_cmpgt_epi32(threshold, _mm_loadu_si128(pp + 3));
+        __m128i lt = _mm_packs_epi16(_mm_packs_epi32(lt0, lt1),
+                _mm_packs_epi32(lt2, lt3));
+        _mm_storeu_si128((__m128i *)(dst + cc), _mm_andnot_si128(lt, ones));
+    }
+
+    mark_row_c(dst + cc, sgm + cc, width - cc, thresholdval);
+}
+
+static void
+sgm_rank_sse2(const unsigned int *sgm, int nn, unsigned int val,
+        int *nless, int *nequal, unsigned int *next)
+{
+    const __m128i   value = _mm_set1_epi32(val);
+    const __m128i   none = _mm_set1_epi32(INT_MAX);
+    __m128i         less = _mm_setzero_si128();
+    __m128i         equal = _mm_setzero_si128();
+    __m128i         above = none;
+    int             ii, lanes[4], tailless, tailequal;
+    unsigned int    tailabove;
+
+    for (ii = 0; ii + 4 <= nn; ii += 4)
+    {
+        __m128i vv = _mm_loadu_si128((const __m128i *)(sgm + ii));
+        __m128i lt = _mm_cmplt_epi32(vv, value);
+        __m128i eq = _mm_cmpeq_epi32(vv, value);
+        __m128i gt = _mm_cmpgt_epi32(vv, value);
+
+        /* The masks are -1, so subtracting them counts. */
+        less = _mm_sub_epi32(less, lt);
+        equal = _mm_sub_epi32(equal, eq);
+
+        /* above = min(above, gt ? vv : INT_MAX), without SSE4.1 pminsd. */
+        __m128i cand = _mm_or_si128(_mm_and_si128(gt, vv),
+                _mm_andnot_si128(gt, none));
+        __m128i smaller = _mm_cmplt_epi32(cand, above);
+        above = _mm_or_si128(_mm_and_si128(smaller, cand),
+                _mm_andnot_si128(smaller, above));
+    }
+
+    sgm_rank_c(sgm + ii, nn - ii, val, &tailless, &tailequal, &tailabove);
+
+    _mm_storeu_si128((__m128i *)lanes, less);
+    *nless = tailless + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    _mm_storeu_si128((__m128i *)lanes, equal);
+    *nequal = tailequal + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    _mm_storeu_si128((__m128i *)lanes, above);
+    *next = tailabove;
+    for (ii = 0; ii < 4; ii++)
+    {
+        if (lanes[ii] != INT_MAX && (unsigned int)lanes[ii] < *next)
+            *next = lanes[ii];
+    }
+}
+
+static void
+histogram_split(int *counts, const unsigned char *src, int srcwidth,
+        int nrows, int rowstep, int ncols, int colstep)
+{
+    /*
+     * There is no SSE2 scatter, so this stays scalar. Neighbouring pixels
+     * tend to be the same color, and counting them in four tables avoids
+     * each increment waiting on the store of the previous one.
+     */
+    int tables[4][256];
+
+    memset(tables, 0, sizeof(tables));
+    for (int rr = 0; rr < nrows; rr++)
+    {
+        const unsigned char *row = src + rr * rowstep * srcwidth;
+        int cc = 0;
+
+        for (; cc + 4 <= ncols; cc += 4)
+        {
+            tables[0][row[cc * colstep]]++;
+            tables[1][row[(cc + 1) * colstep]]++;
+            tables[2][row[(cc + 2) * colstep]]++;
+            tables[3][row[(cc + 3) * colstep]]++;
+        }
+        for (; cc < ncols; cc++)
+            tables[0][row[cc * colstep]]++;
+    }
+
+    for (int ii = 0; ii < 256; ii++)
+        counts[ii] += tables[0][ii] + tables[1][ii] + tables[2][ii] +
+            tables[3][ii];
+}
+
+static const Kernels kernels_sse2 = {
+    "SSE2",
+    convolve_col_sse2,
+    convolve_row_sse2,
+    sgm_row_sse2,
+    mark_row_sse2,
+    sgm_rank_sse2,
+    histogram_split,
+};
+
+#endif /* USING_SSE2_KERNELS */
+
+/* Read by the commercial flagger's worker threads as well. */
+static QAtomicPointer<const Kernels> current;
+
+int
+allKernels(const Kernels **list, int maxlist)
+{
+    int nn = 0;
+
+    if (nn < maxlist)
+        list[nn++] = &kernels_c;
+
+#ifdef USING_SSE2_KERNELS
+    if (nn < maxlist && (av_get_cpu_flags() & AV_CPU_FLAG_SSE2))
+        list[nn++] = &kernels_sse2;
+#endif
+
+    return nn;
+}
+
+const Kernels *
+kernels(void)
+{
+    const Kernels *kk = current;
+    if (!kk)
+    {
+        /* The last ones are the fastest. */
+        const Kernels *list[4];
+        int nn = allKernels(list, sizeof(list) / sizeof(*list));
+
+        /* Threads racing to get here all pick the same kernels. */
+        kk = list[nn - 1];
+        if (current.testAndSetOrdered(NULL, kk))
+            LOG(VB_COMMFLAG, LOG_INFO,
+                QString("Using %1 frame kernels").arg(kk->name));
+        else
+            kk = current;
+    }
+    return kk;
+}
+
+void
+setKernels(const Kernels *kk)
+{
+    current.fetchAndStoreOrdered(kk);
+}
+
+};  /* namespace */
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
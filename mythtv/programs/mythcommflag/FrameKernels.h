@@ -0,0 +1,68 @@
+/*
+ * FrameKernels
+ *
+ * Inner loops of the edge detection, convolution and histogram code, with
+ * SIMD versions selected at runtime. Every version gives the same results
+ * as the portable C version, bit for bit.
+ */
+
+#ifndef __FRAMEKERNELS_H__
+#define __FRAMEKERNELS_H__
+
+/* Largest squared gradient magnitude of a greyscale image. */
+#define SGM_MAX     (2 * 255 * 255)
+
+namespace frameKernels {
+
+typedef struct {
+    const char  *name;
+
+    /*
+     * Convolve "width" pixels with a vertical mask of "mask_width" rows;
+     * "src" is the top row under the mask.
+     */
+    void    (*convolve_col)(unsigned char *dst, const unsigned char *src,
+                int srcwidth, int width, const double *mask, int mask_width);
+
+    /*
+     * Convolve "width" pixels with a horizontal mask; "src" is the leftmost
+     * pixel under the mask.
+     */
+    void    (*convolve_row)(unsigned char *dst, const unsigned char *src,
+                int width, const double *mask, int mask_width);
+
+    /*
+     * Squared gradient magnitudes of "width" pixels, from two consecutive
+     * rows. Reads "width + 1" pixels of each row.
+     */
+    void    (*sgm_row)(unsigned int *sgm, const unsigned char *rr0,
+                const unsigned char *rr1, int width);
+
+    /* Set "dst" to UCHAR_MAX where "sgm" >= "thresholdval", else to 0. */
+    void    (*mark_row)(unsigned char *dst, const unsigned int *sgm,
+                int width, unsigned int thresholdval);
+
+    /*
+     * Count the SGM values below and equal to "val", and find the smallest
+     * one above it (UINT_MAX if none).
+     */
+    void    (*sgm_rank)(const unsigned int *sgm, int nn, unsigned int val,
+                int *nless, int *nequal, unsigned int *next);
+
+    /* Count every "colstep"-th pixel of every "rowstep"-th row. */
+    void    (*histogram)(int *counts, const unsigned char *src, int srcwidth,
+                int nrows, int rowstep, int ncols, int colstep);
+} Kernels;
+
+/* The kernels used by the commercial flagger. */
+const Kernels *kernels(void);
+void setKernels(const Kernels *kk);
+
+/* All the kernels this CPU can run; the portable C version comes first. */
+int allKernels(const Kernels **list, int maxlist);
+
+};  /* namespace */
+
+#endif  /* !__FRAMEKERNELS_H__ */
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -1,4 +1,5 @@
 #include "Histogram.h"
+#include "FrameKernels.h"
 #include <string>
 #include <cmath>
 #include <cstring>
@@ -29,12 +30,16 @@ void Histogram::generateFromImage(unsigned char* frame, unsigned int frameWidth,
     if (maxScanY > frameHeight-1)
         maxScanY = frameHeight-1;
 
-    for(unsigned int y = minScanY; y < maxScanY; y += YSpacing)
-        for(unsigned int x = minScanX; x < maxScanX; x += XSpacing)
-        {
-            data[frame[y * frameWidth + x]]++;
-            numberOfSamples++;
-        }
+    if (minScanX >= maxScanX || minScanY >= maxScanY)
+        return;
+
+    unsigned int columns = (maxScanX - minScanX + XSpacing - 1) / XSpacing;
+    unsigned int rows = (maxScanY - minScanY + YSpacing - 1) / YSpacing;
+
+    frameKernels::kernels()->histogram(data,
+        frame + minScanY * frameWidth + minScanX, frameWidth,
+        rows, YSpacing, columns, XSpacing);
+    numberOfSamples = rows * columns;
 }
 
 unsigned int Histogram::getAverageIntensity(void) const
@@ -64,6 +64,10 @@ void MythCommFlagCommandLineParser::LoadArguments(void)
         "off, blank, scene, blankscene, logo, all, "
         "d2, d2_logo, d2_blank, d2_scene, d2_all", "")
             ->SetGroup("Commflagging");
+    add("--pipeline", "pipeline", false,
+        "Run the d2 frame analyzers on their own threads while "
+        "the next frames are decoded.", "")
+            ->SetGroup("Commflagging");
     add("--outputmethod", "outputmethod", "",
         "Format of output written to outputfile, essentials, full.", "")
             ->SetGroup("Commflagging");
@@ -17,8 +17,9 @@ HEADERS += ClassicCommDetector.h
 HEADERS += Histogram.h
 HEADERS += quickselect.h
 HEADERS += CommDetector2.h
+HEADERS += AnalyzerPipeline.h
 HEADERS += pgm.h
-HEADERS += EdgeDetector.h CannyEdgeDetector.h
+HEADERS += EdgeDetector.h CannyEdgeDetector.h FrameKernels.h
 HEADERS += PGMConverter.h BorderDetector.h
 HEADERS += FrameAnalyzer.h
 HEADERS += TemplateFinder.h TemplateMatcher.h
@@ -37,9 +38,9 @@ SOURCES += ClassicSceneChangeDetector.cpp
 SOURCES += ClassicCommDetector.cpp
 SOURCES += Histogram.cpp
 SOURCES += quickselect.c
-SOURCES += CommDetector2.cpp
+SOURCES += CommDetector2.cpp AnalyzerPipeline.cpp
 SOURCES += pgm.cpp
-SOURCES += EdgeDetector.cpp CannyEdgeDetector.cpp
+SOURCES += EdgeDetector.cpp CannyEdgeDetector.cpp FrameKernels.cpp
 SOURCES += PGMConverter.cpp BorderDetector.cpp
 SOURCES += FrameAnalyzer.cpp
 SOURCES += TemplateFinder.cpp TemplateMatcher.cpp
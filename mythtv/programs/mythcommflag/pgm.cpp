@@ -7,6 +7,7 @@ extern "C" {
 #include "mythlogging.h"
 #include "myth_imgconvert.h"
 #include "pgm.h"
+#include "FrameKernels.h"
 
 // TODO: verify this
 /*
@@ -248,11 +249,12 @@ int pgm_convolve_radial(AVPicture *dst, AVPicture *s1, AVPicture *s2,
      * two-dimensional convolution with two commutative single-dimensional
      * convolutions.
      */
+    const frameKernels::Kernels *kernels = frameKernels::kernels();
     const int       srcwidth = src->linesize[0];
     const int       newwidth = srcwidth + 2 * mask_radius;
     const int       newheight = srcheight + 2 * mask_radius;
-    int             ii, rr, cc, rr2, cc2;
-    double          sum;
+    const int       mask_width = 2 * mask_radius + 1;
+    int             rr, rr2;
 
     /* Get a padded copy of the src image for use by the convolutions. */
     if (pgm_expand_uniform(s1, src, srcheight, mask_radius))
@@ -264,34 +266,18 @@ int pgm_convolve_radial(AVPicture *dst, AVPicture *s1, AVPicture *s2,
 
     /* "s1" convolve with column vector => "s2" */
     rr2 = mask_radius + srcheight;
-    cc2 = mask_radius + srcwidth;
     for (rr = mask_radius; rr < rr2; rr++)
     {
-        for (cc = mask_radius; cc < cc2; cc++)
-        {
-            sum = 0;
-            for (ii = -mask_radius; ii <= mask_radius; ii++)
-            {
-                sum += mask[ii + mask_radius] *
-                    s1->data[0][(rr + ii) * newwidth + cc];
-            }
-            s2->data[0][rr * newwidth + cc] = (unsigned char)(sum + 0.5);
-        }
+        kernels->convolve_col(s2->data[0] + rr * newwidth + mask_radius,
+                s1->data[0] + (rr - mask_radius) * newwidth + mask_radius,
+                newwidth, srcwidth, mask, mask_width);
     }
 
     /* "s2" convolve with row vector => "dst" */
     for (rr = mask_radius; rr < rr2; rr++)
     {
-        for (cc = mask_radius; cc < cc2; cc++)
-        {
-            sum = 0;
-            for (ii = -mask_radius; ii <= mask_radius; ii++)
-            {
-                sum += mask[ii + mask_radius] *
-                    s2->data[0][rr * newwidth + cc + ii];
-            }
-            dst->data[0][rr * newwidth + cc] = (unsigned char)(sum + 0.5);
-        }
+        kernels->convolve_row(dst->data[0] + rr * newwidth + mask_radius,
+                s2->data[0] + rr * newwidth, srcwidth, mask, mask_width);
     }
 
     return 0;
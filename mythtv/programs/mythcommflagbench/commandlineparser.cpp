@@ -0,0 +1,35 @@
+#include "commandlineparser.h"
+#include "mythcorecontext.h"
+
+MythCommFlagBenchCommandLineParser::MythCommFlagBenchCommandLineParser() :
+    MythCommandLineParser(MYTH_APPNAME_MYTHCOMMFLAGBENCH)
+{
+    LoadArguments();
+}
+
+void MythCommFlagBenchCommandLineParser::LoadArguments(void)
+{
+    addHelp();
+    addVersion();
+    addLogging("none", LOG_ERR);
+    add("--width", "width", 720,
+            "Width of the test frame (default: 720).", "");
+    add("--height", "height", 480,
+            "Height of the test frame (default: 480).", "");
+    add("--frames", "frames", 50,
+            "Number of frames in each run (default: 50).", "");
+    add("--iterations", "iterations", 5,
+            "Number of times each step is run (default: 5).",
+            "The fastest run of each step is reported.");
+    add("--checkonly", "checkonly", false,
+            "Only check that all the kernels give the same results.", "");
+}
+
+QString MythCommFlagBenchCommandLineParser::GetHelpHeader(void) const
+{
+    return
+        "MythCommFlagBench times the edge detection, convolution and\n"
+        "histogram kernels of mythcommflag on a synthetic frame, for each\n"
+        "instruction set this CPU supports, and checks that they all give\n"
+        "the same results as the portable C kernels.";
+}
@@ -0,0 +1,453 @@
+// -*- Mode: c++ -*-
+
+// C++ headers
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+// Qt headers
+#include <QCoreApplication>
+#include <QStringList>
+#include <QByteArray>
+#include <QString>
+
+// FFmpeg headers
+extern "C" {
+#include "libavcodec/avcodec.h"
+}
+
+// MythTV headers
+#include "commandlineparser.h"
+#include "mythcorecontext.h"
+#include "mythlogging.h"
+#include "mythtimer.h"
+#include "exitcodes.h"
+
+// Commercial Flagging headers
+#include "CannyEdgeDetector.h"
+#include "EdgeDetector.h"
+#include "FrameKernels.h"
+#include "pgm.h"
+
+using namespace frameKernels;
+using namespace edgeDetector;
+
+static const int kMaskRadius = 2;
+static const int kPercentile = 90;
+
+/// The buffers CannyEdgeDetector uses for a frame.
+class Frame
+{
+  public:
+    Frame(int width, int height) :
+        m_width(width), m_height(height),
+        m_paddedWidth(width + 2 * kMaskRadius),
+        m_paddedHeight(height + 2 * kMaskRadius)
+    {
+        avpicture_alloc(&m_pgm, PIX_FMT_GRAY8, m_width, m_height);
+        avpicture_alloc(&m_s1, PIX_FMT_GRAY8, m_paddedWidth, m_paddedHeight);
+        avpicture_alloc(&m_s2, PIX_FMT_GRAY8, m_paddedWidth, m_paddedHeight);
+        avpicture_alloc(&m_convolved, PIX_FMT_GRAY8,
+                        m_paddedWidth, m_paddedHeight);
+        avpicture_alloc(&m_edges, PIX_FMT_GRAY8, m_width, m_height);
+        m_sgm = new unsigned int[m_paddedWidth * m_paddedHeight];
+        m_sgmsorted = new unsigned int[m_width * m_height];
+
+        // A logo sized area, as excluded by the TemplateMatcher
+        m_excludeRow = m_height / 10;
+        m_excludeCol = m_width * 3 / 4;
+        m_excludeWidth = m_width / 8;
+        m_excludeHeight = m_height / 8;
+    }
+
+    ~Frame()
+    {
+        delete [] m_sgmsorted;
+        delete [] m_sgm;
+        avpicture_free(&m_edges);
+        avpicture_free(&m_convolved);
+        avpicture_free(&m_s2);
+        avpicture_free(&m_s1);
+        avpicture_free(&m_pgm);
+    }
+
+    int         m_width, m_height;
+    int         m_paddedWidth, m_paddedHeight;
+    AVPicture   m_pgm, m_s1, m_s2, m_convolved, m_edges;
+    unsigned int *m_sgm, *m_sgmsorted;
+    int         m_excludeRow, m_excludeCol;
+    int         m_excludeWidth, m_excludeHeight;
+};
+
+/// A gradient background with a few hard edged boxes and some noise.
+static void make_frame(Frame &frame)
+{
+    unsigned char *buf = frame.m_pgm.data[0];
+    int width = frame.m_width;
+    int height = frame.m_height;
+    unsigned int seed = 12345;
+
+    for (int rr = 0; rr < height; rr++)
+    {
+        for (int cc = 0; cc < width; cc++)
+        {
+            int val = 16 + rr * 160 / height + cc * 40 / width;
+
+            if (rr > height / 8 && rr < height / 5 &&
+                cc > width * 4 / 5 && cc < width * 7 / 8)
+                val = 235;  // logo
+            else if (rr > height / 3 && rr < height * 2 / 3 &&
+                     cc > width / 4 && cc < width / 2)
+                val = 60 + (cc / 16 % 2) * 120;  // stripes
+            else if (rr > height * 7 / 8)
+                val = 16;  // black band
+
+            seed = seed * 1103515245 + 12345;
+            val += (int)((seed >> 16) % 9) - 4;
+            buf[rr * width + cc] = min(max(val, 0), 255);
+        }
+    }
+}
+
+/// The Gaussian mask of CannyEdgeDetector.
+static void make_mask(double *mask)
+{
+    const double sigma = 0.5;
+    double sum = 1.0;
+
+    mask[kMaskRadius] = 1.0;
+    for (int rr = 1; rr <= kMaskRadius; rr++)
+    {
+        double val = exp(-(rr * rr) / (2 * sigma * sigma));
+        mask[kMaskRadius + rr] = val;
+        mask[kMaskRadius - rr] = val;
+        sum += 2 * val;
+    }
+    for (int ii = 0; ii < 2 * kMaskRadius + 1; ii++)
+        mask[ii] /= sum;
+}
+
+static void do_convolve(Frame &frame, const double *mask)
+{
+    pgm_convolve_radial(&frame.m_convolved, &frame.m_s1, &frame.m_s2,
+                        &frame.m_pgm, frame.m_height, mask, kMaskRadius);
+}
+
+static void do_sgm(Frame &frame)
+{
+    sgm_init_exclude(frame.m_sgm, &frame.m_convolved, frame.m_paddedHeight,
+                     frame.m_excludeRow + kMaskRadius,
+                     frame.m_excludeCol + kMaskRadius,
+                     frame.m_excludeWidth, frame.m_excludeHeight);
+}
+
+static void do_mark(Frame &frame)
+{
+    edge_mark_uniform_exclude(&frame.m_edges, frame.m_height, kMaskRadius,
+                              frame.m_sgm, frame.m_sgmsorted, kPercentile,
+                              frame.m_excludeRow, frame.m_excludeCol,
+                              frame.m_excludeWidth, frame.m_excludeHeight);
+}
+
+static void do_histogram(Frame &frame, int *counts, int step)
+{
+    memset(counts, 0, 256 * sizeof(*counts));
+    kernels()->histogram(counts, frame.m_pgm.data[0], frame.m_width,
+                         (frame.m_height + step - 1) / step, step,
+                         (frame.m_width + step - 1) / step, step);
+}
+
+/// The threshold selection edge_mark() used to do, by sorting all values.
+static int reference_threshold(unsigned int *sgmvals, int nn, int percentile,
+                               unsigned int *thresholdval)
+{
+    vector<unsigned int> sorted(sgmvals, sgmvals + nn);
+    sort(sorted.begin(), sorted.end());
+
+    int ii = percentile * nn / 100;
+    unsigned int val = sorted[ii];
+
+    int first;
+    for (first = ii; first > 0 && sorted[first] == val; first--) ;
+    if (sorted[first] != val)
+        first++;
+    if (first * 100 / nn < 95)
+    {
+        int last;
+        for (last = ii; last < nn - 1 && sorted[last] == val; last++) ;
+        if (sorted[last] != val)
+            last--;
+
+        unsigned int newval = sorted[min(last + 1, nn - 1)];
+        if (val == newval)
+            return -1;
+        val = newval;
+    }
+
+    *thresholdval = val;
+    return 0;
+}
+
+/// Runs every step once, and keeps what they produced.
+static QByteArray run_steps(Frame &frame, const double *mask)
+{
+    QByteArray out;
+    int counts[256];
+
+    do_convolve(frame, mask);
+    out.append((const char *)frame.m_convolved.data[0],
+               frame.m_paddedWidth * frame.m_paddedHeight);
+
+    do_sgm(frame);
+    out.append((const char *)frame.m_sgm,
+               frame.m_paddedWidth * frame.m_paddedHeight *
+               sizeof(*frame.m_sgm));
+
+    // sgm_threshold() reorders the values, so check it on a copy
+    int nn = frame.m_width * frame.m_height;
+    vector<unsigned int> sgmvals(nn);
+    for (int rr = 0; rr < frame.m_height; rr++)
+    {
+        memcpy(&sgmvals[rr * frame.m_width],
+               frame.m_sgm + (rr + kMaskRadius) * frame.m_paddedWidth +
+               kMaskRadius, frame.m_width * sizeof(*frame.m_sgm));
+    }
+    int percentiles[] = { 50, 90, 95, 99 };
+    for (uint ii = 0; ii < sizeof(percentiles) / sizeof(*percentiles); ii++)
+    {
+        vector<unsigned int> vals = sgmvals;
+        unsigned int val = 0, refval = 0;
+        int ret = sgm_threshold(&vals[0], nn, percentiles[ii], &val);
+        int refret = reference_threshold(&vals[0], nn, percentiles[ii],
+                                         &refval);
+        if (ret != refret || val != refval)
+        {
+            cerr << "sgm_threshold differs from sorting at percentile "
+                 << percentiles[ii] << endl;
+            return QByteArray();
+        }
+    }
+
+    do_mark(frame);
+    out.append((const char *)frame.m_edges.data[0],
+               frame.m_width * frame.m_height);
+
+    CannyEdgeDetector canny;
+    canny.setExcludeArea(frame.m_excludeRow, frame.m_excludeCol,
+                         frame.m_excludeWidth, frame.m_excludeHeight);
+    const AVPicture *edges = canny.detectEdges(&frame.m_pgm, frame.m_height,
+                                               kPercentile);
+    if (!edges)
+        return QByteArray();
+    out.append((const char *)edges->data[0], frame.m_width * frame.m_height);
+
+    for (int step = 1; step <= 4; step++)
+    {
+        do_histogram(frame, counts, step);
+        out.append((const char *)counts, sizeof(counts));
+    }
+
+    return out;
+}
+
+/// Checks that every set of kernels gives the results of the C kernels.
+static bool check_kernels(int width, int height, const double *mask,
+                          const Kernels **list, int nkernels)
+{
+    Frame frame(width, height);
+    make_frame(frame);
+
+    setKernels(list[0]);
+    QByteArray expected = run_steps(frame, mask);
+    if (expected.isEmpty())
+        return false;
+
+    bool ok = true;
+    for (int ii = 1; ii < nkernels; ii++)
+    {
+        setKernels(list[ii]);
+        if (run_steps(frame, mask) != expected)
+        {
+            cerr << qPrintable(QString("%1 kernels differ from %2 at %3x%4")
+                               .arg(list[ii]->name).arg(list[0]->name)
+                               .arg(width).arg(height)) << endl;
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+enum BenchStep
+{
+    kStepConvolve,
+    kStepSGM,
+    kStepMark,
+    kStepCanny,
+    kStepHistogram,
+    kStepCount
+};
+
+static const char *kStepNames[kStepCount] =
+{
+    "convolve", "sgm", "threshold", "canny", "histogram",
+};
+
+/// Best time in ms of running step on frames frames.
+static int time_step(BenchStep step, Frame &frame, const double *mask,
+                     uint frames, uint iterations)
+{
+    CannyEdgeDetector canny;
+    canny.setExcludeArea(frame.m_excludeRow, frame.m_excludeCol,
+                         frame.m_excludeWidth, frame.m_excludeHeight);
+    int counts[256];
+
+    // The later steps work on what the earlier ones produced
+    do_convolve(frame, mask);
+    do_sgm(frame);
+
+    int best = INT_MAX;
+    for (uint ii = 0; ii < iterations; ii++)
+    {
+        MythTimer t;
+        t.start();
+        for (uint jj = 0; jj < frames; jj++)
+        {
+            switch (step)
+            {
+                case kStepConvolve:
+                    do_convolve(frame, mask);
+                    break;
+                case kStepSGM:
+                    do_sgm(frame);
+                    break;
+                case kStepMark:
+                    do_mark(frame);
+                    break;
+                case kStepCanny:
+                    canny.detectEdges(&frame.m_pgm, frame.m_height,
+                                      kPercentile);
+                    break;
+                default:
+                    do_histogram(frame, counts, 1);
+                    break;
+            }
+        }
+        best = min(best, t.elapsed());
+    }
+
+    return best;
+}
+
+static int RunBench(int width, int height, uint frames, uint iterations,
+                    bool checkonly)
+{
+    const Kernels *list[4];
+    int nkernels = allKernels(list, sizeof(list) / sizeof(*list));
+    double mask[2 * kMaskRadius + 1];
+    make_mask(mask);
+
+    // Odd sizes too, for the pixels left over by the SIMD loops
+    bool ok = check_kernels(width, height, mask, list, nkernels) &&
+        check_kernels(width - 5, height - 3, mask, list, nkernels);
+    if (!ok)
+        return GENERIC_EXIT_NOT_OK;
+
+    QStringList names;
+    for (int ii = 0; ii < nkernels; ii++)
+        names << list[ii]->name;
+    cout << qPrintable(QString("Kernels: %1, results match")
+                       .arg(names.join(", "))) << endl;
+
+    if (checkonly)
+        return GENERIC_EXIT_OK;
+
+    cout << qPrintable(QString("%1x%2, %3 frames per run, best of %4 runs")
+                       .arg(width).arg(height).arg(frames).arg(iterations))
+         << endl;
+
+    Frame frame(width, height);
+    make_frame(frame);
+
+    int reference[kStepCount];
+    for (int ii = 0; ii < nkernels; ii++)
+    {
+        setKernels(list[ii]);
+        cout << list[ii]->name << endl;
+
+        for (int step = 0; step < kStepCount; step++)
+        {
+            int elapsed = time_step((BenchStep)step, frame, mask,
+                                    frames, iterations);
+            if (ii == 0)
+                reference[step] = elapsed;
+
+            QString speedup;
+            if (ii > 0)
+            {
+                speedup = QString(" (%1x)").arg(
+                    double(max(reference[step], 1)) / max(elapsed, 1),
+                    0, 'f', 1);
+            }
+            cout << qPrintable(QString("  %1 %2 ms, %3 fps%4")
+                               .arg(QString(kStepNames[step]) + ':', -10)
+                               .arg(elapsed, 5)
+                               .arg(frames * 1000.0 / max(elapsed, 1),
+                                    7, 'f', 1)
+                               .arg(speedup))
+                 << endl;
+        }
+    }
+
+    return GENERIC_EXIT_OK;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCoreApplication::setApplicationName(MYTH_APPNAME_MYTHCOMMFLAGBENCH);
+
+    MythCommFlagBenchCommandLineParser cmdline;
+    if (!cmdline.Parse(argc, argv))
+    {
+        cmdline.PrintHelp();
+        return GENERIC_EXIT_INVALID_CMDLINE;
+    }
+
+    if (cmdline.toBool("showhelp"))
+    {
+        cmdline.PrintHelp();
+        return GENERIC_EXIT_OK;
+    }
+
+    if (cmdline.toBool("showversion"))
+    {
+        cmdline.PrintVersion();
+        return GENERIC_EXIT_OK;
+    }
+
+    int retval = cmdline.ConfigureLogging("none");
+    if (retval != GENERIC_EXIT_OK)
+        return retval;
+
+    int width = cmdline.toInt("width");
+    int height = cmdline.toInt("height");
+    int frames = cmdline.toInt("frames");
+    int iterations = cmdline.toInt("iterations");
+    if (width < 32 || height < 32 || frames < 1 || iterations < 1)
+    {
+        cerr << "Invalid --width, --height, --frames or --iterations" << endl;
+        return GENERIC_EXIT_INVALID_CMDLINE;
+    }
+
+    return RunBench(width, height, frames, iterations,
+                    cmdline.toBool("checkonly"));
+}
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
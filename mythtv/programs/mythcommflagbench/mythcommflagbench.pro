@@ -0,0 +1,25 @@
+include ( ../../settings.pro )
+include ( ../../version.pro )
+include ( ../programs-libs.pro )
+
+QT += network xml sql
+
+TEMPLATE = app
+CONFIG += thread
+TARGET = mythcommflagbench
+target.path = $${PREFIX}/bin
+INSTALLS = target
+
+QMAKE_CLEAN += $(TARGET)
+
+INCLUDEPATH += ../mythcommflag
+
+# Input
+HEADERS += commandlineparser.h
+
+SOURCES += main.cpp commandlineparser.cpp
+
+# The commercial flagging code being measured
+SOURCES += ../mythcommflag/FrameKernels.cpp ../mythcommflag/pgm.cpp
+SOURCES += ../mythcommflag/EdgeDetector.cpp
+SOURCES += ../mythcommflag/CannyEdgeDetector.cpp
@@ -200,6 +200,19 @@ void MythFillDatabaseCommandLineParser::LoadArguments(void)
             "Download as little listings data as possible to update the "
             "channel lineup.")
         ->SetGroup("Channel List Handling");
+    add("--xmltv-streaming", "xmltvstreaming", false,
+            "parse XMLTV listings incrementally",
+            "Parse XMLTV listings one element at a time and insert each "
+            "channel's programs as soon as they have been read, instead "
+            "of loading the whole file into memory first. This keeps "
+            "memory use bounded for very large listings files, which "
+            "should be grouped by channel as tv_sort outputs them.");
+    add("--bulk-insert", "bulkinsert", false,
+            "insert programs using multi-row statements",
+            "Queue new programs, ratings and credits and write them to "
+            "the database with multi-row statements, one batch per "
+            "channel, instead of one statement per row. A per-phase "
+            "timing summary is logged when the update completes.");
     add("--no-mark-repeats", "markrepeats", true, "do not mark repeats", "");
     add("--export-icon-map", "exporticonmap", "iconmap.xml",
             "export icon map to file", "")
@@ -27,6 +27,7 @@ using namespace std;
 #include "mythdirs.h"
 #include "mythdb.h"
 #include "mythsystem.h"
+#include "mythtimer.h"
 #include "videosource.h" // for is_grabber..
 
 // filldata headers
@@ -323,8 +324,80 @@ bool FillData::GrabDDData(Source source, int poffset,
 }
 
 // XMLTV stuff
+class FillDataStreamHandler : public XMLTVStreamHandler
+{
+  public:
+    FillDataStreamHandler(FillData *fd, int id) :
+        fill_data(fd), sourceid(id), proglist_count(0),
+        unchanged(0), updated(0),
+        batch(fd->bulk_insert ? new DBEventBatch() : NULL) {}
+
+    ~FillDataStreamHandler() { delete batch; }
+
+    void HandleChannels(QList<ChanInfo> &chanlist)
+    {
+        fill_data->chan_data.handleChannels(sourceid, &chanlist);
+        fill_data->icon_data.UpdateSourceIcons(sourceid);
+    }
+
+    void HandlePrograms(const QString &xmltvid, QList<ProgInfo> &proglist)
+    {
+        proglist_count++;
+        ProgramData::HandleChannelPrograms(
+            sourceid, xmltvid, proglist, unchanged, updated, batch);
+    }
+
+  public:
+    FillData *fill_data;
+    int       sourceid;
+    uint      proglist_count;
+    uint      unchanged;
+    uint      updated;
+    DBEventBatch *batch;
+};
+
 bool FillData::GrabDataFromFile(int id, QString &filename)
 {
+    if (xmltv_streaming)
+    {
+        FillDataStreamHandler handler(this, id);
+
+        MythTimer timer;
+        timer.start();
+
+        bool split = false;
+        if (xmltv_parser.parseFileStreaming(filename, &handler, split))
+        {
+            int msecs = timer.elapsed();
+
+            if (handler.proglist_count == 0)
+            {
+                LOG(VB_GENERAL, LOG_INFO, "No programs found in data.");
+                endofdata = true;
+            }
+            else
+            {
+                LOG(VB_GENERAL, LOG_INFO,
+                    QString("Updated programs: %1 Unchanged programs: %2")
+                        .arg(handler.updated) .arg(handler.unchanged));
+                LOG(VB_GENERAL, LOG_INFO,
+                    QString("Parsing and program update took %1 ms%2")
+                        .arg(msecs)
+                        .arg(handler.batch ?
+                             handler.batch->GetStatistics() : QString()));
+            }
+            return true;
+        }
+
+        if (!split)
+            return false;
+
+        // The channels already handled are simply updated again
+        LOG(VB_GENERAL, LOG_WARNING,
+            "The listings are not grouped by channel, reading the whole "
+            "file instead.");
+    }
+
     QList<ChanInfo> chanlist;
     QMap<QString, QList<ProgInfo> > proglist;
 
@@ -340,7 +413,7 @@ bool FillData::GrabDataFromFile(int id, QString &filename)
     }
     else
     {
-        prog_data.HandlePrograms(id, proglist);
+        prog_data.HandlePrograms(id, proglist, bulk_insert);
     }
     return true;
 }
@@ -324,6 +324,10 @@ int main(int argc, char *argv[])
     }
     if (cmdline.toBool("onlychannels"))
         fill_data.only_update_channels = true;
+    if (cmdline.toBool("xmltvstreaming"))
+        fill_data.xmltv_streaming = true;
+    if (cmdline.toBool("bulkinsert"))
+        fill_data.bulk_insert = true;
 
     mark_repeats = cmdline.toBool("markrepeats");
     if (cmdline.toBool("exporticonmap"))
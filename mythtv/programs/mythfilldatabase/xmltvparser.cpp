@@ -5,6 +5,8 @@
 #include <QStringList>
 #include <QDateTime>
 #include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QSet>
 #include <QUrl>
 
 // C++ headers
@@ -581,6 +583,118 @@ ProgInfo *XMLTVParser::parseProgram(
     return pginfo;
 }
 
+static int getLocalTimezoneOffset(void)
+{
+    // now we calculate the localTimezoneOffset, so that we can fix
+    // the programdata if needed
+    QString config_offset = gCoreContext->GetSetting("TimeOffset", "None");
+    // we disable this feature by setting it invalid (> 840min = 14hr)
+    int localTimezoneOffset = 841;
+
+    if (config_offset == "Auto")
+    {
+        // we mark auto with the -ve of the disable magic number
+        localTimezoneOffset = -841;
+    }
+    else if (config_offset != "None")
+    {
+        localTimezoneOffset = TimezoneToInt(config_offset);
+        if (abs(localTimezoneOffset) > 840)
+        {
+            LOG(VB_XMLTV, LOG_ERR, QString("Ignoring invalid TimeOffset %1")
+                .arg(config_offset));
+            localTimezoneOffset = 841;
+        }
+    }
+
+    return localTimezoneOffset;
+}
+
+static void checkSourceUrl(const QString &source_info_url)
+{
+    QUrl sourceUrl(source_info_url);
+    if (sourceUrl.toString() == "http://labs.zap2it.com/")
+    {
+        LOG(VB_GENERAL, LOG_ERR, "Don't use tv_grab_na_dd, use the"
+                                 "internal datadirect grabber.");
+        exit(GENERIC_EXIT_SETUP_ERROR);
+    }
+}
+
+void XMLTVParser::resetGrouping(void)
+{
+    aggregatedTitle.clear();
+    aggregatedDesc.clear();
+    groupingTitle.clear();
+    groupingDesc.clear();
+}
+
+/** \brief Applies grouping markers and clumps to a freshly parsed program.
+ *
+ *  \return true if the program should be added to the program list.
+ */
+bool XMLTVParser::groupProgram(ProgInfo *pginfo)
+{
+    if (pginfo->startts == pginfo->endts)
+    {
+        /* Not a real program : just a grouping marker */
+        if (!pginfo->title.isEmpty())
+            groupingTitle = pginfo->title + " : ";
+
+        if (!pginfo->description.isEmpty())
+            groupingDesc = pginfo->description + " : ";
+
+        return false;
+    }
+
+    if (pginfo->clumpidx.isEmpty())
+    {
+        if (!groupingTitle.isEmpty())
+        {
+            pginfo->title.prepend(groupingTitle);
+            groupingTitle.clear();
+        }
+
+        if (!groupingDesc.isEmpty())
+        {
+            pginfo->description.prepend(groupingDesc);
+            groupingDesc.clear();
+        }
+
+        return true;
+    }
+
+    /* append all titles/descriptions from one clump */
+    if (pginfo->clumpidx.toInt() == 0)
+    {
+        aggregatedTitle.clear();
+        aggregatedDesc.clear();
+    }
+
+    if (!pginfo->title.isEmpty())
+    {
+        if (!aggregatedTitle.isEmpty())
+            aggregatedTitle.append(" | ");
+        aggregatedTitle.append(pginfo->title);
+    }
+
+    if (!pginfo->description.isEmpty())
+    {
+        if (!aggregatedDesc.isEmpty())
+            aggregatedDesc.append(" | ");
+        aggregatedDesc.append(pginfo->description);
+    }
+
+    if (pginfo->clumpidx.toInt() == pginfo->clumpmax.toInt() - 1)
+    {
+        pginfo->title = aggregatedTitle;
+        pginfo->description = aggregatedDesc;
+        return true;
+    }
+
+    return false;
+}
+
 bool XMLTVParser::parseFile(
     QString filename, QList<ChanInfo> *chanlist,
     QMap<QString, QList<ProgInfo> > *proglist)
@@ -605,49 +719,20 @@ bool XMLTVParser::parseFile(
             .arg(errorLine).arg(errorColumn).arg(errorMsg));
 
         f.close();
-        return true;
+        return false;
     }
 
     f.close();
 
-    // now we calculate the localTimezoneOffset, so that we can fix
-    // the programdata if needed
-    QString config_offset = gCoreContext->GetSetting("TimeOffset", "None");
-    // we disable this feature by setting it invalid (> 840min = 14hr)
-    int localTimezoneOffset = 841;
-
-    if (config_offset == "Auto")
-    {
-        // we mark auto with the -ve of the disable magic number
-        localTimezoneOffset = -841;
-    }
-    else if (config_offset != "None")
-    {
-        localTimezoneOffset = TimezoneToInt(config_offset);
-        if (abs(localTimezoneOffset) > 840)
-        {
-            LOG(VB_XMLTV, LOG_ERR, QString("Ignoring invalid TimeOffset %1")
-                .arg(config_offset));
-            localTimezoneOffset = 841;
-        }
-    }
+    int localTimezoneOffset = getLocalTimezoneOffset();
 
     QDomElement docElem = doc.documentElement();
 
     QUrl baseUrl(docElem.attribute("source-data-url", ""));
 
-    QUrl sourceUrl(docElem.attribute("source-info-url", ""));
-    if (sourceUrl.toString() == "http://labs.zap2it.com/")
-    {
-        LOG(VB_GENERAL, LOG_ERR, "Don't use tv_grab_na_dd, use the"
-                                 "internal datadirect grabber.");
-        exit(GENERIC_EXIT_SETUP_ERROR);
-    }
+    checkSourceUrl(docElem.attribute("source-info-url", ""));
 
-    QString aggregatedTitle;
-    QString aggregatedDesc;
-    QString groupingTitle;
-    QString groupingDesc;
+    resetGrouping();
 
     QDomNode n = docElem.firstChild();
     while (!n.isNull())
@@ -665,70 +750,174 @@ bool XMLTVParser::parseFile(
             {
                 ProgInfo *pginfo = parseProgram(e, localTimezoneOffset);
 
-                if (pginfo->startts == pginfo->endts)
-                {
-                    /* Not a real program : just a grouping marker */
-                    if (!pginfo->title.isEmpty())
-                        groupingTitle = pginfo->title + " : ";
+                if (groupProgram(pginfo))
+                    (*proglist)[pginfo->channel].push_back(*pginfo);
+
+                delete pginfo;
+            }
+        }
+        n = n.nextSibling();
+    }
+
+    return true;
+}
+
+/// Reads the element the stream is positioned on, including all of its
+/// children, into a detached QDomElement owned by doc.
+static QDomElement readDomElement(QXmlStreamReader &xml, QDomDocument &doc)
+{
+    QDomElement element = doc.createElement(xml.name().toString());
+
+    QXmlStreamAttributes attrs = xml.attributes();
+    for (int i = 0; i < attrs.size(); ++i)
+    {
+        element.setAttribute(attrs[i].qualifiedName().toString(),
+                             attrs[i].value().toString());
+    }
+
+    while (!xml.atEnd())
+    {
+        xml.readNext();
+
+        if (xml.isStartElement())
+            element.appendChild(readDomElement(xml, doc));
+        else if (xml.isCharacters() && !xml.isWhitespace())
+            element.appendChild(doc.createTextNode(xml.text().toString()));
+        else if (xml.isEndElement())
+            break;
+    }
+
+    return element;
+}
+
+/** \brief Parses an XMLTV file without loading the whole document.
+ *
+ *  Only one channel or programme element is held in memory at a time.
+ *  Programmes are accumulated while they belong to the same channel and
+ *  handed to the handler as soon as a programme for a different channel
+ *  is seen, so peak memory is bounded by the largest contiguous block of
+ *  programmes for one channel. Grabbers output listings grouped by
+ *  channel, so this is normally a single channel's worth of data.
+ *
+ *  The end times of a channel's programmes are fixed up from the
+ *  programmes following them, so a channel must not come in more than
+ *  one block. If it does, parsing stops and split is set, for the
+ *  caller to read the file with parseFile() instead.
+ *
+ *  \return false if the file could not be read, is not well formed, or
+ *          a channel is split.
+ */
+bool XMLTVParser::parseFileStreaming(
+    QString filename, XMLTVStreamHandler *handler, bool &split)
+{
+    split = false;
+
+    QFile f;
+
+    if (!dash_open(f, filename, QIODevice::ReadOnly))
+    {
+        LOG(VB_GENERAL, LOG_ERR,
+            QString("Error unable to open '%1' for reading.") .arg(filename));
+        return false;
+    }
+
+    int localTimezoneOffset = getLocalTimezoneOffset();
+
+    QXmlStreamReader xml(&f);
+    QUrl baseUrl;
+
+    QList<ChanInfo> chanlist;
+    bool channels_done = false;
+
+    QString xmltvid;
+    QList<ProgInfo> proglist;
+    QSet<QString> handled;
+
+    resetGrouping();
+
+    while (xml.readNextStartElement())
+    {
+        if (xml.name() == "tv")
+        {
+            QXmlStreamAttributes attrs = xml.attributes();
+            baseUrl = QUrl(attrs.value("source-data-url").toString());
+            checkSourceUrl(attrs.value("source-info-url").toString());
 
-                    if (!pginfo->description.isEmpty())
-                        groupingDesc = pginfo->description + " : ";
+            while (xml.readNextStartElement())
+            {
+                QDomDocument doc;
+                QDomElement e = readDomElement(xml, doc);
+
+                if (e.tagName() == "channel")
+                {
+                    ChanInfo *chinfo = parseChannel(e, baseUrl);
+                    chanlist.push_back(*chinfo);
+                    delete chinfo;
                 }
-                else
+                else if (e.tagName() == "programme")
                 {
-                    if (pginfo->clumpidx.isEmpty())
+                    if (!channels_done)
                     {
-                        if (!groupingTitle.isEmpty())
-                        {
-                            pginfo->title.prepend(groupingTitle);
-                            groupingTitle.clear();
-                        }
+                        handler->HandleChannels(chanlist);
+                        chanlist.clear();
+                        channels_done = true;
+                    }
 
-                        if (!groupingDesc.isEmpty())
-                        {
-                            pginfo->description.prepend(groupingDesc);
-                            groupingDesc.clear();
-                        }
+                    ProgInfo *pginfo = parseProgram(e, localTimezoneOffset);
 
-                        (*proglist)[pginfo->channel].push_back(*pginfo);
-                    }
-                    else
+                    if (groupProgram(pginfo))
                     {
-                        /* append all titles/descriptions from one clump */
-                        if (pginfo->clumpidx.toInt() == 0)
-                        {
-                            aggregatedTitle.clear();
-                            aggregatedDesc.clear();
-                        }
-
-                        if (!pginfo->title.isEmpty())
+                        if (pginfo->channel != xmltvid)
                         {
-                            if (!aggregatedTitle.isEmpty())
-                                aggregatedTitle.append(" | ");
-                            aggregatedTitle.append(pginfo->title);
+                            if (!proglist.empty())
+                                handler->HandlePrograms(xmltvid, proglist);
+                            proglist.clear();
+                            handled.insert(xmltvid);
+                            xmltvid = pginfo->channel;
                         }
 
-                        if (!pginfo->description.isEmpty())
-                        {
-                            if (!aggregatedDesc.isEmpty())
-                                aggregatedDesc.append(" | ");
-                            aggregatedDesc.append(pginfo->description);
-                        }
-                        if (pginfo->clumpidx.toInt() ==
-                            pginfo->clumpmax.toInt() - 1)
+                        if (handled.contains(xmltvid))
                         {
-                            pginfo->title = aggregatedTitle;
-                            pginfo->description = aggregatedDesc;
-                            (*proglist)[pginfo->channel].push_back(*pginfo);
+                            LOG(VB_GENERAL, LOG_WARNING,
+                                QString("Programmes for %1 are not all "
+                                        "together, line %2")
+                                .arg(xmltvid).arg(xml.lineNumber()));
+                            delete pginfo;
+                            f.close();
+                            split = true;
+                            return false;
                         }
+                        proglist.push_back(*pginfo);
                     }
+
+                    delete pginfo;
                 }
-                delete pginfo;
             }
         }
-        n = n.nextSibling();
+        else
+        {
+            xml.skipCurrentElement();
+        }
     }
 
+    if (xml.hasError())
+    {
+        // The channels before the error have been handled already, but
+        // the last one may be cut short, so leave it out.
+        LOG(VB_GENERAL, LOG_ERR, QString("Error in %1:%2: %3")
+            .arg(xml.lineNumber()).arg(xml.columnNumber())
+            .arg(xml.errorString()));
+        f.close();
+        return false;
+    }
+
+    if (!channels_done || !chanlist.empty())
+        handler->HandleChannels(chanlist);
+
+    if (!proglist.empty())
+        handler->HandlePrograms(xmltvid, proglist);
+
+    f.close();
+
     return true;
 }
-
@@ -11,6 +11,22 @@ class ChanInfo;
 class QUrl;
 class QDomElement;
 
+/** \brief Receives channels and programs from XMLTVParser::parseFileStreaming()
+ *         as soon as they have been parsed.
+ */
+class XMLTVStreamHandler
+{
+  public:
+    virtual ~XMLTVStreamHandler() {}
+
+    /// Called once all the channel elements preceding the first
+    /// programme element have been parsed.
+    virtual void HandleChannels(QList<ChanInfo> &chanlist) = 0;
+    /// Called with all the programmes of one channel.
+    virtual void HandlePrograms(const QString &xmltvid,
+                                QList<ProgInfo> &proglist) = 0;
+};
+
 class XMLTVParser
 {
   public:
@@ -21,13 +37,22 @@ class XMLTVParser
     bool parseFile(
         QString filename, QList<ChanInfo> *chanlist,
         QMap<QString, QList<ProgInfo> > *proglist);
-
+    bool parseFileStreaming(QString filename, XMLTVStreamHandler *handler,
+                            bool &split);
 
   public:
     bool isJapan;
 
   private:
+    void resetGrouping(void);
+    bool groupProgram(ProgInfo *pginfo);
+
     unsigned int current_year;
+
+    QString aggregatedTitle;
+    QString aggregatedDesc;
+    QString groupingTitle;
+    QString groupingDesc;
 };
 
 #endif // _XMLTVPARSER_H_
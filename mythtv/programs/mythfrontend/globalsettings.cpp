@@ -2306,6 +2306,46 @@ static GlobalComboBox *GRSchedOpenEnd()
     return bc;
 }
 
+static GlobalCheckBox *GRSchedInMemoryMatch()
+{
+    GlobalCheckBox *bc = new GlobalCheckBox("SchedInMemoryMatch");
+    bc->setLabel(QObject::tr("Match rules in memory"));
+    bc->setHelpText(QObject::tr("Match the recording rules which don't use "
+                    "a search or a filter against a copy of the program "
+                    "guide kept by the backend, instead of rebuilding "
+                    "the matches in the database on every reschedule. "
+                    "Titles are compared ignoring case and trailing spaces "
+                    "rather than with the database's collation, and times "
+                    "use the backend's time zone, so a few matches may "
+                    "differ."));
+    bc->setValue(false);
+    return bc;
+}
+
+static GlobalCheckBox *GRSchedVerifyMatches()
+{
+    GlobalCheckBox *bc = new GlobalCheckBox("SchedVerifyMatches");
+    bc->setLabel(QObject::tr("Verify in memory matches"));
+    bc->setHelpText(QObject::tr("Also match the rules in the database and "
+                    "log any difference from the in memory matches. This "
+                    "is only useful for debugging and slows down "
+                    "rescheduling."));
+    bc->setValue(false);
+    return bc;
+}
+
+static GlobalCheckBox *GRSchedParallelPlacement()
+{
+    GlobalCheckBox *bc = new GlobalCheckBox("SchedParallelPlacement");
+    bc->setLabel(QObject::tr("Resolve conflicts in parallel"));
+    bc->setHelpText(QObject::tr("Split the schedule into parts which can't "
+                    "conflict with each other and resolve the conflicts "
+                    "in each part on a separate thread. The resulting "
+                    "schedule is the same either way."));
+    bc->setValue(true);
+    return bc;
+}
+
 static GlobalSpinBox *GRPrefInputRecPriority()
 {
     GlobalSpinBox *bs = new GlobalSpinBox("PrefInputPriority", 1, 99, 1);
@@ -3458,6 +3498,9 @@ GeneralRecPrioritiesSettings::GeneralRecPrioritiesSettings()
 
     sched->addChild(GRSchedMoveHigher());
     sched->addChild(GRSchedOpenEnd());
+    sched->addChild(GRSchedInMemoryMatch());
+    sched->addChild(GRSchedVerifyMatches());
+    sched->addChild(GRSchedParallelPlacement());
     sched->addChild(GRPrefInputRecPriority());
     sched->addChild(GRHDTVRecPriority());
     sched->addChild(GRWSRecPriority());
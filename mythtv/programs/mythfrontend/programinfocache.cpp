@@ -6,6 +6,8 @@
 
 #include <QCoreApplication>
 #include <QRunnable>
+#include <QMap>
+#include <QSet>
 
 #include "programinfocache.h"
 #include "mthreadpool.h"
@@ -27,6 +29,49 @@ static void free_vec(VPI_ptr &v)
     }
 }
 
+/// Replaces or adds the changed ProgramInfos in list, taking ownership
+/// of them, and removes the deleted ones.
+static void merge_vec(vector<ProgramInfo*> &list,
+                      vector<ProgramInfo*> &changed,
+                      const QStringList &deleted)
+{
+    QMap<QString, uint> index;
+    for (uint i = 0; i < list.size(); i++)
+        index[list[i]->MakeUniqueKey()] = i;
+
+    vector<ProgramInfo*>::iterator it = changed.begin();
+    for (; it != changed.end(); ++it)
+    {
+        QString key = (*it)->MakeUniqueKey();
+        QMap<QString, uint>::iterator iit = index.find(key);
+        if (iit != index.end())
+        {
+            delete list[*iit];
+            list[*iit] = *it;
+        }
+        else
+        {
+            index[key] = list.size();
+            list.push_back(*it);
+        }
+    }
+    changed.clear();
+
+    if (deleted.empty())
+        return;
+
+    QSet<QString> keys = deleted.toSet();
+    vector<ProgramInfo*>::iterator out = list.begin();
+    for (it = list.begin(); it != list.end(); ++it)
+    {
+        if (keys.contains((*it)->MakeUniqueKey()))
+            delete *it;
+        else
+            *out++ = *it;
+    }
+    list.erase(out, list.end());
+}
+
 class ProgramInfoLoader : public QRunnable
 {
   public:
@@ -43,7 +88,8 @@ class ProgramInfoLoader : public QRunnable
 };
 
 ProgramInfoCache::ProgramInfoCache(QObject *o) :
-    m_next_cache(NULL), m_listener(o),
+    m_next_cache(NULL), m_next_changed(NULL),
+    m_use_delta(true), m_listener(o),
     m_load_is_queued(false), m_loads_in_progress(0)
 {
 }
@@ -57,6 +103,7 @@ ProgramInfoCache::~ProgramInfoCache()
 
     Clear();
     free_vec(m_next_cache);
+    free_vec(m_next_changed);
 }
 
 void ProgramInfoCache::ScheduleLoad(const bool updateUI)
@@ -75,17 +122,77 @@ void ProgramInfoCache::Load(const bool updateUI)
 {
     QMutexLocker locker(&m_lock);
     m_load_is_queued = false;
+    QString token = m_token;
+    bool use_delta = m_use_delta;
 
     locker.unlock();
     /**/
-    // Get an unsorted list (sort = 0) from RemoteGetRecordedList
-    // we sort the list later anyway.
-    vector<ProgramInfo*> *tmp = RemoteGetRecordedList(0);
+    // Ask only for the recordings changed since the last load,
+    // if the backend supports it.
+    vector<ProgramInfo*> *tmp = NULL;
+    QStringList deleted;
+    bool full = true;
+    if (use_delta)
+    {
+        tmp = new vector<ProgramInfo*>;
+        bool unsupported = false;
+        if (!RemoteGetRecordedListDelta(token, full, *tmp, deleted,
+                                        unsupported))
+        {
+            if (unsupported)
+            {
+                LOG(VB_GENERAL, LOG_INFO, "ProgramInfoCache: Backend does "
+                    "not support QUERY_RECORDINGS_DELTA, loading full lists");
+                use_delta = false;
+            }
+            else
+            {
+                // Load everything this time, and start over with the
+                // changes since then on the next load.
+                LOG(VB_GENERAL, LOG_WARNING, "ProgramInfoCache: "
+                    "QUERY_RECORDINGS_DELTA failed, loading full list");
+                token.clear();
+            }
+            delete tmp;
+            tmp = NULL;
+        }
+    }
+    if (!tmp)
+    {
+        // Get an unsorted list (sort = 0) from RemoteGetRecordedList
+        // we sort the list later anyway.
+        tmp = RemoteGetRecordedList(0);
+        full = true;
+    }
     /**/
     locker.relock();
 
-    free_vec(m_next_cache);
-    m_next_cache = tmp;
+    m_use_delta = use_delta;
+    m_token = use_delta ? token : QString();
+
+    if (full)
+    {
+        free_vec(m_next_cache);
+        free_vec(m_next_changed);
+        m_next_deleted.clear();
+        m_next_cache = tmp;
+    }
+    else if (m_next_cache)
+    {
+        merge_vec(*m_next_cache, *tmp, deleted);
+        delete tmp;
+    }
+    else if (m_next_changed)
+    {
+        merge_vec(*m_next_changed, *tmp, deleted);
+        m_next_deleted += deleted;
+        delete tmp;
+    }
+    else
+    {
+        m_next_changed = tmp;
+        m_next_deleted = deleted;
+    }
 
     if (updateUI)
         QCoreApplication::postEvent(
@@ -110,9 +217,9 @@ void ProgramInfoCache::WaitForLoadToComplete(void) const
 
 /** \brief Refreshed the cache.
  *  
- *  If a new list has been loaded this fills the cache with that list
- *  if not, this simply removes list items marked for deletion from the
- *  the list.
+ *  If a new list has been loaded this fills the cache with that list,
+ *  if only the changes since the last list have been loaded this applies
+ *  them. Then this removes list items marked for deletion from the list.
  *
  *  \note This must only be called from the UI thread.
  *  \note All references to the ProgramInfo pointers should be cleared
@@ -137,6 +244,46 @@ void ProgramInfoCache::Refresh(void)
         m_next_cache = NULL;
         return;
     }
+
+    if (m_next_changed)
+    {
+        QStringList::const_iterator dit = m_next_deleted.begin();
+        for (; dit != m_next_deleted.end(); ++dit)
+        {
+            uint      chanid;
+            QDateTime recstartts;
+            if (!ProgramInfo::ExtractKey(*dit, chanid, recstartts))
+                continue;
+
+            Cache::iterator it = m_cache.find(PICKey(chanid, recstartts));
+            if (it != m_cache.end())
+            {
+                delete it->second;
+                m_cache.erase(it);
+            }
+        }
+
+        vector<ProgramInfo*>::iterator it = m_next_changed->begin();
+        for (; it != m_next_changed->end(); ++it)
+        {
+            PICKey k((*it)->GetChanID(), (*it)->GetRecordingStartTime());
+            Cache::iterator cit = m_cache.find(k);
+            if (cit != m_cache.end())
+            {
+                // Keep the pointers held by the UI valid
+                cit->second->clone(**it, true);
+                delete *it;
+            }
+            else
+            {
+                m_cache[k] = *it;
+            }
+        }
+
+        delete m_next_changed;
+        m_next_changed = NULL;
+        m_next_deleted.clear();
+    }
     locker.unlock();
 
     Cache::iterator it = m_cache.begin();
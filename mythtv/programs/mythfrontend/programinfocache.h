@@ -13,6 +13,7 @@ using namespace std;
 
 // Qt headers
 #include <QWaitCondition>
+#include <QStringList>
 #include <QDateTime>
 #include <QMutex>
 
@@ -73,6 +74,10 @@ class ProgramInfoCache
     mutable QMutex          m_lock;
     Cache                   m_cache;
     vector<ProgramInfo*>   *m_next_cache;
+    vector<ProgramInfo*>   *m_next_changed;
+    QStringList             m_next_deleted;
+    QString                 m_token;
+    bool                    m_use_delta;
     QObject                *m_listener;
     bool                    m_load_is_queued;
     uint                    m_loads_in_progress;
@@ -0,0 +1,32 @@
+#include "commandlineparser.h"
+#include "mythcorecontext.h"
+
+MythProtoBenchCommandLineParser::MythProtoBenchCommandLineParser() :
+    MythCommandLineParser(MYTH_APPNAME_MYTHPROTOBENCH)
+{
+    LoadArguments();
+}
+
+void MythProtoBenchCommandLineParser::LoadArguments(void)
+{
+    addHelp();
+    addVersion();
+    addLogging("none", LOG_ERR);
+    add("--count", "count", 10000,
+            "Number of recordings in the list (default: 10000).", "");
+    add("--iterations", "iterations", 5,
+            "Number of times each step is run (default: 5).",
+            "The fastest run of each step is reported.");
+    add("--unicode", "unicode", 10,
+            "Percentage of recordings with non Latin-1 text (default: 10).",
+            "These are sent as UTF-16 rather than Latin-1 by the binary "
+            "encoding.");
+}
+
+QString MythProtoBenchCommandLineParser::GetHelpHeader(void) const
+{
+    return
+        "MythProtoBench compares the text and binary encodings of the\n"
+        "myth protocol string lists on a synthetic recording list, as sent\n"
+        "in reply to QUERY_RECORDINGS.";
+}
@@ -0,0 +1,19 @@
+// -*- Mode: c++ -*-
+
+#ifndef _MYTH_PROTOBENCH_COMMAND_LINE_PARSER_H_
+#define _MYTH_PROTOBENCH_COMMAND_LINE_PARSER_H_
+
+#include "mythcommandlineparser.h"
+
+class MythProtoBenchCommandLineParser : public MythCommandLineParser
+{
+  public:
+    MythProtoBenchCommandLineParser();
+    void LoadArguments(void);
+  protected:
+    QString GetHelpHeader(void) const;
+};
+
+#endif // _MYTH_PROTOBENCH_COMMAND_LINE_PARSER_H_
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -0,0 +1,255 @@
+// -*- Mode: c++ -*-
+
+// C++ headers
+#include <climits>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+// Qt headers
+#include <QCoreApplication>
+#include <QStringList>
+#include <QString>
+
+// MythTV headers
+#include "commandlineparser.h"
+#include "mythcorecontext.h"
+#include "programinfo.h"
+#include "mythversion.h"
+#include "mythlogging.h"
+#include "mythsocket.h"
+#include "mythtimer.h"
+#include "mythdate.h"
+#include "exitcodes.h"
+
+static const char *kTitles[] =
+{
+    "The Evening News", "Nature", "Doctor Who", "Top Gear",
+    "University Challenge", "Coronation Street", "Match of the Day",
+    "Horizon", "QI", "Newsnight",
+};
+
+static const char *kUnicodeTitles[] =
+{
+    "\xd0\x9d\xd0\xbe\xd0\xb2\xd0\xbe\xd1\x81\xd1\x82\xd0\xb8",
+    "\xe3\x83\x8b\xe3\x83\xa5\xe3\x83\xbc\xe3\x82\xb9",
+    "\xce\x95\xce\xb9\xce\xb4\xce\xae\xcf\x83\xce\xb5\xce\xb9\xcf\x82",
+};
+
+static const char *kDescription =
+    "A look at the week's events, with reports from around the country "
+    "and interviews with the people behind the headlines. Followed by "
+    "the weather forecast for the weekend and the travel news.";
+
+/// Builds count recordings looking like the ones in QUERY_RECORDINGS.
+static void make_recordings(uint count, uint unicode_pct,
+                            vector<ProgramInfo*> &list)
+{
+    QDateTime start = MythDate::current().addDays(-365);
+    uint ntitles = sizeof(kTitles) / sizeof(kTitles[0]);
+    uint nunicode = sizeof(kUnicodeTitles) / sizeof(kUnicodeTitles[0]);
+
+    for (uint i = 0; i < count; i++)
+    {
+        bool unicode = (i % 100) < unicode_pct;
+        QString title = unicode ?
+            QString::fromUtf8(kUnicodeTitles[i % nunicode]) :
+            QString(kTitles[i % ntitles]);
+        QString subtitle = QString("Episode %1").arg(i);
+        QString description = unicode ?
+            title + ": " + kDescription : QString(kDescription);
+
+        uint chanid = 1001 + (i % 40);
+        QDateTime startts = start.addSecs(i * 1800);
+        QDateTime endts = startts.addSecs(1800);
+
+        ProgramInfo *pginfo = new ProgramInfo(
+            title, subtitle, description, i / 20 + 1, i % 20 + 1, "News",
+            chanid, QString::number(chanid - 1000),
+            QString("CH%1").arg(chanid), QString("Channel %1").arg(chanid),
+            "", "Default", "Default",
+            startts, endts, startts.addSecs(-60), endts.addSecs(300),
+            QString("SH%1").arg(i / 20, 8, 10, QChar('0')),
+            QString("EP%1").arg(i, 12, 10, QChar('0')), "");
+        pginfo->SetPathname(QString("myth://192.168.1.10:6543/%1_%2.mpg")
+                            .arg(chanid)
+                            .arg(startts.toString("yyyyMMddhhmmss")));
+        pginfo->SetFilesize(2000000000ULL + i);
+        pginfo->SetRecordingStatus(rsRecorded);
+        list.push_back(pginfo);
+    }
+}
+
+static void print_step(const QString &name, int elapsed, qint64 bytes)
+{
+    QString rate;
+    if (bytes)
+    {
+        rate = QString(", %1 MB/s").arg(
+            double(bytes) * 1000.0 /
+            (double(max(elapsed, 1)) * 1024.0 * 1024.0), 0, 'f', 1);
+    }
+    cout << qPrintable(QString("  %1 %2 ms%3")
+                       .arg(name + ':', -8).arg(elapsed, 5).arg(rate))
+         << endl;
+}
+
+/// Encodes and decodes strlist with the given BinaryProtocol flags.
+static bool bench_encoding(const QString &name, uint flags,
+                           const QStringList &strlist, uint iterations)
+{
+    QByteArray frame;
+    int encode = INT_MAX;
+    for (uint i = 0; i < iterations; i++)
+    {
+        MythTimer t;
+        t.start();
+        frame = MythSocket::EncodeStringList(strlist, flags);
+        encode = min(encode, t.elapsed());
+    }
+
+    uint frameflags = 0;
+    qint64 size = MythSocket::DecodeFrameHeader(frame.constData(),
+                                                frameflags);
+    QByteArray payload = frame.mid(MythSocket::kFrameHeaderSize);
+    if (size != payload.size())
+    {
+        cerr << qPrintable(name) << ": invalid frame header" << endl;
+        return false;
+    }
+
+    QStringList decoded;
+    int decode = INT_MAX;
+    for (uint i = 0; i < iterations; i++)
+    {
+        MythTimer t;
+        t.start();
+        bool ok = MythSocket::DecodeStringList(payload, frameflags, decoded);
+        decode = min(decode, t.elapsed());
+        if (!ok)
+        {
+            cerr << qPrintable(name) << ": failed to decode" << endl;
+            return false;
+        }
+    }
+
+    if (decoded != strlist)
+    {
+        cerr << qPrintable(name) << ": decoded list differs" << endl;
+        return false;
+    }
+
+    cout << qPrintable(QString("%1 (%2 bytes)").arg(name).arg(frame.size()))
+         << endl;
+    print_step("encode", encode, frame.size());
+    print_step("decode", decode, frame.size());
+
+    return true;
+}
+
+static int RunBench(uint count, uint iterations, uint unicode_pct)
+{
+    vector<ProgramInfo*> recordings;
+    make_recordings(count, unicode_pct, recordings);
+
+    // The same list HandleQueryRecordings() sends
+    QStringList strlist;
+    int serialize = INT_MAX;
+    for (uint i = 0; i < iterations; i++)
+    {
+        MythTimer t;
+        t.start();
+        strlist = QStringList(QString::number(recordings.size()));
+        vector<ProgramInfo*>::const_iterator it = recordings.begin();
+        for (; it != recordings.end(); ++it)
+            (*it)->ToStringList(strlist);
+        serialize = min(serialize, t.elapsed());
+    }
+
+    int deserialize = INT_MAX;
+    for (uint i = 0; i < iterations; i++)
+    {
+        vector<ProgramInfo*> reclist;
+        MythTimer t;
+        t.start();
+        QStringList::const_iterator it = strlist.begin() + 1;
+        for (uint j = 0; j < count; j++)
+            reclist.push_back(new ProgramInfo(it, strlist.end()));
+        deserialize = min(deserialize, t.elapsed());
+
+        while (!reclist.empty())
+        {
+            delete reclist.back();
+            reclist.pop_back();
+        }
+    }
+
+    while (!recordings.empty())
+    {
+        delete recordings.back();
+        recordings.pop_back();
+    }
+
+    cout << qPrintable(QString("%1 recordings, %2 strings, best of %3 runs")
+                       .arg(count).arg(strlist.size()).arg(iterations))
+         << endl;
+    cout << "ProgramInfo" << endl;
+    print_step("to list", serialize, 0);
+    print_step("from list", deserialize, 0);
+
+    bool ok = true;
+    ok &= bench_encoding("text", MythSocket::kBinaryNone,
+                         strlist, iterations);
+    ok &= bench_encoding("binary", MythSocket::kBinaryFrames,
+                         strlist, iterations);
+    ok &= bench_encoding("binary+zlib",
+                         MythSocket::kBinaryFrames |
+                         MythSocket::kBinaryCompress,
+                         strlist, iterations);
+
+    return ok ? GENERIC_EXIT_OK : GENERIC_EXIT_NOT_OK;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCoreApplication::setApplicationName(MYTH_APPNAME_MYTHPROTOBENCH);
+
+    MythProtoBenchCommandLineParser cmdline;
+    if (!cmdline.Parse(argc, argv))
+    {
+        cmdline.PrintHelp();
+        return GENERIC_EXIT_INVALID_CMDLINE;
+    }
+
+    if (cmdline.toBool("showhelp"))
+    {
+        cmdline.PrintHelp();
+        return GENERIC_EXIT_OK;
+    }
+
+    if (cmdline.toBool("showversion"))
+    {
+        cmdline.PrintVersion();
+        return GENERIC_EXIT_OK;
+    }
+
+    int retval = cmdline.ConfigureLogging("none");
+    if (retval != GENERIC_EXIT_OK)
+        return retval;
+
+    int count = cmdline.toInt("count");
+    int iterations = cmdline.toInt("iterations");
+    int unicode = cmdline.toInt("unicode");
+    if (count < 1 || iterations < 1 || unicode < 0 || unicode > 100)
+    {
+        cerr << "Invalid --count, --iterations or --unicode" << endl;
+        return GENERIC_EXIT_INVALID_CMDLINE;
+    }
+
+    return RunBench(count, iterations, unicode);
+}
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -0,0 +1,44 @@
+#include "commandlineparser.h"
+#include "mythcorecontext.h"
+
+MythRecBenchCommandLineParser::MythRecBenchCommandLineParser() :
+    MythCommandLineParser(MYTH_APPNAME_MYTHRECBENCH)
+{
+    LoadArguments();
+}
+
+void MythRecBenchCommandLineParser::LoadArguments(void)
+{
+    allowArgs();
+    addHelp();
+    addSettingsOverride();
+    addVersion();
+    addLogging("none", LOG_ERR);
+    addInFile();
+    add("--outdir", "outdir", "",
+            "Directory to write the recordings to (default: temp dir).",
+            "The recorded files are removed once the run is finished "
+            "unless --keep is given.");
+    add("--keep", "keep", false,
+            "Keep the recorded files.", "")
+            ->SetChildOf("outdir");
+    add("--program", "program", -1,
+            "MPEG program number to record.",
+            "If not given the first program in the PAT of each "
+            "input file is recorded.");
+    add("--streams", "streams", 1,
+            "Number of concurrent recordings of each input file.", "");
+    add("--realtime", "realtime", false,
+            "Replay at wall-clock rate.",
+            "Paces the replay by the PCR of the input instead of "
+            "feeding the recorder as fast as possible.");
+}
+
+QString MythRecBenchCommandLineParser::GetHelpHeader(void) const
+{
+    return
+        "MythRecBench replays captured transport streams through the\n"
+        "recording pipeline (StreamHandler, MPEGStreamData, DTVRecorder and\n"
+        "RingBuffer) and reports its throughput.\n"
+        "Additional input files may be given as arguments.";
+}
@@ -0,0 +1,19 @@
+// -*- Mode: c++ -*-
+
+#ifndef _MYTH_RECBENCH_COMMAND_LINE_PARSER_H_
+#define _MYTH_RECBENCH_COMMAND_LINE_PARSER_H_
+
+#include "mythcommandlineparser.h"
+
+class MythRecBenchCommandLineParser : public MythCommandLineParser
+{
+  public:
+    MythRecBenchCommandLineParser();
+    void LoadArguments(void);
+  protected:
+    QString GetHelpHeader(void) const;
+};
+
+#endif // _MYTH_RECBENCH_COMMAND_LINE_PARSER_H_
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -0,0 +1,506 @@
+// -*- Mode: c++ -*-
+
+// POSIX headers
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+// C++ headers
+#include <algorithm>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+// Qt headers
+#include <QCoreApplication>
+#include <QString>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+
+// MythTV headers
+#include "commandlineparser.h"
+#include "mpegstreamdata.h"
+#include "streamlisteners.h"
+#include "streamhandler.h"
+#include "dtvrecorder.h"
+#include "mythcontext.h"
+#include "mythversion.h"
+#include "mythlogging.h"
+#include "ringbuffer.h"
+#include "mythtimer.h"
+#include "exitcodes.h"
+#include "tspacket.h"
+#include "mthread.h"
+
+#define LOC QString("ReplaySH(%1): ").arg(_device)
+
+/// Number of bytes read from the capture file at a time
+static const int kReadSize = 348 * TSPacket::kSize;
+/// PCR jumps larger than this (in 90kHz ticks) restart the pacing clock
+static const int64_t kMaxPCRJump = 10 * 90000;
+
+static double thread_cpu_seconds(void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+    return 0.0;
+}
+
+/** \class ReplayStreamHandler
+ *  \brief StreamHandler which feeds a captured transport stream file
+ *         to its listeners instead of reading from a tuner.
+ *
+ *  The thread exits at the end of the file, so IsRunning() returning
+ *  false after AddListener() means the replay is finished.
+ */
+class ReplayStreamHandler : public StreamHandler
+{
+  public:
+    ReplayStreamHandler(const QString &filename, const QString &device,
+                        bool realtime) :
+        StreamHandler(device), _filename(filename), _realtime(realtime),
+        _pcr_pid(-1), _pcr_start(0), _pcr_offset(0),
+        _packets(0), _elapsed(0), _cpu(0.0)
+    {
+        setObjectName("ReplayStreamHandler");
+    }
+
+    uint64_t GetPackets(void) const { return _packets; }
+    int      GetElapsed(void) const { return _elapsed; }
+    double   GetCPUTime(void) const { return _cpu; }
+
+  protected:
+    void run(void);
+    void Pace(const unsigned char *buffer, int len);
+
+  private:
+    QString   _filename;
+    bool      _realtime;
+
+    // pacing state, see Pace()
+    int       _pcr_pid;
+    int64_t   _pcr_start;
+    int       _pcr_offset;
+    MythTimer _clock;
+
+    // results, valid once the thread has exited
+    uint64_t  _packets;
+    int       _elapsed;
+    double    _cpu;
+};
+
+void ReplayStreamHandler::run(void)
+{
+    RunProlog();
+
+    int fd = open(_filename.toLocal8Bit().constData(), O_RDONLY);
+    if (fd < 0)
+    {
+        LOG(VB_GENERAL, LOG_ERR, LOC + "Could not open input file" + ENO);
+        _error = true;
+        RunEpilog();
+        return;
+    }
+
+    SetRunning(true, false, false);
+
+    unsigned char *buffer = new unsigned char[kReadSize];
+    int remainder = 0;
+    double cpu_start = thread_cpu_seconds();
+    _clock.start();
+
+    while (_running_desired && !_error)
+    {
+        int len = read(fd, buffer + remainder, kReadSize - remainder);
+        if (len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            LOG(VB_GENERAL, LOG_ERR, LOC + "Read error" + ENO);
+            _error = true;
+            break;
+        }
+        if (len == 0)
+            break; // end of file
+
+        len += remainder;
+
+        if (_realtime)
+            Pace(buffer, len);
+
+        _listener_lock.lock();
+        remainder = ProcessTSData(buffer, len);
+        _listener_lock.unlock();
+
+        _packets += (len - remainder) / TSPacket::kSize;
+
+        // Keep a partial packet for the next read, drop anything
+        // ProcessTSData() could not find a sync byte in.
+        if (remainder > 0 && remainder < (int)TSPacket::kSize)
+            memmove(buffer, buffer + len - remainder, remainder);
+        else
+            remainder = 0;
+    }
+
+    _elapsed = max(_clock.elapsed(), 1);
+    _cpu     = thread_cpu_seconds() - cpu_start;
+
+    delete[] buffer;
+    close(fd);
+
+    LOG(VB_RECORD, LOG_INFO, LOC + "Replay finished");
+
+    SetRunning(false, false, false);
+    RunEpilog();
+}
+
+/** \brief Sleeps until the first PCR in the buffer is due, so that the
+ *         stream is delivered at the rate it was captured at.
+ *
+ *  Only the first PID seen carrying a PCR is used. PCR discontinuities,
+ *  including the wrap of the 33 bit counter, restart the pacing clock.
+ */
+void ReplayStreamHandler::Pace(const unsigned char *buffer, int len)
+{
+    for (int pos = 0; pos + (int)TSPacket::kSize <= len;
+         pos += TSPacket::kSize)
+    {
+        const unsigned char *p = buffer + pos;
+        if (p[0] != SYNC_BYTE || !(p[3] & 0x20) || p[4] < 7 ||
+            !(p[5] & 0x10))
+        {
+            continue; // no PCR in this packet
+        }
+
+        int pid = ((p[1] << 8) | p[2]) & 0x1fff;
+        if (_pcr_pid < 0)
+            _pcr_pid = pid;
+        else if (pid != _pcr_pid)
+            continue;
+
+        int64_t pcr = ((int64_t)p[6] << 25) | ((int64_t)p[7] << 17) |
+            ((int64_t)p[8] << 9) | ((int64_t)p[9] << 1) | (p[10] >> 7);
+
+        int now = _clock.elapsed();
+        int64_t delta = pcr - _pcr_start;
+        if (_pcr_start == 0 || delta < 0 || delta > kMaxPCRJump)
+        {
+            _pcr_start  = pcr;
+            _pcr_offset = now;
+            return;
+        }
+
+        int due = _pcr_offset + (int)(delta / 90);
+        if (due > now)
+            usleep((due - now) * 1000);
+        return;
+    }
+}
+
+/** \class ReplayRecorder
+ *  \brief DTVRecorder driven by a ReplayStreamHandler, which records
+ *         until the end of the replayed file.
+ */
+class ReplayRecorder : public DTVRecorder
+{
+  public:
+    ReplayRecorder(ReplayStreamHandler *handler) :
+        DTVRecorder(NULL), _stream_handler(handler),
+        _keyframes(0), _flush_time(0) {}
+
+    void run(void);
+
+    uint GetKeyframes(void) const { return _keyframes; }
+    int  GetFlushTime(void) const { return _flush_time; }
+
+  private:
+    ReplayStreamHandler *_stream_handler;
+    uint                 _keyframes;
+    int                  _flush_time;
+};
+
+void ReplayRecorder::run(void)
+{
+    ResetForNewFile();
+
+    {
+        QMutexLocker locker(&pauseLock);
+        request_recording = true;
+        recording = true;
+        recordingWait.wakeAll();
+    }
+
+    _stream_data->AddAVListener(this);
+    _stream_data->AddWritingListener(this);
+    _stream_handler->AddListener(_stream_data);
+
+    while (IsRecordingRequested() && !IsErrored() &&
+           _stream_handler->IsRunning())
+    {
+        QMutexLocker locker(&pauseLock);
+        unpauseWait.wait(&pauseLock, 100);
+    }
+
+    _stream_handler->RemoveListener(_stream_data);
+    _stream_data->RemoveWritingListener(this);
+    _stream_data->RemoveAVListener(this);
+
+    MythTimer t;
+    t.start();
+    FinishRecording();
+    _flush_time = t.elapsed();
+
+    {
+        QMutexLocker locker(&positionMapLock);
+        _keyframes = positionMap.size();
+    }
+
+    QMutexLocker locker(&pauseLock);
+    recording = false;
+    recordingWait.wakeAll();
+}
+
+/// Listener used to find the first program in the PAT of a file.
+class ProgramFinder : public MPEGStreamListener
+{
+  public:
+    ProgramFinder() : m_program(-1) {}
+
+    void HandlePAT(const ProgramAssociationTable *pat)
+    {
+        if (m_program < 0 && pat->FindAnyPID())
+            m_program = pat->FindProgram(pat->FindAnyPID());
+    }
+    void HandleCAT(const ConditionalAccessTable*) {}
+    void HandlePMT(uint, const ProgramMapTable*) {}
+    void HandleEncryptionStatus(uint, bool) {}
+
+    int m_program;
+};
+
+static int find_program(const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return -1;
+
+    MPEGStreamData sd(-1, false);
+    ProgramFinder finder;
+    sd.AddMPEGListener(&finder);
+
+    // Look at the first 16 MB at most
+    QByteArray data;
+    for (int i = 0; i < 64 && finder.m_program < 0; i++)
+    {
+        data += file.read(kReadSize);
+        if (data.size() < (int)TSPacket::kSize)
+            break;
+        int left = sd.ProcessData(
+            reinterpret_cast<const unsigned char*>(data.constData()),
+            data.size());
+        data = data.right(left);
+    }
+
+    sd.RemoveMPEGListener(&finder);
+    return finder.m_program;
+}
+
+class ReplayStream
+{
+  public:
+    QString              infile;
+    QString              outfile;
+    ReplayStreamHandler *handler;
+    ReplayRecorder      *recorder;
+    RingBuffer          *ringbuffer;
+    MThread             *thread;
+};
+
+static void print_report(const QString &name, uint64_t packets,
+                         uint keyframes, int elapsed, double cpu,
+                         int flush_time)
+{
+    elapsed = max(elapsed, 1);
+    cout << qPrintable(
+        QString("%1: %2 packets in %3 ms, %4 packets/s, %5 MB/s, "
+                "%6 keyframes/s, CPU %7 s (%8%), flush %9 ms")
+        .arg(name)
+        .arg(packets)
+        .arg(elapsed)
+        .arg(packets * 1000 / elapsed)
+        .arg(double(packets * TSPacket::kSize) * 1000.0 /
+             (double(elapsed) * 1024.0 * 1024.0), 0, 'f', 1)
+        .arg(double(keyframes) * 1000.0 / elapsed, 0, 'f', 1)
+        .arg(cpu, 0, 'f', 2)
+        .arg(cpu * 100000.0 / elapsed, 0, 'f', 1)
+        .arg(flush_time)) << endl;
+}
+
+static int RunReplay(const QStringList &files, const QString &outdir,
+                     int program, uint streams, bool realtime, bool keep)
+{
+    vector<ReplayStream> replays;
+
+    for (int i = 0; i < files.size(); i++)
+    {
+        int prog = program;
+        if (prog < 0)
+            prog = find_program(files[i]);
+        if (prog < 0)
+        {
+            cerr << qPrintable(QString("Could not find a program in %1")
+                               .arg(files[i])) << endl;
+            return GENERIC_EXIT_NOT_OK;
+        }
+
+        for (uint j = 0; j < streams; j++)
+        {
+            ReplayStream rs;
+            rs.infile  = files[i];
+            rs.outfile = QString("%1/mythrecbench-%2-%3.ts")
+                .arg(outdir).arg(i).arg(j);
+            rs.ringbuffer = RingBuffer::Create(rs.outfile, true);
+            if (!rs.ringbuffer || !rs.ringbuffer->IsOpen())
+            {
+                cerr << qPrintable(QString("Unable to create RingBuffer "
+                                           "for %1").arg(rs.outfile)) << endl;
+                delete rs.ringbuffer;
+                return GENERIC_EXIT_PERMISSIONS_ERROR;
+            }
+
+            rs.handler = new ReplayStreamHandler(
+                files[i], QString("%1:%2").arg(QFileInfo(files[i]).fileName())
+                .arg(j), realtime);
+            rs.recorder = new ReplayRecorder(rs.handler);
+            rs.recorder->SetRingBuffer(rs.ringbuffer);
+            rs.recorder->SetStreamData(new MPEGStreamData(prog, true));
+            rs.thread = new MThread("RecBench", rs.recorder);
+            replays.push_back(rs);
+        }
+    }
+
+    MythTimer t;
+    t.start();
+
+    for (uint i = 0; i < replays.size(); i++)
+        replays[i].thread->start();
+    for (uint i = 0; i < replays.size(); i++)
+        replays[i].thread->wait();
+
+    int elapsed = t.elapsed();
+
+    uint64_t total_packets = 0;
+    uint total_keyframes = 0;
+    double total_cpu = 0.0;
+    int max_flush = 0;
+    bool errored = false;
+
+    for (uint i = 0; i < replays.size(); i++)
+    {
+        ReplayStream &rs = replays[i];
+
+        if (rs.recorder->IsErrored())
+            errored = true;
+
+        print_report(rs.outfile, rs.handler->GetPackets(),
+                     rs.recorder->GetKeyframes(), rs.handler->GetElapsed(),
+                     rs.handler->GetCPUTime(), rs.recorder->GetFlushTime());
+
+        total_packets   += rs.handler->GetPackets();
+        total_keyframes += rs.recorder->GetKeyframes();
+        total_cpu       += rs.handler->GetCPUTime();
+        max_flush        = max(max_flush, rs.recorder->GetFlushTime());
+
+        delete rs.thread;
+        delete rs.recorder;
+        delete rs.ringbuffer;
+        delete rs.handler;
+
+        if (!keep)
+            QFile::remove(rs.outfile);
+    }
+
+    if (replays.size() > 1)
+    {
+        print_report("total", total_packets, total_keyframes, elapsed,
+                     total_cpu, max_flush);
+    }
+
+    cout << "Per write latency is logged by ThreadedFileWriter "
+            "with '-v record'." << endl;
+
+    return errored ? GENERIC_EXIT_NOT_OK : GENERIC_EXIT_OK;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCoreApplication::setApplicationName(MYTH_APPNAME_MYTHRECBENCH);
+
+    MythRecBenchCommandLineParser cmdline;
+    if (!cmdline.Parse(argc, argv))
+    {
+        cmdline.PrintHelp();
+        return GENERIC_EXIT_INVALID_CMDLINE;
+    }
+
+    if (cmdline.toBool("showhelp"))
+    {
+        cmdline.PrintHelp();
+        return GENERIC_EXIT_OK;
+    }
+
+    if (cmdline.toBool("showversion"))
+    {
+        cmdline.PrintVersion();
+        return GENERIC_EXIT_OK;
+    }
+
+    int retval = cmdline.ConfigureLogging("none");
+    if (retval != GENERIC_EXIT_OK)
+        return retval;
+
+    QStringList files;
+    if (!cmdline.toString("infile").isEmpty())
+        files << cmdline.toString("infile");
+    files << cmdline.GetArgs();
+    if (files.isEmpty())
+    {
+        cerr << "At least one input file is required" << endl;
+        return GENERIC_EXIT_INVALID_CMDLINE;
+    }
+
+    QString outdir = QDir::tempPath();
+    if (!cmdline.toString("outdir").isEmpty())
+        outdir = cmdline.toString("outdir");
+
+    int streams = max(cmdline.toInt("streams"), 1);
+
+    gContext = new MythContext(MYTH_BINARY_VERSION);
+    if (!gContext->Init(false))
+    {
+        cerr << "Failed to init MythContext, exiting." << endl;
+        delete gContext;
+        return GENERIC_EXIT_NO_MYTHCONTEXT;
+    }
+
+    cmdline.ApplySettingsOverride();
+
+    retval = RunReplay(files, outdir, cmdline.toInt("program"), streams,
+                       cmdline.toBool("realtime"), cmdline.toBool("keep"));
+
+    delete gContext;
+
+    return retval;
+}
+
+/* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -186,6 +186,70 @@ static GlobalSpinBox *HDRingbufferSize()
     return bs;
 }
 
+static GlobalSpinBox *HDRingbufferReadBatch()
+{
+    GlobalSpinBox *bs = new GlobalSpinBox(
+        "HDRingbufferReadBatch", 0, 1024, 8);
+    bs->setLabel(QObject::tr("HD ringbuffer read batch (packets)"));
+    bs->setHelpText(QObject::tr("The maximum number of packets read from "
+                    "a capture device at once. Larger batches use less CPU "
+                    "per tuner. Set to 0 to use the default for each type "
+                    "of device."));
+    bs->setValue(0);
+    return bs;
+}
+
+static GlobalSpinBox *HDRingbufferMinRead()
+{
+    GlobalSpinBox *bs = new GlobalSpinBox(
+        "HDRingbufferMinRead", 1, 256, 1);
+    bs->setLabel(QObject::tr("HD ringbuffer minimum read (packets)"));
+    bs->setHelpText(QObject::tr("The number of packets the recorder waits "
+                    "for before taking data from the HD ringbuffer, unless "
+                    "the maximum latency passes first."));
+    bs->setValue(4);
+    return bs;
+}
+
+static GlobalSpinBox *HDRingbufferMaxLatency()
+{
+    GlobalSpinBox *bs = new GlobalSpinBox(
+        "HDRingbufferMaxLatency", 10, 2000, 10);
+    bs->setLabel(QObject::tr("HD ringbuffer maximum latency (ms)"));
+    bs->setHelpText(QObject::tr("The longest the recorder waits for the "
+                    "minimum read before taking whatever data is in the HD "
+                    "ringbuffer. Lower values can make LiveTV start faster."));
+    bs->setValue(500);
+    return bs;
+}
+
+static HostLineEdit *DirectIOStorageGroups()
+{
+    HostLineEdit *he = new HostLineEdit("DirectIOStorageGroups");
+    he->setLabel(QObject::tr("Direct I/O storage groups"));
+    he->setValue("");
+    he->setHelpText(QObject::tr("Comma separated list of storage groups "
+                    "whose directories on this backend are written with "
+                    "direct I/O and preallocated disk space. This keeps many "
+                    "simultaneous recordings from flushing playback data out "
+                    "of memory. Not all filesystems support direct I/O; "
+                    "normal writes are used where it is unavailable."));
+    return he;
+}
+
+static HostCheckBox *FileTransferZeroCopy()
+{
+    HostCheckBox *hc = new HostCheckBox("FileTransferZeroCopy");
+    hc->setLabel(QObject::tr("Zero-copy file streaming"));
+    hc->setValue(true);
+    hc->setHelpText(QObject::tr("If enabled, finished recordings on local "
+                    "storage are streamed to frontends by the kernel directly "
+                    "from the file, which lowers the CPU load when several "
+                    "frontends are watching at once. Recordings in progress "
+                    "are always streamed the normal way."));
+    return hc;
+}
+
 static GlobalComboBox *StorageScheduler()
 {
     GlobalComboBox *gc = new GlobalComboBox("StorageScheduler");
@@ -361,6 +425,18 @@ static GlobalSpinBox *EITCrawIdleStart()
     return gc;
 }
 
+static GlobalCheckBox *EITBulkInsert()
+{
+    GlobalCheckBox *gc = new GlobalCheckBox("EITBulkInsert");
+    gc->setLabel(QObject::tr("Batch EIT database writes"));
+    gc->setValue(false);
+    gc->setHelpText(QObject::tr(
+        "If enabled, new EIT listings, ratings and credits are queued and "
+        "written to the database with multi-row statements, which reduces "
+        "database load when collecting listings for many services."));
+    return gc;
+}
+
 static GlobalSpinBox *WOLbackendReconnectWaitTime()
 {
     GlobalSpinBox *gc = new GlobalSpinBox("WOLbackendReconnectWaitTime", 0, 1200, 5);
@@ -556,6 +632,35 @@ static HostSpinBox *JobQueueCheckFrequency()
     return gc;
 };
 
+static HostSpinBox *JobQueueMaxTypeJobs(const QString &type,
+                                       const QString &name)
+{
+    HostSpinBox *gc = new HostSpinBox(QString("JobQueueMax%1Jobs").arg(type),
+                                      0, 10, 1);
+    gc->setLabel(QObject::tr("Maximum simultaneous %1 jobs").arg(name));
+    gc->setHelpText(QObject::tr("The Job Queue will run at most this many "
+                    "%1 jobs at once on this backend. If set to 0, "
+                    "metadata lookups are only limited by the maximum "
+                    "simultaneous jobs, and the other jobs can use each CPU "
+                    "that is not busy with a recording.")
+                    .arg(name));
+    gc->setValue(0);
+    return gc;
+};
+
+static GlobalSpinBox *JobQueuePriority(const QString &type,
+                                       const QString &name)
+{
+    GlobalSpinBox *gc = new GlobalSpinBox(
+        QString("JobQueuePriority%1").arg(type), -10, 10, 1);
+    gc->setLabel(QObject::tr("%1 job priority").arg(name));
+    gc->setHelpText(QObject::tr("Queued jobs with a higher priority are "
+                    "started before the ones with a lower priority, jobs "
+                    "with the same priority in the order they were queued."));
+    gc->setValue(0);
+    return gc;
+};
+
 static HostComboBox *JobQueueCPU()
 {
     HostComboBox *gc = new HostComboBox("JobQueueCPU");
@@ -896,6 +1001,11 @@ BackendSettings::BackendSettings() {
     fmh1->addChild(TruncateDeletes());
     fm->addChild(fmh1);
     fm->addChild(HDRingbufferSize());
+    fm->addChild(HDRingbufferReadBatch());
+    fm->addChild(HDRingbufferMinRead());
+    fm->addChild(HDRingbufferMaxLatency());
+    fm->addChild(FileTransferZeroCopy());
+    fm->addChild(DirectIOStorageGroups());
     fm->addChild(StorageScheduler());
     group2->addChild(fm);
     VerticalConfigurationGroup* upnp = new VerticalConfigurationGroup();
@@ -913,6 +1023,7 @@ BackendSettings::BackendSettings() {
     //group2a1->addChild(EITTimeOffset());
     group2a1->addChild(EITTransportTimeout());
     group2a1->addChild(EITCrawIdleStart());
+    group2a1->addChild(EITBulkInsert());
     addChild(group2a1);
 
     VerticalConfigurationGroup* group3 = new VerticalConfigurationGroup(false);
@@ -978,6 +1089,22 @@ BackendSettings::BackendSettings() {
     group5->addChild(group5a);
     addChild(group5);
 
+    VerticalConfigurationGroup* group5b = new VerticalConfigurationGroup(false);
+    group5b->setLabel(QObject::tr("Job Queue (Worker Slots)"));
+    group5b->addChild(JobQueueMaxTypeJobs("CommFlag",
+                                          QObject::tr("commercial detection")));
+    group5b->addChild(JobQueueMaxTypeJobs("Transcode",
+                                          QObject::tr("transcoding")));
+    group5b->addChild(JobQueueMaxTypeJobs("Metadata",
+                                          QObject::tr("metadata lookup")));
+    group5b->addChild(JobQueuePriority("CommFlag",
+                                       QObject::tr("Commercial detection")));
+    group5b->addChild(JobQueuePriority("Transcode",
+                                       QObject::tr("Transcoding")));
+    group5b->addChild(JobQueuePriority("Metadata",
+                                       QObject::tr("Metadata lookup")));
+    addChild(group5b);
+
     VerticalConfigurationGroup* group6 = new VerticalConfigurationGroup(false);
     group6->setLabel(QObject::tr("Job Queue (Global)"));
     group6->addChild(JobsRunOnRecordHost());
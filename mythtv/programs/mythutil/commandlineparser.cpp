@@ -31,6 +31,11 @@ void MythUtilCommandLineParser::LoadArguments(void)
                 ->SetGroup("MPEG-TS")
                 ->SetRequiredChild("infile")
                 ->SetChild("outfile")
+        << add("--pidbench", "pidbench", false,
+                "Benchmark TS packet demultiplexing on a MythTV Storage "
+                "Group file", "")
+                ->SetGroup("MPEG-TS")
+                ->SetRequiredChild("infile")
 
         // markuputils.cpp
         << add("--gencutlist", "gencutlist", false,
@@ -63,6 +68,11 @@ void MythUtilCommandLineParser::LoadArguments(void)
                 "Clear the commercial skip list.", "")
                 ->SetGroup("Recording Markup")
                 ->SetRequiredChild(QStringList("chanid") << "starttime")
+        << add("--exportseektable", "exportseektable", false,
+                "Write the position map to the recordedseek table, "
+                "a row per keyframe.", "")
+                ->SetGroup("Recording Markup")
+                ->SetRequiredChild(QStringList("chanid") << "starttime")
 
         // backendutils.cpp
         << add("--resched", "resched", false,
@@ -124,12 +134,15 @@ void MythUtilCommandLineParser::LoadArguments(void)
     // mpegutils.cpp
     add("--pids", "pids", "", "Pids to process", "")
         ->SetRequiredChildOf("pidfilter")
-        ->SetRequiredChildOf("pidprinter");
+        ->SetRequiredChildOf("pidprinter")
+        ->SetChildOf("pidbench");
     add("--ptspids", "ptspids", "", "Pids to extract PTS from", "")
         ->SetGroup("MPEG-TS");
     add("--packetsize", "packetsize", 188, "TS Packet Size", "")
         ->SetChildOf("pidcounter")
         ->SetChildOf("pidfilter");
+    add("--loops", "loops", 10, "Number of passes over the input", "")
+        ->SetChildOf("pidbench");
     add("--noautopts", "noautopts", false, "Disables PTS discovery", "")
         ->SetChildOf("pidprinter");
     add("--xml", "xml", false, "Enables XML output of PSIP", "")
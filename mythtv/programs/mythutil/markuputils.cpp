@@ -166,6 +166,30 @@ static int ClearSkipList(const MythUtilCommandLineParser &cmdline)
     return SetMarkupList(cmdline, QString("skiplist"), QString(""));
 }
 
+static int ExportSeekTable(const MythUtilCommandLineParser &cmdline)
+{
+    ProgramInfo pginfo;
+    if (!GetProgramInfo(cmdline, pginfo))
+        return GENERIC_EXIT_NO_RECORDING_DATA;
+
+    const MarkTypes types[] = {
+        MARK_GOP_START, MARK_KEYFRAME, MARK_GOP_BYFRAME, MARK_DURATION_MS };
+
+    for (uint i = 0; i < sizeof(types) / sizeof(MarkTypes); i++)
+    {
+        int rows = pginfo.ExportPositionMap(types[i]);
+        if (rows < 0)
+            return GENERIC_EXIT_DB_ERROR;
+        if (rows > 0)
+        {
+            cout << QString("Exported %1 %2 entries to recordedseek\n")
+                .arg(rows).arg(toString(types[i])).toLocal8Bit().constData();
+        }
+    }
+
+    return GENERIC_EXIT_OK;
+}
+
 void registerMarkupUtils(UtilMap &utilMap)
 {
     utilMap["gencutlist"]             = &CopySkipListToCutList;
@@ -175,6 +199,7 @@ void registerMarkupUtils(UtilMap &utilMap)
     utilMap["getskiplist"]            = &GetSkipList;
     utilMap["setskiplist"]            = &SetSkipList;
     utilMap["clearskiplist"]          = &ClearSkipList;
+    utilMap["exportseektable"]        = &ExportSeekTable;
 }
 
 /* vim: set expandtab tabstop=4 shiftwidth=4: */
@@ -4,7 +4,9 @@ TEMPLATE = subdirs
 
 # Directories
 using_frontend {
-    SUBDIRS += mythavtest mythfrontend mythcommflag
+    SUBDIRS += mythavtest mythprotobench mythcommflagbench
+    SUBDIRS += mythaudiobench
+    SUBDIRS += mythfrontend mythcommflag
     SUBDIRS += mythjobqueue mythlcdserver mythlogserver
     SUBDIRS += mythwelcome mythshutdown mythutil
     SUBDIRS += mythpreviewgen mythmediaserver mythccextractor
@@ -14,6 +16,8 @@ using_frontend {
 using_backend {
     SUBDIRS += mythbackend mythfilldatabase mythtv-setup scripts
     SUBDIRS += mythmetadatalookup
+    # libmythtv only has StreamHandler with one of these
+    using_dvb|using_hdhomerun|using_ceton|using_asi: SUBDIRS += mythrecbench
 }
 
 using_mythtranscode: SUBDIRS += mythtranscode